@@ -3,6 +3,7 @@
 
 #include "Buffer.h"
 #include "DeleteQueue.h"
+#include "BufferReadback.h"
 
 namespace Vulture
 {
@@ -73,6 +74,7 @@ namespace Vulture
 		m_MemoryPropertyFlags = 0;
 		m_MinOffsetAlignment = 1; // Stored only for copies of the buffer
 		m_NoPool = false;
+		m_PersistentlyMapped = false;
 
 		m_Initialized = false;
 	}
@@ -122,7 +124,17 @@ namespace Vulture
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 		// Create the Vulkan buffer and allocate memory for it.
-		Device::CreateBuffer(bufferInfo, m_BufferHandle, *m_Allocation, m_MemoryPropertyFlags, &*m_Pool, m_NoPool, createInfo.MinMemoryAlignment);
+		Device::CreateBuffer(bufferInfo, m_BufferHandle, *m_Allocation, m_MemoryPropertyFlags, &*m_Pool, m_NoPool, createInfo.MinMemoryAlignment, createInfo.Category);
+
+		// Host visible memory stays mapped until the buffer is destroyed, so writes never have to map it again
+		if ((m_MemoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(m_MemoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+		{
+			VL_CORE_RETURN_ASSERT(vmaMapMemory(Device::GetAllocator(), *m_Allocation, &m_Mapped),
+				VK_SUCCESS,
+				"Failed to map buffer!"
+			);
+			m_PersistentlyMapped = true;
+		}
 	}
 
 	/**
@@ -136,8 +148,10 @@ namespace Vulture
 		if (!m_Initialized)
 			return;
 
-		// Unmap the buffer memory if it was mapped.
-		Unmap();
+		// Unmap the buffer memory if it was mapped, persistent mappings included.
+		if (m_Mapped)
+			vmaUnmapMemory(Device::GetAllocator(), *m_Allocation);
+		m_Mapped = nullptr;
 
 		DeleteQueue::TrashBuffer(*this);
 
@@ -253,6 +267,7 @@ namespace Vulture
 		m_MemoryPropertyFlags = std::move(other.m_MemoryPropertyFlags);
 		m_MinOffsetAlignment = std::move(other.m_MinOffsetAlignment); // Stored only for copies of the buffer
 		m_NoPool = std::move(other.m_NoPool);
+		m_PersistentlyMapped = other.m_PersistentlyMapped;
 
 		m_Initialized = other.m_Initialized;
 
@@ -277,6 +292,7 @@ namespace Vulture
 		m_MemoryPropertyFlags = std::move(other.m_MemoryPropertyFlags);
 		m_MinOffsetAlignment = std::move(other.m_MinOffsetAlignment); // Stored only for copies of the buffer
 		m_NoPool = std::move(other.m_NoPool);
+		m_PersistentlyMapped = other.m_PersistentlyMapped;
 
 		m_Initialized = other.m_Initialized;
 
@@ -295,6 +311,7 @@ namespace Vulture
 
 	/**
 	 * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
+	 * Host visible buffers are mapped persistently by Init(), for them this does nothing.
 	 *
 	 * @param size (Optional) - Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
 	 * buffer range.
@@ -308,6 +325,10 @@ namespace Vulture
 		// Check if the buffer is not device local, as device local buffers cannot be mapped.
 		VL_CORE_ASSERT(!(m_MemoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), "Can't map device local buffer!");
 
+		// Persistently mapped buffers are already mapped.
+		if (m_Mapped)
+			return VK_SUCCESS;
+
 		// Map the memory range of the buffer into CPU accessible memory.
 		VkResult result = vmaMapMemory(Device::GetAllocator(), *m_Allocation, &m_Mapped);
 
@@ -315,13 +336,17 @@ namespace Vulture
 	}
 
 	/**
-	 * @brief Unmaps a previously mapped memory range of the buffer.
+	 * @brief Unmaps a previously mapped memory range of the buffer. Persistently mapped buffers stay mapped.
 	 */
 	void Buffer::Unmap()
 	{
 		// Check if the Buffer has been initialized.
 		VL_CORE_ASSERT(m_Initialized, "Buffer Not Initialized!");
 
+		// Persistent mappings are only released in Destroy().
+		if (m_PersistentlyMapped)
+			return;
+
 		// If the buffer is mapped, unmap the memory range.
 		if (m_Mapped)
 		{
@@ -364,22 +389,16 @@ namespace Vulture
 		// If the buffer is device local, use a staging buffer to transfer the data.
 		if (m_MemoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
 		{
-			// Create a staging buffer.
+			// Create a staging buffer, it's mapped by Init.
 			Buffer::CreateInfo info{};
 			info.InstanceSize = size;
 			info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 			info.UsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 			Buffer stagingBuffer(info);
 
-			// Map the staging buffer.
-			stagingBuffer.Map();
-
 			// Write data to the staging buffer.
 			stagingBuffer.WriteToBuffer(data, size, 0, cmd);
 
-			// Unmap the staging buffer.
-			stagingBuffer.Unmap();
-
 			// Copy data from the staging buffer to the device local buffer.
 			Buffer::CopyBuffer(stagingBuffer.GetBuffer(), m_BufferHandle, size, 0, offset, Device::GetGraphicsQueue(), cmd, Device::GetGraphicsCommandPool());
 		}
@@ -414,12 +433,19 @@ namespace Vulture
 		if (size == VK_WHOLE_SIZE)
 			size = m_BufferSize - offset;
 
-		// If the buffer is device local, use a staging buffer to transfer the data.
+		// If the buffer is device local, copy the data into a staging buffer first.
 		if (m_MemoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
 		{
 			VL_CORE_ASSERT((m_UsageFlags & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) != 0, "Can't read from buffer that is DEVICE_LOCAL and wasn't create with USAGE_TRANSFERS_SRC_BIT!");
 
-			// Create a staging buffer.
+			// Waits for this copy only, without draining the queue
+			if (BufferReadback::IsInitialized())
+			{
+				BufferReadback::Read({ { this, outData, size, offset } });
+				return;
+			}
+
+			// Create a staging buffer, it's mapped by Init.
 			Buffer::CreateInfo info{};
 			info.InstanceSize = size;
 			info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
@@ -428,17 +454,11 @@ namespace Vulture
 
 			VkCommandBuffer cmd;
 			Device::BeginSingleTimeCommands(cmd, Device::GetGraphicsCommandPool());
-			Buffer::CopyBuffer(m_BufferHandle, stagingBuffer.GetBuffer(), size, 0, offset, Device::GetGraphicsQueue(), cmd, Device::GetGraphicsCommandPool());
+			Buffer::CopyBuffer(m_BufferHandle, stagingBuffer.GetBuffer(), size, offset, 0, Device::GetGraphicsQueue(), cmd, Device::GetGraphicsCommandPool());
 			Device::EndSingleTimeCommands(cmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool()); // End the command to synch with CPU
 
-			// Map the staging buffer.
-			stagingBuffer.Map();
-
 			// Read data from the staging buffer.
 			stagingBuffer.ReadFromBuffer(outData, size, 0);
-
-			// Unmap the staging buffer.
-			stagingBuffer.Unmap();
 		}
 		else // If the buffer is not device local, read directly to the buffer.
 		{
@@ -448,7 +468,7 @@ namespace Vulture
 			// Calculate the memory offset within the mapped buffer.
 			char* memOffset = reinterpret_cast<char*>(m_Mapped) + offset;
 
-			memcpy(outData, m_Mapped, size);
+			memcpy(outData, memOffset, size);
 		}
 	}
 
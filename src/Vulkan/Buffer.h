@@ -19,6 +19,7 @@ namespace Vulture
 			VkBufferUsageFlags UsageFlags = 0;
 			uint64_t InstanceCount = 1;
 			bool NoPool = false;
+			MemoryCategory Category = MemoryCategory::Auto; // Only used for memory statistics
 
 			operator bool() const
 			{
@@ -93,6 +94,7 @@ namespace Vulture
 		uint64_t m_InstanceCount = 0;
 
 		bool m_NoPool = false;
+		bool m_PersistentlyMapped = false; // Host visible buffers are mapped from Init until Destroy
 
 		bool m_Initialized = false;
 
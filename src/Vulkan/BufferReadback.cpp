@@ -0,0 +1,313 @@
+#include "pch.h"
+#include "BufferReadback.h"
+
+#include "Device.h"
+
+#include <bit>
+
+namespace Vulture
+{
+	BufferReadback::CreateInfo BufferReadback::s_Info;
+
+	void BufferReadback::Init(const CreateInfo& createInfo)
+	{
+		if (s_Initialized)
+			Destroy();
+
+		s_Info = createInfo;
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = Device::FindPhysicalQueueFamilies().GraphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		VL_CORE_RETURN_ASSERT(vkCreateCommandPool(Device::GetDevice(), &poolInfo, nullptr, &s_CommandPool),
+			VK_SUCCESS,
+			"Failed to create readback command pool!"
+		);
+
+		s_Initialized = true;
+	}
+
+	/**
+	 * @brief Waits for every pending batch and completes it, then frees the staging memory.
+	 */
+	void BufferReadback::Destroy()
+	{
+		if (!s_Initialized)
+			return;
+
+		Complete(UINT64_MAX);
+
+		std::unique_lock<std::mutex> lock(s_Mutex);
+		for (VkFence fence : s_FreeFences)
+			vkDestroyFence(Device::GetDevice(), fence, nullptr);
+		s_FreeFences.clear();
+		s_FreeStaging.clear();
+
+		vkDestroyCommandPool(Device::GetDevice(), s_CommandPool, nullptr);
+		s_CommandPool = VK_NULL_HANDLE;
+
+		s_Initialized = false;
+	}
+
+	/**
+	 * @brief Completes every batch that has finished on the GPU, never blocks. Called once per frame.
+	 */
+	void BufferReadback::Update()
+	{
+		if (!s_Initialized)
+			return;
+
+		Complete(0);
+	}
+
+	/**
+	 * @brief Records copies of every request into a single command buffer and submits it.
+	 *
+	 * @param requests - Buffers to read, they have to be created with VK_BUFFER_USAGE_TRANSFER_SRC_BIT.
+	 * @param onComplete - Called after the data was written into the destinations. It runs on the thread that
+	 * completes the batch and must not call Wait().
+	 *
+	 * @return Timeline value of the batch, pass it to Wait() or IsComplete().
+	 */
+	uint64_t BufferReadback::Submit(const std::vector<Request>& requests, const Callback& onComplete)
+	{
+		VL_CORE_ASSERT(s_Initialized, "BufferReadback is not initialized!");
+
+		Scope<Batch> batch = std::make_unique<Batch>();
+		batch->OnComplete = onComplete;
+		batch->Copies.reserve(requests.size());
+
+		VkDeviceSize stagingSize = 0;
+		for (const Request& request : requests)
+		{
+			VL_CORE_ASSERT(request.Source != nullptr && request.Destination != nullptr, "Invalid readback request!");
+			VL_CORE_ASSERT((request.Source->GetUsageFlags() & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) != 0, "Can't read from buffer that wasn't created with USAGE_TRANSFER_SRC_BIT!");
+
+			const VkDeviceSize bufferSize = request.Source->GetBufferSize();
+			const VkDeviceSize size = request.Size == VK_WHOLE_SIZE ? bufferSize - request.Offset : request.Size;
+			VL_CORE_ASSERT(request.Offset + size <= bufferSize, "Data size is larger than buffer size on reading! Offset: {}, Size: {}, Buffer Size: {}", request.Offset, size, bufferSize);
+
+			batch->Copies.push_back({ request.Destination, stagingSize, size });
+			stagingSize = (stagingSize + size + 15) & ~15ull;
+		}
+
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		batch->Staging = AcquireStaging(stagingSize);
+		batch->Fence = AcquireFence();
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = s_CommandPool;
+		allocInfo.commandBufferCount = 1;
+		vkAllocateCommandBuffers(Device::GetDevice(), &allocInfo, &batch->Cmd);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(batch->Cmd, &beginInfo);
+
+		if (!batch->Copies.empty())
+		{
+			// Writes of earlier submissions have to be visible to the copies
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(batch->Cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+			for (size_t i = 0; i < requests.size(); i++)
+			{
+				const Copy& copy = batch->Copies[i];
+				if (copy.Size == 0)
+					continue;
+
+				VkBufferCopy region{};
+				region.srcOffset = requests[i].Offset;
+				region.dstOffset = copy.StagingOffset;
+				region.size = copy.Size;
+				vkCmdCopyBuffer(batch->Cmd, requests[i].Source->GetBuffer(), batch->Staging->GetBuffer(), 1, &region);
+			}
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(batch->Cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		vkEndCommandBuffer(batch->Cmd);
+
+		// Submitted while holding the lock, so batches reach the queue in the order of their values
+		batch->Value = s_NextValue++;
+		{
+			std::unique_lock<std::mutex> queueLock(Device::GetGraphicsQueueMutex());
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch->Cmd;
+			VL_CORE_RETURN_ASSERT(vkQueueSubmit(Device::GetGraphicsQueue(), 1, &submitInfo, batch->Fence),
+				VK_SUCCESS,
+				"Failed to submit readback!"
+			);
+		}
+
+		const uint64_t value = batch->Value;
+		s_Pending.push_back(std::move(batch));
+
+		return value;
+	}
+
+	/**
+	 * @brief Submits the requests, the future is ready once the batch is completed by Update() or Wait(). Waiting on
+	 * the future on the thread that calls Update() never finishes, use Read() there instead.
+	 */
+	std::future<void> BufferReadback::ReadAsync(const std::vector<Request>& requests)
+	{
+		std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+		std::future<void> future = promise->get_future();
+
+		Submit(requests, [promise]() { promise->set_value(); });
+
+		return future;
+	}
+
+	/**
+	 * @brief Reads every request in one submission and waits for it. Only this batch and the ones before it are
+	 * waited for, other work keeps being submitted to the queue in the meantime.
+	 */
+	void BufferReadback::Read(const std::vector<Request>& requests)
+	{
+		Wait(Submit(requests));
+	}
+
+	/**
+	 * @brief Blocks until the batch with the value and every batch before it is completed.
+	 */
+	void BufferReadback::Wait(uint64_t value)
+	{
+		if (IsComplete(value))
+			return;
+
+		Complete(value);
+	}
+
+	/**
+	 * @brief Completes pending batches in order. Batches up to waitValue are waited for, later ones only if they
+	 * already finished.
+	 */
+	void BufferReadback::Complete(uint64_t waitValue)
+	{
+		std::unique_lock<std::mutex> completeLock(s_CompleteMutex);
+		while (true)
+		{
+			Scope<Batch> batch;
+			{
+				std::unique_lock<std::mutex> lock(s_Mutex);
+				if (s_Pending.empty())
+					break;
+
+				Batch& front = *s_Pending.front();
+				if (front.Value > waitValue && vkGetFenceStatus(Device::GetDevice(), front.Fence) != VK_SUCCESS)
+					break;
+
+				batch = std::move(s_Pending.front());
+				s_Pending.erase(s_Pending.begin());
+			}
+
+			vkWaitForFences(Device::GetDevice(), 1, &batch->Fence, VK_TRUE, UINT64_MAX);
+
+			for (const Copy& copy : batch->Copies)
+			{
+				if (copy.Size != 0)
+					memcpy(copy.Destination, (const uint8_t*)batch->Staging->GetMappedMemory() + copy.StagingOffset, copy.Size);
+			}
+
+			if (batch->OnComplete)
+				batch->OnComplete();
+
+			s_CompletedValue.store(batch->Value, std::memory_order_release);
+
+			std::unique_lock<std::mutex> lock(s_Mutex);
+			Recycle(*batch);
+		}
+	}
+
+	/**
+	 * @brief Returns the smallest cached staging buffer that fits, or a new one. Called with s_Mutex held.
+	 */
+	Scope<Buffer> BufferReadback::AcquireStaging(VkDeviceSize size)
+	{
+		if (size == 0)
+			return nullptr;
+
+		auto best = s_FreeStaging.end();
+		for (auto it = s_FreeStaging.begin(); it != s_FreeStaging.end(); it++)
+		{
+			if ((*it)->GetBufferSize() >= size && (best == s_FreeStaging.end() || (*it)->GetBufferSize() < (*best)->GetBufferSize()))
+				best = it;
+		}
+
+		if (best != s_FreeStaging.end())
+		{
+			Scope<Buffer> staging = std::move(*best);
+			s_FreeStaging.erase(best);
+			return staging;
+		}
+
+		// Host visible buffers are persistently mapped by Init
+		Buffer::CreateInfo info{};
+		info.InstanceSize = std::bit_ceil(std::max(size, s_Info.MinStagingSize));
+		info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		info.UsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		info.Category = MemoryCategory::Staging;
+
+		return std::make_unique<Buffer>(info);
+	}
+
+	VkFence BufferReadback::AcquireFence()
+	{
+		if (!s_FreeFences.empty())
+		{
+			VkFence fence = s_FreeFences.back();
+			s_FreeFences.pop_back();
+			return fence;
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VkFence fence;
+		VL_CORE_RETURN_ASSERT(vkCreateFence(Device::GetDevice(), &fenceInfo, nullptr, &fence),
+			VK_SUCCESS,
+			"Failed to create readback fence!"
+		);
+
+		return fence;
+	}
+
+	/**
+	 * @brief Returns resources of a completed batch for reuse. Called with s_Mutex held.
+	 */
+	void BufferReadback::Recycle(Batch& batch)
+	{
+		vkFreeCommandBuffers(Device::GetDevice(), s_CommandPool, 1, &batch.Cmd);
+
+		vkResetFences(Device::GetDevice(), 1, &batch.Fence);
+		s_FreeFences.push_back(batch.Fence);
+
+		if (batch.Staging)
+		{
+			// The smallest buffer is dropped when the cache is full, large reads tend to repeat
+			s_FreeStaging.push_back(std::move(batch.Staging));
+			if (s_FreeStaging.size() > s_Info.MaxCachedStagingBuffers)
+			{
+				auto smallest = std::min_element(s_FreeStaging.begin(), s_FreeStaging.end(), [](const Scope<Buffer>& a, const Scope<Buffer>& b) { return a->GetBufferSize() < b->GetBufferSize(); });
+				s_FreeStaging.erase(smallest);
+			}
+		}
+	}
+
+}
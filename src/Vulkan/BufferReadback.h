@@ -0,0 +1,93 @@
+#pragma once
+#include "pch.h"
+#include "Utility/Utility.h"
+
+#include "Buffer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <mutex>
+#include <future>
+
+namespace Vulture
+{
+	// Reads buffers back from the GPU without draining the queue. Copies of a batch are recorded into one command
+	// buffer that writes into a persistently mapped staging buffer, staging buffers are reused between batches.
+	//
+	// Every submitted batch gets the next value on a timeline. Batches are completed in order, either by Update()
+	// once their fence signaled or by Wait(), which blocks on the fence of that batch only. Completing a batch copies
+	// its data into the destinations and then calls its callback, on the thread that completed it.
+	class BufferReadback
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32_t MaxCachedStagingBuffers = 8;
+			VkDeviceSize MinStagingSize = 1024 * 1024;
+		};
+
+		struct Request
+		{
+			Buffer* Source = nullptr;
+			void* Destination = nullptr; // Has to stay valid until the batch is completed
+			VkDeviceSize Size = VK_WHOLE_SIZE;
+			VkDeviceSize Offset = 0;
+		};
+
+		using Callback = std::function<void()>;
+
+		static void Init(const CreateInfo& createInfo);
+		static void Destroy();
+		static void Update();
+
+		static uint64_t Submit(const std::vector<Request>& requests, const Callback& onComplete = {});
+		static std::future<void> ReadAsync(const std::vector<Request>& requests);
+		static void Read(const std::vector<Request>& requests);
+
+		static void Wait(uint64_t value);
+		static inline bool IsComplete(uint64_t value) { return s_CompletedValue.load(std::memory_order_acquire) >= value; }
+		static inline uint64_t GetCompletedValue() { return s_CompletedValue.load(std::memory_order_acquire); }
+
+		static inline bool IsInitialized() { return s_Initialized; }
+
+		BufferReadback() = delete;
+		~BufferReadback() = delete;
+
+	private:
+		struct Copy
+		{
+			void* Destination;
+			VkDeviceSize StagingOffset;
+			VkDeviceSize Size;
+		};
+
+		struct Batch
+		{
+			uint64_t Value = 0;
+			VkCommandBuffer Cmd = VK_NULL_HANDLE;
+			VkFence Fence = VK_NULL_HANDLE;
+			Scope<Buffer> Staging;
+			std::vector<Copy> Copies;
+			Callback OnComplete;
+		};
+
+		static void Complete(uint64_t waitValue);
+		static Scope<Buffer> AcquireStaging(VkDeviceSize size);
+		static VkFence AcquireFence();
+		static void Recycle(Batch& batch);
+
+		inline static bool s_Initialized = false;
+		static CreateInfo s_Info;
+
+		inline static std::mutex s_Mutex; // Guards everything below, the command pool included
+		inline static std::mutex s_CompleteMutex; // Held while batches are completed, so that they finish in order
+		inline static VkCommandPool s_CommandPool = VK_NULL_HANDLE;
+		inline static std::vector<Scope<Batch>> s_Pending; // Ordered by value
+		inline static std::vector<Scope<Buffer>> s_FreeStaging;
+		inline static std::vector<VkFence> s_FreeFences;
+		inline static uint64_t s_NextValue = 1;
+		inline static std::atomic<uint64_t> s_CompletedValue = 0;
+	};
+
+}
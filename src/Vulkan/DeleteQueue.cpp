@@ -73,9 +73,17 @@ namespace Vulture
 					vkDestroyImageView(Device::GetDevice(), view, nullptr);
 				}
 
-				vmaDestroyImage(Device::GetAllocator(), s_ImageQueue[i].first.Handle, *s_ImageQueue[i].first.Allocation);
-
-				delete s_ImageQueue[i].first.Allocation;
+				if (s_ImageQueue[i].first.Allocation != nullptr)
+				{
+					MemoryService::Untrack(*s_ImageQueue[i].first.Allocation);
+					vmaDestroyImage(Device::GetAllocator(), s_ImageQueue[i].first.Handle, *s_ImageQueue[i].first.Allocation);
+					delete s_ImageQueue[i].first.Allocation;
+				}
+				else
+				{
+					// Aliased image, the memory belongs to someone else
+					vkDestroyImage(Device::GetDevice(), s_ImageQueue[i].first.Handle, nullptr);
+				}
 
 				s_ImageQueue.erase(s_ImageQueue.begin() + i);
 				i = -1; // Go back to the beginning of the vector
@@ -86,6 +94,23 @@ namespace Vulture
 			}
 		}
 
+		// Image Views
+		for (int i = 0; i < s_ImageViewQueue.size(); i++)
+		{
+			auto& view = s_ImageViewQueue[i];
+			if (view.second == 0)
+			{
+				vkDestroyImageView(Device::GetDevice(), view.first, nullptr);
+
+				s_ImageViewQueue.erase(s_ImageViewQueue.begin() + i);
+				i = -1; // Go back to the beginning of the vector
+			}
+			else
+			{
+				view.second--;
+			}
+		}
+
 		// Buffers
 		for (int i = 0; i < s_BufferQueue.size(); i++)
 		{
@@ -93,6 +118,7 @@ namespace Vulture
 			if (buf.second == 0)
 			{
 				// Destroy the Vulkan buffer and deallocate the buffer memory.
+				MemoryService::Untrack(*buf.first.Allocation);
 				vmaDestroyBuffer(Device::GetAllocator(), buf.first.Handle, *buf.first.Allocation);
 
 				if (buf.first.Pool != nullptr)
@@ -172,6 +198,26 @@ namespace Vulture
 		s_Mutex.unlock();
 	}
 
+	// The memory belongs to someone else, e.g. the old handle of a moved image
+	void DeleteQueue::TrashImage(VkImage image, const std::vector<VkImageView>& views)
+	{
+		ImageInfo info{};
+		info.Handle = image;
+		info.Views = views;
+		info.Allocation = nullptr;
+
+		s_Mutex.lock();
+		s_ImageQueue.emplace_back(std::make_pair(info, s_FramesInFlight));
+		s_Mutex.unlock();
+	}
+
+	void DeleteQueue::TrashImageView(VkImageView view)
+	{
+		s_Mutex.lock();
+		s_ImageViewQueue.emplace_back(std::make_pair(view, s_FramesInFlight));
+		s_Mutex.unlock();
+	}
+
 	void DeleteQueue::TrashBuffer(Buffer& buffer)
 	{
 		BufferInfo info{};
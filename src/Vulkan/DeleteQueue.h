@@ -28,6 +28,8 @@ namespace Vulture
 
 		static void TrashPipeline(const Pipeline& pipeline);
 		static void TrashImage(Image& image);
+		static void TrashImage(VkImage image, const std::vector<VkImageView>& views = {});
+		static void TrashImageView(VkImageView view);
 		static void TrashBuffer(Buffer& buffer);
 		static void TrashDescriptorSetLayout(DescriptorSetLayout& set);
 		static void TrashRenderPass(VkRenderPass renderPass);
@@ -63,6 +65,7 @@ namespace Vulture
 
 		inline static std::vector<std::pair<PipelineInfo, uint32_t>> s_PipelineQueue;
 		inline static std::vector<std::pair<ImageInfo, uint32_t>> s_ImageQueue;
+		inline static std::vector<std::pair<VkImageView, uint32_t>> s_ImageViewQueue;
 		inline static std::vector<std::pair<BufferInfo, uint32_t>> s_BufferQueue;
 		inline static std::vector<std::pair<DescriptorInfo, uint32_t>> s_SetQueue;
 		inline static std::vector<std::pair<VkRenderPass, uint32_t>> s_RenderPassQueue;
@@ -18,7 +18,9 @@ namespace Vulture
 	std::vector<const char*> Device::s_DeviceExtensions;
 	std::vector<Extension> Device::s_OptionalExtensions = {
 		{VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME, false},
-		{VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME, false}
+		{VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME, false},
+		{VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, false},
+		{VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, false}
 	};
 
 	/*
@@ -82,6 +84,16 @@ namespace Vulture
 		s_UseMemoryAddressFeature = createInfo.UseMemoryAddress;
 
 		s_DeviceExtensions = createInfo.DeviceExtensions;
+
+		// Nothing is presented without a window, the swapchain extension may not even be available (e.g. software ICDs)
+		if (IsHeadless())
+		{
+			auto swapchainExtension = std::find_if(s_DeviceExtensions.begin(), s_DeviceExtensions.end(), [](const char* name) { return strcmp(name, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; });
+			if (swapchainExtension != s_DeviceExtensions.end())
+				s_DeviceExtensions.erase(swapchainExtension);
+
+			VL_CORE_INFO("Creating headless device");
+		}
 		for (int i = 0; i < createInfo.OptionalExtensions.size(); i++)
 		{
 			s_OptionalExtensions.emplace_back(Extension{ createInfo.OptionalExtensions[i], false });
@@ -98,7 +110,8 @@ namespace Vulture
 		SetupDebugMessenger();
 
 		// Create rendering surface
-		CreateSurface();
+		if (!IsHeadless())
+			CreateSurface();
 
 		// Choose suitable physical device
 		PickPhysicalDevice();
@@ -150,7 +163,11 @@ namespace Vulture
 		if (s_EnableValidationLayers) { DestroyDebugUtilsMessengerEXT(s_Instance, s_DebugMessenger, nullptr); }
 
 		// Destroy rendering surface
-		vkDestroySurfaceKHR(s_Instance, s_Surface, nullptr);
+		if (s_Surface != VK_NULL_HANDLE)
+		{
+			vkDestroySurfaceKHR(s_Instance, s_Surface, nullptr);
+			s_Surface = VK_NULL_HANDLE;
+		}
 		// Destroy Vulkan instance
 		vkDestroyInstance(s_Instance, nullptr);
 		s_Instance = VK_NULL_HANDLE;
@@ -209,13 +226,18 @@ namespace Vulture
 	 */
 	std::vector<const char*> Device::GetRequiredGlfwExtensions()
 	{
-		// Get the count and list of required GLFW extensions
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
 
-		// Convert the array of extension names to a vector
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		// Get the count and list of required GLFW extensions, headless devices don't need any surface extensions
+		if (!IsHeadless())
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+			// Convert the array of extension names to a vector
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		// If validation layers are enabled, add the debug utils extension to the list
 		if (s_EnableValidationLayers) 
@@ -392,9 +414,13 @@ namespace Vulture
 				indices.ComputeFamilyHasValue = true;
 			}
 
-			// Check if the queue family supports presentation to the associated surface
+			// Check if the queue family supports presentation to the associated surface, without a surface
+			// the graphics queue takes its place
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, s_Surface, &presentSupport);
+			if (IsHeadless())
+				presentSupport = indices.GraphicsFamilyHasValue && indices.GraphicsFamily == (uint32_t)i;
+			else
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, s_Surface, &presentSupport);
 			if (presentSupport)
 			{
 				indices.PresentFamily = i;
@@ -425,20 +451,29 @@ namespace Vulture
 		allocatorInfo.instance = s_Instance;
 		allocatorInfo.physicalDevice = s_PhysicalDevice;
 		allocatorInfo.device = s_Device;
+		allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2; // Budget queries use the core vkGetPhysicalDeviceMemoryProperties2
 
-		// Check if the memory priority extension is present
+		// Check if the memory priority and budget extensions are present
 		for (Vulture::Extension& ext : s_OptionalExtensions)
 		{
 			if (std::string(ext.Name) == std::string(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME))
 				if (ext.supported)
 					allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
+			if (std::string(ext.Name) == std::string(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+				s_MemoryBudgetSupported = ext.supported;
 		}
 		for (auto ext : s_DeviceExtensions)
 		{
 			if (std::string(ext) == std::string(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME))
 				allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
+			if (std::string(ext) == std::string(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+				s_MemoryBudgetSupported = true;
 		}
 
+		// Without the extension VMA estimates budgets from heap sizes
+		if (s_MemoryBudgetSupported)
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
 		// Enable buffer device address feature
 		if (s_UseMemoryAddressFeature)
 			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
@@ -565,8 +600,9 @@ namespace Vulture
 	 * @param alloc - Reference to store the VmaAllocation for the buffer's memory.
 	 * @param customFlags - Custom memory property flags for the buffer's memory (optional).
 	 * @param noPool - Flag indicating whether to create a dedicated memory pool for the buffer (optional).
+	 * @param category - Category the allocation is counted under in MemoryService, picked from the usage by default.
 	 */
-	void Device::CreateBuffer(VkBufferCreateInfo& createInfo, VkBuffer& buffer, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags, VmaPool* poolOut, bool noPool, VkDeviceSize minAlignment)
+	void Device::CreateBuffer(VkBufferCreateInfo& createInfo, VkBuffer& buffer, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags, VmaPool* poolOut, bool noPool, VkDeviceSize minAlignment, MemoryCategory category)
 	{
 		// Assert that the device has been initialized before creating the buffer
 		VL_CORE_ASSERT(s_Initialized, "Device not Initialized!");
@@ -591,6 +627,7 @@ namespace Vulture
 			allocCreateInfo.pool = *poolOut;
 
 			VkResult res = vmaCreateBufferWithAlignment(s_Allocator, &createInfo, &allocCreateInfo, minAlignment, &buffer, &alloc, nullptr);
+			MemoryService::Track(alloc, MemoryService::ResolveCategory(createInfo, customFlags, category));
 			return;
 		}
 
@@ -639,6 +676,8 @@ namespace Vulture
 				}
 			}
 		}
+
+		MemoryService::Track(alloc, MemoryService::ResolveCategory(createInfo, customFlags, category));
 	}
 
 	/**
@@ -648,8 +687,9 @@ namespace Vulture
 	 * @param image - Reference to store the created Vulkan image.
 	 * @param alloc - Reference to store the VmaAllocation for the image's memory.
 	 * @param customFlags - Custom memory property flags for the image's memory (optional).
+	 * @param category - Category the allocation is counted under in MemoryService, picked from the usage by default.
 	 */
-	void Device::CreateImage(VkImageCreateInfo& createInfo, VkImage& image, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags)
+	void Device::CreateImage(VkImageCreateInfo& createInfo, VkImage& image, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags, MemoryCategory category)
 	{
 		// Assert that the device has been initialized before creating the image
 		VL_CORE_ASSERT(s_Initialized, "Device not Initialized!");
@@ -658,6 +698,7 @@ namespace Vulture
 		uint32_t memoryIndex = 0;
 		FindMemoryTypeIndexForImage(createInfo, memoryIndex, customFlags);
 
+		std::unique_lock<std::mutex> poolsLock(s_ImagePoolsMutex);
 		auto it = s_ImagePools.find(memoryIndex);
 		if (it != s_ImagePools.end())
 		{
@@ -698,6 +739,9 @@ namespace Vulture
 				VL_CORE_ASSERT(false, "Couldn't create an image!");
 			}
 		}
+		poolsLock.unlock();
+
+		MemoryService::Track(alloc, MemoryService::ResolveCategory(createInfo, category));
 
 		// // Assert that the device has been initialized before creating the image
 		// VL_CORE_ASSERT(s_Initialized, "Device not Initialized!");
@@ -718,6 +762,20 @@ namespace Vulture
 		// );
 	}
 
+	/**
+	 * @brief Returns the pools images are allocated from, one per memory type.
+	 */
+	std::vector<VmaPool> Device::GetImagePools()
+	{
+		std::unique_lock<std::mutex> lock(s_ImagePoolsMutex);
+
+		std::vector<VmaPool> pools;
+		for (auto& [memoryIndex, pool] : s_ImagePools)
+			pools.push_back(pool);
+
+		return pools;
+	}
+
 	/**
 	 * @brief Sets a debug name for a Vulkan object, allowing for easier identification
 	 * and debugging of objects in Vulkan applications. It is typically used for objects like
@@ -839,8 +897,8 @@ namespace Vulture
 		bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
 		// Check if the swap chain is adequate (availability of formats and present modes)
-		bool swapChainAdequate = false;
-		if (extensionsSupported) 
+		bool swapChainAdequate = IsHeadless();
+		if (extensionsSupported && !IsHeadless())
 		{
 			SwapchainSupportDetails swapChainSupport = QuerySwapchainSupport(device);
 			swapChainAdequate = !swapChainSupport.Formats.empty() && !swapChainSupport.PresentModes.empty();
@@ -867,8 +925,9 @@ namespace Vulture
 		std::vector<VkPhysicalDevice> devices(deviceCount);
 		vkEnumeratePhysicalDevices(s_Instance, &deviceCount, devices.data());
 
-		// Flag to track if a discrete GPU is found
+		// Flags to track the best device type found so far
 		bool discreteFound = false;
+		bool integratedFound = false;
 
 		// Iterate through all physical devices to find the most suitable one
 		for (const auto& device : devices) 
@@ -886,6 +945,12 @@ namespace Vulture
 					discreteFound = true;
 				}
 				else if (properties.deviceType == VkPhysicalDeviceType::VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU && !discreteFound)
+				{
+					s_PhysicalDevice = device;
+					integratedFound = true;
+				}
+				// Software and virtual devices (e.g. lavapipe on CI machines) only when there's no real GPU
+				else if (!discreteFound && !integratedFound && s_PhysicalDevice == VK_NULL_HANDLE)
 				{
 					s_PhysicalDevice = device;
 				}
@@ -943,6 +1008,11 @@ namespace Vulture
 			if (extension.supported)
 				extensions.push_back(extension.Name);
 
+		// The GPU profiler maps timestamps onto the CPU clock with it, without stalling the queue
+		for (const char* extension : extensions)
+			if (strcmp(extension, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0)
+				s_CalibratedTimestampsSupported = true;
+
 		// Create device creation information
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -954,6 +1024,31 @@ namespace Vulture
 		s_Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
 		createInfo.pNext = &s_Features;
 
+		// Block compressed textures are cooked at import time, enable them whenever the device supports it
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures(s_PhysicalDevice, &supportedFeatures);
+		if (supportedFeatures.textureCompressionBC)
+			s_Features.features.textureCompressionBC = VK_TRUE;
+
+		// Batched scene rendering submits whole command arrays in one indirect draw when these are available
+		if (supportedFeatures.multiDrawIndirect)
+			s_Features.features.multiDrawIndirect = VK_TRUE;
+
+		VkPhysicalDeviceVulkan12Features supportedFeatures12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+		VkPhysicalDeviceFeatures2 supportedFeatures2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+		supportedFeatures2.pNext = &supportedFeatures12;
+		vkGetPhysicalDeviceFeatures2(s_PhysicalDevice, &supportedFeatures2);
+
+		// Vulkan 1.2 features can only be enabled through the struct already chained by the application
+		for (VkBaseOutStructure* feature = (VkBaseOutStructure*)s_Features.pNext; feature != nullptr; feature = feature->pNext)
+		{
+			if (feature->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES && supportedFeatures12.drawIndirectCount)
+			{
+				((VkPhysicalDeviceVulkan12Features*)feature)->drawIndirectCount = VK_TRUE;
+				s_DrawIndirectCountSupported = true;
+			}
+		}
+
 		// Enable validation layers if required
 		if (s_EnableValidationLayers)
 		{
@@ -1040,7 +1135,9 @@ namespace Vulture
 	SwapchainSupportDetails Device::QuerySwapchainSupport(VkPhysicalDevice device)
 	{
 		// Initialize the details structure
-		SwapchainSupportDetails details;
+		SwapchainSupportDetails details{};
+		if (s_Surface == VK_NULL_HANDLE)
+			return details;
 
 		// Retrieve surface capabilities
 		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, s_Surface, &details.Capabilities);
@@ -1301,6 +1398,9 @@ namespace Vulture
 	VkQueue Device::s_ComputeQueue = {};
 	std::mutex Device::s_ComputeQueueMutex;
 	bool Device::s_UseRayTracing;
+	bool Device::s_DrawIndirectCountSupported = false;
+	bool Device::s_MemoryBudgetSupported = false;
+	bool Device::s_CalibratedTimestampsSupported = false;
 	bool Device::s_Initialized = false;
 
 	VkPhysicalDeviceRayTracingPipelinePropertiesKHR Device::s_RayTracingProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR };
@@ -1482,4 +1582,22 @@ namespace Vulture
 		else { VL_CORE_ASSERT(false, "VK_ERROR_EXTENSION_NOT_PRESENT"); }
 	}
 
+	VkResult Device::vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(VkPhysicalDevice physicalDevice, uint32_t* pTimeDomainCount, VkTimeDomainEXT* pTimeDomains)
+	{
+		VL_CORE_ASSERT(s_Initialized, "Device not Initialized!");
+
+		static auto func = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(Device::GetInstance(), "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+		if (func != nullptr) { return func(physicalDevice, pTimeDomainCount, pTimeDomains); }
+		else { VL_CORE_ASSERT(false, "VK_ERROR_EXTENSION_NOT_PRESENT"); return VK_RESULT_MAX_ENUM; }
+	}
+
+	VkResult Device::vkGetCalibratedTimestampsEXT(VkDevice device, uint32_t timestampCount, const VkCalibratedTimestampInfoEXT* pTimestampInfos, uint64_t* pTimestamps, uint64_t* pMaxDeviation)
+	{
+		VL_CORE_ASSERT(s_Initialized, "Device not Initialized!");
+
+		static auto func = (PFN_vkGetCalibratedTimestampsEXT)vkGetInstanceProcAddr(Device::GetInstance(), "vkGetCalibratedTimestampsEXT");
+		if (func != nullptr) { return func(device, timestampCount, pTimestampInfos, pTimestamps, pMaxDeviation); }
+		else { VL_CORE_ASSERT(false, "VK_ERROR_EXTENSION_NOT_PRESENT"); return VK_RESULT_MAX_ENUM; }
+	}
+
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "pch.h"
 
 #include "Window.h"
+#include "MemoryService.h"
 #include "Utility/Utility.h"
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
@@ -47,7 +48,7 @@ namespace Vulture
 	public:
 		struct CreateInfo
 		{
-			Window* Window = nullptr;
+			Window* Window = nullptr; // Null creates a headless device
 			std::vector<const char*> DeviceExtensions;
 			std::vector<const char*> OptionalExtensions;
 			VkPhysicalDeviceFeatures2 Features = {};
@@ -84,6 +85,9 @@ namespace Vulture
 
 		static inline bool IsInitialized() { return s_Initialized; }
 
+		// Created without a window, there is no surface and nothing can be presented
+		static inline bool IsHeadless() { return s_Window == nullptr; }
+
 		static inline VkPhysicalDeviceProperties2 GetDeviceProperties() { return s_Properties; }
 		static inline VkPhysicalDeviceRayTracingPipelinePropertiesKHR GetRayTracingProperties() { return s_RayTracingProperties; }
 		static VkSampleCountFlagBits GetMaxSampleCount();
@@ -94,8 +98,9 @@ namespace Vulture
 		static void BeginSingleTimeCommands(VkCommandBuffer& buffer, VkCommandPool pool);
 		static uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
-		static void CreateBuffer(VkBufferCreateInfo& createInfo, VkBuffer& buffer, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags = 0, VmaPool* poolOut = nullptr, bool noPool = false, VkDeviceSize minAlignment = 1);
-		static void CreateImage(VkImageCreateInfo& createInfo, VkImage& image, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags = 0);
+		static void CreateBuffer(VkBufferCreateInfo& createInfo, VkBuffer& buffer, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags = 0, VmaPool* poolOut = nullptr, bool noPool = false, VkDeviceSize minAlignment = 1, MemoryCategory category = MemoryCategory::Auto);
+		static void CreateImage(VkImageCreateInfo& createInfo, VkImage& image, VmaAllocation& alloc, VkMemoryPropertyFlags customFlags = 0, MemoryCategory category = MemoryCategory::Auto);
+		static std::vector<VmaPool> GetImagePools();
 
 		static void SetObjectName(VkObjectType type, uint64_t handle, const char* name);
 		static void BeginLabel(VkCommandBuffer cmd, const char* name, glm::vec4 color);
@@ -115,6 +120,12 @@ namespace Vulture
 		}
 
 		static bool inline UseRayTracing() { return s_UseRayTracing; }
+		static bool inline UseMemoryAddress() { return s_UseMemoryAddressFeature; }
+		static bool inline IsTextureCompressionBCSupported() { return s_Features.features.textureCompressionBC == VK_TRUE; }
+		static bool inline IsMultiDrawIndirectSupported() { return s_Features.features.multiDrawIndirect == VK_TRUE; }
+		static bool inline IsDrawIndirectCountSupported() { return s_DrawIndirectCountSupported; }
+		static bool inline IsMemoryBudgetSupported() { return s_MemoryBudgetSupported; }
+		static bool inline IsCalibratedTimestampsSupported() { return s_CalibratedTimestampsSupported; }
 	private:
 		Device() {} // make constructor private
 		static bool s_Initialized;
@@ -149,6 +160,7 @@ namespace Vulture
 		static VmaAllocator s_Allocator;
 		static std::unordered_map<uint32_t, VmaPool> s_Pools;
 		static inline std::unordered_map<uint32_t, VmaPool> s_ImagePools;
+		static inline std::mutex s_ImagePoolsMutex; // Images are created on loader threads while the memory service reads the pools
 		static VkPhysicalDeviceProperties2 s_Properties;
 		static VkSampleCountFlagBits s_MaxSampleCount;
 		static VkPhysicalDeviceFeatures2 s_Features;
@@ -170,6 +182,9 @@ namespace Vulture
 		static std::unordered_map<std::thread::id, CommandPool> s_CommandPools;
 
 		static bool s_UseRayTracing;
+		static bool s_DrawIndirectCountSupported;
+		static bool s_MemoryBudgetSupported;
+		static bool s_CalibratedTimestampsSupported;
 		static std::vector<const char*> s_ValidationLayers;
 		static std::vector<const char*> s_DeviceExtensions;
 		static std::vector<Extension> s_OptionalExtensions;
@@ -205,5 +220,7 @@ namespace Vulture
 		static void vkCmdBeginDebugUtilsLabelEXT(VkCommandBuffer commandBuffer, const VkDebugUtilsLabelEXT* pLabelInfo);
 		static void vkCmdBeginRenderingKHR(VkCommandBuffer commandBuffer, const VkRenderingInfo* pRenderingInfo);
 		static void vkCmdEndRenderingKHR(VkCommandBuffer commandBuffer);
+		static VkResult vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(VkPhysicalDevice physicalDevice, uint32_t* pTimeDomainCount, VkTimeDomainEXT* pTimeDomains);
+		static VkResult vkGetCalibratedTimestampsEXT(VkDevice device, uint32_t timestampCount, const VkCalibratedTimestampInfoEXT* pTimestampInfos, uint64_t* pTimestamps, uint64_t* pMaxDeviation);
 	};
 }
\ No newline at end of file
@@ -11,6 +11,11 @@
 #include "Vulture/Math/Defines.h"
 #include "DeleteQueue.h"
 
+#if defined(_M_X64) || defined(__SSE2__)
+#define VL_ENV_ACCEL_SSE
+#include <immintrin.h>
+#endif
+
 namespace Vulture
 {
 	void Image::Init(const CreateInfo& createInfo)
@@ -21,30 +26,23 @@ namespace Vulture
 		VL_CORE_ASSERT(createInfo, "Incorectly initialized image create info! Values");
 		m_Usage = createInfo.Usage;
 		m_MemoryProperties = createInfo.Properties;
-		m_Allocation = new VmaAllocation();
+		m_Allocation = createInfo.AliasAllocation == VK_NULL_HANDLE ? new VmaAllocation() : nullptr;
 		m_Size.width = createInfo.Width;
 		m_Size.height = createInfo.Height;
 
 		m_MipLevels = createInfo.MipMapCount + 1;
-		m_MipLevels = glm::min((int)m_MipLevels, (int)glm::floor(glm::log2((float)glm::max(createInfo.Width, createInfo.Height))));
+		m_MipLevels = glm::min((int)m_MipLevels, (int)glm::floor(glm::log2((float)glm::max(createInfo.Width, createInfo.Height))) + 1); // Full chain ends at 1x1
 		m_MipLevels = glm::max((int)m_MipLevels, 1);
+		m_BaseMipLevel = glm::min(createInfo.BaseMipLevel, m_MipLevels - 1);
 		m_Format = createInfo.Format;
 		m_Aspect = createInfo.Aspect;
+		m_Swizzle = createInfo.Swizzle;
+		m_Tiling = createInfo.Tiling;
+		m_LayerCount = createInfo.LayerCount;
+		m_Type = createInfo.Type;
 
 		CreateImage(createInfo);
-
-		if (createInfo.Type == ImageType::Cubemap)
-		{
-			CreateImageView(createInfo.Format, createInfo.Aspect, createInfo.LayerCount, VK_IMAGE_VIEW_TYPE_CUBE);
-		}
-		else if (createInfo.LayerCount > 1 || createInfo.Type == ImageType::Image2DArray)
-		{
-			CreateImageView(createInfo.Format, createInfo.Aspect, createInfo.LayerCount, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
-		}
-		else
-		{
-			CreateImageView(createInfo.Format, createInfo.Aspect, createInfo.LayerCount, VK_IMAGE_VIEW_TYPE_2D);
-		}
+		CreateImageViews();
 
 		if (std::string(createInfo.DebugName) != std::string())
 		{
@@ -54,7 +52,7 @@ namespace Vulture
 		if (createInfo.Data != nullptr)
 		{
 			if (createInfo.HDR)
-				CreateHDRSamplingBuffer(createInfo.Data);
+				CreateHDRSamplingBuffer(createInfo.Data, createInfo.EnvAccelCachePath);
 			WritePixels(createInfo.Data);
 
 			GenerateMipmaps();
@@ -68,6 +66,13 @@ namespace Vulture
 		if (!m_Initialized)
 			return;
 
+		if (m_Allocation != nullptr)
+			MemoryService::ClearMoveHandler(*m_Allocation);
+
+		// The copy's memory is released by the memory service
+		if (m_MovedImage != VK_NULL_HANDLE)
+			DeleteQueue::TrashImage(m_MovedImage);
+
 		DeleteQueue::TrashImage(*this);
 
 		if (m_ImportanceSmplAccel.IsInitialized())
@@ -109,6 +114,15 @@ namespace Vulture
 		m_Allocation = std::move(other.m_Allocation);
 		m_Size = std::move(other.m_Size);
 		m_MipLevels = std::move(other.m_MipLevels);
+		m_Swizzle = std::move(other.m_Swizzle);
+		m_BaseMipLevel = std::move(other.m_BaseMipLevel);
+
+		// A move by defragmentation may be in progress, its handler has to reach this object from now on
+		m_MovedImage = std::move(other.m_MovedImage);
+		m_MoveCallbacks = std::move(other.m_MoveCallbacks);
+		m_Movable = std::move(other.m_Movable);
+		if (m_Movable)
+			RegisterMoveHandler();
 
 		other.Reset();
 	}
@@ -135,6 +149,15 @@ namespace Vulture
 		m_Allocation = std::move(other.m_Allocation);
 		m_Size = std::move(other.m_Size);
 		m_MipLevels = std::move(other.m_MipLevels);
+		m_Swizzle = std::move(other.m_Swizzle);
+		m_BaseMipLevel = std::move(other.m_BaseMipLevel);
+
+		// A move by defragmentation may be in progress, its handler has to reach this object from now on
+		m_MovedImage = std::move(other.m_MovedImage);
+		m_MoveCallbacks = std::move(other.m_MoveCallbacks);
+		m_Movable = std::move(other.m_Movable);
+		if (m_Movable)
+			RegisterMoveHandler();
 
 		other.Reset();
 
@@ -161,6 +184,7 @@ namespace Vulture
 		imageInfo.LayerCount = m_LayerCount;
 		imageInfo.SamplerInfo = Vulture::SamplerInfo{}; // TODO
 		imageInfo.Type = m_Type;
+		imageInfo.Swizzle = m_Swizzle;
 		imageInfo.DebugName = ""; // TODO
 
 		Init(imageInfo);
@@ -200,6 +224,257 @@ namespace Vulture
 		}
 	}
 
+	/**
+	 * @brief Uploads already prepared mip levels (e.g. block compressed data cooked on the CPU) in a single copy.
+	 * Uploaded levels end up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levels that weren't uploaded keep their content.
+	 *
+	 * @param mipData - Tightly packed data of each level, for block compressed formats rows are rows of blocks.
+	 * @param mipSizes - Size in bytes of each level.
+	 * @param baseMip - Mip level to which mipData[0] is written.
+	 * @param cmd - Optional command buffer, single time command is submitted when it's not provided.
+	 */
+	void Image::WriteMipLevels(const std::vector<const void*>& mipData, const std::vector<uint64_t>& mipSizes, uint32_t baseMip, VkCommandBuffer cmd)
+	{
+		VL_CORE_ASSERT(mipData.size() == mipSizes.size(), "Mip data and mip sizes count mismatch!");
+		VL_CORE_ASSERT(baseMip + mipData.size() <= m_MipLevels, "Image has only {} mip levels! Tried to write {} levels from level {}", m_MipLevels, mipData.size(), baseMip);
+
+		if (mipData.empty())
+			return;
+
+		bool cmdProvided = cmd != 0;
+
+		if (!cmdProvided)
+		{
+			Device::BeginSingleTimeCommands(cmd, Device::GetGraphicsCommandPool());
+		}
+
+		// Offsets have to be a multiple of the texel block size, 16 covers every format
+		std::vector<VkDeviceSize> offsets(mipData.size());
+		VkDeviceSize stagingSize = 0;
+		for (int i = 0; i < mipData.size(); i++)
+		{
+			offsets[i] = stagingSize;
+			stagingSize += (mipSizes[i] + 15) & ~(VkDeviceSize)15;
+		}
+
+		Buffer::CreateInfo bufferInfo{};
+		bufferInfo.InstanceSize = stagingSize;
+		bufferInfo.UsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		bufferInfo.NoPool = true;
+		Buffer stagingBuffer(bufferInfo);
+
+		stagingBuffer.Map(stagingSize);
+		for (int i = 0; i < mipData.size(); i++)
+		{
+			memcpy((char*)stagingBuffer.GetMappedMemory() + offsets[i], mipData[i], mipSizes[i]);
+		}
+		stagingBuffer.Unmap();
+
+		// Whole image has to be in a known layout first so that the levels which aren't written are valid too
+		if (m_Layout != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		{
+			const bool undefined = m_Layout == VK_IMAGE_LAYOUT_UNDEFINED;
+			TransitionImageLayout(m_ImageHandle, m_Layout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				undefined ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				undefined ? 0 : VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, cmd, { m_Aspect, 0, m_MipLevels, 0, (uint32_t)m_LayerCount }
+			);
+			m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		VkImageSubresourceRange range{};
+		range.aspectMask = m_Aspect;
+		range.baseMipLevel = baseMip;
+		range.levelCount = (uint32_t)mipData.size();
+		range.baseArrayLayer = 0;
+		range.layerCount = 1;
+
+		// Levels are fully overwritten so their previous content can be discarded
+		TransitionImageLayout(m_ImageHandle, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT, cmd, range
+		);
+
+		std::vector<VkBufferImageCopy> regions(mipData.size());
+		for (int i = 0; i < mipData.size(); i++)
+		{
+			const uint32_t level = baseMip + i;
+
+			regions[i].bufferOffset = offsets[i];
+			regions[i].bufferRowLength = 0;
+			regions[i].bufferImageHeight = 0;
+			regions[i].imageSubresource.aspectMask = m_Aspect;
+			regions[i].imageSubresource.mipLevel = level;
+			regions[i].imageSubresource.baseArrayLayer = 0;
+			regions[i].imageSubresource.layerCount = 1;
+			regions[i].imageOffset = { 0, 0, 0 };
+			regions[i].imageExtent = { glm::max(m_Size.width >> level, 1u), glm::max(m_Size.height >> level, 1u), 1 };
+		}
+
+		vkCmdCopyBufferToImage(cmd, stagingBuffer.GetBuffer(), m_ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+
+		TransitionImageLayout(m_ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, cmd, range
+		);
+
+		if (!cmdProvided)
+		{
+			Device::EndSingleTimeCommands(cmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
+		}
+	}
+
+	/**
+	 * @brief Recreates the image view so that it starts at the given mip level. Used by texture streaming to
+	 * hide levels that aren't uploaded yet. Old view is destroyed through the DeleteQueue, so frames in flight
+	 * can still use it, but descriptors referencing it have to be updated.
+	 *
+	 * @param baseMip - First mip level visible through the view.
+	 */
+	void Image::SetBaseMipLevel(uint32_t baseMip)
+	{
+		VL_CORE_ASSERT(m_Initialized, "Image not initialized!");
+		VL_CORE_ASSERT(baseMip < m_MipLevels, "Image has only {} mip levels! Tried to set base level to {}", m_MipLevels, baseMip);
+
+		if (baseMip == m_BaseMipLevel)
+			return;
+
+		for (VkImageView view : m_ImageViews)
+		{
+			DeleteQueue::TrashImageView(view);
+		}
+
+		m_BaseMipLevel = baseMip;
+
+		CreateImageViews();
+	}
+
+	/**
+	 * @brief Lets the memory service move the image during defragmentation. The handler follows the image when it's
+	 * moved to another address and is removed when it's destroyed. Requires both transfer usage flags, see
+	 * RecordMove().
+	 */
+	void Image::SetMovable(const MoveCallbacks& callbacks)
+	{
+		if (m_Allocation == nullptr)
+			return;
+
+		m_MoveCallbacks = callbacks;
+		m_Movable = true;
+		RegisterMoveHandler();
+	}
+
+	void Image::RegisterMoveHandler()
+	{
+		MemoryService::MoveHandler handler;
+		handler.Copy = [this](VmaAllocation allocation, VkCommandBuffer cmd)
+			{
+				if (!RecordMove(allocation, cmd))
+					return false;
+
+				if (m_MoveCallbacks.OnMoving)
+					m_MoveCallbacks.OnMoving(this, true);
+				return true;
+			};
+		handler.Commit = [this]()
+			{
+				CommitMove();
+				if (m_MoveCallbacks.OnMoving)
+					m_MoveCallbacks.OnMoving(this, false);
+				if (m_MoveCallbacks.OnMoved)
+					m_MoveCallbacks.OnMoved(this);
+			};
+		handler.Abort = [this]()
+			{
+				AbortMove();
+				if (m_MoveCallbacks.OnMoving)
+					m_MoveCallbacks.OnMoving(this, false);
+			};
+		handler.Lock = m_MoveCallbacks.Lock;
+
+		MemoryService::SetMoveHandler(*m_Allocation, handler);
+	}
+
+	/**
+	 * @brief Creates a copy of the image bound to memory of the given allocation and records copying of every level
+	 * and layer into it. Used to move the image during defragmentation (see MemoryService::MoveHandler), CommitMove()
+	 * switches to the copy once the commands finished. The image stays usable until then. Requires both transfer
+	 * usage flags.
+	 *
+	 * @param allocation - Allocation of the new memory.
+	 * @param cmd - Command buffer the copy is recorded into.
+	 *
+	 * @return false if the image can't be moved.
+	 */
+	bool Image::RecordMove(VmaAllocation allocation, VkCommandBuffer cmd)
+	{
+		const VkImageUsageFlags transferUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if (!m_Initialized || m_Allocation == nullptr || (m_Usage & transferUsage) != transferUsage)
+			return false;
+
+		VL_CORE_ASSERT(m_MovedImage == VK_NULL_HANDLE, "Image is already being moved!");
+
+		const VkImageCreateInfo imageCreateInfo = GetImageCreateInfo();
+		VL_CORE_RETURN_ASSERT(vkCreateImage(Device::GetDevice(), &imageCreateInfo, nullptr, &m_MovedImage),
+			VK_SUCCESS,
+			"failed to create image!"
+		);
+		VL_CORE_RETURN_ASSERT(vmaBindImageMemory(Device::GetAllocator(), allocation, m_MovedImage),
+			VK_SUCCESS,
+			"failed to bind moved image memory!"
+		);
+
+		// Nothing was written into the image yet, there's nothing to copy
+		if (m_Layout == VK_IMAGE_LAYOUT_UNDEFINED)
+			return true;
+
+		const VkImageSubresourceRange range = { (VkImageAspectFlags)m_Aspect, 0, m_MipLevels, 0, (uint32_t)m_LayerCount };
+		TransitionImageLayout(m_ImageHandle, m_Layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, cmd, range);
+		TransitionImageLayout(m_MovedImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT, cmd, range);
+
+		std::vector<VkImageCopy> regions(m_MipLevels);
+		for (uint32_t mip = 0; mip < m_MipLevels; mip++)
+		{
+			VkImageCopy& region = regions[mip];
+			region.srcSubresource = { (VkImageAspectFlags)m_Aspect, mip, 0, (uint32_t)m_LayerCount };
+			region.dstSubresource = region.srcSubresource;
+			region.extent = { glm::max(m_Size.width >> mip, 1u), glm::max(m_Size.height >> mip, 1u), 1 };
+		}
+		vkCmdCopyImage(cmd, m_ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_MovedImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+
+		TransitionImageLayout(m_MovedImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_Layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT, cmd, range);
+		TransitionImageLayout(m_ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, VK_ACCESS_MEMORY_READ_BIT, cmd, range);
+
+		return true;
+	}
+
+	/**
+	 * @brief Replaces the image with the copy made by RecordMove(). Has to be called once the copy finished, the
+	 * old image and its views are retired through the DeleteQueue since frames in flight may still use them.
+	 * Descriptors referencing the image have to be updated.
+	 */
+	void Image::CommitMove()
+	{
+		VL_CORE_ASSERT(m_MovedImage != VK_NULL_HANDLE, "Image is not being moved!");
+
+		DeleteQueue::TrashImage(m_ImageHandle, m_ImageViews);
+
+		m_ImageHandle = m_MovedImage;
+		m_MovedImage = VK_NULL_HANDLE;
+
+		CreateImageViews();
+	}
+
+	/**
+	 * @brief Drops the copy made by RecordMove(), the image stays where it is.
+	 */
+	void Image::AbortMove()
+	{
+		VL_CORE_ASSERT(m_MovedImage != VK_NULL_HANDLE, "Image is not being moved!");
+
+		DeleteQueue::TrashImage(m_MovedImage);
+		m_MovedImage = VK_NULL_HANDLE;
+	}
+
 	/*
 	 * @brief Creates an image view for the image based on the provided format, aspect, layer count, and image type.
 	 * It also handles the creation of individual layer views when the layer count is greater than 1.
@@ -219,9 +494,10 @@ namespace Vulture
 		viewInfo.image = m_ImageHandle;
 		viewInfo.viewType = imageType;
 		viewInfo.format = format;
+		viewInfo.components = m_Swizzle;
 		viewInfo.subresourceRange.aspectMask = aspect;
-		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = m_MipLevels;
+		viewInfo.subresourceRange.baseMipLevel = m_BaseMipLevel;
+		viewInfo.subresourceRange.levelCount = m_MipLevels - m_BaseMipLevel;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = layerCount;
 		VL_CORE_RETURN_ASSERT(vkCreateImageView(Device::GetDevice(), &viewInfo, nullptr, &m_ImageViews[0]),
@@ -231,44 +507,112 @@ namespace Vulture
 	}
 
 	/*
-	 * @brief Creates an image with the specified parameters.
+	 * @brief Creates the view matching the image type.
 	 */
-	void Image::CreateImage(const CreateInfo& createInfo)
+	void Image::CreateImageViews()
+	{
+		if (m_Type == ImageType::Cubemap)
+			CreateImageView(m_Format, m_Aspect, m_LayerCount, VK_IMAGE_VIEW_TYPE_CUBE);
+		else if (m_LayerCount > 1 || m_Type == ImageType::Image2DArray)
+			CreateImageView(m_Format, m_Aspect, m_LayerCount, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+		else
+			CreateImageView(m_Format, m_Aspect, m_LayerCount, VK_IMAGE_VIEW_TYPE_2D);
+	}
+
+	VkImageCreateInfo Image::GetImageCreateInfo() const
 	{
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.extent.width = createInfo.Width;
-		imageCreateInfo.extent.height = createInfo.Height;
+		imageCreateInfo.extent.width = m_Size.width;
+		imageCreateInfo.extent.height = m_Size.height;
 		imageCreateInfo.extent.depth = 1;
 		imageCreateInfo.mipLevels = m_MipLevels;
-		imageCreateInfo.arrayLayers = createInfo.LayerCount;
-		imageCreateInfo.format = createInfo.Format;
-		imageCreateInfo.tiling = createInfo.Tiling;
+		imageCreateInfo.arrayLayers = m_LayerCount;
+		imageCreateInfo.format = m_Format;
+		imageCreateInfo.tiling = m_Tiling;
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.usage = createInfo.Usage;
+		imageCreateInfo.usage = m_Usage;
 		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		if (createInfo.Type == ImageType::Cubemap)
+		if (m_Type == ImageType::Cubemap)
 			imageCreateInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 
-		Device::CreateImage(imageCreateInfo, m_ImageHandle, *m_Allocation, createInfo.Properties);
+		return imageCreateInfo;
+	}
+
+	/*
+	 * @brief Creates an image with the specified parameters.
+	 */
+	void Image::CreateImage(const CreateInfo& createInfo)
+	{
+		VkImageCreateInfo imageCreateInfo = GetImageCreateInfo();
+
+		if (createInfo.AliasAllocation != VK_NULL_HANDLE)
+		{
+			VL_CORE_RETURN_ASSERT(vkCreateImage(Device::GetDevice(), &imageCreateInfo, nullptr, &m_ImageHandle),
+				VK_SUCCESS,
+				"failed to create aliased image!"
+			);
+			VL_CORE_RETURN_ASSERT(vmaBindImageMemory2(Device::GetAllocator(), createInfo.AliasAllocation, createInfo.AliasOffset, m_ImageHandle, nullptr),
+				VK_SUCCESS,
+				"failed to bind aliased image memory!"
+			);
+			return;
+		}
+
+		Device::CreateImage(imageCreateInfo, m_ImageHandle, *m_Allocation, createInfo.Properties, createInfo.Category);
 	}
 
-	void Image::CreateHDRSamplingBuffer(void* pixels)
+	void Image::CreateHDRSamplingBuffer(void* pixels, const std::string& cachePath)
 	{
 		// TODO: add ability to not create importance sampling buffer?
 		float average, integral;
-		std::vector<EnvAccel> envAccel = CreateEnvAccel((float*)pixels, m_Size.width, m_Size.height, average, integral);
+		std::vector<EnvAccel> envAccel;
+		if (!cachePath.empty() && LoadEnvAccelCache(cachePath, (float*)pixels, envAccel, average, integral))
+		{
+			WriteEnvPDF((float*)pixels, m_Size.width, m_Size.height, integral);
+		}
+		else
+		{
+			envAccel = CreateEnvAccel((float*)pixels, m_Size.width, m_Size.height, average, integral);
+
+			if (!cachePath.empty())
+				SaveEnvAccelCache(cachePath, (float*)pixels, envAccel, average, integral);
+		}
+
+		UploadEnvAccel(envAccel);
+	}
 
+	/**
+	 * @brief Same as CreateHDRSamplingBuffer but for pixels that already have the PDF in alpha channel, e.g. level 0
+	 * of a cooked environment map. Pixels are only read, so they can point into a read only mapping.
+	 */
+	void Image::LoadHDRSamplingBuffer(const void* pixels, const std::string& cachePath)
+	{
+		float average, integral;
+		std::vector<EnvAccel> envAccel;
+		if (LoadEnvAccelCache(cachePath, (const float*)pixels, envAccel, average, integral))
+		{
+			UploadEnvAccel(envAccel);
+			return;
+		}
+
+		// Building the table rewrites alpha, which ends up with the same PDF, but the mapping can't be written to
+		std::vector<float> copy((const float*)pixels, (const float*)pixels + (uint64_t)m_Size.width * m_Size.height * 4);
+		CreateHDRSamplingBuffer(copy.data(), cachePath);
+	}
+
+	void Image::UploadEnvAccel(const std::vector<EnvAccel>& accel)
+	{
 		Buffer::CreateInfo bufferInfo{};
-		bufferInfo.InstanceSize = sizeof(EnvAccel) * envAccel.size();
+		bufferInfo.InstanceSize = sizeof(EnvAccel) * accel.size();
 		bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 		bufferInfo.UsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
 		Buffer stagingBuf(bufferInfo);
 		stagingBuf.Map();
-		stagingBuf.WriteToBuffer(envAccel.data());
+		stagingBuf.WriteToBuffer((void*)accel.data());
 		stagingBuf.Unmap();
 
 		bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
@@ -628,52 +972,111 @@ namespace Vulture
 		return color.r * 0.2126F + color.g * 0.7152F + color.b * 0.0722F;
 	}
 
+	// Rows / texels processed by a single thread when building the env accel structure
+	static constexpr uint64_t s_EnvAccelRowBatch = 16;
+	static constexpr uint64_t s_EnvAccelTexelBatch = 1 << 16;
+
+	/**
+	 * @brief Computes solid angle weighted importance of a single env map row and returns the sum of
+	 * CIE luminance of its texels. Texels are processed 4 at a time with SSE, the rest falls back to scalar code.
+	 * Both paths perform the exact same float operations so the output doesn't depend on the width of the row.
+	 *
+	 * @param pixels - RGBA32F texels of the row.
+	 * @param importance - Output importance of each texel.
+	 * @param width - Texel count in the row.
+	 * @param area - Solid angle subtended by a single texel of the row.
+	 */
+	static double ComputeRowImportance(const float* pixels, float* importance, uint32_t width, float area)
+	{
+		double luminanceSum = 0.0;
+		uint32_t x = 0;
+
+#ifdef VL_ENV_ACCEL_SSE
+		const __m128 areaV = _mm_set1_ps(area);
+		const __m128 lumR = _mm_set1_ps(0.2126F);
+		const __m128 lumG = _mm_set1_ps(0.7152F);
+		const __m128 lumB = _mm_set1_ps(0.0722F);
+		__m128d sumLow = _mm_setzero_pd();
+		__m128d sumHigh = _mm_setzero_pd();
+
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128 r = _mm_loadu_ps(pixels + (x + 0) * 4);
+			__m128 g = _mm_loadu_ps(pixels + (x + 1) * 4);
+			__m128 b = _mm_loadu_ps(pixels + (x + 2) * 4);
+			__m128 a = _mm_loadu_ps(pixels + (x + 3) * 4);
+			_MM_TRANSPOSE4_PS(r, g, b, a); // AoS -> SoA, each register now holds one channel of 4 texels
+
+			const __m128 maxChannel = _mm_max_ps(r, _mm_max_ps(g, b));
+			_mm_storeu_ps(importance + x, _mm_mul_ps(areaV, maxChannel));
+
+			const __m128 luminance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, lumR), _mm_mul_ps(g, lumG)), _mm_mul_ps(b, lumB));
+			sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(luminance));
+			sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(luminance, luminance)));
+		}
+
+		double lanes[2];
+		_mm_storeu_pd(lanes, _mm_add_pd(sumLow, sumHigh));
+		luminanceSum = lanes[0] + lanes[1];
+#endif
+
+		for (; x < width; x++)
+		{
+			const float* texel = pixels + x * 4;
+			importance[x] = area * glm::max(texel[0], glm::max(texel[1], texel[2]));
+			luminanceSum += texel[0] * 0.2126F + texel[1] * 0.7152F + texel[2] * 0.0722F;
+		}
+
+		return luminanceSum;
+	}
+
 	// Create acceleration data for importance sampling
 	// And store the PDF into the ALPHA channel of pixels
 	std::vector<Image::EnvAccel> Image::CreateEnvAccel(float* pixels, uint32_t width, uint32_t height, float& average, float& integral)
 	{
 		VL_CORE_INFO("Creating Env Accel Structure...");
+		Timer timer;
+
 		const uint32_t rx = width;
 		const uint32_t ry = height;
 
 		// Create importance sampling data
-		std::vector<Image::EnvAccel> envAccel(rx * ry);
-		std::vector<float> importanceData(rx * ry);
+		std::vector<Image::EnvAccel> envAccel((uint64_t)rx * ry);
+		std::vector<float> importanceData((uint64_t)rx * ry);
 
-		float cosTheta0			= 1.0F; // cosine of the up vector
 		const float stepPhi		= (float)2.0F * (float)M_PI / (float)rx; // azimuth step
 		const float stepTheta	= (float)M_PI / (float)ry; // elevation step
-		double total			= 0.0;
 
 		// For each texel of the environment map, we compute the related solid angle
 		// subtended by the texel, and store the weighted luminance in importance_data,
 		// representing the amount of energy emitted through each texel.
 		// Also compute the average CIE luminance to drive the tonemapping of the final image
-		for (uint32_t y = 0; y < ry; ++y)
+		// Rows are independent so they're split between threads, each thread sums luminance of its own rows
+		std::vector<double> partialTotals(Parallel::GetBatchCount(ry, s_EnvAccelRowBatch), 0.0);
+		Parallel::For(ry, s_EnvAccelRowBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
 		{
-			const float theta1 = (float)(y + 1) * stepTheta; // elevation angle of currently sampled texel
-			const float cosTheta1 = glm::cos(theta1); // cosine of the elevation angle
-
-			// Calculate how much area does each texel take
-			// (cosTheta0 - cosTheta1) - how much of the unit sphere does texel take
-			//  * stepPhi - get solid angle
-			const float area = (cosTheta0 - cosTheta1) * stepPhi;  // solid angle
-			cosTheta0 = cosTheta1; // set cosine of the up vector to the elevation cosine to advance the loop
-
-			for (uint32_t x = 0; x < rx; ++x)
+			double total = 0.0;
+			for (uint64_t y = begin; y < end; ++y)
 			{
-				const uint32_t idx = y * rx + x;
-				const uint32_t idx4 = idx * 4; // texel index
-				float          luminance = GetLuminance(*(glm::vec3*)&pixels[idx4]);
+				// cosine of the up vector, same value that the previous row computed as its cosTheta1
+				const float cosTheta0 = y == 0 ? 1.0F : glm::cos((float)y * stepTheta);
+				const float theta1 = (float)(y + 1) * stepTheta; // elevation angle of currently sampled texel
+				const float cosTheta1 = glm::cos(theta1); // cosine of the elevation angle
 
-				// Store the radiance of the texel into importance array, importance will be higher for brither texels
-				importanceData[idx] = area * glm::max(pixels[idx4], glm::max(pixels[idx4 + 1], pixels[idx4 + 2]));
-				total += luminance;
+				// Calculate how much area does each texel take
+				// (cosTheta0 - cosTheta1) - how much of the unit sphere does texel take
+				//  * stepPhi - get solid angle
+				const float area = (cosTheta0 - cosTheta1) * stepPhi;  // solid angle
+
+				total += ComputeRowImportance(&pixels[y * rx * 4], &importanceData[y * rx], rx, area);
 			}
-		}
+			partialTotals[batch] = total;
+		});
+
+		const double total = std::accumulate(partialTotals.begin(), partialTotals.end(), 0.0);
 
 		// maybe I'll use this for tonemapping? idk
-		average = float(total) / float(rx * ry);
+		average = float(total) / float((uint64_t)rx * ry);
 
 		// Alias map is used to efficiently sslect texels from env map based on importance.
 		// It aims at creating a set of texel couples
@@ -682,16 +1085,57 @@ namespace Vulture
 		integral = BuildAliasMap(importanceData, envAccel);
 
 		// We deduce the PDF of each texel by normalizing its emitted radiance by the radiance integral
-		for (uint32_t i = 0; i < rx * ry; ++i)
-		{
-			const uint32_t idx4 = i * 4;
-			// Store the PDF inside Alpha channel(idx4 + 3)
-			pixels[idx4 + 3] = glm::max(pixels[idx4], glm::max(pixels[idx4 + 1], pixels[idx4 + 2])) / integral;
-		}
+		WriteEnvPDF(pixels, rx, ry, integral);
+
+		VL_CORE_INFO("Env Accel Structure created in {}ms ({}x{})", timer.ElapsedMillis(), rx, ry);
 
 		return envAccel;
 	}
 
+	/**
+	 * @brief Stores the PDF of each texel inside its alpha channel.
+	 *
+	 * @param pixels - RGBA32F texels of the env map.
+	 * @param width - Width of the env map.
+	 * @param height - Height of the env map.
+	 * @param integral - Integral of the emitted radiance returned by BuildAliasMap.
+	 */
+	void Image::WriteEnvPDF(float* pixels, uint32_t width, uint32_t height, float integral)
+	{
+		Parallel::For((uint64_t)width * height, s_EnvAccelTexelBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+		{
+			uint64_t i = begin;
+
+#ifdef VL_ENV_ACCEL_SSE
+			const __m128 integralV = _mm_set1_ps(integral);
+			for (; i + 4 <= end; i += 4)
+			{
+				float* texels = &pixels[i * 4];
+				__m128 r = _mm_loadu_ps(texels + 0);
+				__m128 g = _mm_loadu_ps(texels + 4);
+				__m128 b = _mm_loadu_ps(texels + 8);
+				__m128 a = _mm_loadu_ps(texels + 12);
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+
+				a = _mm_div_ps(_mm_max_ps(r, _mm_max_ps(g, b)), integralV);
+
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+				_mm_storeu_ps(texels + 0, r);
+				_mm_storeu_ps(texels + 4, g);
+				_mm_storeu_ps(texels + 8, b);
+				_mm_storeu_ps(texels + 12, a);
+			}
+#endif
+
+			for (; i < end; ++i)
+			{
+				const uint64_t idx4 = i * 4;
+				// Store the PDF inside Alpha channel(idx4 + 3)
+				pixels[idx4 + 3] = glm::max(pixels[idx4], glm::max(pixels[idx4 + 1], pixels[idx4 + 2])) / integral;
+			}
+		});
+	}
+
 	// Alias map is used to efficiently sslect texels from env map based on importance.
 	// It aims at creating a set of texel couples
 	// so that all couples emit roughly the same amount of energy. To do this,
@@ -699,20 +1143,51 @@ namespace Vulture
 	float Image::BuildAliasMap(const std::vector<float>& data, std::vector<EnvAccel>& accel)
 	{
 		uint32_t size = uint32_t(data.size());
+		const uint32_t batchCount = Parallel::GetBatchCount(size, s_EnvAccelTexelBatch);
 
 		// Compute the integral of the emitted radiance of the environment map
 		// Since each element in data is already weighted by its solid angle
-		float sum = std::accumulate(data.begin(), data.end(), 0.0F);
+		std::vector<double> partialSums(batchCount, 0.0);
+		Parallel::For(size, s_EnvAccelTexelBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+		{
+			double partialSum = 0.0;
+			for (uint64_t i = begin; i < end; i++)
+			{
+				partialSum += data[i];
+			}
+			partialSums[batch] = partialSum;
+		});
+		float sum = (float)std::accumulate(partialSums.begin(), partialSums.end(), 0.0);
 
 		float average = sum / float(size);
-		for (uint32_t i = 0; i < size; i++)
+
+		// Calculate PDF. Inside PDF average of all values must be equal to 1, that's
+		// why we divide texel importance from data by the average of all texels.
+		// Each batch also counts its below average texels so that the partition below can be done in parallel
+		std::vector<uint32_t> lowEnergyOffsets(batchCount, 0);
+		Parallel::For(size, s_EnvAccelTexelBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
 		{
-			// Calculate PDF. Inside PDF average of all values must be equal to 1, that's
-			// why we divide texel importance from data by the average of all texels
-			accel[i].Importance = data[i] / average;
+			uint32_t lowCount = 0;
+			for (uint64_t i = begin; i < end; i++)
+			{
+				accel[i].Importance = data[i] / average;
+
+				// identity, ie. each texel is its own alias
+				accel[i].Alias = (uint32_t)i;
+
+				if (accel[i].Importance < 1.F)
+					lowCount++;
+			}
+			lowEnergyOffsets[batch] = lowCount;
+		});
 
-			// identity, ie. each texel is its own alias
-			accel[i].Alias = i;
+		// Exclusive prefix sum, lowEnergyOffsets[i] = number of below average texels before batch i
+		uint32_t lowEnergyTotal = 0;
+		for (uint32_t i = 0; i < batchCount; i++)
+		{
+			const uint32_t count = lowEnergyOffsets[i];
+			lowEnergyOffsets[i] = lowEnergyTotal;
+			lowEnergyTotal += count;
 		}
 
 		// Partition the texels according to their importance.
@@ -720,23 +1195,57 @@ namespace Vulture
 		// array, while texels emitting higher-than-average radiance are stored from the end of the array.
 		// This effectively separates the texels into two groups: one containing texels with below-average 
 		// radiance and the other containing texels with above-average radiance
+		//
+		// The layout matches the old serial loop exactly: low energy texels start at index 1, so the
+		// slot at lowEnergyTotal is written by both the last low energy and the last high energy texel.
+		// The serial loop kept whichever came later, here that slot is skipped by the threads and resolved afterwards.
 		std::vector<uint32_t> partitionTable(size);
-		uint32_t              lowEnergyCounter = 0U;
-		uint32_t              HighEnergyCounter = size;
-		for (uint32_t i = 0; i < size; ++i)
+		Parallel::For(size, s_EnvAccelTexelBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
 		{
-			if (accel[i].Importance < 1.F)
+			uint32_t lowEnergyCounter = lowEnergyOffsets[batch];
+			uint32_t highEnergyCounter = (uint32_t)begin - lowEnergyOffsets[batch]; // high energy texels before this batch
+			for (uint64_t i = begin; i < end; i++)
 			{
-				lowEnergyCounter++;
-				partitionTable[lowEnergyCounter] = i;
+				uint32_t slot;
+				if (accel[i].Importance < 1.F)
+				{
+					lowEnergyCounter++;
+					slot = lowEnergyCounter;
+				}
+				else
+				{
+					slot = size - 1 - highEnergyCounter;
+					highEnergyCounter++;
+				}
+
+				if (slot != lowEnergyTotal)
+					partitionTable[slot] = (uint32_t)i;
 			}
-			else
+		});
+
+		if (lowEnergyTotal < size)
+		{
+			int64_t lastLow = -1;
+			int64_t lastHigh = -1;
+			for (int64_t i = (int64_t)size - 1; i >= 0 && (lastLow == -1 || lastHigh == -1); i--)
 			{
-				HighEnergyCounter--;
-				partitionTable[HighEnergyCounter] = i;
+				if (accel[i].Importance < 1.F)
+				{
+					if (lastLow == -1)
+						lastLow = i;
+				}
+				else if (lastHigh == -1)
+				{
+					lastHigh = i;
+				}
 			}
+
+			partitionTable[lowEnergyTotal] = (uint32_t)glm::max(lastLow, lastHigh);
 		}
 
+		uint32_t lowEnergyCounter = 0U;
+		uint32_t HighEnergyCounter = lowEnergyTotal; // index of the first high energy texel in the partition table
+
 		// Associate the lower-energy texels to higher-energy ones. Since the emission of a high-energy texel may
 		// be vastly superior to the average,
 		for (lowEnergyCounter = 0; lowEnergyCounter < HighEnergyCounter && HighEnergyCounter < size; lowEnergyCounter++)
@@ -779,6 +1288,199 @@ namespace Vulture
 		return sum;
 	}
 
+	struct EnvAccelCacheHeader
+	{
+		uint32_t Magic = 0x43434145; // "EACC"
+		uint32_t Version = 3;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint64_t Fingerprint = 0;
+		float Average = 0.0f;
+		float Integral = 0.0f;
+	};
+
+	/**
+	 * @brief Hashes dimensions and the color of every texel so that a cache built for a different image (or an
+	 * edited version of the same file) gets rejected. Blocks of s_EnvAccelTexelBatch texels are hashed in parallel
+	 * and combined in order, the result doesn't depend on how many threads there are.
+	 */
+	static uint64_t ComputeEnvFingerprint(const float* pixels, uint32_t width, uint32_t height)
+	{
+		// FNV-1a over 32 bit words
+		auto hashWord = [](uint64_t hash, uint32_t word)
+		{
+			return (hash ^ word) * 1099511628211ULL;
+		};
+
+		const uint64_t texelCount = (uint64_t)width * height;
+		const uint64_t blockCount = (texelCount + s_EnvAccelTexelBatch - 1) / s_EnvAccelTexelBatch;
+
+		std::vector<uint64_t> blockHashes(blockCount);
+		Parallel::For(blockCount, 1, [&](uint64_t begin, uint64_t end, uint32_t)
+			{
+				for (uint64_t block = begin; block < end; block++)
+				{
+					uint64_t hash = 14695981039346656037ULL;
+					const uint64_t last = std::min(texelCount, (block + 1) * s_EnvAccelTexelBatch);
+					for (uint64_t i = block * s_EnvAccelTexelBatch; i < last; i++)
+					{
+						// Alpha is overwritten with PDF, skip it
+						uint32_t rgb[3];
+						memcpy(rgb, &pixels[i * 4], sizeof(rgb));
+						hash = hashWord(hash, rgb[0]);
+						hash = hashWord(hash, rgb[1]);
+						hash = hashWord(hash, rgb[2]);
+					}
+
+					blockHashes[block] = hash;
+				}
+			});
+
+		uint64_t hash = 14695981039346656037ULL;
+		hash = hashWord(hash, width);
+		hash = hashWord(hash, height);
+		for (uint64_t blockHash : blockHashes)
+		{
+			hash = hashWord(hash, (uint32_t)blockHash);
+			hash = hashWord(hash, (uint32_t)(blockHash >> 32));
+		}
+
+		return hash;
+	}
+
+	/**
+	 * @brief Loads importance sampling table saved by SaveEnvAccelCache. The PDF isn't written into alpha channel of
+	 * pixels, callers that need it call WriteEnvPDF with the loaded integral.
+	 *
+	 * @return false if the cache doesn't exist or was built for different pixels.
+	 */
+	bool Image::LoadEnvAccelCache(const std::string& cachePath, const float* pixels, std::vector<EnvAccel>& accel, float& average, float& integral)
+	{
+		std::ifstream file(cachePath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		EnvAccelCacheHeader expected{};
+		expected.Width = m_Size.width;
+		expected.Height = m_Size.height;
+		expected.Fingerprint = ComputeEnvFingerprint(pixels, m_Size.width, m_Size.height);
+
+		EnvAccelCacheHeader header{};
+		file.read((char*)&header, sizeof(EnvAccelCacheHeader));
+		if (!file || header.Magic != expected.Magic || header.Version != expected.Version || header.Width != expected.Width
+			|| header.Height != expected.Height || header.Fingerprint != expected.Fingerprint)
+		{
+			VL_CORE_WARN("Env Accel cache is outdated, rebuilding: {}", cachePath);
+			return false;
+		}
+
+		accel.resize((uint64_t)header.Width * header.Height);
+		file.read((char*)accel.data(), accel.size() * sizeof(EnvAccel));
+		if (!file)
+		{
+			VL_CORE_WARN("Env Accel cache is truncated, rebuilding: {}", cachePath);
+			return false;
+		}
+
+		average = header.Average;
+		integral = header.Integral;
+
+		VL_CORE_TRACE("Loaded Env Accel Structure from cache: {}", cachePath);
+		return true;
+	}
+
+	/**
+	 * @brief Saves importance sampling table next to the env map so that next load doesn't have to rebuild it.
+	 */
+	void Image::SaveEnvAccelCache(const std::string& cachePath, const float* pixels, const std::vector<EnvAccel>& accel, float average, float integral)
+	{
+		EnvAccelCacheHeader header{};
+		header.Width = m_Size.width;
+		header.Height = m_Size.height;
+		header.Fingerprint = ComputeEnvFingerprint(pixels, m_Size.width, m_Size.height);
+		header.Average = average;
+		header.Integral = integral;
+
+		std::ofstream file(cachePath, std::ios::binary);
+		if (!file.is_open())
+		{
+			VL_CORE_WARN("Failed to write Env Accel cache: {}", cachePath);
+			return;
+		}
+
+		file.write((const char*)&header, sizeof(EnvAccelCacheHeader));
+		file.write((const char*)accel.data(), accel.size() * sizeof(EnvAccel));
+	}
+
+	/**
+	 * @brief Builds the importance sampling table of synthetic equirectangular env maps and compares it with loading
+	 * the table from the cache, which includes fingerprinting the pixels. Results are logged.
+	 *
+	 * @param widths - Widths of the env maps, heights are half of them. 16K needs about 3GB of memory.
+	 */
+	void Image::RunEnvAccelBenchmark(const std::vector<uint32_t>& widths)
+	{
+		const std::string cachePath = (std::filesystem::temp_directory_path() / "VultureEnvAccelBenchmark.envaccel").string();
+
+		VL_CORE_INFO("Env accel benchmark, {} threads", std::thread::hardware_concurrency());
+		for (uint32_t width : widths)
+		{
+			const uint32_t height = glm::max(width / 2, 1u);
+
+			// Dim sky gradient with a small bright sun, so the alias map has to redistribute most of the energy
+			std::vector<float> pixels((uint64_t)width * height * 4);
+			uint32_t seed = 0x12345678;
+			for (uint32_t y = 0; y < height; y++)
+			{
+				for (uint32_t x = 0; x < width; x++)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					const float noise = (float)(seed >> 8) / (float)(1 << 24) * 0.05f;
+					const float sky = 1.0f - (float)y / (float)height;
+					const float dx = (float)x / width - 0.3f;
+					const float dy = (float)y / height - 0.2f;
+					const float sun = dx * dx + dy * dy < 0.0001f ? 5000.0f : 0.0f;
+
+					float* texel = &pixels[((uint64_t)y * width + x) * 4];
+					texel[0] = 0.3f * sky + noise + sun;
+					texel[1] = 0.5f * sky + noise + sun;
+					texel[2] = 0.9f * sky + noise + sun;
+					texel[3] = 1.0f;
+				}
+			}
+
+			Image image;
+			image.m_Size = { width, height };
+
+			float average, integral;
+			Timer timer;
+			std::vector<EnvAccel> accel = image.CreateEnvAccel(pixels.data(), width, height, average, integral);
+			const float buildMs = timer.ElapsedMillis();
+
+			timer.Reset();
+			ComputeEnvFingerprint(pixels.data(), width, height);
+			const float fingerprintMs = timer.ElapsedMillis();
+
+			timer.Reset();
+			image.SaveEnvAccelCache(cachePath, pixels.data(), accel, average, integral);
+			const float saveMs = timer.ElapsedMillis();
+
+			std::vector<EnvAccel> loaded;
+			float loadedAverage, loadedIntegral;
+			timer.Reset();
+			const bool hit = image.LoadEnvAccelCache(cachePath, pixels.data(), loaded, loadedAverage, loadedIntegral);
+			if (hit)
+				image.WriteEnvPDF(pixels.data(), width, height, loadedIntegral);
+			const float loadMs = timer.ElapsedMillis();
+
+			VL_CORE_INFO("    {:>5}x{:<5} build {:9.2f}ms  fingerprint {:8.2f}ms  save {:8.2f}ms  load {:8.2f}ms ({})  speedup {:.1f}x",
+				width, height, buildMs, fingerprintMs, saveMs, loadMs, hit ? "hit" : "miss", loadMs > 0.0f ? buildMs / loadMs : 0.0f);
+		}
+
+		std::error_code error;
+		std::filesystem::remove(cachePath, error);
+	}
+
 	void Image::Reset()
 	{
 		m_Format = VK_FORMAT_MAX_ENUM;
@@ -787,10 +1489,15 @@ namespace Vulture
 		m_LayerCount = 1;
 		m_Type = ImageType::Image2D;
 		m_ImageHandle = VK_NULL_HANDLE;
+		m_MovedImage = VK_NULL_HANDLE;
+		m_MoveCallbacks = {};
+		m_Movable = false;
 		m_ImageViews.clear();
 		m_Allocation = nullptr;
 		m_Size = { 0, 0 };
 		m_MipLevels = 1;
+		m_Swizzle = {};
+		m_BaseMipLevel = 0;
 		m_Initialized = false;
 		m_Usage = 0;
 		m_MemoryProperties = 0;
@@ -20,6 +20,14 @@ namespace Vulture
 			Cubemap,
 		};
 
+		// Called around a move made by defragmentation, see SetMovable()
+		struct MoveCallbacks
+		{
+			std::function<void(Image* image, bool moving)> OnMoving; // true once the copy was recorded, false after it was committed or aborted
+			std::function<void(Image* image)> OnMoved; // The image switched to the new memory, its views changed
+			std::mutex* Lock = nullptr; // Held while the image is copied, committed or aborted, see MemoryService::MoveHandler
+		};
+
 		struct CreateInfo
 		{
 			void* Data = nullptr;
@@ -35,10 +43,20 @@ namespace Vulture
 			ImageType Type = ImageType::Image2D;
 			int LayerCount = 1;
 			int MipMapCount = 0;
+			uint32_t BaseMipLevel = 0; // First level visible through the image view
+			VkComponentMapping Swizzle = {}; // Identity by default
 
 			Vulture::SamplerInfo SamplerInfo = { VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR };
 
 			bool HDR = false;
+			const char* EnvAccelCachePath = ""; // HDR only, importance sampling table is loaded from / saved to this file when set
+
+			// Binds the image to memory of this allocation instead of allocating its own, so that images which are never
+			// alive at the same time can share memory (see RenderGraph). The allocation isn't owned by the image.
+			VmaAllocation AliasAllocation = VK_NULL_HANDLE;
+			VkDeviceSize AliasOffset = 0;
+
+			MemoryCategory Category = MemoryCategory::Auto; // Only used for memory statistics
 
 			operator bool() const
 			{
@@ -70,7 +88,17 @@ namespace Vulture
 		void BlitImageToImage(Image* srcImage, VkCommandBuffer cmd);
 
 		void WritePixels(void* data, VkCommandBuffer cmd = 0, uint32_t baseLayer = 0);
+		void WriteMipLevels(const std::vector<const void*>& mipData, const std::vector<uint64_t>& mipSizes, uint32_t baseMip = 0, VkCommandBuffer cmd = 0);
 		void GenerateMipmaps();
+
+		void CreateHDRSamplingBuffer(void* pixels, const std::string& cachePath);
+		void LoadHDRSamplingBuffer(const void* pixels, const std::string& cachePath);
+		void SetBaseMipLevel(uint32_t baseMip);
+
+		void SetMovable(const MoveCallbacks& callbacks);
+		bool RecordMove(VmaAllocation allocation, VkCommandBuffer cmd);
+		void CommitMove();
+		void AbortMove();
 	public:
 
 		inline VkImage GetImage() const { return m_ImageHandle; }
@@ -81,20 +109,28 @@ namespace Vulture
 		inline VkImageUsageFlags GetUsageFlags() const { return m_Usage; }
 		inline VkMemoryPropertyFlags GetMemoryProperties() const { return m_MemoryProperties; }
 		inline VkImageLayout GetLayout() const { return m_Layout; }
+		inline VkFormat GetFormat() const { return m_Format; }
 		inline void SetLayout(VkImageLayout newLayout) { m_Layout = newLayout; }
 		inline Buffer* GetAccelBuffer() { return &m_ImportanceSmplAccel; }
 		inline uint32_t GetMipLevelsCount() const { return m_MipLevels; }
+		inline uint32_t GetBaseMipLevel() const { return m_BaseMipLevel; }
 		inline bool IsInitialized() const { return m_Initialized; }
-		inline VmaAllocation* GetAllocation() { return m_Allocation; }
+		inline VmaAllocation* GetAllocation() { return m_Allocation; } // Null for aliased images
+
+		// Bytes per texel of uncompressed formats
+		static uint32_t FormatToSize(VkFormat format);
+
+		static void RunEnvAccelBenchmark(const std::vector<uint32_t>& widths = { 2048, 8192, 16384 });
 
 	private:
-		uint32_t FormatToSize(VkFormat format);
 		void CreateImageView(VkFormat format, VkImageAspectFlagBits aspect, int layerCount = 1, VkImageViewType imageType = VK_IMAGE_VIEW_TYPE_2D);
+		void CreateImageViews();
 		void CreateImage(const CreateInfo& createInfo);
+		VkImageCreateInfo GetImageCreateInfo() const;
+		void RegisterMoveHandler();
 		
 		float GetLuminance(const glm::vec3& color);
 
-		void CreateHDRSamplingBuffer(void* pixels);
 		struct EnvAccel
 		{
 			uint32_t Alias;
@@ -103,6 +139,11 @@ namespace Vulture
 		
 		std::vector<EnvAccel> CreateEnvAccel(float* pixels, uint32_t width, uint32_t height, float& average, float& integral);
 		float BuildAliasMap(const std::vector<float>& data, std::vector<EnvAccel>& accel);
+		void WriteEnvPDF(float* pixels, uint32_t width, uint32_t height, float integral);
+		void UploadEnvAccel(const std::vector<EnvAccel>& accel);
+
+		bool LoadEnvAccelCache(const std::string& cachePath, const float* pixels, std::vector<EnvAccel>& accel, float& average, float& integral);
+		void SaveEnvAccelCache(const std::string& cachePath, const float* pixels, const std::vector<EnvAccel>& accel, float average, float integral);
 
 		VkFormat m_Format = VK_FORMAT_MAX_ENUM;
 		VkImageAspectFlagBits m_Aspect = VK_IMAGE_ASPECT_NONE;
@@ -111,10 +152,15 @@ namespace Vulture
 		ImageType m_Type = ImageType::Image2D;
 
 		VkImage m_ImageHandle;
+		VkImage m_MovedImage = VK_NULL_HANDLE; // Copy in the new memory between RecordMove and CommitMove or AbortMove
+		MoveCallbacks m_MoveCallbacks;
+		bool m_Movable = false;
 		std::vector<VkImageView> m_ImageViews; // view for each layer
 		VmaAllocation* m_Allocation;
 		VkExtent2D m_Size;
 		uint32_t m_MipLevels = 1;
+		VkComponentMapping m_Swizzle = {};
+		uint32_t m_BaseMipLevel = 0;
 
 		bool m_Initialized = false;
 
@@ -0,0 +1,681 @@
+#include "pch.h"
+#include "MemoryService.h"
+
+#include "Device.h"
+#include "Utility/Utility.h"
+
+namespace Vulture
+{
+	MemoryService::CreateInfo MemoryService::s_Info;
+	MemoryService::CategoryStats MemoryService::s_Categories[(int)MemoryCategory::Count];
+
+	static constexpr double s_MB = 1024.0 * 1024.0;
+
+	void MemoryService::Init(const CreateInfo& createInfo)
+	{
+		if (s_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(Device::IsInitialized(), "Device has to be initialized before the memory service!");
+
+		s_Info = createInfo;
+		s_FrameIndex = 0;
+
+		if (!Device::IsMemoryBudgetSupported())
+			VL_CORE_WARN("VK_EXT_memory_budget is not supported, heap budgets are only estimated");
+
+		UpdateBudgets();
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = Device::FindPhysicalQueueFamilies().GraphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		VL_CORE_RETURN_ASSERT(vkCreateCommandPool(Device::GetDevice(), &poolInfo, nullptr, &s_CommandPool),
+			VK_SUCCESS,
+			"Failed to create defragmentation command pool!"
+		);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VL_CORE_RETURN_ASSERT(vkCreateFence(Device::GetDevice(), &fenceInfo, nullptr, &s_PassFence),
+			VK_SUCCESS,
+			"Failed to create defragmentation fence!"
+		);
+
+		s_Initialized = true;
+	}
+
+	void MemoryService::Destroy()
+	{
+		if (!s_Initialized)
+			return;
+
+		// Old memory of committed moves may still be read by frames in flight
+		if (s_PassState == PassState::Copying)
+			CommitDefragmentationPass(true);
+		if (s_PassState == PassState::Committed)
+		{
+			Device::WaitIdle();
+			EndDefragmentationPass();
+		}
+
+		if (s_DefragmentationContext != VK_NULL_HANDLE)
+			EndDefragmentation();
+
+		vkDestroyFence(Device::GetDevice(), s_PassFence, nullptr);
+		s_PassFence = VK_NULL_HANDLE;
+		vkDestroyCommandPool(Device::GetDevice(), s_CommandPool, nullptr);
+		s_CommandPool = VK_NULL_HANDLE;
+
+		{
+			std::unique_lock<std::mutex> lock(s_MoveMutex);
+			s_MoveHandlers.clear();
+		}
+		{
+			std::unique_lock<std::mutex> lock(s_CallbacksMutex);
+			s_Callbacks.clear();
+		}
+
+		s_Initialized = false;
+	}
+
+	/**
+	 * @brief Refreshes heap budgets, raises over budget callbacks and runs a defragmentation pass when one is due.
+	 * Has to be called once per frame from the thread that records the frame, before anything is recorded.
+	 *
+	 * @return true if any resource switched to new memory, descriptors created outside of materials have to be
+	 * updated then.
+	 */
+	bool MemoryService::Update()
+	{
+		VL_CORE_ASSERT(s_Initialized, "MemoryService is not initialized!");
+		VL_PROFILE_FUNCTION();
+
+		s_FrameIndex++;
+
+		UpdateBudgets();
+		CheckBudgets();
+
+		return Defragment();
+	}
+
+	/**
+	 * @brief Counts the allocation under the category. Called by Device for everything it allocates, memory
+	 * allocated directly through VMA has to be tracked manually.
+	 */
+	void MemoryService::Track(VmaAllocation allocation, MemoryCategory category)
+	{
+		VL_CORE_ASSERT(category != MemoryCategory::Auto, "Category has to be resolved before tracking!");
+
+		if (allocation == VK_NULL_HANDLE)
+			return;
+
+		VmaAllocationInfo info{};
+		vmaGetAllocationInfo(Device::GetAllocator(), allocation, &info);
+
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+		s_Allocations[allocation] = { category, info.size };
+
+		CategoryStats& stats = s_Categories[(int)category];
+		stats.AllocationCount++;
+		stats.Bytes += info.size;
+		stats.PeakBytes = glm::max(stats.PeakBytes, stats.Bytes);
+	}
+
+	/**
+	 * @brief Has to be called right before the allocation is freed, VMA may hand out the same handle again.
+	 */
+	void MemoryService::Untrack(VmaAllocation allocation)
+	{
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+
+		auto iter = s_Allocations.find(allocation);
+		if (iter == s_Allocations.end())
+			return;
+
+		CategoryStats& stats = s_Categories[(int)iter->second.Category];
+		stats.AllocationCount--;
+		stats.Bytes -= iter->second.Size;
+
+		s_Allocations.erase(iter);
+	}
+
+	/**
+	 * @brief Picks a category for a buffer from its usage when the caller didn't specify one.
+	 */
+	MemoryCategory MemoryService::ResolveCategory(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags memoryFlags, MemoryCategory category)
+	{
+		if (category != MemoryCategory::Auto)
+			return category;
+
+		const VkBufferUsageFlags usage = createInfo.usage;
+		if (usage & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR)
+			return MemoryCategory::AccelerationStructure;
+
+		if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+			return MemoryCategory::Mesh;
+
+		// Instance buffers, geometry inputs are vertex and index buffers and are caught above
+		if (usage & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR)
+			return MemoryCategory::AccelerationStructure;
+
+		const VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		if ((memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (usage & ~transferUsage) == 0)
+			return MemoryCategory::Staging;
+
+		return MemoryCategory::Other;
+	}
+
+	/**
+	 * @brief Picks a category for an image from its usage when the caller didn't specify one.
+	 */
+	MemoryCategory MemoryService::ResolveCategory(const VkImageCreateInfo& createInfo, MemoryCategory category)
+	{
+		if (category != MemoryCategory::Auto)
+			return category;
+
+		const VkImageUsageFlags usage = createInfo.usage;
+		if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT))
+			return MemoryCategory::RenderTarget;
+
+		if (usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+			return MemoryCategory::Texture;
+
+		return MemoryCategory::Other;
+	}
+
+	/**
+	 * @brief Allows defragmentation to move the allocation. The handler is removed with ClearMoveHandler(),
+	 * which has to be called before the allocation is freed. Setting it again replaces the handler of a move that's
+	 * in progress as well, e.g. after the owner itself was moved to another address.
+	 */
+	void MemoryService::SetMoveHandler(VmaAllocation allocation, const MoveHandler& handler)
+	{
+		VL_CORE_ASSERT(handler.Copy && handler.Commit && handler.Abort, "Move handler needs Copy, Commit and Abort!");
+
+		std::unique_lock<std::mutex> lock(s_MoveMutex);
+		s_MoveHandlers[allocation] = handler;
+
+		for (auto& [index, passHandler] : s_PassMoves)
+		{
+			if (s_Pass.pMoves[index].srcAllocation == allocation)
+				passHandler = handler;
+		}
+	}
+
+	/**
+	 * @brief Pins the allocation in place. A move of it that's still being copied is dropped, the owner has to
+	 * destroy the copy it made. The allocation can be freed through the DeleteQueue afterwards, the pass in
+	 * progress ends before the queue gets to it.
+	 */
+	void MemoryService::ClearMoveHandler(VmaAllocation allocation)
+	{
+		std::unique_lock<std::mutex> lock(s_MoveMutex);
+		s_MoveHandlers.erase(allocation);
+
+		if (s_PassState != PassState::Copying)
+			return;
+
+		for (size_t i = 0; i < s_PassMoves.size(); i++)
+		{
+			VmaDefragmentationMove& move = s_Pass.pMoves[s_PassMoves[i].first];
+			if (move.srcAllocation != allocation)
+				continue;
+
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			s_PassMoves.erase(s_PassMoves.begin() + i);
+			s_PassCancelled = true;
+			break;
+		}
+	}
+
+	/**
+	 * @brief Starts defragmenting the most fragmented image pool on the next Update(), even when it's below
+	 * the threshold. Call it after a large batch of assets was unloaded, e.g. on a level change.
+	 */
+	void MemoryService::RequestDefragmentation()
+	{
+		s_DefragmentationRequested.store(true, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Registers a function that's called when a device local heap goes over the budget threshold, and then
+	 * every OverBudgetInterval frames for as long as it stays there. Called from the thread that calls Update().
+	 *
+	 * @return Id used to remove the callback.
+	 */
+	uint32_t MemoryService::AddOverBudgetCallback(const OverBudgetCallback& callback)
+	{
+		std::unique_lock<std::mutex> lock(s_CallbacksMutex);
+
+		const uint32_t id = s_NextCallbackID++;
+		s_Callbacks[id] = callback;
+		return id;
+	}
+
+	void MemoryService::RemoveOverBudgetCallback(uint32_t id)
+	{
+		std::unique_lock<std::mutex> lock(s_CallbacksMutex);
+		s_Callbacks.erase(id);
+	}
+
+	/**
+	 * @brief Returns budgets of every memory heap as of the last Update().
+	 */
+	std::vector<MemoryService::HeapBudget> MemoryService::GetHeapBudgets()
+	{
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+		return s_Heaps;
+	}
+
+	MemoryService::CategoryStats MemoryService::GetCategoryStats(MemoryCategory category)
+	{
+		VL_CORE_ASSERT(category != MemoryCategory::Auto && category != MemoryCategory::Count, "Invalid memory category!");
+
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+		return s_Categories[(int)category];
+	}
+
+	void MemoryService::LogStats()
+	{
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+
+		VL_CORE_INFO("Device memory:");
+		for (uint32_t i = 0; i < (uint32_t)s_Heaps.size(); i++)
+		{
+			const HeapBudget& heap = s_Heaps[i];
+			VL_CORE_INFO("    Heap {}{}: {:.1f} / {:.1f} MB used, {:.1f} MB in blocks, {:.1f} MB in resources", i, heap.DeviceLocal ? " (device local)" : "",
+				heap.Usage / s_MB, heap.Budget / s_MB, heap.BlockBytes / s_MB, heap.AllocationBytes / s_MB);
+		}
+
+		for (int i = (int)MemoryCategory::Auto + 1; i < (int)MemoryCategory::Count; i++)
+		{
+			const CategoryStats& stats = s_Categories[i];
+			VL_CORE_INFO("    {:<24} {:6} allocations {:10.1f} MB (peak {:.1f} MB)", CategoryToString((MemoryCategory)i), stats.AllocationCount, stats.Bytes / s_MB, stats.PeakBytes / s_MB);
+		}
+	}
+
+	const char* MemoryService::CategoryToString(MemoryCategory category)
+	{
+		switch (category)
+		{
+		case MemoryCategory::Auto:					return "Auto";
+		case MemoryCategory::Texture:				return "Texture";
+		case MemoryCategory::RenderTarget:			return "Render Target";
+		case MemoryCategory::Mesh:					return "Mesh";
+		case MemoryCategory::AccelerationStructure:	return "Acceleration Structure";
+		case MemoryCategory::Scratch:				return "Scratch";
+		case MemoryCategory::Staging:				return "Staging";
+		case MemoryCategory::Other:					return "Other";
+		default:									return "Unknown";
+		}
+	}
+
+	void MemoryService::UpdateBudgets()
+	{
+		VmaAllocator allocator = Device::GetAllocator();
+		vmaSetCurrentFrameIndex(allocator, s_FrameIndex);
+
+		const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+		vmaGetMemoryProperties(allocator, &memoryProperties);
+
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetHeapBudgets(allocator, budgets);
+
+		VkDeviceSize deviceLocalUsage = 0;
+
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+		s_Heaps.resize(memoryProperties->memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++)
+		{
+			HeapBudget& heap = s_Heaps[i];
+			heap.Usage = budgets[i].usage;
+			heap.Budget = budgets[i].budget;
+			heap.BlockBytes = budgets[i].statistics.blockBytes;
+			heap.AllocationBytes = budgets[i].statistics.allocationBytes;
+			heap.DeviceLocal = (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+			if (heap.DeviceLocal)
+				deviceLocalUsage += heap.Usage;
+		}
+		lock.unlock();
+
+		VL_PROFILE_COUNTER("Device Local Memory (MB)", deviceLocalUsage / s_MB);
+	}
+
+	void MemoryService::CheckBudgets()
+	{
+		std::vector<OverBudgetInfo> overBudget;
+
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+		s_HeapOverBudgetFrame.resize(s_Heaps.size(), 0);
+		for (uint32_t i = 0; i < (uint32_t)s_Heaps.size(); i++)
+		{
+			const HeapBudget& heap = s_Heaps[i];
+			if (!heap.DeviceLocal || heap.Budget == 0)
+				continue;
+
+			const VkDeviceSize threshold = (VkDeviceSize)((double)heap.Budget * s_Info.OverBudgetThreshold);
+			uint32_t& lastRaised = s_HeapOverBudgetFrame[i];
+			if (heap.Usage <= threshold)
+			{
+				if (lastRaised != 0)
+					VL_CORE_INFO("Memory heap {} is back under budget: {:.1f} / {:.1f} MB", i, heap.Usage / s_MB, heap.Budget / s_MB);
+
+				lastRaised = 0;
+				continue;
+			}
+
+			if (lastRaised != 0 && s_FrameIndex - lastRaised < s_Info.OverBudgetInterval)
+				continue;
+
+			if (lastRaised == 0)
+				VL_CORE_WARN("Memory heap {} is over budget: {:.1f} / {:.1f} MB", i, heap.Usage / s_MB, heap.Budget / s_MB);
+
+			lastRaised = s_FrameIndex;
+			overBudget.push_back({ i, heap.Usage, heap.Budget, heap.Usage - threshold });
+		}
+		lock.unlock();
+
+		if (overBudget.empty())
+			return;
+
+		// Callbacks free memory, which takes the stats lock, and may remove themselves
+		std::vector<OverBudgetCallback> callbacks;
+		{
+			std::unique_lock<std::mutex> callbacksLock(s_CallbacksMutex);
+			for (auto& [id, callback] : s_Callbacks)
+				callbacks.push_back(callback);
+		}
+
+		for (const OverBudgetInfo& info : overBudget)
+		{
+			for (const OverBudgetCallback& callback : callbacks)
+				callback(info);
+		}
+	}
+
+	/**
+	 * @brief Advances the pass in progress: commits its moves once the copies finished and ends it once frames
+	 * that could read the old memory are done. Starts the next pass, or a new defragmentation when it's due.
+	 *
+	 * @return true if moves were committed.
+	 */
+	bool MemoryService::Defragment()
+	{
+		if (s_PassState == PassState::Copying)
+		{
+			// A pass with dropped moves ends right away, before the freed allocations get to the DeleteQueue
+			return CommitDefragmentationPass(s_PassCancelled);
+		}
+
+		if (s_PassState == PassState::Committed)
+		{
+			if (s_FrameIndex - s_PassCommitFrame < s_Info.FramesInFlight)
+				return false;
+
+			EndDefragmentationPass();
+		}
+
+		if (s_DefragmentationContext == VK_NULL_HANDLE)
+		{
+			const bool due = s_Info.DefragmentationInterval != 0 && s_FrameIndex % s_Info.DefragmentationInterval == 0;
+			if (!due && !s_DefragmentationRequested.load(std::memory_order_relaxed))
+				return false;
+
+			if (!BeginDefragmentation())
+				return false;
+		}
+
+		BeginDefragmentationPass();
+
+		return false;
+	}
+
+	/**
+	 * @brief Picks the image pool with the most free space inside its blocks and starts defragmenting it.
+	 *
+	 * @return false if no pool is worth compacting.
+	 */
+	bool MemoryService::BeginDefragmentation()
+	{
+		const bool requested = s_DefragmentationRequested.exchange(false, std::memory_order_relaxed);
+
+		{
+			std::unique_lock<std::mutex> lock(s_MoveMutex);
+			if (s_MoveHandlers.empty())
+				return false;
+		}
+
+		VmaPool bestPool = VK_NULL_HANDLE;
+		float bestFreeFraction = 0.0f;
+		for (VmaPool pool : Device::GetImagePools())
+		{
+			VmaDetailedStatistics stats{};
+			vmaCalculatePoolStatistics(Device::GetAllocator(), pool, &stats);
+
+			const VmaStatistics& statistics = stats.statistics;
+			if (statistics.blockCount == 0)
+				continue;
+
+			// Unless asked to, only compact pools where it can give at least a whole block back
+			const VkDeviceSize freeBytes = statistics.blockBytes - statistics.allocationBytes;
+			if (!requested && freeBytes < statistics.blockBytes / statistics.blockCount)
+				continue;
+
+			const float freeFraction = (float)freeBytes / (float)statistics.blockBytes;
+			if (freeFraction > bestFreeFraction)
+			{
+				bestFreeFraction = freeFraction;
+				bestPool = pool;
+			}
+		}
+
+		if (bestPool == VK_NULL_HANDLE || (!requested && bestFreeFraction < s_Info.DefragmentationThreshold))
+			return false;
+
+		VmaDefragmentationInfo info{};
+		info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+		info.pool = bestPool;
+		info.maxBytesPerPass = s_Info.MaxBytesPerPass;
+		info.maxAllocationsPerPass = s_Info.MaxMovesPerPass;
+
+		if (vmaBeginDefragmentation(Device::GetAllocator(), &info, &s_DefragmentationContext) != VK_SUCCESS)
+		{
+			VL_CORE_WARN("Failed to begin defragmentation!");
+			s_DefragmentationContext = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VL_CORE_TRACE("Defragmenting image pool, {:.1f}% of its memory is free", bestFreeFraction * 100.0f);
+		return true;
+	}
+
+	void MemoryService::EndDefragmentation()
+	{
+		VmaDefragmentationStats stats{};
+		vmaEndDefragmentation(Device::GetAllocator(), s_DefragmentationContext, &stats);
+		s_DefragmentationContext = VK_NULL_HANDLE;
+
+		VL_CORE_INFO("Defragmentation moved {} allocations ({:.1f} MB) and freed {} blocks ({:.1f} MB)",
+			stats.allocationsMoved, stats.bytesMoved / s_MB, stats.deviceMemoryBlocksFreed, stats.bytesFreed / s_MB);
+	}
+
+	/**
+	 * @brief Records copies of the allocations VMA picked for this pass and submits them with a fence. Allocations
+	 * without a move handler are left in place.
+	 */
+	void MemoryService::BeginDefragmentationPass()
+	{
+		VL_PROFILE_FUNCTION();
+
+		s_Pass = {};
+		if (vmaBeginDefragmentationPass(Device::GetAllocator(), s_DefragmentationContext, &s_Pass) == VK_SUCCESS)
+		{
+			EndDefragmentation();
+			return;
+		}
+
+		std::unique_lock<std::mutex> moveLock(s_MoveMutex);
+
+		s_PassMoves.clear();
+		s_PassCancelled = false;
+		for (uint32_t i = 0; i < s_Pass.moveCount; i++)
+		{
+			VmaDefragmentationMove& move = s_Pass.pMoves[i];
+
+			auto iter = s_MoveHandlers.find(move.srcAllocation);
+			if (iter == s_MoveHandlers.end())
+			{
+				// Nothing knows how to recreate the resource, so it stays where it is
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			s_PassMoves.emplace_back(i, iter->second);
+		}
+
+		if (s_PassMoves.empty())
+		{
+			moveLock.unlock();
+			EndDefragmentationPass();
+			return;
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = s_CommandPool;
+		allocInfo.commandBufferCount = 1;
+		vkAllocateCommandBuffers(Device::GetDevice(), &allocInfo, &s_PassCmd);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(s_PassCmd, &beginInfo);
+
+		{
+			std::vector<std::unique_lock<std::mutex>> handlerLocks = LockHandlers(s_PassMoves);
+			for (size_t i = 0; i < s_PassMoves.size();)
+			{
+				auto& [index, handler] = s_PassMoves[i];
+				if (handler.Copy(s_Pass.pMoves[index].dstTmpAlloc, s_PassCmd))
+				{
+					i++;
+					continue;
+				}
+
+				s_Pass.pMoves[index].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				s_PassMoves.erase(s_PassMoves.begin() + i);
+			}
+		}
+
+		vkEndCommandBuffer(s_PassCmd);
+
+		// Frames go to the same queue, barriers of the copies order them against the frames before and after
+		{
+			std::unique_lock<std::mutex> queueLock(Device::GetGraphicsQueueMutex());
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &s_PassCmd;
+			VL_CORE_RETURN_ASSERT(vkQueueSubmit(Device::GetGraphicsQueue(), 1, &submitInfo, s_PassFence),
+				VK_SUCCESS,
+				"Failed to submit defragmentation copies!"
+			);
+		}
+
+		s_PassState = PassState::Copying;
+	}
+
+	/**
+	 * @brief Switches the moved resources to their new memory once the copies finished. When a move was dropped
+	 * in the meantime, the remaining ones are aborted instead so that the pass can end right away.
+	 *
+	 * @param wait - Blocks until the copies finish instead of returning when they haven't yet.
+	 *
+	 * @return true if any move was committed.
+	 */
+	bool MemoryService::CommitDefragmentationPass(bool wait)
+	{
+		if (!wait && vkGetFenceStatus(Device::GetDevice(), s_PassFence) != VK_SUCCESS)
+			return false;
+
+		vkWaitForFences(Device::GetDevice(), 1, &s_PassFence, VK_TRUE, UINT64_MAX);
+		vkResetFences(Device::GetDevice(), 1, &s_PassFence);
+		vkFreeCommandBuffers(Device::GetDevice(), s_CommandPool, 1, &s_PassCmd);
+		s_PassCmd = VK_NULL_HANDLE;
+
+		std::unique_lock<std::mutex> moveLock(s_MoveMutex);
+
+		const bool abort = s_PassCancelled;
+		{
+			std::vector<std::unique_lock<std::mutex>> handlerLocks = LockHandlers(s_PassMoves);
+			for (auto& [index, handler] : s_PassMoves)
+			{
+				if (abort)
+				{
+					s_Pass.pMoves[index].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+					handler.Abort();
+				}
+				else
+				{
+					handler.Commit();
+				}
+			}
+		}
+
+		const bool committed = !abort && !s_PassMoves.empty();
+		s_PassState = PassState::Committed;
+		s_PassCommitFrame = s_FrameIndex;
+		moveLock.unlock();
+
+		// Nothing uses the new memory of aborted moves, so there's no need to wait for frames in flight
+		if (abort)
+			EndDefragmentationPass();
+
+		return committed;
+	}
+
+	/**
+	 * @brief Hands the pass back to VMA, which frees the memory the resources moved out of.
+	 */
+	void MemoryService::EndDefragmentationPass()
+	{
+		std::unique_lock<std::mutex> moveLock(s_MoveMutex);
+
+		const bool finished = vmaEndDefragmentationPass(Device::GetAllocator(), s_DefragmentationContext, &s_Pass) == VK_SUCCESS;
+		s_PassMoves.clear();
+		s_PassCancelled = false;
+		s_PassState = PassState::None;
+		moveLock.unlock();
+
+		if (finished)
+			EndDefragmentation();
+	}
+
+	/**
+	 * @brief Handlers usually share a mutex, each one is taken once and always in the same order.
+	 */
+	std::vector<std::unique_lock<std::mutex>> MemoryService::LockHandlers(const std::vector<std::pair<uint32_t, MoveHandler>>& moves)
+	{
+		std::vector<std::mutex*> mutexes;
+		for (const auto& [index, handler] : moves)
+		{
+			if (handler.Lock != nullptr && std::find(mutexes.begin(), mutexes.end(), handler.Lock) == mutexes.end())
+				mutexes.push_back(handler.Lock);
+		}
+
+		std::sort(mutexes.begin(), mutexes.end());
+
+		std::vector<std::unique_lock<std::mutex>> locks;
+		for (std::mutex* mutex : mutexes)
+			locks.emplace_back(*mutex);
+
+		return locks;
+	}
+
+}
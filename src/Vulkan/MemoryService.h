@@ -0,0 +1,166 @@
+#pragma once
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace Vulture
+{
+	enum class MemoryCategory : uint8_t
+	{
+		Auto, // Picked from the usage flags of the resource
+		Texture,
+		RenderTarget,
+		Mesh,
+		AccelerationStructure,
+		Scratch,
+		Staging,
+		Other,
+
+		Count
+	};
+
+	// Keeps track of device memory. Every allocation made through Device is counted under a category, heap budgets
+	// are read from VK_EXT_memory_budget once per frame (VMA estimates them when the extension is missing) and
+	// callbacks are raised when a device local heap gets close to its budget, so that the application can free
+	// memory. Nothing is freed automatically.
+	//
+	// Image pools are compacted with incremental VMA defragmentation. Copies of a pass are submitted with a fence,
+	// resources switch to their new memory once it signaled and the old memory is released after the frames in
+	// flight that could still read it have finished. Only allocations with a registered MoveHandler are moved,
+	// everything else stays where it is.
+	class MemoryService
+	{
+	public:
+		struct CreateInfo
+		{
+			float OverBudgetThreshold = 0.9f; // Fraction of a heap's budget above which the callbacks are raised
+			uint32_t OverBudgetInterval = 60; // Frames between callbacks while the heap stays over the threshold
+			uint32_t DefragmentationInterval = 300; // Frames between checks whether the image pools are worth compacting
+			float DefragmentationThreshold = 0.25f; // Fraction of a pool's memory that has to be free to start compacting it
+			VkDeviceSize MaxBytesPerPass = 64 * 1024 * 1024;
+			uint32_t MaxMovesPerPass = 16;
+			uint32_t FramesInFlight = 2; // Frames the old memory of moved resources is kept for, set by Application
+		};
+
+		struct HeapBudget
+		{
+			VkDeviceSize Usage = 0; // Whole process, including other APIs
+			VkDeviceSize Budget = 0;
+			VkDeviceSize BlockBytes = 0; // Allocated by VMA
+			VkDeviceSize AllocationBytes = 0; // Used by resources inside the VMA blocks
+			bool DeviceLocal = false;
+		};
+
+		struct CategoryStats
+		{
+			uint64_t AllocationCount = 0;
+			VkDeviceSize Bytes = 0;
+			VkDeviceSize PeakBytes = 0;
+		};
+
+		struct OverBudgetInfo
+		{
+			uint32_t HeapIndex = 0;
+			VkDeviceSize Usage = 0;
+			VkDeviceSize Budget = 0;
+			VkDeviceSize BytesToFree = 0; // Brings the usage back under the threshold
+		};
+
+		using OverBudgetCallback = std::function<void(const OverBudgetInfo& info)>;
+
+		// Moves a resource into new memory during defragmentation. Both functions are called from the thread that
+		// calls Update(), Commit a frame or more after Copy. The old resource may still be used by frames in flight
+		// in the meantime and after Commit, so it has to be retired through the DeleteQueue.
+		struct MoveHandler
+		{
+			std::function<bool(VmaAllocation allocation, VkCommandBuffer cmd)> Copy; // Record the copy into memory of the allocation, false skips the move
+			std::function<void()> Commit; // The copy finished, switch to the new resource and retire the old one
+			std::function<void()> Abort; // The move was dropped after Copy, destroy the new resource
+			std::mutex* Lock = nullptr; // Optional, held while Copy, Commit and Abort run. Writes in between have to be held back by the owner
+		};
+
+		static void Init(const CreateInfo& createInfo);
+		static void Destroy();
+		static bool Update();
+
+		static void Track(VmaAllocation allocation, MemoryCategory category);
+		static void Untrack(VmaAllocation allocation);
+		static MemoryCategory ResolveCategory(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags memoryFlags, MemoryCategory category);
+		static MemoryCategory ResolveCategory(const VkImageCreateInfo& createInfo, MemoryCategory category);
+
+		static void SetMoveHandler(VmaAllocation allocation, const MoveHandler& handler);
+		static void ClearMoveHandler(VmaAllocation allocation);
+		static void RequestDefragmentation();
+
+		static uint32_t AddOverBudgetCallback(const OverBudgetCallback& callback);
+		static void RemoveOverBudgetCallback(uint32_t id);
+
+		static std::vector<HeapBudget> GetHeapBudgets();
+		static CategoryStats GetCategoryStats(MemoryCategory category);
+		static void LogStats();
+
+		static const char* CategoryToString(MemoryCategory category);
+
+		static inline bool IsInitialized() { return s_Initialized; }
+
+		MemoryService() = delete;
+		~MemoryService() = delete;
+
+	private:
+		struct TrackedAllocation
+		{
+			MemoryCategory Category;
+			VkDeviceSize Size;
+		};
+
+		static void UpdateBudgets();
+		static void CheckBudgets();
+		static bool Defragment();
+		static bool BeginDefragmentation();
+		static void EndDefragmentation();
+		static void BeginDefragmentationPass();
+		static bool CommitDefragmentationPass(bool wait);
+		static void EndDefragmentationPass();
+		static std::vector<std::unique_lock<std::mutex>> LockHandlers(const std::vector<std::pair<uint32_t, MoveHandler>>& moves);
+
+		enum class PassState : uint8_t
+		{
+			None,
+			Copying, // Copies were submitted, waiting for the fence
+			Committed // Resources use the new memory, waiting for frames in flight before the old memory is released
+		};
+
+		inline static bool s_Initialized = false;
+		static CreateInfo s_Info;
+		inline static uint32_t s_FrameIndex = 0;
+
+		inline static std::mutex s_StatsMutex;
+		inline static std::unordered_map<VmaAllocation, TrackedAllocation> s_Allocations;
+		static CategoryStats s_Categories[(int)MemoryCategory::Count];
+		inline static std::vector<HeapBudget> s_Heaps;
+		inline static std::vector<uint32_t> s_HeapOverBudgetFrame; // Frame the callbacks were last raised for the heap, 0 when it's under the threshold
+
+		inline static std::mutex s_CallbacksMutex;
+		inline static std::unordered_map<uint32_t, OverBudgetCallback> s_Callbacks;
+		inline static uint32_t s_NextCallbackID = 1;
+
+		inline static std::mutex s_MoveMutex; // Guards the handlers and the moves of the current pass
+		inline static std::unordered_map<VmaAllocation, MoveHandler> s_MoveHandlers;
+		inline static VmaDefragmentationContext s_DefragmentationContext = VK_NULL_HANDLE;
+		inline static std::atomic<bool> s_DefragmentationRequested = false;
+
+		inline static PassState s_PassState = PassState::None;
+		inline static VmaDefragmentationPassMoveInfo s_Pass{};
+		inline static std::vector<std::pair<uint32_t, MoveHandler>> s_PassMoves; // Index into s_Pass.pMoves and the handler that copied it
+		inline static bool s_PassCancelled = false; // A moved allocation lost its handler before the commit
+		inline static uint32_t s_PassCommitFrame = 0;
+		inline static VkCommandPool s_CommandPool = VK_NULL_HANDLE;
+		inline static VkCommandBuffer s_PassCmd = VK_NULL_HANDLE;
+		inline static VkFence s_PassFence = VK_NULL_HANDLE;
+	};
+
+}
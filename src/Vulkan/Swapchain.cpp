@@ -19,7 +19,11 @@ namespace Vulture
 		m_OldSwapchain = createInfo.PreviousSwapchain;
 		m_WindowExtent = createInfo.WindowExtent;
 		m_SwapchainDepthFormat = FindDepthFormat();
-		CreateSwapchain(createInfo.PrefferedPresentMode);
+		m_Headless = createInfo.Headless;
+		if (m_Headless)
+			CreateOffscreenImages();
+		else
+			CreateSwapchain(createInfo.PrefferedPresentMode);
 		CreateImageViews();
 		CreateRenderPass();
 		CreateFramebuffers();
@@ -44,6 +48,12 @@ namespace Vulture
 			m_Swapchain = 0;
 		}
 
+		for (uint32_t i = 0; i < (uint32_t)m_OffscreenAllocations.size(); i++)
+		{
+			MemoryService::Untrack(m_OffscreenAllocations[i]);
+			vmaDestroyImage(Device::GetAllocator(), m_PresentableImages[i], m_OffscreenAllocations[i]);
+		}
+
 		for (auto framebuffer : m_PresentableFramebuffers) { vkDestroyFramebuffer(Device::GetDevice(), framebuffer, nullptr); }
 
 		// cleanup synchronization objects
@@ -78,6 +88,7 @@ namespace Vulture
 		m_CurrentFrame				= std::move(other.m_CurrentFrame);
 		m_PresentableFramebuffers	= std::move(other.m_PresentableFramebuffers);
 		m_PresentableImages			= std::move(other.m_PresentableImages);
+		m_OffscreenAllocations		= std::move(other.m_OffscreenAllocations);
 		m_PresentableImageViews		= std::move(other.m_PresentableImageViews);
 		m_ImageAvailableSemaphores	= std::move(other.m_ImageAvailableSemaphores);
 		m_RenderFinishedSemaphores	= std::move(other.m_RenderFinishedSemaphores);
@@ -87,6 +98,7 @@ namespace Vulture
 		m_SwapchainDepthFormat		= std::move(other.m_SwapchainDepthFormat);
 		m_SwapchainExtent			= std::move(other.m_SwapchainExtent);
 		m_RenderPass				= std::move(other.m_RenderPass);
+		m_Headless					= std::move(other.m_Headless);
 		m_Initialized				= std::move(other.m_Initialized);
 
 		other.Reset();
@@ -106,6 +118,7 @@ namespace Vulture
 		m_CurrentFrame = std::move(other.m_CurrentFrame);
 		m_PresentableFramebuffers = std::move(other.m_PresentableFramebuffers);
 		m_PresentableImages = std::move(other.m_PresentableImages);
+		m_OffscreenAllocations = std::move(other.m_OffscreenAllocations);
 		m_PresentableImageViews = std::move(other.m_PresentableImageViews);
 		m_ImageAvailableSemaphores = std::move(other.m_ImageAvailableSemaphores);
 		m_RenderFinishedSemaphores = std::move(other.m_RenderFinishedSemaphores);
@@ -115,6 +128,7 @@ namespace Vulture
 		m_SwapchainDepthFormat = std::move(other.m_SwapchainDepthFormat);
 		m_SwapchainExtent = std::move(other.m_SwapchainExtent);
 		m_RenderPass = std::move(other.m_RenderPass);
+		m_Headless = std::move(other.m_Headless);
 		m_Initialized = std::move(other.m_Initialized);
 
 		other.Reset();
@@ -305,6 +319,49 @@ namespace Vulture
 		m_SwapchainExtent = extent;
 	}
 
+	/*
+	 * @brief Creates the offscreen image ring used instead of swapchain images in headless mode. One image
+	 * per frame in flight, so the image index always equals the frame index.
+	 */
+	void Swapchain::CreateOffscreenImages()
+	{
+		m_SwapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		m_SwapchainExtent = m_WindowExtent;
+		FindPresentModes({});
+
+		m_PresentableImages.resize(m_MaxFramesInFlight);
+		m_OffscreenAllocations.resize(m_MaxFramesInFlight);
+		for (uint32_t i = 0; i < m_MaxFramesInFlight; i++)
+		{
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = m_SwapchainImageFormat;
+			imageInfo.extent = { m_SwapchainExtent.width, m_SwapchainExtent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			Device::CreateImage(imageInfo, m_PresentableImages[i], m_OffscreenAllocations[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			Image::TransitionImageLayout(
+				m_PresentableImages[i],
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				GetPresentableLayout(),
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0,
+				0
+			);
+
+			Device::SetObjectName(VK_OBJECT_TYPE_IMAGE, (uint64_t)m_PresentableImages[i], "Offscreen Presentable Image");
+		}
+	}
+
 	/*
 	 * @brief Creates image views for the presentable images in the swapchain.
 	 */
@@ -345,7 +402,7 @@ namespace Vulture
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = GetPresentableLayout();
 
 		VkAttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
@@ -431,6 +488,7 @@ namespace Vulture
 		m_CurrentFrame = 0;
 		m_PresentableFramebuffers.clear();
 		m_PresentableImages.clear();
+		m_OffscreenAllocations.clear();
 		m_PresentableImageViews.clear();
 		m_ImageAvailableSemaphores.clear();
 		m_RenderFinishedSemaphores.clear();
@@ -440,6 +498,7 @@ namespace Vulture
 		m_SwapchainDepthFormat = VK_FORMAT_UNDEFINED;
 		m_SwapchainExtent = { 0, 0 };
 		m_RenderPass = {};
+		m_Headless = false;
 		m_Initialized = false;
 	}
 
@@ -481,6 +540,8 @@ namespace Vulture
 	 */
 	VkResult Swapchain::SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t& imageIndex)
 	{
+		Timer timer;
+
 		if (m_ImagesInFlight[imageIndex] != VK_NULL_HANDLE) 
 		{
 			vkWaitForFences(Device::GetDevice(), 1, &m_ImagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
@@ -490,6 +551,27 @@ namespace Vulture
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+		// Offscreen images are free as soon as the frame fence is, there is nothing to wait for or present
+		if (m_Headless)
+		{
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = buffers;
+
+			std::unique_lock<std::mutex> lock(Device::GetGraphicsQueueMutex());
+			vkResetFences(Device::GetDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
+			VL_CORE_RETURN_ASSERT(vkQueueSubmit(Device::GetGraphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrame]),
+				VK_SUCCESS,
+				"failed to submit draw command buffer!"
+			);
+
+			m_LastSubmitMs = timer.ElapsedMillis();
+			m_LastPresentMs = 0.0f;
+
+			m_CurrentFrame = (m_CurrentFrame + 1) % m_MaxFramesInFlight;
+
+			return VK_SUCCESS;
+		}
+
 		VkSemaphore waitSemaphores = m_ImageAvailableSemaphores[m_CurrentFrame];
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 		submitInfo.waitSemaphoreCount = 1;
@@ -510,6 +592,9 @@ namespace Vulture
 			"failed to submit draw command buffer!"
 		);
 
+		m_LastSubmitMs = timer.ElapsedMillis();
+		timer.Reset();
+
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -523,6 +608,7 @@ namespace Vulture
 		presentInfo.pImageIndices = &imageIndex;
 
 		auto result = vkQueuePresentKHR(Device::GetPresentQueue(), &presentInfo);
+		m_LastPresentMs = timer.ElapsedMillis();
 
 		m_CurrentFrame = (m_CurrentFrame + 1) % m_MaxFramesInFlight;
 
@@ -540,6 +626,12 @@ namespace Vulture
 	{
 		vkWaitForFences(Device::GetDevice(), 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
 
+		if (m_Headless)
+		{
+			imageIndex = m_CurrentFrame;
+			return VK_SUCCESS;
+		}
+
 		VkResult result = vkAcquireNextImageKHR(Device::GetDevice(), m_Swapchain, std::numeric_limits<uint64_t>::max(), m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
 
 		return result;
@@ -32,6 +32,9 @@ namespace Vulture
 			PresentModes PrefferedPresentMode = PresentModes::VSync;
 			uint32_t MaxFramesInFlight = 0;
 			Ref<Swapchain> PreviousSwapchain = nullptr;
+
+			// Renders into a ring of MaxFramesInFlight offscreen images instead of a surface, present becomes a no-op
+			bool Headless = false;
 		};
 
 		void Init(const CreateInfo& createInfo);
@@ -60,6 +63,11 @@ namespace Vulture
 		inline VkExtent2D GetSwapchainExtent() const { return m_SwapchainExtent; }
 
 		inline bool IsInitialized() const { return m_Initialized; }
+		inline bool IsHeadless() const { return m_Headless; }
+
+		// Layout the presentable images are in outside of the frame. Offscreen images are never presented so they're
+		// kept ready for readback instead
+		inline VkImageLayout GetPresentableLayout() const { return m_Headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
 
 		inline const std::vector<PresentMode>& GetAvailablePresentModes() const { return m_AvailablePresentModes; }
 		inline PresentModes GetCurrentPresentMode() const { return m_CurrentPresentMode; }
@@ -69,11 +77,17 @@ namespace Vulture
 		VkResult SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t& imageIndex);
 		VkResult AcquireNextImage(uint32_t& imageIndex);
 
+		// CPU time of the last SubmitCommandBuffers call, split into the queue submit (including the wait for
+		// the image to be free) and the present
+		inline float GetLastSubmitTime() const { return m_LastSubmitMs; }
+		inline float GetLastPresentTime() const { return m_LastPresentMs; }
+
 		bool CompareSwapFormats(const Swapchain& swapChain) const { return swapChain.m_SwapchainDepthFormat == m_SwapchainDepthFormat && swapChain.m_SwapchainImageFormat == m_SwapchainImageFormat; }
 
 		static VkFormat FindDepthFormat();
 	private:
 		void CreateSwapchain(const PresentModes& prefferedPresentMode);
+		void CreateOffscreenImages();
 		void CreateImageViews();
 		void CreateRenderPass();
 		void CreateFramebuffers();
@@ -97,7 +111,11 @@ namespace Vulture
 		uint32_t m_CurrentFrame = 0;
 		std::vector<VkFramebuffer> m_PresentableFramebuffers;
 
+		float m_LastSubmitMs = 0.0f;
+		float m_LastPresentMs = 0.0f;
+
 		std::vector<VkImage> m_PresentableImages;
+		std::vector<VmaAllocation> m_OffscreenAllocations; // Only in headless mode, swapchain images are owned by the driver
 		std::vector<VkImageView> m_PresentableImageViews;
 
 		std::vector<VkSemaphore> m_ImageAvailableSemaphores;
@@ -111,6 +129,8 @@ namespace Vulture
 
 		VkRenderPass m_RenderPass{};
 
+		bool m_Headless = false;
+
 		bool m_Initialized = false;
 
 		void Reset();
@@ -15,6 +15,8 @@
 #include "Vulture/src/Vulture/Math/Transform.h"
 #include "Vulture/src/Vulture/Renderer/AccelerationStructure.h"
 #include "Vulture/src/Vulture/Renderer/Denoiser.h"
+#include "Vulture/src/Vulture/Renderer/RenderGraph.h"
+#include "Vulture/src/Vulture/Renderer/GpuProfiler.h"
 #include "Vulture/src/Vulkan/SBT.h"
 #include "Vulture/src/Vulkan/PushConstant.h"
 #include "Vulture/src/Vulkan/Shader.h"
@@ -225,7 +225,7 @@ namespace Vulture
 
 	void MaterialTextures::CreateSet()
 	{
-		if (TexturesSet.IsInitialized())
+		if (IsSetCreated())
 			return;
 
 		Vulture::DescriptorSetLayout::Binding bin1{ 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT };
@@ -233,38 +233,76 @@ namespace Vulture
 		Vulture::DescriptorSetLayout::Binding bin3{ 2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT };
 		Vulture::DescriptorSetLayout::Binding bin4{ 3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT };
 
-		TexturesSet.Init(&Vulture::Renderer::GetDescriptorPool(), { bin1, bin2, bin3, bin4 });
-
 		AlbedoTexture.WaitToLoad();
-		TexturesSet.AddImageSampler(
-			0,
-			{ Vulture::Renderer::GetLinearRepeatSampler().GetSamplerHandle(),
-			AlbedoTexture.GetImage()->GetImageView(),
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
-		);
 		NormalTexture.WaitToLoad();
-		TexturesSet.AddImageSampler(
-			1,
-			{ Vulture::Renderer::GetLinearRepeatSampler().GetSamplerHandle(),
-			NormalTexture.GetImage()->GetImageView(),
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
-		);
 		RoughnessTexture.WaitToLoad();
-		TexturesSet.AddImageSampler(
-			2,
-			{ Vulture::Renderer::GetLinearRepeatSampler().GetSamplerHandle(),
-			RoughnessTexture.GetImage()->GetImageView(),
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
-		);
 		MetallnessTexture.WaitToLoad();
-		TexturesSet.AddImageSampler(
-			3,
-			{ Vulture::Renderer::GetLinearRepeatSampler().GetSamplerHandle(),
-			MetallnessTexture.GetImage()->GetImageView(),
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
-		);
-
-		TexturesSet.Build();
+
+		const AssetHandle* textures[] = { &AlbedoTexture, &NormalTexture, &RoughnessTexture, &MetallnessTexture };
+
+		TexturesSets.resize(Vulture::Renderer::GetMaxFramesInFlight());
+		for (Vulture::DescriptorSet& set : TexturesSets)
+		{
+			set.Init(&Vulture::Renderer::GetDescriptorPool(), { bin1, bin2, bin3, bin4 });
+
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				set.AddImageSampler(
+					i,
+					{ Vulture::Renderer::GetLinearRepeatSampler().GetSamplerHandle(),
+					textures[i]->GetImage()->GetImageView(),
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+				);
+			}
+
+			set.Build();
+		}
+
+		StaleSetMask = 0;
+	}
+
+	/**
+	 * @brief Marks every set as stale after image views of the textures changed. Each set is rewritten with
+	 * UpdateSet(frameIndex) at the beginning of its frame, the others may still be in use by the GPU.
+	 */
+	void MaterialTextures::UpdateSet()
+	{
+		VL_CORE_ASSERT(IsSetCreated(), "Textures set not created!");
+
+		StaleSetMask = (1u << (uint32_t)TexturesSets.size()) - 1;
+	}
+
+	/**
+	 * @brief Rewrites all texture bindings of the frame's set with current image views if the set is stale.
+	 * The frame that used the set last has to be finished.
+	 */
+	void MaterialTextures::UpdateSet(uint32_t frameIndex)
+	{
+		if ((StaleSetMask & (1u << frameIndex)) == 0)
+			return;
+
+		const AssetHandle* textures[] = { &AlbedoTexture, &NormalTexture, &RoughnessTexture, &MetallnessTexture };
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			TexturesSets[frameIndex].UpdateImageSampler(
+				i,
+				{ Vulture::Renderer::GetLinearRepeatSampler().GetSamplerHandle(),
+				textures[i]->GetImage()->GetImageView(),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+			);
+		}
+
+		StaleSetMask &= ~(1u << frameIndex);
+	}
+
+	/**
+	 * @brief Returns the set of the frame that's currently being recorded.
+	 */
+	Vulture::DescriptorSet& MaterialTextures::GetSet()
+	{
+		VL_CORE_ASSERT(IsSetCreated(), "Textures set not created!");
+
+		return TexturesSets[Vulture::Renderer::GetCurrentFrameIndex()];
 	}
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "Vulkan/Image.h"
 #include "Scene/Scene.h"
 #include "Renderer/Mesh.h"
+#include "TextureStreamer.h"
 
 namespace Vulture
 {
@@ -111,9 +112,18 @@ namespace Vulture
 		AssetHandle RoughnessTexture;
 		AssetHandle MetallnessTexture;
 
-		Vulture::DescriptorSet TexturesSet;
+		// One set per frame in flight, a set is only rewritten once the frame that used it last has finished. This
+		// replaces the single TexturesSet member, bind GetSet() (the set of the frame being recorded) instead
+		std::vector<Vulture::DescriptorSet> TexturesSets;
+		uint32_t StaleSetMask = 0; // Sets that still reference image views from before the last UpdateSet()
 
 		void CreateSet();
+		void UpdateSet();
+		void UpdateSet(uint32_t frameIndex);
+
+		Vulture::DescriptorSet& GetSet();
+		inline Vulture::DescriptorSet& GetSet(uint32_t frameIndex) { return TexturesSets[frameIndex]; }
+		inline bool IsSetCreated() const { return !TexturesSets.empty(); }
 	};
 
 	class Material
@@ -129,7 +139,7 @@ namespace Vulture
 	{
 	public:
 		explicit TextureAsset(Image&& image) { Image = std::move(image); };
-		~TextureAsset() {};
+		~TextureAsset() { TextureStreamer::Unregister(&Image); };
 		explicit TextureAsset(const TextureAsset& other) = delete;
 		TextureAsset& operator=(const TextureAsset& other) = delete;
 		explicit TextureAsset(TextureAsset&& other) noexcept { Image = std::move(other.Image); }
@@ -5,13 +5,22 @@
 #include <stb_image.h>
 
 #include "AssetManager.h"
+#include "TextureCooker.h"
+#include "TextureStreamer.h"
+#include "Renderer/MeshOptimizer.h"
+#include "Renderer/MeshSimplifier.h"
+#include "Renderer/MeshletBuilder.h"
+#include "Utility/Parallel.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
 namespace Vulture
 {
-	Image AssetImporter::ImportTexture(std::string path, bool HDR)
+	/**
+	 * @brief Returns path under which the texture file actually lives. Model files store spaces in texture names as '%'.
+	 */
+	std::string AssetImporter::ResolveTexturePath(std::string path)
 	{
 		for (int i = 0; i < path.size(); i++)
 		{
@@ -19,95 +28,265 @@ namespace Vulture
 				path[i] = ' ';
 		}
 
-		int texChannels;
-		bool flipOnLoad = !HDR;
-		stbi_set_flip_vertically_on_load_thread(flipOnLoad);
-		int sizeX, sizeY;
-		void* pixels;
-		if (HDR)
+		return path;
+	}
+
+	/**
+	 * @brief Loads a texture, builds its mip chain and compresses it according to its usage.
+	 * Cooked result is cached next to the source file so that subsequent loads skip decoding and compression.
+	 * Only the mip tail (see TextureStreamer::GetTailMipLevel) is uploaded when the cache can be mapped, the rest
+	 * is streamed in after TextureStreamer::Register is called for the image. Environment maps are always uploaded whole.
+	 *
+	 * @param path - Path to the source image.
+	 * @param usage - What the texture is used for, see TextureUsage.
+	 */
+	Image AssetImporter::ImportTexture(std::string path, TextureUsage usage)
+	{
+		VL_PROFILE_FUNCTION();
+		Timer timer;
+
+		path = ResolveTexturePath(path);
+
+		const bool HDR = usage == TextureUsage::HDR || usage == TextureUsage::Environment;
+		const bool compress = Device::IsTextureCompressionBCSupported();
+		const std::string cachePath = TextureCooker::GetCachePath(path);
+
+		MappedFile cacheFile;
+		TextureCooker::MappedTexture mapped;
+		bool cached = false;
+		if (std::filesystem::exists(cachePath))
 		{
-			pixels = stbi_loadf(path.c_str(), &sizeX, &sizeY, &texChannels, STBI_rgb_alpha);
+			cacheFile.Init({ cachePath });
+			cached = TextureCooker::OpenFromCache(cacheFile, path, usage, compress, mapped);
 		}
-		else
+
+		TextureCooker::CookedTexture cooked;
+		void* pixels = nullptr;
+		if (!cached)
 		{
-			pixels = stbi_load(path.c_str(), &sizeX, &sizeY, &texChannels, STBI_rgb_alpha);
-		}
+			int texChannels;
+			bool flipOnLoad = !HDR;
+			stbi_set_flip_vertically_on_load_thread(flipOnLoad);
+			int sizeX, sizeY;
+			if (HDR)
+			{
+				pixels = stbi_loadf(path.c_str(), &sizeX, &sizeY, &texChannels, STBI_rgb_alpha);
+			}
+			else
+			{
+				pixels = stbi_load(path.c_str(), &sizeX, &sizeY, &texChannels, STBI_rgb_alpha);
+			}
 
-		std::filesystem::path cwd = std::filesystem::current_path();
-		VL_CORE_ASSERT(pixels, "failed to load texture image! Path: {0}, Current working directory: {1}", path, cwd.string());
-		uint64_t sizeOfPixel = HDR ? sizeof(float) * 4 : sizeof(uint8_t) * 4;
-		VkDeviceSize imageSize = (uint64_t)sizeX * (uint64_t)sizeY * sizeOfPixel;
+			std::filesystem::path cwd = std::filesystem::current_path();
+			VL_CORE_ASSERT(pixels, "failed to load texture image! Path: {0}, Current working directory: {1}", path, cwd.string());
+
+			cooked.Width = sizeX;
+			cooked.Height = sizeY;
+		}
 
 		Image::CreateInfo info{};
 		info.Aspect = VK_IMAGE_ASPECT_COLOR_BIT;
-		info.Format = HDR ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
-		info.Height = sizeY;
-		info.Width = sizeX;
 		info.Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		info.Usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-		info.Data = (void*)pixels;
-		info.HDR = HDR;
-		info.MipMapCount = glm::min(5, (int)glm::floor(glm::log2((float)glm::max(sizeX, sizeY))));
+
+		// Environment maps aren't streamed, importance sampling needs the full resolution level right away
+		if (usage == TextureUsage::Environment && cached)
+		{
+			info.Format = mapped.Format;
+			info.Width = mapped.Width;
+			info.Height = mapped.Height;
+			info.MipMapCount = (int)mapped.Mips.size() - 1;
+			Image image(info);
+
+			// Cached level 0 already has the PDF in alpha, only the table has to be loaded
+			image.LoadHDRSamplingBuffer(mapped.Mips[0].Data, path + ".envaccel");
+
+			std::vector<const void*> mipData;
+			std::vector<uint64_t> mipSizes;
+			for (const TextureCooker::MappedTexture::Level& level : mapped.Mips)
+			{
+				mipData.push_back(level.Data);
+				mipSizes.push_back(level.Size);
+			}
+			image.WriteMipLevels(mipData, mipSizes);
+
+			VL_CORE_INFO("Imported environment map {} from cache in {}ms", path, timer.ElapsedMillis());
+			return Image(std::move(image));
+		}
+
+		if (usage == TextureUsage::Environment)
+		{
+			info.Format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			info.Width = cooked.Width;
+			info.Height = cooked.Height;
+			info.MipMapCount = TextureCooker::GetMipCount(cooked.Width, cooked.Height) - 1;
+			Image image(info);
+
+			// Writes importance sampling PDF into the alpha channel, so it has to happen before cooking
+			image.CreateHDRSamplingBuffer(pixels, path + ".envaccel");
+			cooked = TextureCooker::Cook(pixels, cooked.Width, cooked.Height, usage, compress);
+			stbi_image_free(pixels);
+
+			cacheFile.Destroy();
+			TextureCooker::SaveToCache(cachePath, path, usage, compress, cooked);
+
+			WriteCookedMips(image, cooked);
+
+			VL_CORE_INFO("Imported environment map {} in {}ms", path, timer.ElapsedMillis());
+			return Image(std::move(image));
+		}
+
+		if (!cached)
+		{
+			cooked = TextureCooker::Cook(pixels, cooked.Width, cooked.Height, usage, compress);
+			stbi_image_free(pixels);
+
+			// A stale cache may still be mapped, it has to be closed before the file can be rewritten
+			cacheFile.Destroy();
+			TextureCooker::SaveToCache(cachePath, path, usage, compress, cooked);
+
+			// Stream from the freshly written cache like any other load, so the cooked data can be freed right away
+			cacheFile.Init({ cachePath });
+			cached = TextureCooker::OpenFromCache(cacheFile, path, usage, compress, mapped);
+		}
+
+		if (!cached)
+		{
+			// Cache couldn't be written, upload everything from memory
+			info.Format = cooked.Format;
+			info.Swizzle = cooked.Swizzle;
+			info.Width = cooked.Width;
+			info.Height = cooked.Height;
+			info.MipMapCount = (int)cooked.Mips.size() - 1;
+
+			Image image(info);
+			WriteCookedMips(image, cooked);
+
+			VL_CORE_TRACE("Imported texture {} without cache in {}ms", path, timer.ElapsedMillis());
+			return Image(std::move(image));
+		}
+
+		const uint32_t tailMip = glm::min(TextureStreamer::GetTailMipLevel(mapped.Width, mapped.Height), (uint32_t)mapped.Mips.size() - 1);
+
+		info.Format = mapped.Format;
+		info.Swizzle = mapped.Swizzle;
+		info.Width = mapped.Width;
+		info.Height = mapped.Height;
+		info.MipMapCount = (int)mapped.Mips.size() - 1;
+		info.BaseMipLevel = tailMip;
+
 		Image image(info);
 
-		stbi_image_free(pixels);
+		std::vector<const void*> mipData;
+		std::vector<uint64_t> mipSizes;
+		for (uint32_t i = tailMip; i < mapped.Mips.size(); i++)
+		{
+			mipData.push_back(mapped.Mips[i].Data);
+			mipSizes.push_back(mapped.Mips[i].Size);
+		}
+		image.WriteMipLevels(mipData, mipSizes, tailMip);
+
+		VL_CORE_TRACE("Imported texture {} from mip {} in {}ms", path, tailMip, timer.ElapsedMillis());
 
 		return Image(std::move(image));
 	}
 
+	void AssetImporter::WriteCookedMips(Image& image, const TextureCooker::CookedTexture& cooked)
+	{
+		std::vector<const void*> mipData(cooked.Mips.size());
+		std::vector<uint64_t> mipSizes(cooked.Mips.size());
+		for (int i = 0; i < cooked.Mips.size(); i++)
+		{
+			mipData[i] = cooked.Mips[i].Data.data();
+			mipSizes[i] = cooked.Mips[i].Data.size();
+		}
+
+		image.WriteMipLevels(mipData, mipSizes);
+	}
+
 	ModelAsset AssetImporter::ImportModel(const std::string& path)
 	{
+		VL_PROFILE_FUNCTION();
 		Timer timer;
 
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path,
-			aiProcess_CalcTangentSpace |
-			aiProcess_GenSmoothNormals |
-			aiProcess_ImproveCacheLocality |
-			aiProcess_RemoveRedundantMaterials |
-			aiProcess_SplitLargeMeshes |
-			aiProcess_Triangulate |
-			aiProcess_GenUVCoords |
-			aiProcess_SortByPType |
-			aiProcess_FindDegenerates |
-			aiProcess_FindInvalidData);
+		const aiScene* scene = nullptr;
+		{
+			VL_PROFILE_SCOPE("Assimp ReadFile");
+			scene = importer.ReadFile(path,
+				aiProcess_CalcTangentSpace |
+				aiProcess_GenSmoothNormals |
+				aiProcess_RemoveRedundantMaterials |
+				aiProcess_SplitLargeMeshes |
+				aiProcess_Triangulate |
+				aiProcess_GenUVCoords |
+				aiProcess_SortByPType |
+				aiProcess_FindDegenerates |
+				aiProcess_FindInvalidData);
+		}
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 		{
 			VL_CORE_ERROR("Failed to load model: {0}", importer.GetErrorString());
 			VL_CORE_ASSERT(false, ""); // TODO: some error handling
 		}
 
+		// Vertex data, optimization, LODs and meshlets of all meshes are done in parallel, buffers are created later on this thread
+		std::vector<ImportedMesh> meshes(scene->mNumMeshes);
+		std::vector<MeshOptimizer::Result> results(scene->mNumMeshes);
+		Parallel::For(scene->mNumMeshes, 1, [&](uint64_t begin, uint64_t end, uint32_t batch)
+		{
+			for (uint64_t i = begin; i < end; i++)
+			{
+				Mesh::ReadAssimpMesh(scene->mMeshes[i], glm::mat4(1.0f), meshes[i].Vertices, meshes[i].Indices);
+
+				if (scene->mMeshes[i]->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+				{
+					results[i] = MeshOptimizer::Optimize(meshes[i].Vertices, meshes[i].Indices);
+					MeshSimplifier::GenerateLODs(meshes[i].Vertices, meshes[i].Indices, meshes[i].LODs, s_LODSettings);
+					MeshletBuilder::Build(meshes[i].Vertices, meshes[i].Indices, meshes[i].LODs[0].IndexCount, meshes[i].Meshlets);
+				}
+			}
+		});
+
+		MeshOptimizer::Result total{};
+		for (const MeshOptimizer::Result& result : results)
+		{
+			total.Before += result.Before;
+			total.After += result.After;
+		}
+
+		VL_CORE_INFO("Optimized {} meshes of {} in {}ms: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", meshes.size(), path, timer.ElapsedMillis(),
+			total.Before.GetACMR(), total.After.GetACMR(), total.Before.GetATVR(), total.After.GetATVR());
+
 		ModelAsset asset;
 
 		int index = 0;
-		ProcessAssimpNode(scene->mRootNode, scene, path, &asset, index);
+		ProcessAssimpNode(scene->mRootNode, scene, meshes, path, &asset, index, glm::mat4(1.0f));
 
 		return asset;
 	}
 
-	void AssetImporter::ProcessAssimpNode(aiNode* node, const aiScene* scene, const std::string& filepath, ModelAsset* outAsset, int& index)
+	void AssetImporter::ProcessAssimpNode(aiNode* node, const aiScene* scene, const std::vector<ImportedMesh>& meshes, const std::string& filepath, ModelAsset* outAsset, int& index, const glm::mat4& parentTransform)
 	{
+		// Accumulated on the way down instead of walking up the parents for every mesh
+		const glm::mat4 nodeTransform = parentTransform * glm::transpose(*(glm::mat4*)(&node->mTransformation));
+
 		// process each mesh located at the current node
 		for (unsigned int i = 0; i < node->mNumMeshes; i++)
 		{
-			glm::mat4 transform = glm::transpose(*(glm::mat4*)(&node->mTransformation));
-			aiNode* currNode = node;
-			while (true)
-			{
-				if (currNode->mParent)
-				{
-					currNode = currNode->mParent;
-					transform = glm::transpose(*(glm::mat4*)(&currNode->mTransformation)) * transform;
-				}
-				else
-				{
-					break;
-				}
-			}
+			glm::mat4 transform = nodeTransform;
 
 			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 			std::string meshName = node->mName.C_Str();
-			Mesh vlMesh(mesh, scene);
+
+			const ImportedMesh& meshData = meshes[node->mMeshes[i]];
+			Mesh::CreateInfo meshInfo{};
+			meshInfo.Vertices = &meshData.Vertices;
+			meshInfo.Indices = &meshData.Indices;
+			meshInfo.Layout = Mesh::GetDefaultVertexLayout();
+			meshInfo.LODs = &meshData.LODs;
+			meshInfo.Meshlets = &meshData.Meshlets;
+			Mesh vlMesh(meshInfo);
 
 			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 			Material mat;
@@ -126,46 +305,46 @@ namespace Vulture
 			{
 				aiString str;
 				material->GetTexture(aiTextureType_DIFFUSE, i, &str);
-				mat.Textures.AlbedoTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()));
+				mat.Textures.AlbedoTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()), TextureUsage::Color);
 			}
 
 			for (int i = 0; i < (int)material->GetTextureCount(aiTextureType_NORMALS); i++)
 			{
 				aiString str;
 				material->GetTexture(aiTextureType_NORMALS, i, &str);
-				mat.Textures.NormalTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()));
+				mat.Textures.NormalTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()), TextureUsage::Normal);
 			}
 
 			for (int i = 0; i < (int)material->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS); i++)
 			{
 				aiString str;
 				material->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, i, &str);
-				mat.Textures.RoughnessTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()));
+				mat.Textures.RoughnessTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()), TextureUsage::Mask);
 			}
 
 			for (int i = 0; i < (int)material->GetTextureCount(aiTextureType_METALNESS); i++)
 			{
 				aiString str;
 				material->GetTexture(aiTextureType_METALNESS, i, &str);
-				mat.Textures.MetallnessTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()));
+				mat.Textures.MetallnessTexture = AssetManager::LoadAsset(std::string("assets/") + std::string(str.C_Str()), TextureUsage::Mask);
 			}
 
 			// Create Empty Texture if none are found
 			if (material->GetTextureCount(aiTextureType_DIFFUSE) == 0)
 			{
-				mat.Textures.AlbedoTexture = AssetManager::LoadAsset("assets/white.png");
+				mat.Textures.AlbedoTexture = AssetManager::LoadAsset("assets/white.png", TextureUsage::Color);
 			}
 			if (material->GetTextureCount(aiTextureType_NORMALS) == 0)
 			{
-				mat.Textures.NormalTexture = AssetManager::LoadAsset("assets/empty_normal.png");
+				mat.Textures.NormalTexture = AssetManager::LoadAsset("assets/empty_normal.png", TextureUsage::Normal);
 			}
 			if (material->GetTextureCount(aiTextureType_METALNESS) == 0)
 			{
-				mat.Textures.MetallnessTexture = AssetManager::LoadAsset("assets/white.png");
+				mat.Textures.MetallnessTexture = AssetManager::LoadAsset("assets/white.png", TextureUsage::Mask);
 			}
 			if (material->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS) == 0)
 			{
-				mat.Textures.RoughnessTexture = AssetManager::LoadAsset("assets/white.png");
+				mat.Textures.RoughnessTexture = AssetManager::LoadAsset("assets/white.png", TextureUsage::Mask);
 			}
 
 			mat.Properties.Color = glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b, 1.0f);
@@ -238,7 +417,7 @@ namespace Vulture
 		// process each of the children nodes
 		for (unsigned int i = 0; i < node->mNumChildren; i++)
 		{
-			ProcessAssimpNode(node->mChildren[i], scene, filepath, outAsset, index);
+			ProcessAssimpNode(node->mChildren[i], scene, meshes, filepath, outAsset, index, nodeTransform);
 		}
 	}
 
@@ -1,8 +1,11 @@
 #pragma once
 #include "Vulkan/Image.h"
+#include "Renderer/Mesh.h"
+#include "Renderer/MeshSimplifier.h"
 #include "Scene/Scene.h"
 
 #include "Serializer.h"
+#include "TextureCooker.h"
 
 namespace Vulture
 {
@@ -11,9 +14,13 @@ namespace Vulture
 	class AssetImporter
 	{
 	public:
-		static Image ImportTexture(std::string path, bool HDR);
+		static Image ImportTexture(std::string path, TextureUsage usage);
+		static std::string ResolveTexturePath(std::string path);
 		static ModelAsset ImportModel(const std::string& path);
 
+		static inline void SetLODSettings(const LODSettings& settings) { s_LODSettings = settings; }
+		static inline const LODSettings& GetLODSettings() { return s_LODSettings; }
+
 		template<typename ... T>
 		static Scene ImportScene(const std::string& path)
 		{
@@ -24,8 +31,19 @@ namespace Vulture
 			return scene;
 		}
 	private:
+		// Vertex data of a single assimp mesh, already optimized
+		struct ImportedMesh
+		{
+			std::vector<Mesh::Vertex> Vertices;
+			std::vector<uint32_t> Indices; // All LODs one after another
+			std::vector<Mesh::LOD> LODs;
+			Mesh::MeshletData Meshlets;
+		};
+
+		static void WriteCookedMips(Image& image, const TextureCooker::CookedTexture& cooked);
+		static void ProcessAssimpNode(aiNode* node, const aiScene* scene, const std::vector<ImportedMesh>& meshes, const std::string& filepath, ModelAsset* outAsset, int& index, const glm::mat4& parentTransform);
 
-		static void ProcessAssimpNode(aiNode* node, const aiScene* scene, const std::string& filepath, ModelAsset* outAsset, int& index);
+		inline static LODSettings s_LODSettings;
 	};
 
 }
\ No newline at end of file
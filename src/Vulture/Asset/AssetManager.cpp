@@ -30,6 +30,12 @@ namespace Vulture
 			s_Assets.erase(iterator->first);
 		}
 
+		{
+			std::unique_lock<std::mutex> lock(s_PinsMutex);
+			s_DeferredUnloads.clear();
+			s_ActivePins.clear();
+		}
+
 		s_ThreadPool.Destroy();
 		s_Assets.clear();
 		s_Initialized = false;
@@ -73,7 +79,13 @@ namespace Vulture
 		return iter->second.Future.wait_for(std::chrono::duration<float>(0)) == std::future_status::ready;
 	}
 
-	AssetHandle AssetManager::LoadAsset(const std::string& path)
+	/**
+	 * @brief Loads asset asynchronously, type of the asset is deduced from the file extension.
+	 *
+	 * @param path - Path to the asset file.
+	 * @param textureUsage - How the texture is going to be sampled, selects its compression format. Ignored for non texture assets.
+	 */
+	AssetHandle AssetManager::LoadAsset(const std::string& path, TextureUsage textureUsage)
 	{
 		std::hash<std::string> hash;
 		AssetHandle handle(AssetHandle::CreateInfo{hash(path)});
@@ -96,10 +108,15 @@ namespace Vulture
 
 		if (extension == ".png" || extension == ".jpg")
 		{
-			s_ThreadPool.PushTask([](std::string path, std::shared_ptr<std::promise<void>> promise, AssetHandle handle)
+			s_ThreadPool.PushTask([](std::string path, std::shared_ptr<std::promise<void>> promise, AssetHandle handle, TextureUsage usage)
 				{
+					VL_PROFILE_SCOPE("Load Texture");
 					VL_CORE_TRACE("Loading Texture: {}", path);
-					Scope<Asset> asset = std::make_unique<TextureAsset>(std::move(AssetImporter::ImportTexture(path, false)));
+					Scope<TextureAsset> texture = std::make_unique<TextureAsset>(std::move(AssetImporter::ImportTexture(path, usage)));
+					TextureStreamer::Register(&texture->Image, AssetImporter::ResolveTexturePath(path), usage, Device::IsTextureCompressionBCSupported());
+					TextureStreamer::SetMovable(&texture->Image);
+
+					Scope<Asset> asset = std::move(texture);
 					asset->SetValid(true);
 					asset->SetPath(path);
 		
@@ -108,12 +125,13 @@ namespace Vulture
 					lock.unlock();
 		
 					promise->set_value();
-				}, path, promise, handle);
+				}, path, promise, handle, textureUsage);
 		}
 		else if (extension == ".gltf" || extension == ".obj" || extension == ".fbx")
 		{
 			s_ThreadPool.PushTask([](std::string path, std::shared_ptr<std::promise<void>> promise, AssetHandle handle)
 				{
+					VL_PROFILE_SCOPE("Load Model");
 					Scope<Asset> asset = std::make_unique<ModelAsset>(std::move(AssetImporter::ImportModel(path)));
 					asset->SetValid(true);
 					asset->SetPath(path);
@@ -129,7 +147,8 @@ namespace Vulture
 		{
 			s_ThreadPool.PushTask([](std::string path, std::shared_ptr<std::promise<void>> promise, AssetHandle handle)
 				{
-					Scope<Asset> asset = std::make_unique<TextureAsset>(std::move(AssetImporter::ImportTexture(path, true)));
+					VL_PROFILE_SCOPE("Load Environment Map");
+					Scope<Asset> asset = std::make_unique<TextureAsset>(std::move(AssetImporter::ImportTexture(path, TextureUsage::Environment)));
 					asset->SetValid(true);
 					asset->SetPath(path);
 		
@@ -182,8 +201,73 @@ namespace Vulture
 
 		lock.unlock();
 
+		// Pinned pointers may still reference it on another thread
+		std::unique_lock<std::mutex> pinsLock(s_PinsMutex);
+		if (!s_ActivePins.empty())
+		{
+			s_DeferredUnloads.push_back({ asset, s_NextPin - 1 });
+			return;
+		}
+		pinsLock.unlock();
+
+		FreeAsset(asset);
+	}
+
+	/**
+	 * @brief Keeps every asset loaded right now alive until UnpinAssets() is called with the returned pin.
+	 */
+	uint64_t AssetManager::PinAssets()
+	{
+		std::unique_lock<std::mutex> lock(s_PinsMutex);
+
+		const uint64_t pin = s_NextPin++;
+		s_ActivePins.insert(pin);
+
+		return pin;
+	}
+
+	/**
+	 * @brief Releases a pin and frees deferred unloads that no pin references anymore.
+	 */
+	void AssetManager::UnpinAssets(uint64_t pin)
+	{
+		std::vector<Ref<AssetWithFuture>> freed;
+		{
+			std::unique_lock<std::mutex> lock(s_PinsMutex);
+
+			auto iter = s_ActivePins.find(pin);
+			VL_CORE_ASSERT(iter != s_ActivePins.end(), "Asset pin {} is not active!", pin);
+			s_ActivePins.erase(iter);
+
+			// Pins only increase, everything unloaded before the oldest active pin was taken is unreferenced
+			const uint64_t oldestPin = s_ActivePins.empty() ? UINT64_MAX : *s_ActivePins.begin();
+			for (size_t i = 0; i < s_DeferredUnloads.size();)
+			{
+				if (s_DeferredUnloads[i].LastPin < oldestPin)
+				{
+					freed.push_back(std::move(s_DeferredUnloads[i].Asset));
+					s_DeferredUnloads[i] = std::move(s_DeferredUnloads.back());
+					s_DeferredUnloads.pop_back();
+				}
+				else
+				{
+					i++;
+				}
+			}
+		}
+
+		for (Ref<AssetWithFuture>& asset : freed)
+			FreeAsset(std::move(asset));
+	}
+
+	/**
+	 * @brief Destroys the asset on the thread pool.
+	 */
+	void AssetManager::FreeAsset(Ref<AssetWithFuture> asset)
+	{
 		s_ThreadPool.PushTask([](Ref<AssetWithFuture> asset)
 			{
+				VL_PROFILE_SCOPE("Unload Asset");
 				asset.reset();
 			}, asset);
 	}
@@ -6,6 +6,8 @@
 
 #include "AssetImporter.h"
 
+#include <set>
+
 namespace Vulture
 {
 	struct AssetWithFuture
@@ -33,10 +35,19 @@ namespace Vulture
 
 		static void WaitToLoad(const AssetHandle& handle);
 		static bool IsAssetLoaded(const AssetHandle& handle);
-		static AssetHandle LoadAsset(const std::string& path);
+		static AssetHandle LoadAsset(const std::string& path, TextureUsage textureUsage = TextureUsage::Color);
 		static AssetHandle AddAsset(const std::string& path, std::unique_ptr<Asset>&& asset);
 		static void UnloadAsset(const AssetHandle& handle);
 
+		// Raw asset pointers handed to another thread, e.g. in a render snapshot, stay valid while they're pinned.
+		// Unloads are deferred until every pin taken before them is released
+		static uint64_t PinAssets();
+		static void UnpinAssets(uint64_t pin);
+
+		// Engine worker pool. Asset loading, system scheduling and parallel recording share it, so the engine
+		// doesn't run more threads than it was configured with
+		static inline ThreadPool& GetThreadPool() { return s_ThreadPool; }
+
 		static inline bool IsInitialized() { return s_Initialized; }
 
 		// T is list of types of components which to deserialize
@@ -84,8 +95,22 @@ namespace Vulture
 		inline static ThreadPool s_ThreadPool;
 		inline static std::mutex s_AssetsMutex;
 
+		struct DeferredUnload
+		{
+			Ref<AssetWithFuture> Asset;
+			uint64_t LastPin; // Newest pin at the time of the unload
+		};
+
+		static void FreeAsset(Ref<AssetWithFuture> asset);
+
+		inline static std::mutex s_PinsMutex; // Guards everything below
+		inline static std::multiset<uint64_t> s_ActivePins;
+		inline static uint64_t s_NextPin = 1;
+		inline static std::vector<DeferredUnload> s_DeferredUnloads;
+
 		inline static bool s_Initialized = false;
 
 		friend class AssetImporter;
+		friend class TextureStreamer;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,409 @@
+#include "pch.h"
+#include "BlockCompressor.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
+
+namespace Vulture
+{
+	static constexpr float s_MaxError = std::numeric_limits<float>::max();
+
+	// Interpolation weights shared by 4 bit indices of BC6H and BC7
+	static constexpr uint32_t s_Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Writes bits into the block LSB first, block has to be zeroed beforehand
+	class BlockBitWriter
+	{
+	public:
+		explicit BlockBitWriter(uint8_t* block) : m_Block(block) {}
+
+		void Write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; i++)
+			{
+				if ((value >> i) & 1)
+					m_Block[m_Offset >> 3] |= (uint8_t)(1 << (m_Offset & 7));
+				m_Offset++;
+			}
+		}
+
+	private:
+		uint8_t* m_Block;
+		uint32_t m_Offset = 0;
+	};
+
+	/**
+	 * @brief Finds the line that best fits the texels of the block. The line is found with a power iteration
+	 * on the covariance matrix, both endpoints are the extreme projections of texels onto it.
+	 *
+	 * @param texels - 16 texels with N channels each.
+	 * @param outStart - First endpoint.
+	 * @param outEnd - Second endpoint.
+	 */
+	template<int N>
+	static void FindEndpoints(const float* texels, float outStart[N], float outEnd[N])
+	{
+		float mean[N] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < N; c++)
+				mean[c] += texels[i * N + c];
+		}
+		for (int c = 0; c < N; c++)
+			mean[c] /= 16.0f;
+
+		float covariance[N][N] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < N; a++)
+			{
+				for (int b = 0; b < N; b++)
+					covariance[a][b] += (texels[i * N + a] - mean[a]) * (texels[i * N + b] - mean[b]);
+			}
+		}
+
+		// Start from the bounding box diagonal, it's usually already close to the principal axis
+		float axis[N];
+		for (int c = 0; c < N; c++)
+		{
+			float minVal = texels[c], maxVal = texels[c];
+			for (int i = 1; i < 16; i++)
+			{
+				minVal = glm::min(minVal, texels[i * N + c]);
+				maxVal = glm::max(maxVal, texels[i * N + c]);
+			}
+			axis[c] = maxVal - minVal;
+		}
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[N] = {};
+			float length = 0.0f;
+			for (int a = 0; a < N; a++)
+			{
+				for (int b = 0; b < N; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length = glm::max(length, glm::abs(next[a]));
+			}
+
+			if (length <= 0.0f)
+				break;
+
+			for (int c = 0; c < N; c++)
+				axis[c] = next[c] / length;
+		}
+
+		float axisLengthSqr = 0.0f;
+		for (int c = 0; c < N; c++)
+			axisLengthSqr += axis[c] * axis[c];
+
+		if (axisLengthSqr <= 0.0f)
+		{
+			// Every texel is the same
+			for (int c = 0; c < N; c++)
+			{
+				outStart[c] = mean[c];
+				outEnd[c] = mean[c];
+			}
+			return;
+		}
+
+		float minT = s_MaxError, maxT = -s_MaxError;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < N; c++)
+				t += (texels[i * N + c] - mean[c]) * axis[c];
+			minT = glm::min(minT, t);
+			maxT = glm::max(maxT, t);
+		}
+
+		for (int c = 0; c < N; c++)
+		{
+			outStart[c] = mean[c] + axis[c] * minT / axisLengthSqr;
+			outEnd[c] = mean[c] + axis[c] * maxT / axisLengthSqr;
+		}
+	}
+
+	/**
+	 * @brief Picks the closest of 16 interpolated colors for every texel.
+	 *
+	 * @param texels - 16 texels with N channels each.
+	 * @param palette - 16 colors with N channels each.
+	 * @param outIndices - Index of the closest color for each texel.
+	 * @return Sum of squared errors of the whole block.
+	 */
+	template<int N>
+	static float SelectIndices4(const float* texels, const float* palette, uint32_t outIndices[16])
+	{
+		float totalError = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float bestError = s_MaxError;
+			uint32_t bestIndex = 0;
+			for (uint32_t j = 0; j < 16; j++)
+			{
+				float error = 0.0f;
+				for (int c = 0; c < N; c++)
+				{
+					const float diff = texels[i * N + c] - palette[j * N + c];
+					error += diff * diff;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = j;
+				}
+			}
+
+			outIndices[i] = bestIndex;
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	/**
+	 * @brief Encodes block in BC4 format using 8 interpolated values between block min and max.
+	 *
+	 * @param values - 16 single channel texels.
+	 * @param outBlock - 8 byte output block.
+	 */
+	void BlockCompressor::EncodeBC4(const uint8_t values[16], uint8_t outBlock[8])
+	{
+		uint8_t maxVal = values[0];
+		uint8_t minVal = values[0];
+		for (int i = 1; i < 16; i++)
+		{
+			maxVal = glm::max(maxVal, values[i]);
+			minVal = glm::min(minVal, values[i]);
+		}
+
+		outBlock[0] = maxVal;
+		outBlock[1] = minVal;
+
+		uint64_t indices = 0;
+		if (maxVal != minVal)
+		{
+			// red0 > red1 selects the 8 value mode: 0 = red0, 1 = red1, 2-7 = interpolated from red0 to red1
+			float palette[8];
+			palette[0] = (float)maxVal;
+			palette[1] = (float)minVal;
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((float)(8 - i) * maxVal + (float)(i - 1) * minVal) / 7.0f;
+
+			for (int i = 0; i < 16; i++)
+			{
+				uint64_t bestIndex = 0;
+				float bestError = s_MaxError;
+				for (uint64_t j = 0; j < 8; j++)
+				{
+					const float error = glm::abs(palette[j] - (float)values[i]);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = j;
+					}
+				}
+
+				indices |= bestIndex << (3 * i);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+			outBlock[2 + i] = (uint8_t)(indices >> (8 * i));
+	}
+
+	/**
+	 * @brief Encodes block in BC5 format, which is just 2 BC4 blocks, one for each channel.
+	 *
+	 * @param red - 16 texels of red channel.
+	 * @param green - 16 texels of green channel.
+	 * @param outBlock - 16 byte output block.
+	 */
+	void BlockCompressor::EncodeBC5(const uint8_t red[16], const uint8_t green[16], uint8_t outBlock[16])
+	{
+		EncodeBC4(red, outBlock);
+		EncodeBC4(green, outBlock + 8);
+	}
+
+	/**
+	 * @brief Encodes block in BC7 mode 6 (single subset, RGBA 7.7.7.7 endpoints with unique p-bits, 4 bit indices).
+	 *
+	 * @param rgba - 16 RGBA8 texels.
+	 * @param outBlock - 16 byte output block.
+	 */
+	void BlockCompressor::EncodeBC7(const uint8_t rgba[64], uint8_t outBlock[16])
+	{
+		float texels[64];
+		for (int i = 0; i < 64; i++)
+			texels[i] = (float)rgba[i];
+
+		float start[4], end[4];
+		FindEndpoints<4>(texels, start, end);
+
+		// Each endpoint has its own p-bit which is the lowest bit of all its channels, try every combination
+		uint32_t bestEndpoints[2][4] = {};
+		uint32_t bestPBits[2] = {};
+		uint32_t bestIndices[16] = {};
+		float bestError = s_MaxError;
+		for (uint32_t pBits = 0; pBits < 4; pBits++)
+		{
+			const uint32_t p[2] = { pBits & 1, pBits >> 1 };
+
+			uint32_t endpoints[2][4];
+			for (int c = 0; c < 4; c++)
+			{
+				endpoints[0][c] = (uint32_t)glm::clamp((int)glm::round((start[c] - (float)p[0]) / 2.0f), 0, 127);
+				endpoints[1][c] = (uint32_t)glm::clamp((int)glm::round((end[c] - (float)p[1]) / 2.0f), 0, 127);
+			}
+
+			float palette[64];
+			for (uint32_t j = 0; j < 16; j++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					const uint32_t e0 = (endpoints[0][c] << 1) | p[0];
+					const uint32_t e1 = (endpoints[1][c] << 1) | p[1];
+					palette[j * 4 + c] = (float)(((64 - s_Weights4[j]) * e0 + s_Weights4[j] * e1 + 32) >> 6);
+				}
+			}
+
+			uint32_t indices[16];
+			const float error = SelectIndices4<4>(texels, palette, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+				memcpy(bestIndices, indices, sizeof(indices));
+				bestPBits[0] = p[0];
+				bestPBits[1] = p[1];
+			}
+		}
+
+		// The MSB of the first index is implicitly 0, swap endpoints when it's set.
+		// Weights are symmetric so 15 - index gives the same color with swapped endpoints
+		if (bestIndices[0] & 8)
+		{
+			for (int c = 0; c < 4; c++)
+				std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+			std::swap(bestPBits[0], bestPBits[1]);
+			for (int i = 0; i < 16; i++)
+				bestIndices[i] = 15 - bestIndices[i];
+		}
+
+		memset(outBlock, 0, 16);
+		BlockBitWriter writer(outBlock);
+		writer.Write(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(bestEndpoints[0][c], 7);
+			writer.Write(bestEndpoints[1][c], 7);
+		}
+		writer.Write(bestPBits[0], 1);
+		writer.Write(bestPBits[1], 1);
+
+		writer.Write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.Write(bestIndices[i], 4);
+	}
+
+	// BC6H unsigned unquantization of 10 bit endpoint into 16 bit interpolation space
+	static uint32_t UnquantizeBC6H(uint32_t value)
+	{
+		if (value == 0)
+			return 0;
+		if (value == 1023)
+			return 0xFFFF;
+
+		return ((value << 16) + 0x8000) >> 10;
+	}
+
+	// Converts interpolated value into final half float bits, for unsigned formats it's scaled by 31/64
+	static uint32_t FinishUnquantizeBC6H(uint32_t value)
+	{
+		return (value * 31) >> 6;
+	}
+
+	/**
+	 * @brief Encodes block in BC6H_UFLOAT mode 11 (single region, 10 bit endpoints without delta, 4 bit indices).
+	 * BC6H interpolates half float bit patterns, so the fit is done on those bit patterns instead of linear
+	 * values, which behaves roughly like fitting in log space.
+	 *
+	 * @param rgb - 16 RGB32F texels, negative values are clamped to 0.
+	 * @param outBlock - 16 byte output block.
+	 */
+	void BlockCompressor::EncodeBC6H(const float rgb[48], uint8_t outBlock[16])
+	{
+		float texels[48];
+		for (int i = 0; i < 48; i++)
+		{
+			const float value = glm::clamp(rgb[i], 0.0f, 65504.0f);
+			texels[i] = (float)glm::packHalf1x16(value == value ? value : 0.0f); // NaN -> 0
+		}
+
+		float start[3], end[3];
+		FindEndpoints<3>(texels, start, end);
+
+		// Pick 10 bit endpoints that unquantize closest to the fitted half values
+		uint32_t endpoints[2][3];
+		for (int c = 0; c < 3; c++)
+		{
+			const float targets[2] = { start[c], end[c] };
+			for (int e = 0; e < 2; e++)
+			{
+				const int guess = (int)glm::round(targets[e] / 31.0f);
+				uint32_t best = 0;
+				float bestError = s_MaxError;
+				for (int q = glm::max(guess - 2, 0); q <= glm::min(guess + 2, 1023); q++)
+				{
+					const float error = glm::abs((float)FinishUnquantizeBC6H(UnquantizeBC6H((uint32_t)q)) - targets[e]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = (uint32_t)q;
+					}
+				}
+				endpoints[e][c] = best;
+			}
+		}
+
+		float palette[48];
+		for (uint32_t j = 0; j < 16; j++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				const uint32_t e0 = UnquantizeBC6H(endpoints[0][c]);
+				const uint32_t e1 = UnquantizeBC6H(endpoints[1][c]);
+				palette[j * 3 + c] = (float)FinishUnquantizeBC6H(((64 - s_Weights4[j]) * e0 + s_Weights4[j] * e1 + 32) >> 6);
+			}
+		}
+
+		uint32_t indices[16];
+		SelectIndices4<3>(texels, palette, indices);
+
+		// The MSB of the anchor index is implicitly 0
+		if (indices[0] & 8)
+		{
+			for (int c = 0; c < 3; c++)
+				std::swap(endpoints[0][c], endpoints[1][c]);
+			for (int i = 0; i < 16; i++)
+				indices[i] = 15 - indices[i];
+		}
+
+		memset(outBlock, 0, 16);
+		BlockBitWriter writer(outBlock);
+		writer.Write(0x03, 5); // mode 11
+		for (int e = 0; e < 2; e++)
+		{
+			for (int c = 0; c < 3; c++)
+				writer.Write(endpoints[e][c], 10);
+		}
+
+		writer.Write(indices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.Write(indices[i], 4);
+	}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "pch.h"
+
+namespace Vulture
+{
+	// CPU encoders for BCn block compressed formats. Every function encodes a single 4x4 block of texels
+	// stored row by row. Only the single subset modes are used (BC7 mode 6, BC6H mode 11), they're fast
+	// and good enough for import time compression.
+	class BlockCompressor
+	{
+	public:
+		BlockCompressor() = delete;
+
+		static void EncodeBC4(const uint8_t values[16], uint8_t outBlock[8]);
+		static void EncodeBC5(const uint8_t red[16], const uint8_t green[16], uint8_t outBlock[16]);
+		static void EncodeBC7(const uint8_t rgba[64], uint8_t outBlock[16]);
+		static void EncodeBC6H(const float rgb[48], uint8_t outBlock[16]);
+	};
+
+}
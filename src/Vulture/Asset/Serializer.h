@@ -15,6 +15,9 @@ namespace Vulture
 
 			auto& reg = scene->GetRegistry();
 
+			// Components that read GPU data do it for the whole scene at once
+			(BeginSerializeComponents<Components>(reg), ...);
+
 			reg.each([&](entt::entity entity) 
 			{
 				std::tuple<Components*...> tuple = reg.try_get<Components...>(entity);
@@ -30,6 +33,8 @@ namespace Vulture
 				}
 			});
 
+			(EndSerializeComponents<Components>(), ...);
+
 			uint64_t size = (uint64_t)bytesOut.size() + 8; // + 8 to account for this 8 size bytes
 			std::vector<char> bytesSize = Vulture::Bytes::ToBytes((char*)&size, 8);
 			bytesOut.insert(bytesOut.begin(), bytesSize.begin(), bytesSize.end()); // first 8 bytes are overall size of the file
@@ -225,6 +230,20 @@ namespace Vulture
 			}
 		}
 
+		template<typename T>
+		static void BeginSerializeComponents(entt::registry& registry)
+		{
+			if constexpr (requires { T::BeginSerialize(registry); })
+				T::BeginSerialize(registry);
+		}
+
+		template<typename T>
+		static void EndSerializeComponents()
+		{
+			if constexpr (requires { T::EndSerialize(); })
+				T::EndSerialize();
+		}
+
 		template<typename T>
 		static void SerializeComponent(T component, std::vector<char>& bytesOut)
 		{
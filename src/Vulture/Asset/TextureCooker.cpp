@@ -0,0 +1,496 @@
+#include "pch.h"
+#include "TextureCooker.h"
+#include "BlockCompressor.h"
+
+#include <atomic>
+
+#include "Utility/Utility.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace Vulture
+{
+	// Rows of texels / rows of blocks processed by a single thread
+	static constexpr uint64_t s_CookRowBatch = 16;
+
+	static constexpr float s_MaxHalf = 65504.0f;
+
+	struct CookedTextureHeader
+	{
+		uint32_t Magic = 0x58544C56; // "VLTX"
+		uint32_t Version = 3;
+		uint32_t Format = 0;
+		uint32_t Usage = 0;
+		uint32_t Compressed = 0;
+		uint32_t Swizzle[4] = {};
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipCount = 0;
+		uint64_t SourceSize = 0;
+		int64_t SourceWriteTime = 0;
+	};
+
+	struct CookedMipEntry
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+	};
+
+	static float SRGBToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : glm::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float LinearToSRGB(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * glm::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	static uint8_t ToUNorm8(float value)
+	{
+		return (uint8_t)glm::clamp((int)glm::round(value * 255.0f), 0, 255);
+	}
+
+	/**
+	 * @brief Converts a texel from the linear working space back into its 8 bit representation.
+	 */
+	static glm::u8vec4 EncodeTexel8(const glm::vec4& texel, TextureUsage usage)
+	{
+		switch (usage)
+		{
+		case TextureUsage::Color:
+			return { ToUNorm8(LinearToSRGB(texel.r)), ToUNorm8(LinearToSRGB(texel.g)), ToUNorm8(LinearToSRGB(texel.b)), ToUNorm8(texel.a) };
+		case TextureUsage::Normal:
+			return { ToUNorm8(texel.r * 0.5f + 0.5f), ToUNorm8(texel.g * 0.5f + 0.5f), ToUNorm8(texel.b * 0.5f + 0.5f), ToUNorm8(texel.a) };
+		default:
+			return { ToUNorm8(texel.r), ToUNorm8(texel.g), ToUNorm8(texel.b), ToUNorm8(texel.a) };
+		}
+	}
+
+	/**
+	 * @brief Decodes source pixels into linear float texels so that mips are filtered in linear space.
+	 * Color textures are converted from sRGB, normals are expanded to [-1, 1].
+	 *
+	 * @param pixels - RGBA8 pixels for LDR usages, RGBA32F for HDR and Environment.
+	 */
+	static std::vector<glm::vec4> DecodeBaseLevel(const void* pixels, uint32_t width, uint32_t height, TextureUsage usage)
+	{
+		std::vector<glm::vec4> level((uint64_t)width * height);
+
+		if (usage == TextureUsage::Environment)
+		{
+			memcpy(level.data(), pixels, level.size() * sizeof(glm::vec4));
+			return level;
+		}
+
+		if (usage == TextureUsage::HDR)
+		{
+			// Both RGBA16F and BC6H top out at the largest half, anything above would turn into inf
+			const float* texels = (const float*)pixels;
+			Parallel::For(height, s_CookRowBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+			{
+				for (uint64_t i = begin * width; i < end * width; i++)
+					level[i] = glm::min(glm::make_vec4(&texels[i * 4]), glm::vec4(s_MaxHalf));
+			});
+			return level;
+		}
+
+		std::array<float, 256> srgbToLinear;
+		for (int i = 0; i < 256; i++)
+			srgbToLinear[i] = SRGBToLinear((float)i / 255.0f);
+
+		const uint8_t* bytes = (const uint8_t*)pixels;
+		Parallel::For(height, s_CookRowBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+		{
+			for (uint64_t i = begin * width; i < end * width; i++)
+			{
+				const uint8_t* texel = &bytes[i * 4];
+				switch (usage)
+				{
+				case TextureUsage::Color:
+					level[i] = { srgbToLinear[texel[0]], srgbToLinear[texel[1]], srgbToLinear[texel[2]], (float)texel[3] / 255.0f };
+					break;
+				case TextureUsage::Normal:
+					level[i] = glm::vec4(glm::vec3(texel[0], texel[1], texel[2]) / 255.0f * 2.0f - 1.0f, (float)texel[3] / 255.0f);
+					break;
+				default:
+					level[i] = glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+					break;
+				}
+			}
+		});
+
+		return level;
+	}
+
+	/**
+	 * @brief Box filters level into the next, smaller one. Odd sizes clamp at the edge.
+	 * Normals are renormalized after filtering.
+	 */
+	static std::vector<glm::vec4> Downsample(const std::vector<glm::vec4>& src, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, TextureUsage usage)
+	{
+		std::vector<glm::vec4> dst((uint64_t)dstWidth * dstHeight);
+
+		Parallel::For(dstHeight, s_CookRowBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+		{
+			for (uint64_t y = begin; y < end; y++)
+			{
+				const uint64_t y0 = glm::min(y * 2, (uint64_t)srcHeight - 1);
+				const uint64_t y1 = glm::min(y * 2 + 1, (uint64_t)srcHeight - 1);
+				for (uint64_t x = 0; x < dstWidth; x++)
+				{
+					const uint64_t x0 = glm::min(x * 2, (uint64_t)srcWidth - 1);
+					const uint64_t x1 = glm::min(x * 2 + 1, (uint64_t)srcWidth - 1);
+
+					glm::vec4 texel = (src[y0 * srcWidth + x0] + src[y0 * srcWidth + x1] + src[y1 * srcWidth + x0] + src[y1 * srcWidth + x1]) * 0.25f;
+
+					if (usage == TextureUsage::Normal)
+					{
+						const float length = glm::length(glm::vec3(texel));
+						if (length > 0.0f)
+							texel = glm::vec4(glm::vec3(texel) / length, texel.a);
+					}
+
+					dst[y * dstWidth + x] = texel;
+				}
+			}
+		});
+
+		return dst;
+	}
+
+	static bool IsGrayscale(const std::vector<glm::vec4>& level)
+	{
+		std::atomic<bool> grayscale = true;
+		Parallel::For(level.size(), 1 << 16, [&](uint64_t begin, uint64_t end, uint32_t batch)
+		{
+			for (uint64_t i = begin; i < end && grayscale; i++)
+			{
+				if (level[i].r != level[i].g || level[i].r != level[i].b || level[i].a != 1.0f)
+					grayscale = false;
+			}
+		});
+
+		return grayscale;
+	}
+
+	static uint32_t GetBlockSize(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+			return 8;
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	/**
+	 * @brief Converts a single linear float level into the final format.
+	 */
+	static std::vector<uint8_t> EncodeLevel(const std::vector<glm::vec4>& level, uint32_t width, uint32_t height, VkFormat format, TextureUsage usage)
+	{
+		std::vector<uint8_t> out;
+
+		const uint32_t blockSize = GetBlockSize(format);
+		if (blockSize != 0)
+		{
+			const uint32_t blocksX = (width + 3) / 4;
+			const uint32_t blocksY = (height + 3) / 4;
+			out.resize((uint64_t)blocksX * blocksY * blockSize);
+
+			Parallel::For(blocksY, s_CookRowBatch / 4, [&](uint64_t begin, uint64_t end, uint32_t batch)
+			{
+				for (uint64_t by = begin; by < end; by++)
+				{
+					for (uint64_t bx = 0; bx < blocksX; bx++)
+					{
+						// Gather 4x4 texels, blocks hanging over the edge repeat the last row / column
+						glm::vec4 texels[16];
+						for (uint32_t i = 0; i < 16; i++)
+						{
+							const uint64_t x = glm::min(bx * 4 + (i % 4), (uint64_t)width - 1);
+							const uint64_t y = glm::min(by * 4 + (i / 4), (uint64_t)height - 1);
+							texels[i] = level[y * width + x];
+						}
+
+						uint8_t* block = &out[(by * blocksX + bx) * blockSize];
+						switch (format)
+						{
+						case VK_FORMAT_BC7_UNORM_BLOCK:
+						{
+							uint8_t rgba[64];
+							for (uint32_t i = 0; i < 16; i++)
+							{
+								const glm::u8vec4 texel = EncodeTexel8(texels[i], usage);
+								memcpy(&rgba[i * 4], &texel, 4);
+							}
+							BlockCompressor::EncodeBC7(rgba, block);
+							break;
+						}
+						case VK_FORMAT_BC4_UNORM_BLOCK:
+						{
+							uint8_t values[16];
+							for (uint32_t i = 0; i < 16; i++)
+								values[i] = EncodeTexel8(texels[i], usage).r;
+							BlockCompressor::EncodeBC4(values, block);
+							break;
+						}
+						case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+						{
+							float rgb[48];
+							for (uint32_t i = 0; i < 16; i++)
+								memcpy(&rgb[i * 3], &texels[i], sizeof(float) * 3);
+							BlockCompressor::EncodeBC6H(rgb, block);
+							break;
+						}
+						default:
+							break;
+						}
+					}
+				}
+			});
+
+			return out;
+		}
+
+		const uint64_t texelCount = (uint64_t)width * height;
+		if (format == VK_FORMAT_R32G32B32A32_SFLOAT)
+		{
+			out.resize(texelCount * sizeof(glm::vec4));
+			memcpy(out.data(), level.data(), out.size());
+		}
+		else if (format == VK_FORMAT_R16G16B16A16_SFLOAT)
+		{
+			out.resize(texelCount * sizeof(uint16_t) * 4);
+			uint16_t* halfs = (uint16_t*)out.data();
+			Parallel::For(height, s_CookRowBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+			{
+				for (uint64_t i = begin * width; i < end * width; i++)
+				{
+					for (int c = 0; c < 4; c++)
+						halfs[i * 4 + c] = glm::packHalf1x16(level[i][c]);
+				}
+			});
+		}
+		else
+		{
+			out.resize(texelCount * 4);
+			Parallel::For(height, s_CookRowBatch, [&](uint64_t begin, uint64_t end, uint32_t batch)
+			{
+				for (uint64_t i = begin * width; i < end * width; i++)
+				{
+					const glm::u8vec4 texel = EncodeTexel8(level[i], usage);
+					memcpy(&out[i * 4], &texel, 4);
+				}
+			});
+		}
+
+		return out;
+	}
+
+	uint32_t TextureCooker::GetMipCount(uint32_t width, uint32_t height)
+	{
+		return (uint32_t)glm::floor(glm::log2((float)glm::max(width, height))) + 1;
+	}
+
+	/**
+	 * @brief Builds a full mip chain on the CPU and converts every level to the format matching its usage.
+	 * Mips are filtered in linear space so that color textures don't get darker with each level.
+	 *
+	 * @param pixels - RGBA8 pixels for LDR usages, RGBA32F for HDR and Environment.
+	 * @param width - Width of the texture.
+	 * @param height - Height of the texture.
+	 * @param usage - What the texture is used for, selects the filtering and the output format.
+	 * @param compress - Whether to use BCn formats, uncompressed RGBA8 / RGBA16F is used otherwise. Environment maps are
+	 * always RGBA32F.
+	 */
+	TextureCooker::CookedTexture TextureCooker::Cook(const void* pixels, uint32_t width, uint32_t height, TextureUsage usage, bool compress)
+	{
+		VL_PROFILE_FUNCTION();
+		Timer timer;
+
+		std::vector<glm::vec4> level = DecodeBaseLevel(pixels, width, height, usage);
+
+		CookedTexture texture{};
+		texture.Width = width;
+		texture.Height = height;
+
+		switch (usage)
+		{
+		case TextureUsage::Color:
+			texture.Format = compress ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_R8G8B8A8_UNORM;
+			break;
+		case TextureUsage::Normal:
+			// Materials sample all 3 components, so a 2 channel format would need Z reconstructed in every shader
+			texture.Format = compress ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_R8G8B8A8_UNORM;
+			break;
+		case TextureUsage::Mask:
+			if (compress && IsGrayscale(level))
+			{
+				// Sampled exactly like the RGBA version
+				texture.Format = VK_FORMAT_BC4_UNORM_BLOCK;
+				texture.Swizzle = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+			}
+			else
+			{
+				texture.Format = compress ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_R8G8B8A8_UNORM;
+			}
+			break;
+		case TextureUsage::HDR:
+			texture.Format = compress ? VK_FORMAT_BC6H_UFLOAT_BLOCK : VK_FORMAT_R16G16B16A16_SFLOAT;
+			break;
+		case TextureUsage::Environment:
+			// Not clamped to the half range, sun disks easily go above it and importance sampling needs their real value
+			texture.Format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			break;
+		}
+
+		const uint32_t mipCount = GetMipCount(width, height);
+		texture.Mips.resize(mipCount);
+
+		uint32_t mipWidth = width;
+		uint32_t mipHeight = height;
+		for (uint32_t i = 0; i < mipCount; i++)
+		{
+			texture.Mips[i].Width = mipWidth;
+			texture.Mips[i].Height = mipHeight;
+			texture.Mips[i].Data = EncodeLevel(level, mipWidth, mipHeight, texture.Format, usage);
+
+			if (i + 1 < mipCount)
+			{
+				const uint32_t nextWidth = glm::max(mipWidth / 2, 1u);
+				const uint32_t nextHeight = glm::max(mipHeight / 2, 1u);
+				level = Downsample(level, mipWidth, mipHeight, nextWidth, nextHeight, usage);
+				mipWidth = nextWidth;
+				mipHeight = nextHeight;
+			}
+		}
+
+		VL_CORE_TRACE("Cooked {}x{} texture with {} mips in {}ms", width, height, mipCount, timer.ElapsedMillis());
+
+		return texture;
+	}
+
+	static bool GetSourceStamp(const std::string& sourcePath, uint64_t& outSize, int64_t& outWriteTime)
+	{
+		std::error_code error;
+		outSize = (uint64_t)std::filesystem::file_size(sourcePath, error);
+		if (error)
+			return false;
+
+		outWriteTime = (int64_t)std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+		return !error;
+	}
+
+	/**
+	 * @brief Reads layout of a texture saved by SaveToCache from a memory mapped file. Mips aren't copied,
+	 * they point straight into the mapping so only the levels that are uploaded are ever read from disk.
+	 *
+	 * @return false if the file isn't a valid cooked texture or it's outdated (source file changed, different usage or compression).
+	 */
+	bool TextureCooker::OpenFromCache(const MappedFile& file, const std::string& sourcePath, TextureUsage usage, bool compress, MappedTexture& outTexture)
+	{
+		if (!file.IsInitialized() || file.GetSize() < sizeof(CookedTextureHeader))
+			return false;
+
+		CookedTextureHeader expected{};
+		if (!GetSourceStamp(sourcePath, expected.SourceSize, expected.SourceWriteTime))
+			return false;
+
+		CookedTextureHeader header{};
+		memcpy(&header, file.GetData(), sizeof(CookedTextureHeader));
+		if (header.Magic != expected.Magic || header.Version != expected.Version || header.Usage != (uint32_t)usage
+			|| header.Compressed != (uint32_t)compress || header.SourceSize != expected.SourceSize || header.SourceWriteTime != expected.SourceWriteTime)
+		{
+			VL_CORE_TRACE("Cooked texture is outdated, recooking: {}", sourcePath);
+			return false;
+		}
+
+		const uint64_t tableEnd = sizeof(CookedTextureHeader) + (uint64_t)header.MipCount * sizeof(CookedMipEntry);
+		if (file.GetSize() < tableEnd)
+			return false;
+
+		std::vector<CookedMipEntry> entries(header.MipCount);
+		memcpy(entries.data(), file.GetData() + sizeof(CookedTextureHeader), entries.size() * sizeof(CookedMipEntry));
+
+		outTexture.Format = (VkFormat)header.Format;
+		outTexture.Swizzle = { (VkComponentSwizzle)header.Swizzle[0], (VkComponentSwizzle)header.Swizzle[1], (VkComponentSwizzle)header.Swizzle[2], (VkComponentSwizzle)header.Swizzle[3] };
+		outTexture.Width = header.Width;
+		outTexture.Height = header.Height;
+		outTexture.Mips.resize(header.MipCount);
+		for (uint32_t i = 0; i < header.MipCount; i++)
+		{
+			if (entries[i].Offset + entries[i].Size > file.GetSize())
+			{
+				VL_CORE_WARN("Cooked texture is truncated, recooking: {}", sourcePath);
+				return false;
+			}
+
+			outTexture.Mips[i].Width = entries[i].Width;
+			outTexture.Mips[i].Height = entries[i].Height;
+			outTexture.Mips[i].Data = file.GetData() + entries[i].Offset;
+			outTexture.Mips[i].Size = entries[i].Size;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Saves cooked texture: header, table of mip entries and then data of every mip aligned to 16 bytes.
+	 * Data is stored from the smallest mip to the largest one, so the levels uploaded first are next to each other.
+	 */
+	void TextureCooker::SaveToCache(const std::string& cachePath, const std::string& sourcePath, TextureUsage usage, bool compress, const CookedTexture& texture)
+	{
+		CookedTextureHeader header{};
+		if (!GetSourceStamp(sourcePath, header.SourceSize, header.SourceWriteTime))
+			return;
+
+		header.Format = (uint32_t)texture.Format;
+		header.Usage = (uint32_t)usage;
+		header.Compressed = (uint32_t)compress;
+		header.Swizzle[0] = (uint32_t)texture.Swizzle.r;
+		header.Swizzle[1] = (uint32_t)texture.Swizzle.g;
+		header.Swizzle[2] = (uint32_t)texture.Swizzle.b;
+		header.Swizzle[3] = (uint32_t)texture.Swizzle.a;
+		header.Width = texture.Width;
+		header.Height = texture.Height;
+		header.MipCount = (uint32_t)texture.Mips.size();
+
+		std::vector<CookedMipEntry> entries(texture.Mips.size());
+		uint64_t offset = sizeof(CookedTextureHeader) + sizeof(CookedMipEntry) * entries.size();
+		for (int i = (int)entries.size() - 1; i >= 0; i--)
+		{
+			offset = (offset + 15) & ~15ull;
+			entries[i].Width = texture.Mips[i].Width;
+			entries[i].Height = texture.Mips[i].Height;
+			entries[i].Offset = offset;
+			entries[i].Size = texture.Mips[i].Data.size();
+			offset += entries[i].Size;
+		}
+
+		std::ofstream file(cachePath, std::ios::binary);
+		if (!file.is_open())
+		{
+			VL_CORE_WARN("Failed to write cooked texture: {}", cachePath);
+			return;
+		}
+
+		file.write((const char*)&header, sizeof(CookedTextureHeader));
+		file.write((const char*)entries.data(), entries.size() * sizeof(CookedMipEntry));
+		for (int i = (int)entries.size() - 1; i >= 0; i--)
+		{
+			file.seekp(entries[i].Offset);
+			file.write((const char*)texture.Mips[i].Data.data(), entries[i].Size);
+		}
+	}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "pch.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include "Utility/MappedFile.h"
+
+namespace Vulture
+{
+	enum class TextureUsage
+	{
+		Color,			// sRGB encoded albedo, BC7
+		Normal,			// Tangent space normal map, BC7
+		Mask,			// Roughness / metalness, BC4 when grayscale, BC7 when channels are packed
+		HDR,			// Linear HDR color, BC6H. Clamped to the half float range
+		Environment,	// HDR environment map, RGBA32F since alpha holds the importance sampling PDF and values aren't clamped
+	};
+
+	// Builds full mip chains on the CPU and compresses them into GPU block formats at import time.
+	// Results are cached next to the source file in a container with a table of per mip offsets,
+	// so later loads map the file and upload only the levels they need.
+	class TextureCooker
+	{
+	public:
+		struct MipLevel
+		{
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			std::vector<uint8_t> Data;
+		};
+
+		struct CookedTexture
+		{
+			VkFormat Format = VK_FORMAT_UNDEFINED;
+			VkComponentMapping Swizzle = {};
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			std::vector<MipLevel> Mips;
+		};
+
+		// Cooked texture read from a memory mapped cache file, mips point into the mapping
+		struct MappedTexture
+		{
+			struct Level
+			{
+				uint32_t Width = 0;
+				uint32_t Height = 0;
+				const uint8_t* Data = nullptr;
+				uint64_t Size = 0;
+			};
+
+			VkFormat Format = VK_FORMAT_UNDEFINED;
+			VkComponentMapping Swizzle = {};
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			std::vector<Level> Mips;
+		};
+
+		TextureCooker() = delete;
+
+		static CookedTexture Cook(const void* pixels, uint32_t width, uint32_t height, TextureUsage usage, bool compress);
+
+		static bool OpenFromCache(const MappedFile& file, const std::string& sourcePath, TextureUsage usage, bool compress, MappedTexture& outTexture);
+		static void SaveToCache(const std::string& cachePath, const std::string& sourcePath, TextureUsage usage, bool compress, const CookedTexture& texture);
+
+		static inline std::string GetCachePath(const std::string& sourcePath) { return sourcePath + ".vltex"; }
+		static uint32_t GetMipCount(uint32_t width, uint32_t height);
+	};
+
+}
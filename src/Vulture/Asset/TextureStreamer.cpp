@@ -0,0 +1,462 @@
+#include "pch.h"
+#include "TextureStreamer.h"
+#include "AssetManager.h"
+#include "Renderer/Renderer.h"
+
+namespace Vulture
+{
+	void TextureStreamer::Init()
+	{
+		if (s_Initialized)
+			Destroy();
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = Device::FindPhysicalQueueFamilies().GraphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		VL_CORE_RETURN_ASSERT(vkCreateCommandPool(Device::GetDevice(), &poolInfo, nullptr, &s_CommandPool),
+			VK_SUCCESS,
+			"Failed to create texture streaming command pool!"
+		);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VL_CORE_RETURN_ASSERT(vkCreateFence(Device::GetDevice(), &fenceInfo, nullptr, &s_UploadFence),
+			VK_SUCCESS,
+			"Failed to create texture streaming fence!"
+		);
+
+		s_Initialized = true;
+	}
+
+	/**
+	 * @brief Waits for the upload in flight and stops streaming. Textures stay at the levels they reached.
+	 */
+	void TextureStreamer::Destroy()
+	{
+		std::unique_lock<std::mutex> uploadLock(s_UploadMutex);
+		if (!s_Initialized)
+			return;
+
+		std::unique_lock<std::mutex> lock(s_Mutex);
+		if (s_Pending.Image != nullptr)
+		{
+			vkWaitForFences(Device::GetDevice(), 1, &s_UploadFence, VK_TRUE, UINT64_MAX);
+			CompleteUpload();
+		}
+
+		vkDestroyFence(Device::GetDevice(), s_UploadFence, nullptr);
+		vkDestroyCommandPool(Device::GetDevice(), s_CommandPool, nullptr);
+		s_UploadFence = VK_NULL_HANDLE;
+		s_CommandPool = VK_NULL_HANDLE;
+
+		s_Initialized = false;
+	}
+
+	/**
+	 * @brief Starts streaming remaining mip levels of an imported texture. Levels below image's base mip level
+	 * are read from the cooked cache file. Does nothing when the texture is already fully resident or the
+	 * cache can't be opened.
+	 *
+	 * @param image - Texture image, has to stay at the same address until Unregister is called.
+	 * @param sourcePath - Path of the source file the texture was cooked from.
+	 * @param usage - Usage the texture was cooked with.
+	 * @param compress - Whether the texture was cooked with block compression.
+	 */
+	void TextureStreamer::Register(Image* image, const std::string& sourcePath, TextureUsage usage, bool compress)
+	{
+		if (image->GetBaseMipLevel() == 0)
+			return;
+
+		VL_CORE_ASSERT(s_Initialized, "TextureStreamer is not initialized!");
+
+		Scope<StreamingTexture> texture = std::make_unique<StreamingTexture>();
+		texture->File.Init({ TextureCooker::GetCachePath(sourcePath) });
+		if (!TextureCooker::OpenFromCache(texture->File, sourcePath, usage, compress, texture->Layout) || texture->Layout.Mips.size() != image->GetMipLevelsCount())
+		{
+			VL_CORE_WARN("Failed to open cooked texture for streaming, it will stay at mip {}: {}", image->GetBaseMipLevel(), sourcePath);
+			return;
+		}
+
+		texture->UploadedMip = image->GetBaseMipLevel();
+
+		std::unique_lock<std::mutex> lock(s_Mutex);
+		s_Textures[image] = std::move(texture);
+		lock.unlock();
+
+		QueueUpload();
+	}
+
+	/**
+	 * @brief Stops streaming the texture. Waits for the upload that's currently in progress when it writes into the
+	 * image, so the image can be safely destroyed afterwards.
+	 */
+	void TextureStreamer::Unregister(Image* image)
+	{
+		std::unique_lock<std::mutex> uploadLock(s_UploadMutex);
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		const bool wasPending = s_Pending.Image == image;
+		if (wasPending)
+		{
+			vkWaitForFences(Device::GetDevice(), 1, &s_UploadFence, VK_TRUE, UINT64_MAX);
+			CompleteUpload();
+		}
+
+		s_Textures.erase(image);
+		lock.unlock();
+		uploadLock.unlock();
+
+		// Other textures were waiting for this upload to finish
+		if (wasPending)
+			QueueUpload();
+	}
+
+	/**
+	 * @brief Sets the most detailed mip level that should be resident. Levels above it are never loaded,
+	 * use it for textures that are only visible from far away. Lowering the target later streams the missing levels in.
+	 *
+	 * @param image - Registered texture image, does nothing for textures that aren't streamed.
+	 * @param mipLevel - Mip level, 0 means full resolution.
+	 */
+	void TextureStreamer::SetTargetMipLevel(Image* image, uint32_t mipLevel)
+	{
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		auto iter = s_Textures.find(image);
+		if (iter == s_Textures.end())
+			return;
+
+		iter->second->TargetMip = glm::min(mipLevel, image->GetMipLevelsCount() - 1);
+		lock.unlock();
+
+		QueueUpload();
+	}
+
+	/**
+	 * @brief Textures with higher priority get their levels uploaded sooner. Default is 1.
+	 */
+	void TextureStreamer::SetPriority(Image* image, float priority)
+	{
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		auto iter = s_Textures.find(image);
+		if (iter != s_Textures.end())
+			iter->second->Priority = glm::max(priority, 0.0f);
+	}
+
+	/**
+	 * @brief Returns the most detailed mip level that currently has valid data.
+	 */
+	uint32_t TextureStreamer::GetResidentMipLevel(Image* image)
+	{
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		auto iter = s_Textures.find(image);
+		if (iter == s_Textures.end())
+			return image->GetBaseMipLevel();
+
+		return iter->second->UploadedMip;
+	}
+
+	/**
+	 * @brief Lets the memory service move the texture during defragmentation. Uploads of the texture are held back
+	 * from the copy until the move is committed and material descriptor sets that use it are rewritten right after.
+	 *
+	 * @param image - Texture image, has to stay at the same address until it's destroyed.
+	 */
+	void TextureStreamer::SetMovable(Image* image)
+	{
+		Image::MoveCallbacks callbacks;
+		callbacks.OnMoving = [](Image* moved, bool moving) { SetMoving(moved, moving); };
+		callbacks.OnMoved = [](Image* moved) { OnViewsChanged({ moved }); };
+		callbacks.Lock = &s_UploadMutex;
+
+		image->SetMovable(callbacks);
+	}
+
+	/**
+	 * @brief Moves image views of streamed textures to their resident levels. Old views are retired through the
+	 * DeleteQueue, material descriptor sets are rewritten by BeginFrame() and view changed callbacks are called.
+	 * Has to be called before any command buffers are recorded for the frame, on the thread that records them.
+	 *
+	 * @return true if any image view changed.
+	 */
+	bool TextureStreamer::Update()
+	{
+		// Uploads write into the images, views can't be swapped in the middle of one. Instead of waiting for it the
+		// swap is retried next frame and uploads pause until then
+		std::unique_lock<std::mutex> uploadLock(s_UploadMutex, std::try_to_lock);
+		std::unique_lock<std::mutex> lock(s_Mutex);
+		if (!uploadLock.owns_lock())
+		{
+			s_ViewSwapPending = !s_Textures.empty();
+			return false;
+		}
+
+		bool resumeUploads = s_ViewSwapPending;
+		s_ViewSwapPending = false;
+
+		if (s_Pending.Image != nullptr && vkGetFenceStatus(Device::GetDevice(), s_UploadFence) == VK_SUCCESS)
+		{
+			CompleteUpload();
+			resumeUploads = true;
+		}
+
+		std::unordered_set<Image*> changedImages;
+		for (auto& [image, texture] : s_Textures)
+		{
+			const uint32_t baseMip = glm::max(texture->UploadedMip, texture->TargetMip);
+			if (baseMip != image->GetBaseMipLevel())
+			{
+				image->SetBaseMipLevel(baseMip);
+				changedImages.insert(image);
+			}
+		}
+
+		lock.unlock();
+		uploadLock.unlock();
+
+		if (resumeUploads)
+			QueueUpload();
+
+		if (changedImages.empty())
+			return false;
+
+		OnViewsChanged(changedImages);
+
+		return true;
+	}
+
+	/**
+	 * @brief Rewrites stale material descriptor sets of the frame index. Called by the renderer once the fence of the
+	 * frame that used the index before was waited on.
+	 */
+	void TextureStreamer::BeginFrame(uint32_t frameIndex)
+	{
+		if (s_StaleFrames.load(std::memory_order_relaxed) == 0)
+			return;
+
+		s_StaleFrames.fetch_sub(1, std::memory_order_relaxed);
+
+		std::unique_lock<std::mutex> assetsLock(AssetManager::s_AssetsMutex);
+		for (auto& [handle, asset] : AssetManager::s_Assets)
+		{
+			if (asset.Asset == nullptr || asset.Asset->GetAssetType() != AssetType::Material)
+				continue;
+
+			MaterialTextures& textures = static_cast<MaterialAsset*>(asset.Asset.get())->Material.Textures;
+			if (textures.IsSetCreated())
+				textures.UpdateSet(frameIndex);
+		}
+	}
+
+	/**
+	 * @brief Registers a function that's called after image views of streamed or moved textures changed. Descriptor
+	 * sets that hold those views outside of materials have to be rewritten in it, the old views stay valid until
+	 * the frames in flight finish.
+	 *
+	 * @return Id for RemoveViewChangedCallback.
+	 */
+	uint32_t TextureStreamer::AddViewChangedCallback(const ViewChangedCallback& callback)
+	{
+		std::unique_lock<std::mutex> lock(s_CallbacksMutex);
+
+		const uint32_t id = s_NextCallbackID++;
+		s_Callbacks[id] = callback;
+
+		return id;
+	}
+
+	void TextureStreamer::RemoveViewChangedCallback(uint32_t id)
+	{
+		std::unique_lock<std::mutex> lock(s_CallbacksMutex);
+
+		s_Callbacks.erase(id);
+	}
+
+	void TextureStreamer::OnViewsChanged(const std::unordered_set<Image*>& images)
+	{
+		UpdateMaterialDescriptors(images);
+
+		std::unique_lock<std::mutex> lock(s_CallbacksMutex);
+		for (auto& [id, callback] : s_Callbacks)
+			callback(images);
+	}
+
+	/**
+	 * @brief Marks descriptor sets of materials that use any of the images as stale, BeginFrame() rewrites them one
+	 * frame index at a time.
+	 */
+	void TextureStreamer::UpdateMaterialDescriptors(const std::unordered_set<Image*>& images)
+	{
+		std::unique_lock<std::mutex> assetsLock(AssetManager::s_AssetsMutex);
+		for (auto& [handle, asset] : AssetManager::s_Assets)
+		{
+			if (asset.Asset == nullptr || asset.Asset->GetAssetType() != AssetType::Material)
+				continue;
+
+			MaterialTextures& textures = static_cast<MaterialAsset*>(asset.Asset.get())->Material.Textures;
+			if (!textures.IsSetCreated())
+				continue;
+
+			const AssetHandle* handles[] = { &textures.AlbedoTexture, &textures.NormalTexture, &textures.RoughnessTexture, &textures.MetallnessTexture };
+			for (const AssetHandle* texture : handles)
+			{
+				if (texture->DoesHandleExist() && texture->IsAssetLoaded() && images.contains(texture->GetImage()))
+				{
+					textures.UpdateSet();
+					break;
+				}
+			}
+		}
+
+		s_StaleFrames.store(Renderer::GetMaxFramesInFlight(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Returns the first mip level that is uploaded during import, every level from it down to 1x1
+	 * is small enough to be loaded right away.
+	 */
+	uint32_t TextureStreamer::GetTailMipLevel(uint32_t width, uint32_t height)
+	{
+		uint32_t level = 0;
+		while (glm::max(width >> level, height >> level) > s_TailSize)
+			level++;
+
+		return level;
+	}
+
+	/**
+	 * @brief Holds uploads of a texture back while it's being moved. Called with s_UploadMutex held.
+	 */
+	void TextureStreamer::SetMoving(Image* image, bool moving)
+	{
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		auto iter = s_Textures.find(image);
+		if (iter == s_Textures.end())
+			return;
+
+		iter->second->Moving = moving;
+		lock.unlock();
+
+		if (!moving)
+			QueueUpload();
+	}
+
+	void TextureStreamer::QueueUpload()
+	{
+		std::unique_lock<std::mutex> lock(s_Mutex);
+		if (s_UploadQueued)
+			return;
+
+		s_UploadQueued = true;
+		lock.unlock();
+
+		AssetManager::s_ThreadPool.PushTask(&TextureStreamer::UploadNextMip);
+	}
+
+	/**
+	 * @brief Marks the level of the pending upload as resident and recycles its command buffer. Called with
+	 * s_UploadMutex and s_Mutex held, after the upload fence signaled.
+	 */
+	void TextureStreamer::CompleteUpload()
+	{
+		auto iter = s_Textures.find(s_Pending.Image);
+		if (iter != s_Textures.end())
+			iter->second->UploadedMip = s_Pending.Level;
+
+		vkFreeCommandBuffers(Device::GetDevice(), s_CommandPool, 1, &s_Pending.Cmd);
+		vkResetFences(Device::GetDevice(), 1, &s_UploadFence);
+
+		s_Pending = {};
+		s_UploadQueued = false;
+	}
+
+	/**
+	 * @brief Records and submits the copy of a single mip level without waiting for it. Update() completes it and
+	 * queues the next one while there are levels left. Picks the level with the best priority to size ratio, so
+	 * small levels of all textures arrive before large ones.
+	 */
+	void TextureStreamer::UploadNextMip()
+	{
+		std::unique_lock<std::mutex> uploadLock(s_UploadMutex);
+		std::unique_lock<std::mutex> lock(s_Mutex);
+
+		// Update() queues the upload again once it swapped the views or completed the pending upload
+		if (s_ViewSwapPending || s_Pending.Image != nullptr || !s_Initialized)
+		{
+			s_UploadQueued = s_Pending.Image != nullptr;
+			return;
+		}
+
+		Image* bestImage = nullptr;
+		StreamingTexture* best = nullptr;
+		float bestScore = 0.0f;
+		for (auto& [image, texture] : s_Textures)
+		{
+			if (texture->UploadedMip <= texture->TargetMip || texture->Priority <= 0.0f || texture->Moving)
+				continue;
+
+			const float score = texture->Priority / (float)texture->Layout.Mips[texture->UploadedMip - 1].Size;
+			if (best == nullptr || score > bestScore)
+			{
+				bestImage = image;
+				best = texture.get();
+				bestScore = score;
+			}
+		}
+
+		if (best == nullptr)
+		{
+			s_UploadQueued = false;
+			return;
+		}
+
+		const uint32_t level = best->UploadedMip - 1;
+		const TextureCooker::MappedTexture::Level& mip = best->Layout.Mips[level];
+		lock.unlock();
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = s_CommandPool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer cmd;
+		vkAllocateCommandBuffers(Device::GetDevice(), &allocInfo, &cmd);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmd, &beginInfo);
+
+		// The level isn't visible through the image view yet, so it can be written while the image is in use. The
+		// staging buffer goes through the DeleteQueue, frames submitted after this copy retire it
+		bestImage->WriteMipLevels({ mip.Data }, { mip.Size }, level, cmd);
+
+		vkEndCommandBuffer(cmd);
+
+		{
+			std::unique_lock<std::mutex> queueLock(Device::GetGraphicsQueueMutex());
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &cmd;
+			VL_CORE_RETURN_ASSERT(vkQueueSubmit(Device::GetGraphicsQueue(), 1, &submitInfo, s_UploadFence),
+				VK_SUCCESS,
+				"Failed to submit texture streaming upload!"
+			);
+		}
+
+		lock.lock();
+		s_Pending.Image = bestImage;
+		s_Pending.Level = level;
+		s_Pending.Cmd = cmd;
+	}
+
+}
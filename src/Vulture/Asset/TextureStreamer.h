@@ -0,0 +1,90 @@
+#pragma once
+#include "pch.h"
+
+#include "Vulkan/Image.h"
+#include "TextureCooker.h"
+
+#include <atomic>
+
+namespace Vulture
+{
+	// Streams mip levels of cooked textures in the background. Textures are imported with only their
+	// smallest mips uploaded (see GetTailMipLevel), the rest is read from the memory mapped cache file
+	// one level at a time, smallest pending uploads first. Every level is copied by a submission of its own
+	// that nothing waits on, Update() checks its fence and moves image views to the level once it signaled.
+	// Update() has to be called once per frame on the thread that records frames.
+	//
+	// Old views are retired through the DeleteQueue. Material descriptor sets are rewritten one frame index at a
+	// time in BeginFrame(), anything else that holds a view of a streamed texture has to register a callback.
+	class TextureStreamer
+	{
+	public:
+		using ViewChangedCallback = std::function<void(const std::unordered_set<Image*>& images)>;
+
+		TextureStreamer() = delete;
+
+		static void Init();
+		static void Destroy();
+
+		static void Register(Image* image, const std::string& sourcePath, TextureUsage usage, bool compress);
+		static void Unregister(Image* image);
+
+		static void SetTargetMipLevel(Image* image, uint32_t mipLevel);
+		static void SetPriority(Image* image, float priority);
+		static uint32_t GetResidentMipLevel(Image* image);
+		static void SetMovable(Image* image);
+
+		static bool Update();
+		static void BeginFrame(uint32_t frameIndex);
+
+		static uint32_t AddViewChangedCallback(const ViewChangedCallback& callback);
+		static void RemoveViewChangedCallback(uint32_t id);
+
+		static uint32_t GetTailMipLevel(uint32_t width, uint32_t height);
+		static inline void SetTailSize(uint32_t size) { s_TailSize = size; }
+	private:
+		struct StreamingTexture
+		{
+			MappedFile File;
+			TextureCooker::MappedTexture Layout;
+			uint32_t UploadedMip = 0; // Lowest level with valid data
+			uint32_t TargetMip = 0;
+			float Priority = 1.0f;
+			bool Moving = false; // Copied by defragmentation, writes would be lost until the move is committed
+		};
+
+		// Level whose copy was submitted but hasn't finished yet, at most one at a time
+		struct PendingUpload
+		{
+			Image* Image = nullptr;
+			uint32_t Level = 0;
+			VkCommandBuffer Cmd = VK_NULL_HANDLE;
+		};
+
+		static void QueueUpload();
+		static void CompleteUpload();
+		static void SetMoving(Image* image, bool moving);
+		static void UploadNextMip();
+		static void OnViewsChanged(const std::unordered_set<Image*>& images);
+		static void UpdateMaterialDescriptors(const std::unordered_set<Image*>& images);
+
+		inline static std::unordered_map<Image*, Scope<StreamingTexture>> s_Textures;
+		inline static std::mutex s_Mutex;
+		inline static std::mutex s_UploadMutex; // Held for the whole upload so textures can't be unregistered in the middle of it
+		inline static bool s_UploadQueued = false;
+		inline static bool s_ViewSwapPending = false; // Update() couldn't take the upload lock, uploads pause until it does
+		inline static std::atomic<uint32_t> s_StaleFrames = 0; // Frame indices whose material sets still have to be rewritten
+
+		// Guarded by s_UploadMutex
+		inline static VkCommandPool s_CommandPool = VK_NULL_HANDLE;
+		inline static VkFence s_UploadFence = VK_NULL_HANDLE;
+		inline static PendingUpload s_Pending;
+		inline static bool s_Initialized = false;
+
+		inline static std::mutex s_CallbacksMutex;
+		inline static std::unordered_map<uint32_t, ViewChangedCallback> s_Callbacks;
+		inline static uint32_t s_NextCallbackID = 1;
+		inline static uint32_t s_TailSize = 128;
+	};
+
+}
@@ -2,8 +2,10 @@
 #include "Application.h"
 #include "Renderer/Renderer.h"
 #include "Asset/AssetManager.h"
+#include "Asset/TextureStreamer.h"
 #include "Input.h"
 #include "Vulkan/DeleteQueue.h"
+#include "Vulkan/BufferReadback.h"
 
 #include "Scene/Components.h"
 #include "Asset/Serializer.h"
@@ -18,12 +20,15 @@ namespace Vulture
 
 		Logger::Init();
 		VL_CORE_TRACE("LOGGER INITIALIZED");
-		Window::CreateInfo winInfo;
-		winInfo.Width = (int)appInfo.WindowWidth;
-		winInfo.Height = (int)appInfo.WindowHeight;
-		winInfo.Name = appInfo.Name;
-		winInfo.Icon = appInfo.Icon;
-		m_Window = std::make_shared<Window>(winInfo);
+		if (!appInfo.Headless)
+		{
+			Window::CreateInfo winInfo;
+			winInfo.Width = (int)appInfo.WindowWidth;
+			winInfo.Height = (int)appInfo.WindowHeight;
+			winInfo.Name = appInfo.Name;
+			winInfo.Icon = appInfo.Icon;
+			m_Window = std::make_shared<Window>(winInfo);
+		}
 
 		Device::CreateInfo deviceInfo{};
 		deviceInfo.DeviceExtensions = appInfo.DeviceExtensions;
@@ -33,11 +38,26 @@ namespace Vulture
 		deviceInfo.UseRayTracing = appInfo.EnableRayTracingSupport;
 		deviceInfo.UseMemoryAddress = appInfo.UseMemoryAddress;
 		Device::Init(deviceInfo);
-		Renderer::Init(*m_Window, appInfo.MaxFramesInFlight);
-		Input::Init(m_Window->GetGLFWwindow());
+		MemoryService::CreateInfo memoryInfo = appInfo.MemoryInfo;
+		memoryInfo.FramesInFlight = appInfo.MaxFramesInFlight;
+		MemoryService::Init(memoryInfo);
+		BufferReadback::Init({});
+		TextureStreamer::Init();
 
+		// The renderer records on the worker pool
 		const uint32_t coresCount = std::thread::hardware_concurrency();
 		AssetManager::Init({ coresCount / 2 });
+
+		if (m_Window)
+		{
+			Renderer::Init(*m_Window, appInfo.MaxFramesInFlight);
+			Input::Init(m_Window->GetGLFWwindow());
+		}
+		else
+		{
+			Renderer::InitHeadless({ appInfo.WindowWidth, appInfo.WindowHeight }, appInfo.MaxFramesInFlight);
+		}
+
 		DeleteQueue::Init({ appInfo.MaxFramesInFlight });
 
 		REGISTER_CLASS_IN_SERIALIZER(ScriptComponent);
@@ -47,6 +67,8 @@ namespace Vulture
 		REGISTER_CLASS_IN_SERIALIZER(MaterialComponent);
 		REGISTER_CLASS_IN_SERIALIZER(TonemapperSettingsComponent);
 		REGISTER_CLASS_IN_SERIALIZER(BloomSettingsComponent);
+
+		m_FrameStats.Init(FrameStats::CreateInfo{});
 	}
 
 	Application::~Application()
@@ -57,25 +79,252 @@ namespace Vulture
 	void Application::Run()
 	{
 		VL_CORE_TRACE("\n\n\n\nMAIN LOOP START\n\n\n\n");
-		Timer timer;
+		VL_PROFILE_THREAD("Main Thread");
+
+		if (m_ApplicationInfo.UseRenderThread)
+			RunWithRenderThread();
+		else
+			RunSingleThreaded();
+
+		m_FrameStats.Log();
+
+		vkDeviceWaitIdle(Device::GetDevice());
+
+		Renderer::Destroy();
+		Destroy();
+		TextureStreamer::Destroy();
+		BufferReadback::Destroy();
+		DeleteQueue::Destroy();
+		MemoryService::Destroy();
+		Device::Destroy();
+		Logger::Shutdown();
+	}
+
+	void Application::RunSingleThreaded()
+	{
+		Timer stageTimer;
 		double deltaTime = 0.0f;
+		FrameLimiter::Clock::time_point frameStart = FrameLimiter::Clock::now();
 
-		while (!m_Window->ShouldClose())
+		while (!ShouldClose())
 		{
-			timer.Reset();
-			m_Window->PollEvents();
+			stageTimer.Reset();
+			PollEvents();
+			m_FrameStats.AddSample(FrameStats::Stage::Poll, stageTimer.ElapsedMillis());
+
+			// Descriptors of streamed and moved textures can only be updated before the frame is recorded
+			MemoryService::Update();
+			TextureStreamer::Update();
+			BufferReadback::Update();
 
+			StepFixedUpdates(deltaTime);
+
+			// Rendering happens inside of OnUpdate, its stages are subtracted to get the update alone
+			stageTimer.Reset();
 			OnUpdate(deltaTime);
-			deltaTime = timer.ElapsedSeconds();
+			const float updateMs = stageTimer.ElapsedMillis();
+
+			const float rendererMs = RecordRendererStages();
+			m_FrameStats.AddSample(FrameStats::Stage::Update, std::max(0.0f, updateMs - rendererMs));
 
 			DeleteQueue::UpdateQueue();
+
+			PaceFrame(frameStart);
+
+			const FrameLimiter::Clock::time_point now = FrameLimiter::Clock::now();
+			deltaTime = std::chrono::duration<double>(now - frameStart).count();
+			m_FrameStats.AddSample(FrameStats::Stage::Frame, (float)(deltaTime * 1000.0));
+			frameStart = now;
+			m_FrameCount++;
 		}
+	}
 
-		vkDeviceWaitIdle(Device::GetDevice());
+	/**
+	 * @brief Simulates frame N + 1 on the main thread while the render thread records frame N. Events have to be
+	 * polled on the main thread, so that's where the simulation stays.
+	 */
+	void Application::RunWithRenderThread()
+	{
+		m_Snapshots.Init(RenderSnapshotQueue::CreateInfo{ m_ApplicationInfo.RenderSnapshotCount });
+		m_RenderBusyNs = 0;
+		std::thread renderThread(&Application::RenderThreadLoop, this);
 
-		Renderer::Destroy();
-		Destroy();
-		DeleteQueue::Destroy();
-		Device::Destroy();
+		Timer stageTimer;
+		Timer statsTimer;
+		Timer busyTimer;
+		double deltaTime = 0.0f;
+		uint64_t frameNumber = 0;
+		FrameLimiter::Clock::time_point frameStart = FrameLimiter::Clock::now();
+
+		double simulationMs = 0.0;
+		uint32_t statsFrames = 0;
+		while (!ShouldClose())
+		{
+			stageTimer.Reset();
+			PollEvents();
+			m_FrameStats.AddSample(FrameStats::Stage::Poll, stageTimer.ElapsedMillis());
+
+			busyTimer.Reset();
+			StepFixedUpdates(deltaTime);
+			OnUpdate(deltaTime);
+			const float updateMs = busyTimer.ElapsedMillis();
+			simulationMs += updateMs;
+
+			// Waits while the render thread is RenderSnapshotCount - 1 frames behind
+			RenderSnapshot* snapshot = m_Snapshots.BeginWrite();
+
+			busyTimer.Reset();
+			snapshot->FrameNumber = frameNumber++;
+			snapshot->DeltaTime = deltaTime;
+			snapshot->InterpolationAlpha = m_InterpolationAlpha;
+			OnExtract(*snapshot);
+			m_Snapshots.EndWrite(snapshot);
+			const float extractMs = busyTimer.ElapsedMillis();
+			simulationMs += extractMs;
+			m_FrameStats.AddSample(FrameStats::Stage::Update, updateMs + extractMs);
+
+			statsFrames++;
+			if (statsTimer.ElapsedSeconds() >= 1.0f)
+			{
+				// Whatever part of both stages doesn't fit into the wall time ran concurrently
+				const double wallMs = statsTimer.ElapsedMillis();
+				const double renderMs = m_RenderBusyNs.exchange(0) / 1000000.0;
+
+				FrameOverlapStats stats;
+				stats.FrameMs = wallMs / statsFrames;
+				stats.SimulationMs = simulationMs / statsFrames;
+				stats.RenderMs = renderMs / statsFrames;
+				stats.OverlapMs = std::max(0.0, simulationMs + renderMs - wallMs) / statsFrames;
+				{
+					std::unique_lock<std::mutex> lock(m_StatsMutex);
+					m_OverlapStats = stats;
+				}
+
+				simulationMs = 0.0;
+				statsFrames = 0;
+				statsTimer.Reset();
+			}
+
+			PaceFrame(frameStart);
+
+			const FrameLimiter::Clock::time_point now = FrameLimiter::Clock::now();
+			deltaTime = std::chrono::duration<double>(now - frameStart).count();
+			m_FrameStats.AddSample(FrameStats::Stage::Frame, (float)(deltaTime * 1000.0));
+			frameStart = now;
+			m_FrameCount++;
+		}
+
+		m_Snapshots.Close();
+		renderThread.join();
+		m_Snapshots.Destroy();
+
+		const FrameOverlapStats stats = GetFrameOverlapStats();
+		VL_CORE_INFO("Render thread: frame {:.3f}ms, simulation {:.3f}ms, render {:.3f}ms, overlap {:.3f}ms ({:.0f}%)",
+			stats.FrameMs, stats.SimulationMs, stats.RenderMs, stats.OverlapMs, stats.GetOverlapRatio() * 100.0);
+	}
+
+	void Application::RenderThreadLoop()
+	{
+		VL_PROFILE_THREAD("Render Thread");
+		Device::CreateCommandPoolForThread();
+
+		while (RenderSnapshot* snapshot = m_Snapshots.BeginRead())
+		{
+			VL_PROFILE_SCOPE("Render Snapshot");
+			const auto start = std::chrono::high_resolution_clock::now();
+
+			// Descriptors of streamed and moved textures can only be updated before the frame is recorded
+			MemoryService::Update();
+			TextureStreamer::Update();
+			BufferReadback::Update();
+
+			OnRender(*snapshot);
+			RecordRendererStages();
+
+			DeleteQueue::UpdateQueue();
+
+			m_RenderBusyNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+			m_Snapshots.EndRead(snapshot);
+		}
+	}
+
+	void Application::Close()
+	{
+		m_CloseRequested = true;
+
+		if (m_Window)
+			m_Window->Close();
+	}
+
+	bool Application::ShouldClose() const
+	{
+		if (m_CloseRequested)
+			return true;
+
+		if (m_Window)
+			return m_Window->ShouldClose();
+
+		return m_ApplicationInfo.HeadlessFrameCount != 0 && m_FrameCount >= m_ApplicationInfo.HeadlessFrameCount;
+	}
+
+	void Application::PollEvents()
+	{
+		// Also feeds ImGui input, the render thread must not call into GLFW
+		if (m_Window)
+			Renderer::PollEvents();
+	}
+
+	/**
+	 * @brief Runs as many OnFixedUpdate steps as fit into the accumulated time and updates the interpolation alpha.
+	 */
+	void Application::StepFixedUpdates(double deltaTime)
+	{
+		const double step = m_ApplicationInfo.FixedTimestep;
+		if (step <= 0.0)
+			return;
+
+		Timer timer;
+
+		m_FixedAccumulator += std::min(deltaTime, step * m_ApplicationInfo.MaxFixedStepsPerFrame);
+		while (m_FixedAccumulator >= step)
+		{
+			OnFixedUpdate(step);
+			m_FixedAccumulator -= step;
+		}
+		m_InterpolationAlpha = m_FixedAccumulator / step;
+
+		m_FrameStats.AddSample(FrameStats::Stage::FixedUpdate, timer.ElapsedMillis());
+	}
+
+	/**
+	 * @brief Moves the renderer stage timings of the last frame into the frame stats.
+	 *
+	 * @return Sum of all renderer stages in milliseconds.
+	 */
+	float Application::RecordRendererStages()
+	{
+		const Renderer::FrameTimings timings = Renderer::TakeFrameTimings();
+		m_FrameStats.AddSample(FrameStats::Stage::Acquire, timings.AcquireMs);
+		m_FrameStats.AddSample(FrameStats::Stage::Record, timings.RecordMs);
+		m_FrameStats.AddSample(FrameStats::Stage::Submit, timings.SubmitMs);
+		m_FrameStats.AddSample(FrameStats::Stage::Present, timings.PresentMs);
+
+		return timings.AcquireMs + timings.RecordMs + timings.SubmitMs + timings.PresentMs;
+	}
+
+	/**
+	 * @brief Waits out the rest of the frame when ApplicationInfo::MaxFrameRate is set.
+	 */
+	void Application::PaceFrame(FrameLimiter::Clock::time_point frameStart)
+	{
+		if (m_ApplicationInfo.MaxFrameRate <= 0.0)
+			return;
+
+		Timer timer;
+
+		const auto frameDuration = std::chrono::duration_cast<FrameLimiter::Clock::duration>(std::chrono::duration<double>(1.0 / m_ApplicationInfo.MaxFrameRate));
+		m_FrameLimiter.WaitUntil(frameStart + frameDuration);
+
+		m_FrameStats.AddSample(FrameStats::Stage::Pacing, timer.ElapsedMillis());
 	}
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 
 #include "Vulture/Utility/Utility.h"
 #include "Vulkan/Device.h"
+#include "Renderer/RenderSnapshot.h"
+#include "Utility/FrameStats.h"
+#include "Utility/FrameLimiter.h"
+
+#include <atomic>
 
 namespace Vulture
 {
@@ -19,6 +24,36 @@ namespace Vulture
 		std::vector<const char*> DeviceExtensions;
 		std::vector<const char*> OptionalExtensions;
 		VkPhysicalDeviceFeatures2 Features = VkPhysicalDeviceFeatures2();
+
+		// No window, surface or swapchain. Frames are rendered offscreen with WindowWidth x WindowHeight, m_Window
+		// stays null and the application runs until Close() or HeadlessFrameCount frames
+		bool Headless = false;
+		uint64_t HeadlessFrameCount = 0; // 0 means no limit
+
+		// When enabled OnUpdate only simulates, OnExtract copies the frame into a snapshot and OnRender
+		// records it on a separate thread while the next frame is simulated
+		bool UseRenderThread = false;
+		uint32_t RenderSnapshotCount = 2; // 2 lets the simulation run one frame ahead, 3 two frames
+
+		// Step of OnFixedUpdate in seconds, 0 disables fixed updates
+		double FixedTimestep = 0.0;
+		uint32_t MaxFixedStepsPerFrame = 8; // Time beyond this many steps is dropped, so a long frame can't snowball
+
+		double MaxFrameRate = 0.0; // 0 leaves pacing to the present mode
+
+		MemoryService::CreateInfo MemoryInfo; // Budget thresholds and defragmentation pacing
+	};
+
+	// Averages over the last measured second of the render thread mode
+	struct FrameOverlapStats
+	{
+		double FrameMs = 0.0;
+		double SimulationMs = 0.0; // OnUpdate + OnExtract
+		double RenderMs = 0.0; // OnRender + per frame upkeep
+		double OverlapMs = 0.0; // Time both threads were working at once
+
+		// Fraction of the shorter stage that was hidden behind the other one
+		inline double GetOverlapRatio() const { double shorter = std::min(SimulationMs, RenderMs); return shorter > 0.0 ? OverlapMs / shorter : 0.0; }
 	};
 
 	class Application
@@ -30,11 +65,57 @@ namespace Vulture
 		virtual void Destroy() = 0;
 		virtual void OnUpdate(double delta) = 0;
 
+		// Called 0 or more times per frame before OnUpdate with ApplicationInfo::FixedTimestep
+		virtual void OnFixedUpdate(double fixedDelta) {}
+
+		// Only called with ApplicationInfo::UseRenderThread, OnExtract on the main thread and OnRender on the render thread
+		virtual void OnExtract(RenderSnapshot& snapshot) {}
+		virtual void OnRender(const RenderSnapshot& snapshot) {}
+
 		void Run();
+
+		// Stops the main loop after the current frame
+		void Close();
+
+		inline uint64_t GetFrameCount() const { return m_FrameCount; }
+
+		inline FrameOverlapStats GetFrameOverlapStats() { std::unique_lock<std::mutex> lock(m_StatsMutex); return m_OverlapStats; }
+		inline FrameStats& GetFrameStats() { return m_FrameStats; }
+
+		// How far the current frame is between the last two fixed updates, in [0, 1). Blend the previous and
+		// current fixed update state with it to render smoothly
+		inline double GetInterpolationAlpha() const { return m_InterpolationAlpha; }
 	protected:
 
 		ApplicationInfo m_ApplicationInfo;
-		Ref<Window> m_Window;
+		Ref<Window> m_Window; // Null in headless mode
+
+	private:
+		void RunSingleThreaded();
+		void RunWithRenderThread();
+		void RenderThreadLoop();
+
+		bool ShouldClose() const;
+		void PollEvents();
+
+		void StepFixedUpdates(double deltaTime);
+		float RecordRendererStages();
+		void PaceFrame(FrameLimiter::Clock::time_point frameStart);
+
+		std::atomic<bool> m_CloseRequested = false;
+		uint64_t m_FrameCount = 0;
+
+		RenderSnapshotQueue m_Snapshots;
+		std::atomic<uint64_t> m_RenderBusyNs = 0;
+
+		std::mutex m_StatsMutex;
+		FrameOverlapStats m_OverlapStats;
+
+		double m_FixedAccumulator = 0.0;
+		double m_InterpolationAlpha = 1.0;
+
+		FrameStats m_FrameStats;
+		FrameLimiter m_FrameLimiter;
 	};
 
 	// defined by client
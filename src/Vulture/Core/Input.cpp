@@ -22,18 +22,29 @@ namespace Vulture
 		glfwSetScrollCallback(window, ScrollCallback);
 	}
 
+	// Without a window (headless mode) nothing is ever pressed
+
 	bool Input::IsKeyPressed(int keyCode)
 	{
+		if (s_Window == nullptr)
+			return false;
+
 		return glfwGetKey(s_Window, keyCode);
 	}
 
 	bool Input::IsMousePressed(int mouseButton)
 	{
+		if (s_Window == nullptr)
+			return false;
+
 		return glfwGetMouseButton(s_Window, mouseButton);
 	}
 
 	glm::vec2 Input::GetMousePosition()
 	{
+		if (s_Window == nullptr)
+			return glm::vec2(0.0f);
+
 		double x, y;
 		glfwGetCursorPos(s_Window, &x, &y);
 		return glm::vec2(x, y);
@@ -49,6 +60,6 @@ namespace Vulture
 		scrollValue = x;
 	}
 
-	GLFWwindow* Input::s_Window;
+	GLFWwindow* Input::s_Window = nullptr;
 
 }
\ No newline at end of file
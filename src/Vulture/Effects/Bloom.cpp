@@ -80,7 +80,9 @@ namespace Vulture
 			m_DownSamplePipeline.Init(info);
 		}
 
-		CreateBloomMips();
+		// Without an input image the mips are created by a render graph in AddToGraph()
+		if (m_InputImage != nullptr)
+			CreateBloomMips();
 
 		m_Initialized = true;
 	}
@@ -114,6 +116,12 @@ namespace Vulture
 		m_DownSampleSet = std::move(other.m_DownSampleSet);
 		m_AccumulateSet = std::move(other.m_AccumulateSet);
 		m_BloomImages = std::move(other.m_BloomImages);
+		m_Mips = std::move(other.m_Mips);
+		m_GraphMips = std::move(other.m_GraphMips);
+		m_GraphInput = std::move(other.m_GraphInput);
+		m_GraphOutput = std::move(other.m_GraphOutput);
+		m_GraphMipCount = std::move(other.m_GraphMipCount);
+		m_GraphVersion = std::move(other.m_GraphVersion);
 		m_SeparateBrightValuesPipeline = std::move(other.m_SeparateBrightValuesPipeline);
 		m_DownSamplePipeline = std::move(other.m_DownSamplePipeline);
 		m_AccumulatePipeline = std::move(other.m_AccumulatePipeline);
@@ -135,6 +143,12 @@ namespace Vulture
 		m_DownSampleSet = std::move(other.m_DownSampleSet);
 		m_AccumulateSet = std::move(other.m_AccumulateSet);
 		m_BloomImages = std::move(other.m_BloomImages);
+		m_Mips = std::move(other.m_Mips);
+		m_GraphMips = std::move(other.m_GraphMips);
+		m_GraphInput = std::move(other.m_GraphInput);
+		m_GraphOutput = std::move(other.m_GraphOutput);
+		m_GraphMipCount = std::move(other.m_GraphMipCount);
+		m_GraphVersion = std::move(other.m_GraphVersion);
 		m_SeparateBrightValuesPipeline = std::move(other.m_SeparateBrightValuesPipeline);
 		m_DownSamplePipeline = std::move(other.m_DownSamplePipeline);
 		m_AccumulatePipeline = std::move(other.m_AccumulatePipeline);
@@ -154,6 +168,10 @@ namespace Vulture
 
 	void Bloom::Run(const BloomInfo& _bloomInfo, VkCommandBuffer cmd)
 	{
+		VL_CORE_ASSERT(!m_BloomImages.empty(), "Bloom was initialized for a render graph, use AddToGraph()!");
+
+		GpuProfileScope scope(cmd, "Bloom");
+
 		BloomInfo bloomInfo = _bloomInfo;
 
 		if (bloomInfo.MipCount != m_CurrentMipCount)
@@ -273,6 +291,171 @@ namespace Vulture
 		);
 	}
 
+	/**
+	 * @brief Adds the bloom passes to a render graph. Mips are transient graph images, so they only take memory while
+	 * bloom runs and only MipCount + 1 of them are created. The mip count is fixed until the graph is rebuilt.
+	 *
+	 * @param input - Image bloom is applied to.
+	 * @param output - Can be the same as input.
+	 * @param settings - Read every time the graph executes, has to outlive the graph.
+	 */
+	void Bloom::AddToGraph(RenderGraph& graph, RenderGraph::ResourceHandle input, RenderGraph::ResourceHandle output, const BloomInfo* settings)
+	{
+		VL_CORE_ASSERT(m_Initialized, "Bloom is not initialized!");
+		VL_CORE_ASSERT(settings != nullptr, "Bloom needs settings!");
+
+		uint32_t mipCount = settings->MipCount;
+		if (mipCount <= 0 || mipCount > 10)
+		{
+			VL_CORE_WARN("Incorrect mips count! {}. Min = 1 & Max = 10", mipCount);
+		}
+		mipCount = glm::clamp(mipCount, (uint32_t)1, (uint32_t)10);
+
+		m_GraphInput = input;
+		m_GraphOutput = output;
+		m_GraphMipCount = mipCount;
+		m_GraphVersion = 0;
+
+		RenderGraph::ImageDesc desc{};
+		desc.Width = graph.GetImageSize(input).width;
+		desc.Height = graph.GetImageSize(input).height;
+		desc.Format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		desc.DebugName = "Bright Values Image";
+
+		m_GraphMips.clear();
+		m_GraphMips.push_back(graph.CreateImage(desc));
+		for (uint32_t j = 0; j < mipCount; j++)
+		{
+			desc.DebugName = "Bloom Mip Image " + std::to_string(j);
+			desc.Width = glm::max(1, (int)desc.Width / 2);
+			desc.Height = glm::max(1, (int)desc.Height / 2);
+			m_GraphMips.push_back(graph.CreateImage(desc));
+		}
+
+		if (input != output)
+		{
+			graph.AddPass("Bloom Copy", RenderGraph::PassType::Transfer,
+				[&](RenderGraph::PassBuilder& builder)
+				{
+					builder.Read(input, RenderGraph::Access::TransferSrc);
+					builder.Write(output, RenderGraph::Access::TransferDst);
+				},
+				[&graph, input, output](VkCommandBuffer cmd)
+				{
+					Image* inputImage = graph.GetImage(input);
+					Image* outputImage = graph.GetImage(output);
+
+					VkImageBlit region{};
+					region.dstOffsets[1] = { (int)outputImage->GetImageSize().width, (int)outputImage->GetImageSize().height, 1 };
+					region.srcOffsets[1] = { (int)inputImage->GetImageSize().width, (int)inputImage->GetImageSize().height, 1 };
+					region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+					region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+					vkCmdBlitImage(cmd, inputImage->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, outputImage->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+				}
+			);
+		}
+
+		graph.AddPass("Bloom Separate Bright Values", RenderGraph::PassType::Compute,
+			[&](RenderGraph::PassBuilder& builder)
+			{
+				builder.Read(output);
+				builder.Write(m_GraphMips[0]);
+			},
+			[this, &graph, settings](VkCommandBuffer cmd)
+			{
+				UpdateGraphDescriptors(graph);
+
+				auto* data = m_Push.GetDataPtr();
+				data->MipCount = m_GraphMipCount;
+				data->Strength = settings->Strength;
+				data->Threshold = settings->Threshold;
+
+				m_SeparateBrightValuesPipeline.Bind(cmd);
+				m_SeparateBrightValuesSet.Bind(0, m_SeparateBrightValuesPipeline.GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE, cmd);
+				m_Push.Push(m_SeparateBrightValuesPipeline.GetPipelineLayout(), cmd);
+
+				VkExtent2D size = m_Mips[0]->GetImageSize();
+				vkCmdDispatch(cmd, size.width / 8 + 1, size.height / 8 + 1, 1);
+			}
+		);
+
+		for (uint32_t i = 1; i < mipCount + 1; i++)
+		{
+			graph.AddPass("Bloom Down Sample " + std::to_string(i), RenderGraph::PassType::Compute,
+				[&](RenderGraph::PassBuilder& builder)
+				{
+					builder.Read(m_GraphMips[i - 1]);
+					builder.Write(m_GraphMips[i]);
+				},
+				[this, i](VkCommandBuffer cmd)
+				{
+					m_DownSamplePipeline.Bind(cmd);
+					m_DownSampleSet[i - 1].Bind(0, m_DownSamplePipeline.GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE, cmd);
+					m_Push.Push(m_DownSamplePipeline.GetPipelineLayout(), cmd);
+
+					VkExtent2D size = m_Mips[i]->GetImageSize();
+					vkCmdDispatch(cmd, size.width / 8 + 1, size.height / 8 + 1, 1);
+				}
+			);
+		}
+
+		for (uint32_t i = 0; i < mipCount; i++)
+		{
+			uint32_t idx = mipCount - i;
+			graph.AddPass("Bloom Accumulate " + std::to_string(idx - 1), RenderGraph::PassType::Compute,
+				[&](RenderGraph::PassBuilder& builder)
+				{
+					builder.Read(m_GraphMips[idx]);
+					builder.Write(m_GraphMips[idx - 1], RenderGraph::Access::StorageReadWrite);
+				},
+				[this, i, idx](VkCommandBuffer cmd)
+				{
+					m_AccumulatePipeline.Bind(cmd);
+					m_AccumulateSet[i].Bind(0, m_AccumulatePipeline.GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE, cmd);
+					m_Push.Push(m_AccumulatePipeline.GetPipelineLayout(), cmd);
+
+					VkExtent2D size = m_Mips[idx - 1]->GetImageSize();
+					vkCmdDispatch(cmd, size.width / 8 + 1, size.height / 8 + 1, 1);
+				}
+			);
+		}
+
+		// Same descriptor as the last set in RecreateDescriptors(), the first mip is composited into the output
+		graph.AddPass("Bloom Composite", RenderGraph::PassType::Compute,
+			[&](RenderGraph::PassBuilder& builder)
+			{
+				builder.Read(m_GraphMips[1]);
+				builder.Write(output, RenderGraph::Access::StorageReadWrite);
+			},
+			[this, &graph, output](VkCommandBuffer cmd)
+			{
+				m_AccumulatePipeline.Bind(cmd);
+				m_AccumulateSet[m_GraphMipCount].Bind(0, m_AccumulatePipeline.GetPipelineLayout(), VK_PIPELINE_BIND_POINT_COMPUTE, cmd);
+				m_Push.Push(m_AccumulatePipeline.GetPipelineLayout(), cmd);
+
+				VkExtent2D size = graph.GetImageSize(output);
+				vkCmdDispatch(cmd, size.width / 8 + 1, size.height / 8 + 1, 1);
+			}
+		);
+	}
+
+	// Transient images are recreated by every RenderGraph::Compile()
+	void Bloom::UpdateGraphDescriptors(const RenderGraph& graph)
+	{
+		if (m_GraphVersion == graph.GetVersion())
+			return;
+
+		m_GraphVersion = graph.GetVersion();
+		m_InputImage = graph.GetImage(m_GraphInput);
+		m_OutputImage = graph.GetImage(m_GraphOutput);
+
+		m_Mips.clear();
+		for (RenderGraph::ResourceHandle mip : m_GraphMips)
+			m_Mips.push_back(graph.GetImage(mip));
+
+		RecreateDescriptors(m_GraphMipCount);
+	}
+
 	void Bloom::RecreateDescriptors(uint32_t mipsCount)
 	{
 		m_CurrentMipCount = mipsCount;
@@ -302,7 +485,7 @@ namespace Vulture
 			m_SeparateBrightValuesSet.AddImageSampler(
 				1,
 				{ Vulture::Renderer::GetLinearSampler().GetSamplerHandle(),
-				m_BloomImages[0].GetImageView(),
+				m_Mips[0]->GetImageView(),
 				VK_IMAGE_LAYOUT_GENERAL }
 			);
 			m_SeparateBrightValuesSet.Build();
@@ -322,13 +505,13 @@ namespace Vulture
 				descIdx = (mipsCount)-j;
 				m_AccumulateSet[j].Init(&Vulture::Renderer::GetDescriptorPool(), { bin, bin1 });
 
-				m_AccumulateSet[j].AddImageSampler(0, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_BloomImages[descIdx].GetImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
-				m_AccumulateSet[j].AddImageSampler(1, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_BloomImages[descIdx - 1].GetImageView(), VK_IMAGE_LAYOUT_GENERAL });
+				m_AccumulateSet[j].AddImageSampler(0, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_Mips[descIdx]->GetImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+				m_AccumulateSet[j].AddImageSampler(1, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_Mips[descIdx - 1]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL });
 				m_AccumulateSet[j].Build();
 			}
 			m_AccumulateSet[j].Init(&Vulture::Renderer::GetDescriptorPool(), { bin, bin1 });
 
-			m_AccumulateSet[j].AddImageSampler(0, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_BloomImages[descIdx].GetImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+			m_AccumulateSet[j].AddImageSampler(0, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_Mips[descIdx]->GetImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
 			m_AccumulateSet[j].AddImageSampler(1, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_OutputImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL });
 			m_AccumulateSet[j].Build();
 		}
@@ -343,10 +526,10 @@ namespace Vulture
 			for (int j = 0; j < m_DownSampleSet.size(); j++)
 			{
 				m_DownSampleSet[j].Init(&Vulture::Renderer::GetDescriptorPool(), { bin, bin1 });
-				m_DownSampleSet[j].AddImageSampler(0, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_BloomImages[j].GetImageView() ,
+				m_DownSampleSet[j].AddImageSampler(0, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_Mips[j]->GetImageView() ,
 					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
 				);
-				m_DownSampleSet[j].AddImageSampler(1, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_BloomImages[j + 1].GetImageView(),
+				m_DownSampleSet[j].AddImageSampler(1, { Vulture::Renderer::GetLinearSampler().GetSamplerHandle(), m_Mips[j + 1]->GetImageView(),
 					VK_IMAGE_LAYOUT_GENERAL }
 				);
 				m_DownSampleSet[j].Build();
@@ -379,6 +562,10 @@ namespace Vulture
 			info.Height = glm::max(1, (int)info.Height / 2);
 			m_BloomImages[j + 1].Init(info);
 		}
+
+		m_Mips.clear();
+		for (Image& image : m_BloomImages)
+			m_Mips.push_back(&image);
 	}
 
 	void Bloom::Reset()
@@ -388,6 +575,12 @@ namespace Vulture
 		m_DownSampleSet.clear();
 		m_AccumulateSet.clear();
 		m_BloomImages.clear();
+		m_Mips.clear();
+		m_GraphMips.clear();
+		m_GraphInput = RenderGraph::InvalidResource;
+		m_GraphOutput = RenderGraph::InvalidResource;
+		m_GraphMipCount = 0;
+		m_GraphVersion = 0;
 		m_InputImage = nullptr;
 		m_OutputImage = nullptr;
 		m_Initialized = false;
@@ -6,6 +6,7 @@
 #include "Vulkan/DescriptorSet.h"
 #include "Vulkan/Pipeline.h"
 #include "Vulkan/PushConstant.h"
+#include "Renderer/RenderGraph.h"
 
 namespace Vulture
 {
@@ -39,12 +40,14 @@ namespace Vulture
 		Bloom& operator=(Bloom&& other) noexcept;
 
 		void Run(const BloomInfo& bloomInfo, VkCommandBuffer cmd);
+		void AddToGraph(RenderGraph& graph, RenderGraph::ResourceHandle input, RenderGraph::ResourceHandle output, const BloomInfo* settings);
 
 		void UpdateDescriptors(const CreateInfo& info);
 
 		inline bool IsInitialized() const { return m_Initialized; }
 	private:
 		void RecreateDescriptors(uint32_t mipsCount);
+		void UpdateGraphDescriptors(const RenderGraph& graph);
 		void CreateBloomMips();
 		PushConstant<BloomInfo> m_Push;
 
@@ -55,6 +58,14 @@ namespace Vulture
 		std::vector<DescriptorSet> m_AccumulateSet;
 
 		std::vector<Image> m_BloomImages;
+		std::vector<Image*> m_Mips; // Either m_BloomImages or transient images of a render graph
+
+		// Render graph path, mips are transient images there
+		std::vector<RenderGraph::ResourceHandle> m_GraphMips;
+		RenderGraph::ResourceHandle m_GraphInput = RenderGraph::InvalidResource;
+		RenderGraph::ResourceHandle m_GraphOutput = RenderGraph::InvalidResource;
+		uint32_t m_GraphMipCount = 0;
+		uint64_t m_GraphVersion = 0;
 
 		Pipeline m_SeparateBrightValuesPipeline;
 		Pipeline m_DownSamplePipeline;
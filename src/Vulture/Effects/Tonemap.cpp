@@ -13,30 +13,12 @@ namespace Vulture
 		if (m_Initialized)
 			Destroy();
 
-		m_ImageSize = info.OutputImage->GetImageSize();
-
 		m_InputImage = info.InputImage;
 		m_OutputImage = info.OutputImage;
 
-		{
-			Vulture::DescriptorSetLayout::Binding bin{ 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT };
-			Vulture::DescriptorSetLayout::Binding bin1{ 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT };
-
-			m_Descriptor.Init(&Vulture::Renderer::GetDescriptorPool(), { bin, bin1 });
-			m_Descriptor.AddImageSampler(
-				0,
-				{ Vulture::Renderer::GetLinearSampler().GetSamplerHandle(),
-				info.InputImage->GetImageView(),
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
-			);
-			m_Descriptor.AddImageSampler(
-				1,
-				{ Vulture::Renderer::GetLinearSampler().GetSamplerHandle(),
-				info.OutputImage->GetImageView(),
-				VK_IMAGE_LAYOUT_GENERAL }
-			);
-			m_Descriptor.Build();
-		}
+		// Without images the descriptor is created once a render graph compiles, see AddToGraph()
+		if (m_InputImage != nullptr && m_OutputImage != nullptr)
+			CreateDescriptor();
 
 		// Pipeline
 		{
@@ -109,6 +91,29 @@ namespace Vulture
 		}
 	}
 
+	void Tonemap::CreateDescriptor()
+	{
+		m_ImageSize = m_OutputImage->GetImageSize();
+
+		Vulture::DescriptorSetLayout::Binding bin{ 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT };
+		Vulture::DescriptorSetLayout::Binding bin1{ 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT };
+
+		m_Descriptor.Init(&Vulture::Renderer::GetDescriptorPool(), { bin, bin1 });
+		m_Descriptor.AddImageSampler(
+			0,
+			{ Vulture::Renderer::GetLinearSampler().GetSamplerHandle(),
+			m_InputImage->GetImageView(),
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+		);
+		m_Descriptor.AddImageSampler(
+			1,
+			{ Vulture::Renderer::GetLinearSampler().GetSamplerHandle(),
+			m_OutputImage->GetImageView(),
+			VK_IMAGE_LAYOUT_GENERAL }
+		);
+		m_Descriptor.Build();
+	}
+
 	Tonemap::Tonemap(const CreateInfo& info)
 	{
 		Init(info);
@@ -125,6 +130,7 @@ namespace Vulture
 		m_ImageSize	= std::move(other.m_ImageSize);
 		m_InputImage = std::move(other.m_InputImage);
 		m_OutputImage = std::move(other.m_OutputImage);
+		m_GraphVersion = std::move(other.m_GraphVersion);
 		m_Initialized = std::move(other.m_Initialized);
 
 		other.Reset();
@@ -141,6 +147,7 @@ namespace Vulture
 		m_ImageSize = std::move(other.m_ImageSize);
 		m_InputImage = std::move(other.m_InputImage);
 		m_OutputImage = std::move(other.m_OutputImage);
+		m_GraphVersion = std::move(other.m_GraphVersion);
 		m_Initialized = std::move(other.m_Initialized);
 
 		other.Reset();
@@ -155,12 +162,9 @@ namespace Vulture
 
 	void Tonemap::Run(const TonemapInfo& info, VkCommandBuffer cmd)
 	{
-		if (m_CurrentTonemapper != info.Tonemapper || m_EnableChromaticAberration != info.ChromaticAberration)
-		{
-			m_CurrentTonemapper = info.Tonemapper;
-			m_EnableChromaticAberration = info.ChromaticAberration;
-			RecompileShader(m_CurrentTonemapper, m_EnableChromaticAberration);
-		}
+		VL_CORE_ASSERT(m_InputImage != nullptr, "Tonemap was initialized for a render graph, use AddToGraph()!");
+
+		GpuProfileScope scope(cmd, "Tonemap");
 
 		m_OutputImage->TransitionImageLayout(
 			VK_IMAGE_LAYOUT_GENERAL,
@@ -169,6 +173,52 @@ namespace Vulture
 
 		m_InputImage->TransitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, Vulture::Renderer::GetCurrentCommandBuffer());
 
+		Dispatch(info, cmd);
+	}
+
+	/**
+	 * @brief Adds a single compute pass that samples the input and writes the output, the graph handles the transitions.
+	 *
+	 * @param settings - Read every time the graph executes, has to outlive the graph.
+	 */
+	void Tonemap::AddToGraph(RenderGraph& graph, RenderGraph::ResourceHandle input, RenderGraph::ResourceHandle output, const TonemapInfo* settings)
+	{
+		VL_CORE_ASSERT(m_Initialized, "Tonemap is not initialized!");
+		VL_CORE_ASSERT(settings != nullptr, "Tonemap needs settings!");
+
+		m_GraphVersion = 0;
+
+		graph.AddPass("Tonemap", RenderGraph::PassType::Compute,
+			[&](RenderGraph::PassBuilder& builder)
+			{
+				builder.Read(input);
+				builder.Write(output);
+			},
+			[this, &graph, input, output, settings](VkCommandBuffer cmd)
+			{
+				// Either image can be transient, those are recreated by every compile
+				if (m_GraphVersion != graph.GetVersion())
+				{
+					m_GraphVersion = graph.GetVersion();
+					m_InputImage = graph.GetImage(input);
+					m_OutputImage = graph.GetImage(output);
+					CreateDescriptor();
+				}
+
+				Dispatch(*settings, cmd);
+			}
+		);
+	}
+
+	void Tonemap::Dispatch(const TonemapInfo& info, VkCommandBuffer cmd)
+	{
+		if (m_CurrentTonemapper != info.Tonemapper || m_EnableChromaticAberration != info.ChromaticAberration)
+		{
+			m_CurrentTonemapper = info.Tonemapper;
+			m_EnableChromaticAberration = info.ChromaticAberration;
+			RecompileShader(m_CurrentTonemapper, m_EnableChromaticAberration);
+		}
+
 		m_Pipeline.Bind(cmd);
 
 		m_Descriptor.Bind(
@@ -218,6 +268,7 @@ namespace Vulture
 		m_ImageSize = { 0, 0 };
 		m_InputImage = nullptr;
 		m_OutputImage = nullptr;
+		m_GraphVersion = 0;
 		m_Initialized = false;
 
 		m_CurrentTonemapper = Tonemappers::Filmic;
@@ -6,6 +6,7 @@
 #include "Vulkan/DescriptorSet.h"
 #include "Vulkan/Pipeline.h"
 #include "Vulkan/PushConstant.h"
+#include "Renderer/RenderGraph.h"
 
 namespace Vulture
 {
@@ -65,7 +66,11 @@ namespace Vulture
 		Tonemap& operator=(Tonemap&& other) noexcept;
 
 		void Run(const TonemapInfo& info, VkCommandBuffer cmd);
+		void AddToGraph(RenderGraph& graph, RenderGraph::ResourceHandle input, RenderGraph::ResourceHandle output, const TonemapInfo* settings);
 	private:
+		void CreateDescriptor();
+		void Dispatch(const TonemapInfo& info, VkCommandBuffer cmd);
+
 		std::string GetTonemapperMacroDefinition(Tonemappers tonemapper);
 
 		void RecompileShader(Tonemappers tonemapper, bool chromaticAberration);
@@ -82,6 +87,8 @@ namespace Vulture
 		Image* m_InputImage = nullptr;
 		Image* m_OutputImage = nullptr;
 
+		uint64_t m_GraphVersion = 0;
+
 		bool m_Initialized = false;
 
 		void Reset();
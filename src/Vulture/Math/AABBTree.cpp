@@ -0,0 +1,634 @@
+#include "pch.h"
+#include "AABBTree.h"
+
+#include "Utility/Logger.h"
+#include "Utility/Timer.h"
+
+namespace Vulture
+{
+	static float SurfaceArea(const glm::vec3& min, const glm::vec3& max)
+	{
+		const glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	/**
+	 * @brief Adds a box to the tree, it becomes visible to queries after the next Flush().
+	 *
+	 * @param min, max - Tight bounds of the object.
+	 * @param userData - Returned by Query() when the box is visible.
+	 *
+	 * @return Proxy id used to move and destroy the box.
+	 */
+	int32_t AABBTree::CreateProxy(const glm::vec3& min, const glm::vec3& max, uint32_t userData)
+	{
+		int32_t proxy;
+		if (!m_FreeProxies.empty())
+		{
+			proxy = m_FreeProxies.back();
+			m_FreeProxies.pop_back();
+		}
+		else
+		{
+			proxy = (int32_t)m_Proxies.size();
+			m_Proxies.emplace_back();
+			m_TightMinX.push_back(0.0f); m_TightMinY.push_back(0.0f); m_TightMinZ.push_back(0.0f);
+			m_TightMaxX.push_back(0.0f); m_TightMaxY.push_back(0.0f); m_TightMaxZ.push_back(0.0f);
+		}
+
+		m_Proxies[proxy].Node = NullNode;
+		m_Proxies[proxy].UserData = userData;
+		m_Proxies[proxy].State = ProxyState::Pending;
+
+		m_TightMinX[proxy] = min.x; m_TightMinY[proxy] = min.y; m_TightMinZ[proxy] = min.z;
+		m_TightMaxX[proxy] = max.x; m_TightMaxY[proxy] = max.y; m_TightMaxZ[proxy] = max.z;
+
+		m_PendingProxies.push_back(proxy);
+		m_ProxyCount++;
+
+		return proxy;
+	}
+
+	void AABBTree::DestroyProxy(int32_t proxy)
+	{
+		VL_CORE_ASSERT(proxy >= 0 && proxy < (int32_t)m_Proxies.size() && m_Proxies[proxy].State != ProxyState::Free, "Invalid proxy!");
+
+		// Pending proxies are skipped by Flush() once they're free
+		if (m_Proxies[proxy].State == ProxyState::Inserted)
+		{
+			RemoveLeaf(m_Proxies[proxy].Node);
+			FreeNode(m_Proxies[proxy].Node);
+		}
+
+		m_Proxies[proxy] = {};
+		m_FreeProxies.push_back(proxy);
+		m_ProxyCount--;
+	}
+
+	/**
+	 * @brief Updates bounds of the proxy. The tree is only modified when the new box leaves the enlarged one.
+	 *
+	 * @return True when the proxy was reinserted.
+	 */
+	bool AABBTree::MoveProxy(int32_t proxy, const glm::vec3& min, const glm::vec3& max)
+	{
+		VL_CORE_ASSERT(proxy >= 0 && proxy < (int32_t)m_Proxies.size() && m_Proxies[proxy].State != ProxyState::Free, "Invalid proxy!");
+
+		m_TightMinX[proxy] = min.x; m_TightMinY[proxy] = min.y; m_TightMinZ[proxy] = min.z;
+		m_TightMaxX[proxy] = max.x; m_TightMaxY[proxy] = max.y; m_TightMaxZ[proxy] = max.z;
+
+		if (m_Proxies[proxy].State == ProxyState::Pending)
+			return false;
+
+		const int32_t leaf = m_Proxies[proxy].Node;
+		if (glm::all(glm::lessThanEqual(m_Nodes[leaf].Min, min)) && glm::all(glm::lessThanEqual(max, m_Nodes[leaf].Max)))
+			return false;
+
+		RemoveLeaf(leaf);
+		SetLeafBox(leaf, proxy);
+		InsertLeaf(leaf);
+
+		return true;
+	}
+
+	void AABBTree::Clear()
+	{
+		m_Nodes.clear();
+		m_Proxies.clear();
+		m_FreeProxies.clear();
+		m_PendingProxies.clear();
+		m_TightMinX.clear(); m_TightMinY.clear(); m_TightMinZ.clear();
+		m_TightMaxX.clear(); m_TightMaxY.clear(); m_TightMaxZ.clear();
+		m_Root = NullNode;
+		m_FreeList = NullNode;
+		m_ProxyCount = 0;
+	}
+
+	/**
+	 * @brief Inserts pending proxies. When they make up a large part of the tree it's rebuilt from scratch instead.
+	 */
+	void AABBTree::Flush()
+	{
+		if (m_PendingProxies.empty())
+			return;
+
+		if (m_PendingProxies.size() * 4 > m_ProxyCount)
+		{
+			Rebuild();
+			return;
+		}
+
+		for (int32_t proxy : m_PendingProxies)
+		{
+			// Proxies destroyed and recreated while pending show up more than once
+			if (m_Proxies[proxy].State != ProxyState::Pending)
+				continue;
+
+			const int32_t leaf = AllocateNode();
+			m_Nodes[leaf].Proxy = proxy;
+			m_Nodes[leaf].UserData = m_Proxies[proxy].UserData;
+			SetLeafBox(leaf, proxy);
+			InsertLeaf(leaf);
+
+			m_Proxies[proxy].Node = leaf;
+			m_Proxies[proxy].State = ProxyState::Inserted;
+		}
+
+		m_PendingProxies.clear();
+	}
+
+	/**
+	 * @brief Rebuilds the tree top down by splitting proxies at the median of the longest axis of their centers.
+	 * Nodes are laid out depth first, so every subtree is a contiguous range of nodes.
+	 */
+	void AABBTree::Rebuild()
+	{
+		m_PendingProxies.clear();
+		m_Nodes.clear();
+		m_Root = NullNode;
+		m_FreeList = NullNode;
+
+		std::vector<int32_t> proxies;
+		proxies.reserve(m_ProxyCount);
+		std::vector<glm::vec3> centers(m_Proxies.size());
+		for (int32_t i = 0; i < (int32_t)m_Proxies.size(); i++)
+		{
+			if (m_Proxies[i].State == ProxyState::Free)
+				continue;
+
+			proxies.push_back(i);
+			centers[i] = glm::vec3(m_TightMinX[i] + m_TightMaxX[i], m_TightMinY[i] + m_TightMaxY[i], m_TightMinZ[i] + m_TightMaxZ[i]) * 0.5f;
+		}
+
+		if (proxies.empty())
+			return;
+
+		m_Nodes.reserve(proxies.size() * 2 - 1);
+		m_Root = BuildRecursive(proxies.data(), (uint32_t)proxies.size(), NullNode, centers);
+	}
+
+	int32_t AABBTree::BuildRecursive(int32_t* proxies, uint32_t count, int32_t parent, const std::vector<glm::vec3>& centers)
+	{
+		const int32_t index = AllocateNode();
+		m_Nodes[index].Parent = parent;
+
+		if (count == 1)
+		{
+			const int32_t proxy = proxies[0];
+			m_Nodes[index].Proxy = proxy;
+			m_Nodes[index].UserData = m_Proxies[proxy].UserData;
+			SetLeafBox(index, proxy);
+
+			m_Proxies[proxy].Node = index;
+			m_Proxies[proxy].State = ProxyState::Inserted;
+
+			return index;
+		}
+
+		glm::vec3 min(std::numeric_limits<float>::max());
+		glm::vec3 max(std::numeric_limits<float>::lowest());
+		for (uint32_t i = 0; i < count; i++)
+		{
+			min = glm::min(min, centers[proxies[i]]);
+			max = glm::max(max, centers[proxies[i]]);
+		}
+
+		const glm::vec3 size = max - min;
+		const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+		const uint32_t half = count / 2;
+		std::nth_element(proxies, proxies + half, proxies + count, [&](int32_t a, int32_t b)
+		{
+			const glm::vec3& centerA = centers[a];
+			const glm::vec3& centerB = centers[b];
+			return axis == 0 ? centerA.x < centerB.x : (axis == 1 ? centerA.y < centerB.y : centerA.z < centerB.z);
+		});
+
+		const int32_t child1 = BuildRecursive(proxies, half, index, centers);
+		const int32_t child2 = BuildRecursive(proxies + half, count - half, index, centers);
+		m_Nodes[index].Child1 = child1;
+		m_Nodes[index].Child2 = child2;
+		Refit(index);
+
+		return index;
+	}
+
+	/**
+	 * @brief Appends user data of every proxy whose tight box isn't outside of the frustum. Subtrees fully inside
+	 * are taken without further tests, leaves of intersecting nodes are tested in batches with Frustum::CullAABBs().
+	 */
+	void AABBTree::Query(const Frustum& frustum, std::vector<uint32_t>& outUserData)
+	{
+		Flush();
+
+		if (m_Root == NullNode)
+			return;
+
+		m_Stack.clear();
+		m_Candidates.clear();
+		m_Stack.push_back(m_Root);
+
+		while (!m_Stack.empty())
+		{
+			const int32_t index = m_Stack.back();
+			m_Stack.pop_back();
+
+			const Node& node = m_Nodes[index];
+			if (node.Child1 == NullNode)
+			{
+				m_Candidates.push_back(node.Proxy);
+				continue;
+			}
+
+			const Frustum::Result result = frustum.TestAABB(node.Min, node.Max);
+			if (result == Frustum::Result::Outside)
+				continue;
+
+			if (result == Frustum::Result::Intersect)
+			{
+				m_Stack.push_back(node.Child2);
+				m_Stack.push_back(node.Child1);
+				continue;
+			}
+
+			// Fully inside, tight boxes of all leaves below are inside as well
+			const size_t stackBase = m_Stack.size();
+			m_Stack.push_back(index);
+			while (m_Stack.size() > stackBase)
+			{
+				const Node& inside = m_Nodes[m_Stack.back()];
+				m_Stack.pop_back();
+
+				if (inside.Child1 == NullNode)
+				{
+					outUserData.push_back(inside.UserData);
+					continue;
+				}
+
+				m_Stack.push_back(inside.Child2);
+				m_Stack.push_back(inside.Child1);
+			}
+		}
+
+		const uint32_t count = (uint32_t)m_Candidates.size();
+		m_CandidateBoxes.resize(count * 6);
+		float* minX = m_CandidateBoxes.data();
+		float* minY = minX + count;
+		float* minZ = minY + count;
+		float* maxX = minZ + count;
+		float* maxY = maxX + count;
+		float* maxZ = maxY + count;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const int32_t proxy = m_Candidates[i];
+			minX[i] = m_TightMinX[proxy]; minY[i] = m_TightMinY[proxy]; minZ[i] = m_TightMinZ[proxy];
+			maxX[i] = m_TightMaxX[proxy]; maxY[i] = m_TightMaxY[proxy]; maxZ[i] = m_TightMaxZ[proxy];
+		}
+
+		m_Visible.resize(count);
+		const uint32_t visibleCount = frustum.CullAABBs(minX, minY, minZ, maxX, maxY, maxZ, count, m_Visible.data());
+		for (uint32_t i = 0; i < visibleCount; i++)
+			outUserData.push_back(m_Proxies[m_Candidates[m_Visible[i]]].UserData);
+	}
+
+	int32_t AABBTree::AllocateNode()
+	{
+		int32_t index;
+		if (m_FreeList != NullNode)
+		{
+			index = m_FreeList;
+			m_FreeList = m_Nodes[index].Parent;
+		}
+		else
+		{
+			index = (int32_t)m_Nodes.size();
+			m_Nodes.emplace_back();
+		}
+
+		Node& node = m_Nodes[index];
+		node.Parent = NullNode;
+		node.Child1 = NullNode;
+		node.Child2 = NullNode;
+		node.Height = 0;
+		node.Proxy = NullNode;
+		node.UserData = 0;
+
+		return index;
+	}
+
+	void AABBTree::FreeNode(int32_t node)
+	{
+		m_Nodes[node].Parent = m_FreeList;
+		m_Nodes[node].Height = -1;
+		m_FreeList = node;
+	}
+
+	void AABBTree::SetLeafBox(int32_t leaf, int32_t proxy)
+	{
+		const glm::vec3 min(m_TightMinX[proxy], m_TightMinY[proxy], m_TightMinZ[proxy]);
+		const glm::vec3 max(m_TightMaxX[proxy], m_TightMaxY[proxy], m_TightMaxZ[proxy]);
+
+		const glm::vec3 size = max - min;
+		const glm::vec3 margin = glm::vec3(glm::max(size.x, glm::max(size.y, size.z)) * m_Margin);
+		m_Nodes[leaf].Min = min - margin;
+		m_Nodes[leaf].Max = max + margin;
+	}
+
+	void AABBTree::InsertLeaf(int32_t leaf)
+	{
+		if (m_Root == NullNode)
+		{
+			m_Root = leaf;
+			m_Nodes[leaf].Parent = NullNode;
+			return;
+		}
+
+		// Walk down towards the sibling with the lowest cost of the new parent plus the growth of its ancestors
+		const glm::vec3 leafMin = m_Nodes[leaf].Min;
+		const glm::vec3 leafMax = m_Nodes[leaf].Max;
+		int32_t index = m_Root;
+		while (!IsLeaf(index))
+		{
+			const Node& node = m_Nodes[index];
+			const float area = SurfaceArea(node.Min, node.Max);
+			const float combinedArea = SurfaceArea(glm::min(node.Min, leafMin), glm::max(node.Max, leafMax));
+
+			const float cost = 2.0f * combinedArea;
+			const float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto descendCost = [&](int32_t child)
+			{
+				const Node& childNode = m_Nodes[child];
+				const float unionArea = SurfaceArea(glm::min(childNode.Min, leafMin), glm::max(childNode.Max, leafMax));
+				return (IsLeaf(child) ? unionArea : unionArea - SurfaceArea(childNode.Min, childNode.Max)) + inheritanceCost;
+			};
+
+			const float cost1 = descendCost(node.Child1);
+			const float cost2 = descendCost(node.Child2);
+			if (cost < cost1 && cost < cost2)
+				break;
+
+			index = cost1 < cost2 ? node.Child1 : node.Child2;
+		}
+
+		const int32_t sibling = index;
+		const int32_t oldParent = m_Nodes[sibling].Parent;
+		const int32_t newParent = AllocateNode();
+
+		m_Nodes[newParent].Parent = oldParent;
+		m_Nodes[newParent].Min = glm::min(leafMin, m_Nodes[sibling].Min);
+		m_Nodes[newParent].Max = glm::max(leafMax, m_Nodes[sibling].Max);
+		m_Nodes[newParent].Height = m_Nodes[sibling].Height + 1;
+		m_Nodes[newParent].Child1 = sibling;
+		m_Nodes[newParent].Child2 = leaf;
+
+		if (oldParent != NullNode)
+		{
+			if (m_Nodes[oldParent].Child1 == sibling)
+				m_Nodes[oldParent].Child1 = newParent;
+			else
+				m_Nodes[oldParent].Child2 = newParent;
+		}
+		else
+		{
+			m_Root = newParent;
+		}
+
+		m_Nodes[sibling].Parent = newParent;
+		m_Nodes[leaf].Parent = newParent;
+
+		for (index = m_Nodes[leaf].Parent; index != NullNode; index = m_Nodes[index].Parent)
+		{
+			index = Balance(index);
+			Refit(index);
+		}
+	}
+
+	void AABBTree::RemoveLeaf(int32_t leaf)
+	{
+		if (leaf == m_Root)
+		{
+			m_Root = NullNode;
+			return;
+		}
+
+		const int32_t parent = m_Nodes[leaf].Parent;
+		const int32_t grandParent = m_Nodes[parent].Parent;
+		const int32_t sibling = m_Nodes[parent].Child1 == leaf ? m_Nodes[parent].Child2 : m_Nodes[parent].Child1;
+
+		FreeNode(parent);
+		if (grandParent == NullNode)
+		{
+			m_Root = sibling;
+			m_Nodes[sibling].Parent = NullNode;
+			return;
+		}
+
+		if (m_Nodes[grandParent].Child1 == parent)
+			m_Nodes[grandParent].Child1 = sibling;
+		else
+			m_Nodes[grandParent].Child2 = sibling;
+		m_Nodes[sibling].Parent = grandParent;
+
+		for (int32_t index = grandParent; index != NullNode; index = m_Nodes[index].Parent)
+		{
+			index = Balance(index);
+			Refit(index);
+		}
+	}
+
+	void AABBTree::Refit(int32_t index)
+	{
+		Node& node = m_Nodes[index];
+		const Node& child1 = m_Nodes[node.Child1];
+		const Node& child2 = m_Nodes[node.Child2];
+
+		node.Min = glm::min(child1.Min, child2.Min);
+		node.Max = glm::max(child1.Max, child2.Max);
+		node.Height = 1 + glm::max(child1.Height, child2.Height);
+	}
+
+	/**
+	 * @brief Rotates the subtree if its children heights differ by more than one.
+	 *
+	 * @return Index of the node that is now at the place of iA.
+	 */
+	int32_t AABBTree::Balance(int32_t iA)
+	{
+		Node& A = m_Nodes[iA];
+		if (IsLeaf(iA) || A.Height < 2)
+			return iA;
+
+		const int32_t iB = A.Child1;
+		const int32_t iC = A.Child2;
+		Node& B = m_Nodes[iB];
+		Node& C = m_Nodes[iC];
+
+		const int32_t balance = C.Height - B.Height;
+
+		// Promote C or B, whichever is higher. The taller grandchild stays under the promoted node
+		auto rotate = [&](int32_t iUp, Node& up, int32_t iOther, Node& other, bool upIsChild2)
+		{
+			const int32_t iF = up.Child1;
+			const int32_t iG = up.Child2;
+			Node& F = m_Nodes[iF];
+			Node& G = m_Nodes[iG];
+
+			up.Child1 = iA;
+			up.Parent = A.Parent;
+			A.Parent = iUp;
+
+			if (up.Parent != NullNode)
+			{
+				if (m_Nodes[up.Parent].Child1 == iA)
+					m_Nodes[up.Parent].Child1 = iUp;
+				else
+					m_Nodes[up.Parent].Child2 = iUp;
+			}
+			else
+			{
+				m_Root = iUp;
+			}
+
+			const int32_t iKeep = F.Height > G.Height ? iF : iG;
+			const int32_t iMove = F.Height > G.Height ? iG : iF;
+			Node& keep = m_Nodes[iKeep];
+			Node& move = m_Nodes[iMove];
+
+			up.Child2 = iKeep;
+			if (upIsChild2)
+				A.Child2 = iMove;
+			else
+				A.Child1 = iMove;
+			move.Parent = iA;
+
+			A.Min = glm::min(other.Min, move.Min);
+			A.Max = glm::max(other.Max, move.Max);
+			A.Height = 1 + glm::max(other.Height, move.Height);
+
+			up.Min = glm::min(A.Min, keep.Min);
+			up.Max = glm::max(A.Max, keep.Max);
+			up.Height = 1 + glm::max(A.Height, keep.Height);
+		};
+
+		if (balance > 1)
+		{
+			rotate(iC, C, iB, B, true);
+			return iC;
+		}
+
+		if (balance < -1)
+		{
+			rotate(iB, B, iC, C, false);
+			return iB;
+		}
+
+		return iA;
+	}
+
+
+	/**
+	 * @brief Builds a tree of random boxes and compares frustum queries with brute force culling, first box by box and
+	 * then with Frustum::CullAABBs(). Tree results are checked against brute force after moving a tenth of the boxes.
+	 * Results are logged.
+	 *
+	 * @param boxCount - Number of boxes scattered in a 2000 unit cube around the camera.
+	 */
+	void AABBTree::RunBenchmark(uint32_t boxCount)
+	{
+		uint32_t seed = 0x12345678;
+		auto random = [&seed](float min, float max)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return min + (max - min) * ((float)(seed >> 8) / (float)(1 << 24));
+		};
+
+		std::vector<glm::vec3> mins(boxCount), maxs(boxCount);
+		for (uint32_t i = 0; i < boxCount; i++)
+		{
+			mins[i] = glm::vec3(random(-1000.0f, 1000.0f), random(-1000.0f, 1000.0f), random(-1000.0f, 1000.0f));
+			maxs[i] = mins[i] + glm::vec3(random(0.5f, 5.0f), random(0.5f, 5.0f), random(0.5f, 5.0f));
+		}
+
+		// 60 degree perspective looking down -Z from the origin, Vulkan clip space with depth in [0, 1]
+		const float nearPlane = 0.1f, farPlane = 1000.0f, aspect = 16.0f / 9.0f;
+		const float focal = 1.0f / glm::tan(glm::radians(60.0f) * 0.5f);
+		glm::mat4 projection(0.0f);
+		projection[0][0] = focal / aspect;
+		projection[1][1] = -focal;
+		projection[2][2] = farPlane / (nearPlane - farPlane);
+		projection[2][3] = -1.0f;
+		projection[3][2] = -(farPlane * nearPlane) / (farPlane - nearPlane);
+		const Frustum frustum(projection);
+
+		auto bruteForce = [&]()
+		{
+			std::vector<uint32_t> visible;
+			for (uint32_t i = 0; i < boxCount; i++)
+			{
+				if (frustum.IsVisible(mins[i], maxs[i]))
+					visible.push_back(i);
+			}
+			return visible;
+		};
+
+		VL_CORE_INFO("AABB tree benchmark, {} boxes", boxCount);
+
+		AABBTree tree;
+		std::vector<int32_t> proxies(boxCount);
+		Timer timer;
+		for (uint32_t i = 0; i < boxCount; i++)
+			proxies[i] = tree.CreateProxy(mins[i], maxs[i], i);
+		tree.Flush();
+		VL_CORE_INFO("    {:<20} {:9.2f}ms  height {}", "bulk build", timer.ElapsedMillis(), tree.GetHeight());
+
+		timer.Reset();
+		std::vector<uint32_t> expected = bruteForce();
+		VL_CORE_INFO("    {:<20} {:9.2f}ms  {} visible", "scalar brute force", timer.ElapsedMillis(), expected.size());
+
+		std::vector<float> minX(boxCount), minY(boxCount), minZ(boxCount), maxX(boxCount), maxY(boxCount), maxZ(boxCount);
+		for (uint32_t i = 0; i < boxCount; i++)
+		{
+			minX[i] = mins[i].x; minY[i] = mins[i].y; minZ[i] = mins[i].z;
+			maxX[i] = maxs[i].x; maxY[i] = maxs[i].y; maxZ[i] = maxs[i].z;
+		}
+		std::vector<uint32_t> soaVisible(boxCount);
+		timer.Reset();
+		const uint32_t soaCount = frustum.CullAABBs(minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), boxCount, soaVisible.data());
+		VL_CORE_INFO("    {:<20} {:9.2f}ms  {} visible", "SoA brute force", timer.ElapsedMillis(), soaCount);
+
+		constexpr uint32_t queryRuns = 10;
+		std::vector<uint32_t> visible;
+		visible.reserve(boxCount);
+		tree.Query(frustum, visible); // Warm up
+		timer.Reset();
+		for (uint32_t run = 0; run < queryRuns; run++)
+		{
+			visible.clear();
+			tree.Query(frustum, visible);
+		}
+		VL_CORE_INFO("    {:<20} {:9.2f}ms  {} visible", "tree query", timer.ElapsedMillis() / queryRuns, visible.size());
+
+		std::sort(visible.begin(), visible.end());
+		const bool soaMatches = std::equal(soaVisible.begin(), soaVisible.begin() + soaCount, expected.begin(), expected.end());
+		if (visible != expected || !soaMatches)
+			VL_CORE_WARN("    Query results don't match brute force!");
+
+		uint32_t reinserted = 0;
+		timer.Reset();
+		for (uint32_t i = 0; i < boxCount; i += 10)
+		{
+			const glm::vec3 offset(random(-3.0f, 3.0f), random(-3.0f, 3.0f), random(-3.0f, 3.0f));
+			mins[i] += offset;
+			maxs[i] += offset;
+			reinserted += tree.MoveProxy(proxies[i], mins[i], maxs[i]) ? 1 : 0;
+		}
+		VL_CORE_INFO("    {:<20} {:9.2f}ms  {} reinserted", "move 10%", timer.ElapsedMillis(), reinserted);
+
+		visible.clear();
+		tree.Query(frustum, visible);
+		std::sort(visible.begin(), visible.end());
+		if (visible != bruteForce())
+			VL_CORE_WARN("    Query results after moves don't match brute force!");
+	}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "pch.h"
+
+#include "glm/glm.hpp"
+#include "Frustum.h"
+
+namespace Vulture
+{
+	// Dynamic bounding volume hierarchy (Box2D style b2DynamicTree). Leaves store enlarged boxes so small movements
+	// don't touch the tree, insertions pick the sibling with the lowest surface area cost and the tree is kept
+	// balanced with rotations. New proxies are inserted lazily on the next query, large batches of them rebuild the
+	// whole tree top down instead, which is much faster and lays nodes out depth first for cache friendly traversal.
+	class AABBTree
+	{
+	public:
+		static constexpr int32_t NullNode = -1;
+
+		AABBTree() = default;
+		~AABBTree() = default;
+
+		AABBTree(const AABBTree&) = delete;
+		AABBTree& operator=(const AABBTree&) = delete;
+		AABBTree(AABBTree&& other) noexcept = default;
+		AABBTree& operator=(AABBTree&& other) noexcept = default;
+
+		int32_t CreateProxy(const glm::vec3& min, const glm::vec3& max, uint32_t userData);
+		void DestroyProxy(int32_t proxy);
+		bool MoveProxy(int32_t proxy, const glm::vec3& min, const glm::vec3& max);
+		void Clear();
+
+		void Flush();
+		void Rebuild();
+
+		void Query(const Frustum& frustum, std::vector<uint32_t>& outUserData);
+
+		inline uint32_t GetUserData(int32_t proxy) const { return m_Proxies[proxy].UserData; }
+		inline uint32_t GetProxyCount() const { return m_ProxyCount; }
+		inline int32_t GetHeight() const { return m_Root == NullNode ? 0 : m_Nodes[m_Root].Height; }
+
+		// Fat boxes are enlarged by this fraction of their largest extent on every side
+		inline void SetMargin(float margin) { m_Margin = margin; }
+		inline float GetMargin() const { return m_Margin; }
+
+		static void RunBenchmark(uint32_t boxCount = 1'000'000);
+
+	private:
+		struct Node
+		{
+			glm::vec3 Min;
+			int32_t Parent;		// Next free node when the node is unused
+			glm::vec3 Max;
+			int32_t Child1;		// NullNode for leaves
+			int32_t Child2;
+			int32_t Height;		// 0 for leaves
+			int32_t Proxy;		// Leaves only
+			uint32_t UserData;	// Leaves only, copy of the proxy's so fully visible subtrees don't touch proxies
+		};
+
+		enum class ProxyState : uint8_t
+		{
+			Free,
+			Pending,	// Created or rebuilt away, waiting for Flush()
+			Inserted,
+		};
+
+		struct Proxy
+		{
+			int32_t Node = NullNode;
+			uint32_t UserData = 0;
+			ProxyState State = ProxyState::Free;
+		};
+
+		int32_t AllocateNode();
+		void FreeNode(int32_t node);
+		void InsertLeaf(int32_t leaf);
+		void RemoveLeaf(int32_t leaf);
+		int32_t Balance(int32_t node);
+		void Refit(int32_t node);
+		void SetLeafBox(int32_t leaf, int32_t proxy);
+		int32_t BuildRecursive(int32_t* proxies, uint32_t count, int32_t parent, const std::vector<glm::vec3>& centers);
+
+		inline bool IsLeaf(int32_t node) const { return m_Nodes[node].Child1 == NullNode; }
+
+		std::vector<Node> m_Nodes;
+		int32_t m_Root = NullNode;
+		int32_t m_FreeList = NullNode;
+		float m_Margin = 0.1f;
+
+		std::vector<Proxy> m_Proxies;
+		std::vector<int32_t> m_FreeProxies;
+		std::vector<int32_t> m_PendingProxies;
+		uint32_t m_ProxyCount = 0;
+
+		// Tight proxy boxes, structure of arrays for Frustum::CullAABBs()
+		std::vector<float> m_TightMinX, m_TightMinY, m_TightMinZ;
+		std::vector<float> m_TightMaxX, m_TightMaxY, m_TightMaxZ;
+
+		// Query scratch, reused between calls
+		std::vector<int32_t> m_Stack;
+		std::vector<int32_t> m_Candidates;
+		std::vector<float> m_CandidateBoxes;
+		std::vector<uint32_t> m_Visible;
+	};
+
+}
@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "Frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VL_FRUSTUM_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace Vulture
+{
+	Frustum::Frustum(const glm::mat4& viewProj)
+	{
+		Init(viewProj);
+	}
+
+	/**
+	 * @brief Extracts planes from the matrix (Gribb-Hartmann), clip space depth is expected to be in [0, 1].
+	 *
+	 * @param viewProj - Projection * view matrix, e.g. PerspectiveCamera::GetProjView().
+	 */
+	void Frustum::Init(const glm::mat4& viewProj)
+	{
+		const glm::mat4 rows = glm::transpose(viewProj);
+		const glm::vec4 planes[6] =
+		{
+			rows[3] + rows[0],	// Left
+			rows[3] - rows[0],	// Right
+			rows[3] + rows[1],	// Bottom
+			rows[3] - rows[1],	// Top
+			rows[2],			// Near
+			rows[3] - rows[2],	// Far
+		};
+
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const glm::vec4 plane = i < 6 ? planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			m_PlaneX[i] = plane.x;
+			m_PlaneY[i] = plane.y;
+			m_PlaneZ[i] = plane.z;
+			m_PlaneW[i] = plane.w;
+		}
+	}
+
+	/**
+	 * @brief Classifies the box, Inside means every corner is inside of all planes. Boxes near frustum
+	 * corners can be reported as Intersect even though they're outside, which is conservative.
+	 */
+	Frustum::Result Frustum::TestAABB(const glm::vec3& min, const glm::vec3& max) const
+	{
+#ifdef VL_FRUSTUM_SSE
+		const __m128 minX = _mm_set1_ps(min.x), minY = _mm_set1_ps(min.y), minZ = _mm_set1_ps(min.z);
+		const __m128 maxX = _mm_set1_ps(max.x), maxY = _mm_set1_ps(max.y), maxZ = _mm_set1_ps(max.z);
+
+		int outside = 0;
+		int intersect = 0;
+		for (uint32_t i = 0; i < 8; i += 4)
+		{
+			const __m128 planeX = _mm_load_ps(m_PlaneX + i);
+			const __m128 planeY = _mm_load_ps(m_PlaneY + i);
+			const __m128 planeZ = _mm_load_ps(m_PlaneZ + i);
+			const __m128 planeW = _mm_load_ps(m_PlaneW + i);
+
+			// Distance of the corner furthest along the plane normal and of the one furthest against it
+			const __m128 x0 = _mm_mul_ps(planeX, minX), x1 = _mm_mul_ps(planeX, maxX);
+			const __m128 y0 = _mm_mul_ps(planeY, minY), y1 = _mm_mul_ps(planeY, maxY);
+			const __m128 z0 = _mm_mul_ps(planeZ, minZ), z1 = _mm_mul_ps(planeZ, maxZ);
+
+			const __m128 farthest = _mm_add_ps(_mm_add_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_add_ps(_mm_max_ps(z0, z1), planeW));
+			const __m128 nearest = _mm_add_ps(_mm_add_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_add_ps(_mm_min_ps(z0, z1), planeW));
+
+			outside |= _mm_movemask_ps(_mm_cmplt_ps(farthest, _mm_setzero_ps()));
+			intersect |= _mm_movemask_ps(_mm_cmplt_ps(nearest, _mm_setzero_ps()));
+		}
+
+		if (outside)
+			return Result::Outside;
+
+		return intersect ? Result::Intersect : Result::Inside;
+#else
+		bool intersect = false;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			const float x0 = m_PlaneX[i] * min.x, x1 = m_PlaneX[i] * max.x;
+			const float y0 = m_PlaneY[i] * min.y, y1 = m_PlaneY[i] * max.y;
+			const float z0 = m_PlaneZ[i] * min.z, z1 = m_PlaneZ[i] * max.z;
+
+			if (glm::max(x0, x1) + glm::max(y0, y1) + glm::max(z0, z1) + m_PlaneW[i] < 0.0f)
+				return Result::Outside;
+
+			if (glm::min(x0, x1) + glm::min(y0, y1) + glm::min(z0, z1) + m_PlaneW[i] < 0.0f)
+				intersect = true;
+		}
+
+		return intersect ? Result::Intersect : Result::Inside;
+#endif
+	}
+
+	bool Frustum::IsVisible(const glm::vec3& min, const glm::vec3& max) const
+	{
+		return TestAABB(min, max) != Result::Outside;
+	}
+
+	/**
+	 * @brief Tests boxes stored structure of arrays, 4 boxes per iteration.
+	 *
+	 * @param minX, minY, minZ, maxX, maxY, maxZ - Box corners, count elements each.
+	 * @param count - Number of boxes.
+	 * @param outVisible - Receives indices of boxes that aren't outside, has to hold count elements.
+	 *
+	 * @return Number of visible boxes written to outVisible.
+	 */
+	uint32_t Frustum::CullAABBs(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, uint32_t count, uint32_t* outVisible) const
+	{
+		uint32_t visibleCount = 0;
+		uint32_t i = 0;
+
+#ifdef VL_FRUSTUM_SSE
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 boxMinX = _mm_loadu_ps(minX + i), boxMaxX = _mm_loadu_ps(maxX + i);
+			const __m128 boxMinY = _mm_loadu_ps(minY + i), boxMaxY = _mm_loadu_ps(maxY + i);
+			const __m128 boxMinZ = _mm_loadu_ps(minZ + i), boxMaxZ = _mm_loadu_ps(maxZ + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (uint32_t plane = 0; plane < 6; plane++)
+			{
+				const __m128 planeX = _mm_set1_ps(m_PlaneX[plane]);
+				const __m128 planeY = _mm_set1_ps(m_PlaneY[plane]);
+				const __m128 planeZ = _mm_set1_ps(m_PlaneZ[plane]);
+
+				const __m128 x = _mm_max_ps(_mm_mul_ps(planeX, boxMinX), _mm_mul_ps(planeX, boxMaxX));
+				const __m128 y = _mm_max_ps(_mm_mul_ps(planeY, boxMinY), _mm_mul_ps(planeY, boxMaxY));
+				const __m128 z = _mm_max_ps(_mm_mul_ps(planeZ, boxMinZ), _mm_mul_ps(planeZ, boxMaxZ));
+				const __m128 distance = _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, _mm_set1_ps(m_PlaneW[plane])));
+
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+			}
+
+			int visibleMask = ~_mm_movemask_ps(outside) & 0xF;
+			while (visibleMask != 0)
+			{
+				const uint32_t lane = visibleMask & 1 ? 0 : visibleMask & 2 ? 1 : visibleMask & 4 ? 2 : 3;
+				outVisible[visibleCount++] = i + lane;
+				visibleMask &= visibleMask - 1;
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			if (IsVisible({ minX[i], minY[i], minZ[i] }, { maxX[i], maxY[i], maxZ[i] }))
+				outVisible[visibleCount++] = i;
+		}
+
+		return visibleCount;
+	}
+
+}
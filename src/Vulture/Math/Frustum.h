@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+
+#include "glm/glm.hpp"
+
+namespace Vulture
+{
+	// View frustum planes stored structure of arrays, so one box is tested against 4 planes per SSE instruction
+	// and batches of boxes are tested 4 at a time. Planes point inward and aren't normalized.
+	class Frustum
+	{
+	public:
+		enum class Result
+		{
+			Outside,
+			Intersect,
+			Inside,
+		};
+
+		Frustum() = default;
+		Frustum(const glm::mat4& viewProj);
+
+		void Init(const glm::mat4& viewProj);
+
+		Result TestAABB(const glm::vec3& min, const glm::vec3& max) const;
+		bool IsVisible(const glm::vec3& min, const glm::vec3& max) const;
+
+		uint32_t CullAABBs(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, uint32_t count, uint32_t* outVisible) const;
+
+		inline glm::vec4 GetPlane(uint32_t index) const { return { m_PlaneX[index], m_PlaneY[index], m_PlaneZ[index], m_PlaneW[index] }; }
+
+	private:
+		// 6 planes padded to 8 with planes that never reject anything
+		alignas(16) float m_PlaneX[8] = {};
+		alignas(16) float m_PlaneY[8] = {};
+		alignas(16) float m_PlaneZ[8] = {};
+		alignas(16) float m_PlaneW[8] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+	};
+
+}
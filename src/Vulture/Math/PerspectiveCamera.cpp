@@ -81,7 +81,7 @@ namespace Vulture
 		ProjMat = glm::perspective(glm::radians(FOV), AspectRatio, NearFar.x, NearFar.y);
 	}
 
-	glm::mat4 PerspectiveCamera::GetProjView()
+	glm::mat4 PerspectiveCamera::GetProjView() const
 	{
 		return ProjMat * ViewMat;
 	}
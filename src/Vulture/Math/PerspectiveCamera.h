@@ -36,7 +36,7 @@ namespace Vulture
 		void AddYaw(float yaw);
 		void AddRoll(float roll);
 
-		glm::mat4 GetProjView();
+		glm::mat4 GetProjView() const;
 		inline const glm::vec3 GetFrontVec() const { return Rotation.GetFrontVec(); }
 		inline const glm::vec3 GetRightVec() const { return Rotation.GetRightVec(); }
 		inline const glm::vec3 GetUpVec() const { return Rotation.GetUpVec(); }
@@ -16,17 +16,12 @@ namespace Vulture
 	void Quaternion::Reset()
 	{
 		m_Quat = { 1.0f, 0.0f, 0.0f, 0.0f };
-		m_FrontVec = { 0.0f, 0.0f, 1.0f };
-		m_UpVec = { 0.0f, 1.0f, 0.0f };
-		m_RightVec = { 1.0f, 0.0f, 0.0f };
 	}
 
 	void Quaternion::SetAngles(const glm::vec3& angles)
 	{
 		m_Quat = glm::quat(glm::radians(angles));
 		m_Quat = glm::normalize(m_Quat);
-
-		UpdateVectors();
 	}
 
 	void Quaternion::AddAngles(const glm::vec3& angles)
@@ -34,8 +29,6 @@ namespace Vulture
 		AddPitch(angles.x);
 		AddYaw(angles.y);
 		AddRoll(angles.z);
-
-		UpdateVectors();
 	}
 
 	glm::vec3 Quaternion::GetAngles() const
@@ -46,50 +39,48 @@ namespace Vulture
 	void Quaternion::SetQuaternion(const glm::quat& quat)
 	{
 		m_Quat = quat;
-
-		UpdateVectors();
 	}
 
 	void Quaternion::AddPitch(float angle)
 	{
+		const glm::vec3 right = GetRightVec();
+
 		glm::quat quat;
 		quat.w =  glm::cos(glm::radians(angle));
-		quat.x = (glm::sin(glm::radians(angle)) * m_RightVec.x);
-		quat.y = (glm::sin(glm::radians(angle)) * m_RightVec.y);
-		quat.z = (glm::sin(glm::radians(angle)) * m_RightVec.z);
+		quat.x = (glm::sin(glm::radians(angle)) * right.x);
+		quat.y = (glm::sin(glm::radians(angle)) * right.y);
+		quat.z = (glm::sin(glm::radians(angle)) * right.z);
 
 		m_Quat = glm::normalize(m_Quat);
 		m_Quat = m_Quat * quat;
-
-		UpdateVectors();
 	}
 
 	void Quaternion::AddYaw(float angle)
 	{
+		const glm::vec3 up = GetUpVec();
+
 		glm::quat quat;
 		quat.w =  glm::cos(glm::radians(angle));
-		quat.x = (glm::sin(glm::radians(angle)) * m_UpVec.x);
-		quat.y = (glm::sin(glm::radians(angle)) * m_UpVec.y);
-		quat.z = (glm::sin(glm::radians(angle)) * m_UpVec.z);
+		quat.x = (glm::sin(glm::radians(angle)) * up.x);
+		quat.y = (glm::sin(glm::radians(angle)) * up.y);
+		quat.z = (glm::sin(glm::radians(angle)) * up.z);
 
 		m_Quat = glm::normalize(m_Quat);
 		m_Quat = m_Quat * quat;
-
-		UpdateVectors();
 	}
 
 	void Quaternion::AddRoll(float angle)
 	{
+		const glm::vec3 front = GetFrontVec();
+
 		glm::quat quat;
 		quat.w =  glm::cos(glm::radians(angle));
-		quat.x = (glm::sin(glm::radians(angle)) * m_FrontVec.x);
-		quat.y = (glm::sin(glm::radians(angle)) * m_FrontVec.y);
-		quat.z = (glm::sin(glm::radians(angle)) * m_FrontVec.z);
+		quat.x = (glm::sin(glm::radians(angle)) * front.x);
+		quat.y = (glm::sin(glm::radians(angle)) * front.y);
+		quat.z = (glm::sin(glm::radians(angle)) * front.z);
 
 		m_Quat = glm::normalize(m_Quat);
 		m_Quat = m_Quat * quat;
-
-		UpdateVectors();
 	}
 
 	glm::mat4 Quaternion::GetMat4() const
@@ -97,13 +88,24 @@ namespace Vulture
 		return glm::toMat4(m_Quat);
 	}
 
-	void Quaternion::UpdateVectors()
+	// Rows of the rotation matrix, same terms as glm::toMat4 without building the whole matrix
+
+	glm::vec3 Quaternion::GetFrontVec() const
 	{
-		glm::mat4 rotationMat = glm::toMat4(m_Quat);
+		const glm::quat& q = m_Quat;
+		return { 2.0f * (q.x * q.z - q.w * q.y), 2.0f * (q.y * q.z + q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y) };
+	}
 
-		m_FrontVec = glm::vec3(rotationMat[0][2], rotationMat[1][2], rotationMat[2][2]);
-		m_RightVec = glm::vec3(rotationMat[0][0], rotationMat[1][0], rotationMat[2][0]);
-		m_UpVec =	 glm::vec3(rotationMat[0][1], rotationMat[1][1], rotationMat[2][1]);
+	glm::vec3 Quaternion::GetUpVec() const
+	{
+		const glm::quat& q = m_Quat;
+		return { 2.0f * (q.x * q.y + q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z - q.w * q.x) };
+	}
+
+	glm::vec3 Quaternion::GetRightVec() const
+	{
+		const glm::quat& q = m_Quat;
+		return { 1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y - q.w * q.z), 2.0f * (q.x * q.z + q.w * q.y) };
 	}
 
 	bool Quaternion::operator!=(const Quaternion& other) const
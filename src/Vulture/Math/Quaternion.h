@@ -31,19 +31,15 @@ namespace Vulture
 		glm::mat4 GetMat4() const;
 		inline glm::quat GetGlmQuat() const { return m_Quat; }
 
-		inline glm::vec3 GetFrontVec() const { return m_FrontVec; };
-		inline glm::vec3 GetUpVec() const { return m_UpVec; };
-		inline glm::vec3 GetRightVec() const { return m_RightVec; };
+		// Derived from the quaternion when asked for instead of being recomputed on every modification
+		glm::vec3 GetFrontVec() const;
+		glm::vec3 GetUpVec() const;
+		glm::vec3 GetRightVec() const;
 
 		bool operator ==(const Quaternion& other) const;
 		bool operator !=(const Quaternion& other) const;
 		
 	private:
-		void UpdateVectors();
-
 		glm::quat m_Quat{1.0f, 0.0f, 0.0f, 0.0f};
-		glm::vec3 m_FrontVec{0.0f, 0.0f, 1.0f};
-		glm::vec3 m_UpVec{0.0f, 1.0f, 0.0f};
-		glm::vec3 m_RightVec{1.0f, 0.0f, 0.0f};
 	};
 }
\ No newline at end of file
@@ -1,8 +1,17 @@
 #include "pch.h"
 #include "Transform.h"
 
+#include <atomic>
+
 namespace Vulture
 {
+	// Versions are unique across all transforms, so an assigned transform never looks unchanged to whoever cached the old one
+	static std::atomic<uint64_t> s_VersionCounter = 0;
+
+	static uint64_t NextVersion()
+	{
+		return s_VersionCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
 
 	Transform::Transform(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale)
 	{
@@ -16,6 +25,7 @@ namespace Vulture
 		m_Scale = other.m_Scale;
 		m_Translation = other.m_Translation;
 		m_Initialized = other.m_Initialized;
+		m_Version = other.m_Version;
 	}
 
 	Transform::Transform(Transform&& other) noexcept
@@ -25,6 +35,7 @@ namespace Vulture
 		m_Scale = other.m_Scale;
 		m_Translation = other.m_Translation;
 		m_Initialized = other.m_Initialized;
+		m_Version = other.m_Version;
 
 		other.Reset();
 	}
@@ -34,6 +45,7 @@ namespace Vulture
 		m_Translation = translation;
 		m_Rotation = rotation;
 		m_Scale = scale;
+		MarkChanged();
 
 		m_Initialized = true;
 	}
@@ -57,6 +69,7 @@ namespace Vulture
 		m_Scale = other.m_Scale;
 		m_Translation = other.m_Translation;
 		m_Initialized = other.m_Initialized;
+		MarkChanged();
 
 		return *this;
 	}
@@ -68,6 +81,7 @@ namespace Vulture
 		m_Scale = other.m_Scale;
 		m_Translation = other.m_Translation;
 		m_Initialized = other.m_Initialized;
+		MarkChanged();
 
 		other.Reset();
 
@@ -93,39 +107,77 @@ namespace Vulture
 		return m_ModelMatrix;
 	}
 
+	void Transform::SetChangeList(TransformChangeList* list, uint32_t index)
+	{
+		m_ChangeList = list;
+		m_ChangeIndex = index;
+		m_ChangeQueued.store(false, std::memory_order_relaxed);
+	}
+
+	void Transform::MarkChanged()
+	{
+		m_Version = NextVersion();
+
+		if (m_ChangeList != nullptr && !m_ChangeQueued.exchange(true, std::memory_order_relaxed))
+			m_ChangeList->Push(m_ChangeIndex);
+	}
+
 	void Transform::SetTranslation(const glm::vec3& vec)
 	{
 		m_Translation = vec;
+		MarkChanged();
 	}
 
 	void Transform::SetRotation(const glm::vec3& vec)
 	{
 		m_Rotation.SetAngles(vec);
+		MarkChanged();
 	}
 
 	void Transform::SetRotation(const glm::quat& quat)
 	{
 		m_Rotation.SetQuaternion(quat);
+		MarkChanged();
 	}
 
 	void Transform::SetScale(const glm::vec3& vec)
 	{
 		m_Scale = vec;
+		MarkChanged();
 	}
 
 	void Transform::AddTranslation(const glm::vec3& vec)
 	{
 		m_Translation += vec;
+		MarkChanged();
 	}
 
 	void Transform::AddRotation(const glm::vec3& vec)
 	{
 		m_Rotation.AddAngles(vec);
+		MarkChanged();
 	}
 
 	void Transform::AddScale(const glm::vec3& vec)
 	{
 		m_Scale += vec;
+		MarkChanged();
+	}
+
+	void TransformChangeList::Push(uint32_t index)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Indices.push_back(index);
+	}
+
+	/**
+	 * @brief Appends the collected indices and empties the list.
+	 */
+	void TransformChangeList::Take(std::vector<uint32_t>& outIndices)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		outIndices.insert(outIndices.end(), m_Indices.begin(), m_Indices.end());
+		m_Indices.clear();
 	}
 
 	void Transform::Reset()
@@ -133,6 +185,7 @@ namespace Vulture
 		m_ModelMatrix = glm::mat4(0.0f);
 		m_Translation = glm::vec3(0.0f);
 		m_Scale = glm::vec3(0.0f);
+		m_Version = NextVersion();
 		m_Initialized = false;
 
 		m_Rotation = {};
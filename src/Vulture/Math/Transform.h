@@ -9,8 +9,24 @@
 
 #include "Quaternion.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace Vulture
 {
+	// Indices of transforms modified since the last time the list was taken. Filled by the transforms themselves,
+	// so TransformHierarchy never has to visit the ones that don't move.
+	class TransformChangeList
+	{
+	public:
+		void Push(uint32_t index);
+		void Take(std::vector<uint32_t>& outIndices);
+
+	private:
+		std::mutex m_Mutex;
+		std::vector<uint32_t> m_Indices;
+	};
+
 	class Transform
 	{
 	public:
@@ -36,6 +52,14 @@ namespace Vulture
 		inline Quaternion GetRotation() const { return m_Rotation; }
 		inline glm::vec3 GetScale() const { return m_Scale; }
 
+		// Changes on every modification, lets caches detect that the transform moved without comparing matrices
+		inline uint64_t GetVersion() const { return m_Version; }
+
+		// Every modification pushes the index into the list, once until ClearChanged() is called. Copies don't
+		// inherit the list
+		void SetChangeList(TransformChangeList* list, uint32_t index);
+		inline void ClearChanged() { m_ChangeQueued.store(false, std::memory_order_relaxed); }
+
 		void SetTranslation(const glm::vec3& vec);
 		void SetRotation(const glm::vec3& vec);
 		void SetRotation(const glm::quat& quat);
@@ -51,8 +75,14 @@ namespace Vulture
 		glm::vec3 m_Scale{};
 
 		Quaternion m_Rotation{};
+		uint64_t m_Version = 0;
+
+		TransformChangeList* m_ChangeList = nullptr;
+		uint32_t m_ChangeIndex = 0;
+		std::atomic<bool> m_ChangeQueued = false;
 
 		bool m_Initialized = false;
+		void MarkChanged();
 		void Reset();
 	};
 
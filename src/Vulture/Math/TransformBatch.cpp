@@ -0,0 +1,584 @@
+#include "pch.h"
+#include "TransformBatch.h"
+
+#include "Utility/Logger.h"
+#include "Utility/Timer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VL_TRANSFORM_SSE
+	#include <immintrin.h>
+#endif
+
+#if defined(VL_TRANSFORM_SSE) && (defined(_M_X64) || defined(__x86_64__))
+	#define VL_TRANSFORM_AVX2
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define VL_TARGET_AVX2
+	#else
+		// Only these functions are compiled with AVX2, the rest of the binary still runs on any x64 CPU
+		#define VL_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+	#define VL_TRANSFORM_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace Vulture
+{
+	namespace TransformBatch
+	{
+		// Rotation matrix terms are the same as in glm::toMat4, so the results match Transform::GetMat4
+
+		static void ComputeScalar(const Input& in, uint64_t begin, uint64_t end, glm::mat4* outMat4, VkTransformMatrixKHR* outKhr)
+		{
+			for (uint64_t i = begin; i < end; i++)
+			{
+				const float x = in.RotationX[i], y = in.RotationY[i], z = in.RotationZ[i], w = in.RotationW[i];
+				const float x2 = x + x, y2 = y + y, z2 = z + z;
+				const float xx = x * x2, yy = y * y2, zz = z * z2;
+				const float xy = x * y2, xz = x * z2, yz = y * z2;
+				const float wx = w * x2, wy = w * y2, wz = w * z2;
+
+				const float sx = in.ScaleX[i], sy = in.ScaleY[i], sz = in.ScaleZ[i];
+
+				// Column major, m[column][row]
+				const float m[3][3] =
+				{
+					{ (1.0f - (yy + zz)) * sx, (xy + wz) * sx, (xz - wy) * sx },
+					{ (xy - wz) * sy, (1.0f - (xx + zz)) * sy, (yz + wx) * sy },
+					{ (xz + wy) * sz, (yz - wx) * sz, (1.0f - (xx + yy)) * sz },
+				};
+				const float t[3] = { in.TranslationX[i], in.TranslationY[i], in.TranslationZ[i] };
+
+				if (outMat4 != nullptr)
+				{
+					glm::mat4& out = outMat4[i];
+					for (int column = 0; column < 3; column++)
+						out[column] = glm::vec4(m[column][0], m[column][1], m[column][2], 0.0f);
+					out[3] = glm::vec4(t[0], t[1], t[2], 1.0f);
+				}
+
+				if (outKhr != nullptr)
+				{
+					VkTransformMatrixKHR& out = outKhr[i];
+					for (int row = 0; row < 3; row++)
+					{
+						out.matrix[row][0] = m[0][row];
+						out.matrix[row][1] = m[1][row];
+						out.matrix[row][2] = m[2][row];
+						out.matrix[row][3] = t[row];
+					}
+				}
+			}
+		}
+
+#ifdef VL_TRANSFORM_SSE
+		static uint64_t ComputeSSE(const Input& in, uint64_t count, glm::mat4* outMat4, VkTransformMatrixKHR* outKhr)
+		{
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 zero = _mm_setzero_ps();
+
+			uint64_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 x = _mm_loadu_ps(in.RotationX + i);
+				const __m128 y = _mm_loadu_ps(in.RotationY + i);
+				const __m128 z = _mm_loadu_ps(in.RotationZ + i);
+				const __m128 w = _mm_loadu_ps(in.RotationW + i);
+				const __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+				const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+				const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+				const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+				const __m128 sx = _mm_loadu_ps(in.ScaleX + i);
+				const __m128 sy = _mm_loadu_ps(in.ScaleY + i);
+				const __m128 sz = _mm_loadu_ps(in.ScaleZ + i);
+
+				// cXrY is column X, row Y of 4 matrices
+				__m128 c0r0 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+				__m128 c0r1 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+				__m128 c0r2 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+				__m128 c1r0 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+				__m128 c1r1 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+				__m128 c1r2 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+				__m128 c2r0 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+				__m128 c2r1 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+				__m128 c2r2 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+				__m128 tx = _mm_loadu_ps(in.TranslationX + i);
+				__m128 ty = _mm_loadu_ps(in.TranslationY + i);
+				__m128 tz = _mm_loadu_ps(in.TranslationZ + i);
+
+				if (outMat4 != nullptr)
+				{
+					// After transposing every register holds one column of one matrix
+					__m128 col0[4] = { c0r0, c0r1, c0r2, zero };
+					__m128 col1[4] = { c1r0, c1r1, c1r2, zero };
+					__m128 col2[4] = { c2r0, c2r1, c2r2, zero };
+					__m128 col3[4] = { tx, ty, tz, one };
+					_MM_TRANSPOSE4_PS(col0[0], col0[1], col0[2], col0[3]);
+					_MM_TRANSPOSE4_PS(col1[0], col1[1], col1[2], col1[3]);
+					_MM_TRANSPOSE4_PS(col2[0], col2[1], col2[2], col2[3]);
+					_MM_TRANSPOSE4_PS(col3[0], col3[1], col3[2], col3[3]);
+
+					for (int j = 0; j < 4; j++)
+					{
+						float* out = (float*)&outMat4[i + j];
+						_mm_storeu_ps(out + 0, col0[j]);
+						_mm_storeu_ps(out + 4, col1[j]);
+						_mm_storeu_ps(out + 8, col2[j]);
+						_mm_storeu_ps(out + 12, col3[j]);
+					}
+				}
+
+				if (outKhr != nullptr)
+				{
+					_MM_TRANSPOSE4_PS(c0r0, c1r0, c2r0, tx);
+					_MM_TRANSPOSE4_PS(c0r1, c1r1, c2r1, ty);
+					_MM_TRANSPOSE4_PS(c0r2, c1r2, c2r2, tz);
+
+					const __m128 row0[4] = { c0r0, c1r0, c2r0, tx };
+					const __m128 row1[4] = { c0r1, c1r1, c2r1, ty };
+					const __m128 row2[4] = { c0r2, c1r2, c2r2, tz };
+					for (int j = 0; j < 4; j++)
+					{
+						float* out = &outKhr[i + j].matrix[0][0];
+						_mm_storeu_ps(out + 0, row0[j]);
+						_mm_storeu_ps(out + 4, row1[j]);
+						_mm_storeu_ps(out + 8, row2[j]);
+					}
+				}
+			}
+
+			return i;
+		}
+#endif
+
+#ifdef VL_TRANSFORM_AVX2
+		// Transposes 4x4 blocks inside both 128 bit halves, the low half ends up with matrices 0-3 and the high one with 4-7
+		VL_TARGET_AVX2 static inline void Transpose4x4x2(__m256& a, __m256& b, __m256& c, __m256& d)
+		{
+			const __m256 t0 = _mm256_unpacklo_ps(a, b);
+			const __m256 t1 = _mm256_unpackhi_ps(a, b);
+			const __m256 t2 = _mm256_unpacklo_ps(c, d);
+			const __m256 t3 = _mm256_unpackhi_ps(c, d);
+			a = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+			b = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			c = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			d = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		VL_TARGET_AVX2 static uint64_t ComputeAVX2(const Input& in, uint64_t count, glm::mat4* outMat4, VkTransformMatrixKHR* outKhr)
+		{
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 zero = _mm256_setzero_ps();
+
+			uint64_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256 x = _mm256_loadu_ps(in.RotationX + i);
+				const __m256 y = _mm256_loadu_ps(in.RotationY + i);
+				const __m256 z = _mm256_loadu_ps(in.RotationZ + i);
+				const __m256 w = _mm256_loadu_ps(in.RotationW + i);
+				const __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+				const __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+				const __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+				const __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+				const __m256 sx = _mm256_loadu_ps(in.ScaleX + i);
+				const __m256 sy = _mm256_loadu_ps(in.ScaleY + i);
+				const __m256 sz = _mm256_loadu_ps(in.ScaleZ + i);
+
+				__m256 c0r0 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx);
+				__m256 c0r1 = _mm256_mul_ps(_mm256_add_ps(xy, wz), sx);
+				__m256 c0r2 = _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx);
+				__m256 c1r0 = _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy);
+				__m256 c1r1 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy);
+				__m256 c1r2 = _mm256_mul_ps(_mm256_add_ps(yz, wx), sy);
+				__m256 c2r0 = _mm256_mul_ps(_mm256_add_ps(xz, wy), sz);
+				__m256 c2r1 = _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz);
+				__m256 c2r2 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz);
+				__m256 tx = _mm256_loadu_ps(in.TranslationX + i);
+				__m256 ty = _mm256_loadu_ps(in.TranslationY + i);
+				__m256 tz = _mm256_loadu_ps(in.TranslationZ + i);
+
+				if (outMat4 != nullptr)
+				{
+					__m256 col0[4] = { c0r0, c0r1, c0r2, zero };
+					__m256 col1[4] = { c1r0, c1r1, c1r2, zero };
+					__m256 col2[4] = { c2r0, c2r1, c2r2, zero };
+					__m256 col3[4] = { tx, ty, tz, one };
+					Transpose4x4x2(col0[0], col0[1], col0[2], col0[3]);
+					Transpose4x4x2(col1[0], col1[1], col1[2], col1[3]);
+					Transpose4x4x2(col2[0], col2[1], col2[2], col2[3]);
+					Transpose4x4x2(col3[0], col3[1], col3[2], col3[3]);
+
+					for (int j = 0; j < 4; j++)
+					{
+						float* low = (float*)&outMat4[i + j];
+						float* high = (float*)&outMat4[i + j + 4];
+						_mm_storeu_ps(low + 0, _mm256_castps256_ps128(col0[j]));
+						_mm_storeu_ps(low + 4, _mm256_castps256_ps128(col1[j]));
+						_mm_storeu_ps(low + 8, _mm256_castps256_ps128(col2[j]));
+						_mm_storeu_ps(low + 12, _mm256_castps256_ps128(col3[j]));
+						_mm_storeu_ps(high + 0, _mm256_extractf128_ps(col0[j], 1));
+						_mm_storeu_ps(high + 4, _mm256_extractf128_ps(col1[j], 1));
+						_mm_storeu_ps(high + 8, _mm256_extractf128_ps(col2[j], 1));
+						_mm_storeu_ps(high + 12, _mm256_extractf128_ps(col3[j], 1));
+					}
+				}
+
+				if (outKhr != nullptr)
+				{
+					Transpose4x4x2(c0r0, c1r0, c2r0, tx);
+					Transpose4x4x2(c0r1, c1r1, c2r1, ty);
+					Transpose4x4x2(c0r2, c1r2, c2r2, tz);
+
+					const __m256 row0[4] = { c0r0, c1r0, c2r0, tx };
+					const __m256 row1[4] = { c0r1, c1r1, c2r1, ty };
+					const __m256 row2[4] = { c0r2, c1r2, c2r2, tz };
+					for (int j = 0; j < 4; j++)
+					{
+						float* low = &outKhr[i + j].matrix[0][0];
+						float* high = &outKhr[i + j + 4].matrix[0][0];
+						_mm256_storeu_ps(low, _mm256_permute2f128_ps(row0[j], row1[j], 0x20));
+						_mm_storeu_ps(low + 8, _mm256_castps256_ps128(row2[j]));
+						_mm256_storeu_ps(high, _mm256_permute2f128_ps(row0[j], row1[j], 0x31));
+						_mm_storeu_ps(high + 8, _mm256_extractf128_ps(row2[j], 1));
+					}
+				}
+			}
+
+			return i;
+		}
+
+		static bool IsAVX2Supported()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// The OS has to save YMM registers on context switches as well
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+#ifdef VL_TRANSFORM_NEON
+		static inline void Transpose4x4(float32x4_t& a, float32x4_t& b, float32x4_t& c, float32x4_t& d)
+		{
+			const float32x4x2_t ab = vtrnq_f32(a, b);
+			const float32x4x2_t cd = vtrnq_f32(c, d);
+			a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+			b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+			c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+			d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+		}
+
+		static uint64_t ComputeNEON(const Input& in, uint64_t count, glm::mat4* outMat4, VkTransformMatrixKHR* outKhr)
+		{
+			const float32x4_t one = vdupq_n_f32(1.0f);
+			const float32x4_t zero = vdupq_n_f32(0.0f);
+
+			uint64_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const float32x4_t x = vld1q_f32(in.RotationX + i);
+				const float32x4_t y = vld1q_f32(in.RotationY + i);
+				const float32x4_t z = vld1q_f32(in.RotationZ + i);
+				const float32x4_t w = vld1q_f32(in.RotationW + i);
+				const float32x4_t x2 = vaddq_f32(x, x), y2 = vaddq_f32(y, y), z2 = vaddq_f32(z, z);
+				const float32x4_t xx = vmulq_f32(x, x2), yy = vmulq_f32(y, y2), zz = vmulq_f32(z, z2);
+				const float32x4_t xy = vmulq_f32(x, y2), xz = vmulq_f32(x, z2), yz = vmulq_f32(y, z2);
+				const float32x4_t wx = vmulq_f32(w, x2), wy = vmulq_f32(w, y2), wz = vmulq_f32(w, z2);
+
+				const float32x4_t sx = vld1q_f32(in.ScaleX + i);
+				const float32x4_t sy = vld1q_f32(in.ScaleY + i);
+				const float32x4_t sz = vld1q_f32(in.ScaleZ + i);
+
+				float32x4_t c0r0 = vmulq_f32(vsubq_f32(one, vaddq_f32(yy, zz)), sx);
+				float32x4_t c0r1 = vmulq_f32(vaddq_f32(xy, wz), sx);
+				float32x4_t c0r2 = vmulq_f32(vsubq_f32(xz, wy), sx);
+				float32x4_t c1r0 = vmulq_f32(vsubq_f32(xy, wz), sy);
+				float32x4_t c1r1 = vmulq_f32(vsubq_f32(one, vaddq_f32(xx, zz)), sy);
+				float32x4_t c1r2 = vmulq_f32(vaddq_f32(yz, wx), sy);
+				float32x4_t c2r0 = vmulq_f32(vaddq_f32(xz, wy), sz);
+				float32x4_t c2r1 = vmulq_f32(vsubq_f32(yz, wx), sz);
+				float32x4_t c2r2 = vmulq_f32(vsubq_f32(one, vaddq_f32(xx, yy)), sz);
+				float32x4_t tx = vld1q_f32(in.TranslationX + i);
+				float32x4_t ty = vld1q_f32(in.TranslationY + i);
+				float32x4_t tz = vld1q_f32(in.TranslationZ + i);
+
+				if (outMat4 != nullptr)
+				{
+					float32x4_t col0[4] = { c0r0, c0r1, c0r2, zero };
+					float32x4_t col1[4] = { c1r0, c1r1, c1r2, zero };
+					float32x4_t col2[4] = { c2r0, c2r1, c2r2, zero };
+					float32x4_t col3[4] = { tx, ty, tz, one };
+					Transpose4x4(col0[0], col0[1], col0[2], col0[3]);
+					Transpose4x4(col1[0], col1[1], col1[2], col1[3]);
+					Transpose4x4(col2[0], col2[1], col2[2], col2[3]);
+					Transpose4x4(col3[0], col3[1], col3[2], col3[3]);
+
+					for (int j = 0; j < 4; j++)
+					{
+						float* out = (float*)&outMat4[i + j];
+						vst1q_f32(out + 0, col0[j]);
+						vst1q_f32(out + 4, col1[j]);
+						vst1q_f32(out + 8, col2[j]);
+						vst1q_f32(out + 12, col3[j]);
+					}
+				}
+
+				if (outKhr != nullptr)
+				{
+					Transpose4x4(c0r0, c1r0, c2r0, tx);
+					Transpose4x4(c0r1, c1r1, c2r1, ty);
+					Transpose4x4(c0r2, c1r2, c2r2, tz);
+
+					const float32x4_t row0[4] = { c0r0, c1r0, c2r0, tx };
+					const float32x4_t row1[4] = { c0r1, c1r1, c2r1, ty };
+					const float32x4_t row2[4] = { c0r2, c1r2, c2r2, tz };
+					for (int j = 0; j < 4; j++)
+					{
+						float* out = &outKhr[i + j].matrix[0][0];
+						vst1q_f32(out + 0, row0[j]);
+						vst1q_f32(out + 4, row1[j]);
+						vst1q_f32(out + 8, row2[j]);
+					}
+				}
+			}
+
+			return i;
+		}
+#endif
+
+		static InstructionSet DetectInstructionSet()
+		{
+#ifdef VL_TRANSFORM_AVX2
+			if (IsAVX2Supported())
+				return InstructionSet::AVX2;
+#endif
+#if defined(VL_TRANSFORM_SSE)
+			return InstructionSet::SSE;
+#elif defined(VL_TRANSFORM_NEON)
+			return InstructionSet::NEON;
+#else
+			return InstructionSet::Scalar;
+#endif
+		}
+
+		static void Compute(const Input& input, uint64_t count, glm::mat4* outMat4, VkTransformMatrixKHR* outKhr, InstructionSet set)
+		{
+			VL_CORE_ASSERT(IsSupported(set), "Instruction set {} isn't supported by this CPU or build!", GetInstructionSetName(set));
+
+			// Vector paths leave the tail that doesn't fill a whole register to the scalar one
+			uint64_t done = 0;
+			switch (set)
+			{
+#ifdef VL_TRANSFORM_SSE
+			case InstructionSet::SSE:  done = ComputeSSE(input, count, outMat4, outKhr); break;
+#endif
+#ifdef VL_TRANSFORM_AVX2
+			case InstructionSet::AVX2: done = ComputeAVX2(input, count, outMat4, outKhr); break;
+#endif
+#ifdef VL_TRANSFORM_NEON
+			case InstructionSet::NEON: done = ComputeNEON(input, count, outMat4, outKhr); break;
+#endif
+			default: break;
+			}
+
+			ComputeScalar(input, done, count, outMat4, outKhr);
+		}
+
+		/**
+		 * @brief Returns the widest instruction set available on this CPU, detected once on first use.
+		 */
+		InstructionSet GetInstructionSet()
+		{
+			static const InstructionSet s_InstructionSet = DetectInstructionSet();
+			return s_InstructionSet;
+		}
+
+		bool IsSupported(InstructionSet set)
+		{
+			switch (set)
+			{
+			case InstructionSet::Scalar: return true;
+#ifdef VL_TRANSFORM_SSE
+			case InstructionSet::SSE:    return true;
+#endif
+#ifdef VL_TRANSFORM_AVX2
+			case InstructionSet::AVX2:   return GetInstructionSet() == InstructionSet::AVX2;
+#endif
+#ifdef VL_TRANSFORM_NEON
+			case InstructionSet::NEON:   return true;
+#endif
+			default:                     return false;
+			}
+		}
+
+		const char* GetInstructionSetName(InstructionSet set)
+		{
+			switch (set)
+			{
+			case InstructionSet::Scalar: return "Scalar";
+			case InstructionSet::SSE:    return "SSE";
+			case InstructionSet::AVX2:   return "AVX2";
+			case InstructionSet::NEON:   return "NEON";
+			default:                     return "Unknown";
+			}
+		}
+
+		/**
+		 * @brief Computes translation * rotation * scale for every transform.
+		 *
+		 * @param input - Arrays of translations, rotations and scales.
+		 * @param count - Number of transforms.
+		 * @param outMatrices - Array of at least count matrices.
+		 */
+		void ComputeMat4(const Input& input, uint64_t count, glm::mat4* outMatrices)
+		{
+			Compute(input, count, outMatrices, nullptr, GetInstructionSet());
+		}
+
+		/**
+		 * @brief Same as ComputeMat4 but writes row major 3x4 matrices used by acceleration structure instances.
+		 */
+		void ComputeKhrMat(const Input& input, uint64_t count, VkTransformMatrixKHR* outMatrices)
+		{
+			Compute(input, count, nullptr, outMatrices, GetInstructionSet());
+		}
+
+		void ComputeMat4(const Input& input, uint64_t count, glm::mat4* outMatrices, InstructionSet set)
+		{
+			Compute(input, count, outMatrices, nullptr, set);
+		}
+
+		void ComputeKhrMat(const Input& input, uint64_t count, VkTransformMatrixKHR* outMatrices, InstructionSet set)
+		{
+			Compute(input, count, nullptr, outMatrices, set);
+		}
+
+		// Random transforms stored structure of arrays, Input points into it
+		struct TestData
+		{
+			std::vector<float> Values[10];
+			Input Batch;
+
+			TestData(uint64_t count)
+			{
+				uint32_t seed = 0x12345678;
+				for (int i = 0; i < 10; i++)
+				{
+					// Translations up to 100, unnormalized quaternions, scales from 0.1 to 4
+					const float min = i < 3 ? -100.0f : (i < 7 ? -1.0f : 0.1f);
+					const float max = i < 3 ? 100.0f : (i < 7 ? 1.0f : 4.0f);
+					Values[i].resize(count);
+					for (float& value : Values[i])
+					{
+						seed = seed * 1664525u + 1013904223u;
+						value = min + (max - min) * ((float)(seed >> 8) / (float)(1 << 24));
+					}
+				}
+
+				Batch.TranslationX = Values[0].data(); Batch.TranslationY = Values[1].data(); Batch.TranslationZ = Values[2].data();
+				Batch.RotationX = Values[3].data(); Batch.RotationY = Values[4].data(); Batch.RotationZ = Values[5].data(); Batch.RotationW = Values[6].data();
+				Batch.ScaleX = Values[7].data(); Batch.ScaleY = Values[8].data(); Batch.ScaleZ = Values[9].data();
+			}
+		};
+
+		static float MaxDifference(const float* a, const float* b, uint64_t count)
+		{
+			float difference = 0.0f;
+			for (uint64_t i = 0; i < count; i++)
+				difference = glm::max(difference, glm::abs(a[i] - b[i]) / glm::max(1.0f, glm::abs(b[i])));
+
+			return difference;
+		}
+
+		/**
+		 * @brief Compares every vector path this CPU supports with the scalar one, for both output layouts. The count
+		 * should leave a tail that doesn't fill a whole register so the mixed vector + scalar path is covered too.
+		 *
+		 * @return false and logs a warning when any path differs by more than float rounding.
+		 */
+		bool Validate(uint64_t count)
+		{
+			constexpr float tolerance = 1e-5f;
+			const TestData data(count);
+
+			std::vector<glm::mat4> expectedMat4(count), mat4(count);
+			std::vector<VkTransformMatrixKHR> expectedKhr(count), khr(count);
+			ComputeMat4(data.Batch, count, expectedMat4.data(), InstructionSet::Scalar);
+			ComputeKhrMat(data.Batch, count, expectedKhr.data(), InstructionSet::Scalar);
+
+			bool valid = true;
+			for (InstructionSet set : { InstructionSet::SSE, InstructionSet::AVX2, InstructionSet::NEON })
+			{
+				if (!IsSupported(set))
+					continue;
+
+				ComputeMat4(data.Batch, count, mat4.data(), set);
+				ComputeKhrMat(data.Batch, count, khr.data(), set);
+
+				const float mat4Difference = MaxDifference((const float*)mat4.data(), (const float*)expectedMat4.data(), count * 16);
+				const float khrDifference = MaxDifference(&khr[0].matrix[0][0], &expectedKhr[0].matrix[0][0], count * 12);
+				if (mat4Difference > tolerance || khrDifference > tolerance)
+				{
+					VL_CORE_WARN("TransformBatch {} doesn't match scalar, max relative difference mat4 {}, khr {}", GetInstructionSetName(set), mat4Difference, khrDifference);
+					valid = false;
+				}
+			}
+
+			return valid;
+		}
+
+		/**
+		 * @brief Validates the vector paths and logs throughput of every path this CPU supports.
+		 *
+		 * @param count - Transforms per batch, default fits the batch into L2.
+		 * @param iterations - Number of batches timed per path.
+		 */
+		void RunBenchmark(uint64_t count, uint32_t iterations)
+		{
+			const bool valid = Validate();
+			VL_CORE_INFO("TransformBatch benchmark, {} transforms x {}, selected {}, {}", count, iterations,
+				GetInstructionSetName(GetInstructionSet()), valid ? "all paths match scalar" : "MISMATCH");
+
+			const TestData data(count);
+			std::vector<glm::mat4> mat4(count);
+			std::vector<VkTransformMatrixKHR> khr(count);
+			for (InstructionSet set : { InstructionSet::Scalar, InstructionSet::SSE, InstructionSet::AVX2, InstructionSet::NEON })
+			{
+				if (!IsSupported(set))
+					continue;
+
+				Timer timer;
+				for (uint32_t i = 0; i < iterations; i++)
+					ComputeMat4(data.Batch, count, mat4.data(), set);
+				const double mat4Ns = timer.ElapsedMillis() * 1e6 / ((double)count * iterations);
+
+				timer.Reset();
+				for (uint32_t i = 0; i < iterations; i++)
+					ComputeKhrMat(data.Batch, count, khr.data(), set);
+				const double khrNs = timer.ElapsedMillis() * 1e6 / ((double)count * iterations);
+
+				VL_CORE_INFO("    {:<8} mat4 {:6.2f}ns  khr {:6.2f}ns per transform", GetInstructionSetName(set), mat4Ns, khrNs);
+			}
+		}
+	}
+
+}
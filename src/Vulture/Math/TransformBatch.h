@@ -0,0 +1,55 @@
+#pragma once
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+#include "glm/glm.hpp"
+
+namespace Vulture
+{
+	// Builds translation * rotation * scale matrices for many transforms at once. Inputs are structure of arrays, so
+	// 4 (SSE, NEON) or 8 (AVX2) transforms are composed per instruction. The instruction set is picked at runtime
+	// from what the CPU supports, results match Transform::GetMat4 up to float rounding.
+	namespace TransformBatch
+	{
+		enum class InstructionSet
+		{
+			Scalar,
+			SSE,
+			AVX2,
+			NEON,
+		};
+
+		// Every pointer has to point to at least count floats, quaternions don't have to be normalized
+		struct Input
+		{
+			const float* TranslationX = nullptr;
+			const float* TranslationY = nullptr;
+			const float* TranslationZ = nullptr;
+
+			const float* RotationX = nullptr;
+			const float* RotationY = nullptr;
+			const float* RotationZ = nullptr;
+			const float* RotationW = nullptr;
+
+			const float* ScaleX = nullptr;
+			const float* ScaleY = nullptr;
+			const float* ScaleZ = nullptr;
+		};
+
+		InstructionSet GetInstructionSet();
+		bool IsSupported(InstructionSet set);
+		const char* GetInstructionSetName(InstructionSet set);
+
+		void ComputeMat4(const Input& input, uint64_t count, glm::mat4* outMatrices);
+		void ComputeKhrMat(const Input& input, uint64_t count, VkTransformMatrixKHR* outMatrices);
+
+		// Forces a specific path, used for comparing the kernels against each other
+		void ComputeMat4(const Input& input, uint64_t count, glm::mat4* outMatrices, InstructionSet set);
+		void ComputeKhrMat(const Input& input, uint64_t count, VkTransformMatrixKHR* outMatrices, InstructionSet set);
+
+		bool Validate(uint64_t count = 1027);
+		void RunBenchmark(uint64_t count = 65536, uint32_t iterations = 200);
+	}
+
+}
@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include "AccelerationStructure.h"
+#include "GpuProfiler.h"
 #include "Scene/Components.h"
 
 namespace Vulture
@@ -14,22 +15,28 @@ namespace Vulture
 	 * @param mesh - Input Mesh object to convert.
 	 * @return BlasInput - AccelerationStructure input data generated from the mesh.
 	 */
-	BlasInput AccelerationStructure::MeshToGeometry(Mesh* mesh)
+	BlasInput AccelerationStructure::MeshToGeometry(Mesh* mesh, uint32_t lod)
 	{
 		// Get device addresses of the vertex and index buffers
 		VkDeviceAddress vertexAddress	= mesh->GetVertexBuffer()->GetDeviceAddress();
 		VkDeviceAddress indexAddress	= mesh->GetIndexBuffer()->GetDeviceAddress();
 
-		uint32_t primitiveCount			= (uint32_t)mesh->GetIndexCount() / 3;
+		uint32_t primitiveCount			= (lod == 0 ? (uint32_t)mesh->GetIndexCount() : mesh->GetLOD(lod).IndexCount) / 3;
 
-		// Describe buffer as array of Mesh::Vertex.
+		// Describe buffer as array of Mesh::Vertex or Mesh::CompactVertex.
 		VkAccelerationStructureGeometryTrianglesDataKHR triangles{ VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR };
 		triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
 		triangles.vertexData.deviceAddress = vertexAddress;
-		triangles.vertexStride = sizeof(Mesh::Vertex);
-		triangles.indexType = VK_INDEX_TYPE_UINT32;
+		triangles.vertexStride = mesh->GetVertexStride();
+		triangles.indexType = mesh->GetIndexType();
 		triangles.indexData.deviceAddress = indexAddress;
 		triangles.transformData = {};
+		if (mesh->GetVertexLayout() == VertexLayout::Compact)
+		{
+			// Quantized positions are dequantized by the geometry transform during the build
+			triangles.vertexFormat = VK_FORMAT_R16G16B16A16_SNORM;
+			triangles.transformData.deviceAddress = mesh->GetDequantTransformBuffer()->GetDeviceAddress();
+		}
 		triangles.maxVertex = (uint32_t)mesh->GetVertexCount() - 1;
 
 		// Identify the above data as opaque triangles.
@@ -42,7 +49,7 @@ namespace Vulture
 		VkAccelerationStructureBuildRangeInfoKHR range{};
 		range.firstVertex = 0;
 		range.primitiveCount = primitiveCount;
-		range.primitiveOffset = 0;
+		range.primitiveOffset = mesh->GetLOD(lod).IndexOffset * mesh->GetIndexSize();
 		range.transformOffset = 0;
 
 		// Our blas is made from only one geometry, but could be made of many geometries
@@ -201,6 +208,7 @@ namespace Vulture
 		BufferInfo.UsageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
 		BufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		BufferInfo.MinMemoryAlignment = Device::GetAccelerationProperties().minAccelerationStructureScratchOffsetAlignment;
+		BufferInfo.Category = MemoryCategory::Scratch;
 		scratchBuffer->Init(BufferInfo);
 
 		// Update build information
@@ -342,6 +350,8 @@ namespace Vulture
 
 	void AccelerationStructure::CreateTopLevelAS(const CreateInfo& info)
 	{
+		VL_PROFILE_FUNCTION();
+
 		std::vector<VkAccelerationStructureInstanceKHR> tlas;
 		int meshCount = 0;
 		for (int i = 0; i < info.Instances.size(); i++)
@@ -389,20 +399,25 @@ namespace Vulture
 
 		// Creating the TLAS
 		Buffer scratchBuffer;
+		GpuProfiler::BeginImmediateScope(cmdBuf, "TLAS Build");
 		CmdCreateTlas(cmdBuf, instanceCount, instancesBuffer.GetDeviceAddress(), &scratchBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR, false);
+		GpuProfiler::EndImmediateScope(cmdBuf);
 
 		// Finalizing and destroying temporary data
 		Device::EndSingleTimeCommands(cmdBuf, Device::GetComputeQueue(), Device::GetComputeCommandPool());
+		GpuProfiler::ResolveImmediate();
 		stagingBuffer.Unmap();
 	}
 
 	void AccelerationStructure::CreateBottomLevelAS(const CreateInfo& info)
 	{
+		VL_PROFILE_FUNCTION();
+
 		std::vector<BlasInput> blases;
 
 		for (int i = 0; i < info.Instances.size(); i++)
 		{
-			BlasInput blas = MeshToGeometry(info.Instances[i].mesh);
+			BlasInput blas = MeshToGeometry(info.Instances[i].mesh, info.Instances[i].lod);
 
 			blases.emplace_back(blas);
 		}
@@ -461,6 +476,7 @@ namespace Vulture
 		BufferInfo.UsageFlags = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
 		BufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		BufferInfo.MinMemoryAlignment = Device::GetAccelerationProperties().minAccelerationStructureScratchOffsetAlignment;
+		BufferInfo.Category = MemoryCategory::Scratch;
 		scratchBuffer.Init(BufferInfo);
 		VkDeviceAddress scratchAddress = scratchBuffer.GetDeviceAddress();
 
@@ -486,17 +502,25 @@ namespace Vulture
 			// Over the limit or last BLAS element
 			if (batchSize >= batchLimit || i == blasCount - 1)
 			{
+				VL_PROFILE_SCOPE("BLAS Batch");
+
 				VkCommandBuffer cmdBuf;
 				Device::BeginSingleTimeCommands(cmdBuf, Device::GetComputeCommandPool());
+				GpuProfiler::BeginImmediateScope(cmdBuf, "BLAS Build");
 				CmdCreateBlas(cmdBuf, indices, buildAs, scratchAddress, queryPool);
+				GpuProfiler::EndImmediateScope(cmdBuf);
 				Device::EndSingleTimeCommands(cmdBuf, Device::GetComputeQueue(), Device::GetComputeCommandPool());
+				GpuProfiler::ResolveImmediate();
 
 				if (queryPool)
 				{
 					VkCommandBuffer cmdBuf;
 					Device::BeginSingleTimeCommands(cmdBuf, Device::GetGraphicsCommandPool());
+					GpuProfiler::BeginImmediateScope(cmdBuf, "BLAS Compaction");
 					CmdCompactBlas(cmdBuf, indices, buildAs, queryPool);
+					GpuProfiler::EndImmediateScope(cmdBuf);
 					Device::EndSingleTimeCommands(cmdBuf, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
+					GpuProfiler::ResolveImmediate();
 
 					// Destroy the non-compacted version
 					DestroyNonCompacted(indices, buildAs);
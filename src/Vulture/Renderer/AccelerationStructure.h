@@ -35,6 +35,7 @@ namespace Vulture
 		{
 			Vulture::Mesh* mesh;
 			VkTransformMatrixKHR transform;
+			uint32_t lod = 0; // Hit shaders have to add the LOD's IndexOffset to primitive indices
 		};
 
 		struct CreateInfo
@@ -62,7 +63,7 @@ namespace Vulture
 	private:
 		void CreateTopLevelAS(const CreateInfo& info);
 		void CreateBottomLevelAS(const CreateInfo& info);
-		BlasInput MeshToGeometry(Mesh* mesh);
+		BlasInput MeshToGeometry(Mesh* mesh, uint32_t lod);
 
 		void CmdCreateBlas(
 			VkCommandBuffer cmdBuf,
@@ -0,0 +1,224 @@
+#include "pch.h"
+#include "FrameAllocator.h"
+
+#include "Vulkan/Device.h"
+
+#include <bit>
+
+namespace Vulture
+{
+	// Keeps every region start usable as a storage, uniform or device address base
+	static constexpr VkDeviceSize s_RegionAlignment = 256;
+
+	void FrameAllocator::Init(const CreateInfo& createInfo)
+	{
+		if (s_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.FramesInFlight != 0, "FramesInFlight can't be 0!");
+
+		const VkDeviceSize capacity = std::bit_ceil(std::max<VkDeviceSize>(createInfo.BytesPerFrame, s_RegionAlignment));
+		for (uint32_t i = 0; i < createInfo.FramesInFlight; i++)
+		{
+			s_Regions.push_back(std::make_unique<Region>());
+			CreateRegionMemory(*s_Regions.back(), capacity);
+		}
+
+		s_Current = nullptr;
+		s_PeakBytes = 0;
+		s_Initialized = true;
+	}
+
+	void FrameAllocator::Destroy()
+	{
+		if (!s_Initialized)
+			return;
+
+		// Buffers go through the delete queue, so nothing has to wait for the frames that still use them
+		s_Regions.clear();
+		s_Current = nullptr;
+		s_Initialized = false;
+	}
+
+	/**
+	 * @brief Resets the region of the frame index. Has to be called after the fence of the frame that used the index
+	 * before was waited on.
+	 */
+	void FrameAllocator::BeginFrame(uint32_t frameIndex)
+	{
+		VL_CORE_ASSERT(s_Initialized, "FrameAllocator is not initialized!");
+
+		Region& region = *s_Regions[frameIndex];
+		const VkDeviceSize used = region.Offset.load(std::memory_order_relaxed) + region.OverflowBytes;
+		s_PeakBytes = std::max(s_PeakBytes, used);
+
+		region.Overflow.clear();
+		if (region.OverflowBytes > 0)
+		{
+			const VkDeviceSize capacity = std::bit_ceil(region.Capacity + region.OverflowBytes);
+			VL_CORE_WARN("Frame allocator region {} ran out of memory, growing it from {} KB to {} KB", frameIndex, region.Capacity / 1024, capacity / 1024);
+
+			CreateRegionMemory(region, capacity);
+			region.OverflowBytes = 0;
+		}
+
+		region.Offset.store(0, std::memory_order_relaxed);
+		s_Current = &region;
+	}
+
+	void FrameAllocator::EndFrame()
+	{
+		s_Current = nullptr;
+	}
+
+	/**
+	 * @brief Reserves memory in the current frame's region. The memory stays valid until the frame retires.
+	 *
+	 * @param size - Size in bytes.
+	 * @param alignment - Alignment of the offset, has to be a power of two.
+	 */
+	FrameAllocator::Allocation FrameAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		VL_CORE_ASSERT(s_Current != nullptr, "FrameAllocator can only be used between Renderer::BeginFrame and Renderer::EndFrame!");
+		VL_CORE_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "Alignment has to be a power of two! Alignment: {}", alignment);
+		VL_CORE_ASSERT(alignment <= s_RegionAlignment, "Alignment can't be larger than {}! Alignment: {}", s_RegionAlignment, alignment);
+
+		Region& region = *s_Current;
+		VkDeviceSize offset = region.Offset.load(std::memory_order_relaxed);
+		VkDeviceSize alignedOffset;
+		do
+		{
+			alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+			if (alignedOffset + size > region.Capacity)
+				return AllocateOverflow(region, size);
+		} while (!region.Offset.compare_exchange_weak(offset, alignedOffset + size, std::memory_order_relaxed));
+
+		Allocation allocation;
+		allocation.Data = region.Data + alignedOffset;
+		allocation.Buffer = region.Memory.GetBuffer();
+		allocation.Offset = alignedOffset;
+		allocation.Size = size;
+		allocation.DeviceAddress = region.DeviceAddress != 0 ? region.DeviceAddress + alignedOffset : 0;
+
+		return allocation;
+	}
+
+	/**
+	 * @brief Allocates with the device's minimum uniform buffer offset alignment.
+	 */
+	FrameAllocator::Allocation FrameAllocator::AllocateUniform(VkDeviceSize size)
+	{
+		const VkDeviceSize alignment = Device::GetDeviceProperties().properties.limits.minUniformBufferOffsetAlignment;
+		return Allocate(size, std::max<VkDeviceSize>(alignment, 16));
+	}
+
+	/**
+	 * @brief Allocates and copies the data into the allocation.
+	 */
+	FrameAllocator::Allocation FrameAllocator::Upload(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+	{
+		Allocation allocation = Allocate(size, alignment);
+		memcpy(allocation.Data, data, size);
+
+		return allocation;
+	}
+
+	/**
+	 * @brief Records a copy of the data into a device local buffer, staged through the current frame's region, and a
+	 * barrier that makes it visible to every command recorded after it. Has to be recorded outside of a render pass.
+	 *
+	 * @param cmd - Command buffer submitted as part of the current frame.
+	 */
+	void FrameAllocator::CmdCopyToBuffer(VkCommandBuffer cmd, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+	{
+		if (size == 0)
+			return;
+
+		Allocation allocation = Upload(data, size, 16);
+
+		VkBufferCopy copy{};
+		copy.srcOffset = allocation.Offset;
+		copy.dstOffset = dstOffset;
+		copy.size = size;
+		vkCmdCopyBuffer(cmd, allocation.Buffer, dstBuffer, 1, &copy);
+
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = dstBuffer;
+		barrier.offset = dstOffset;
+		barrier.size = size;
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	/**
+	 * @brief Returns the number of bytes allocated so far in the current frame, 0 outside of a frame.
+	 */
+	VkDeviceSize FrameAllocator::GetUsedBytes()
+	{
+		if (s_Current == nullptr)
+			return 0;
+
+		std::unique_lock<std::mutex> lock(s_OverflowMutex);
+		return s_Current->Offset.load(std::memory_order_relaxed) + s_Current->OverflowBytes;
+	}
+
+	void FrameAllocator::CreateRegionMemory(Region& region, VkDeviceSize capacity)
+	{
+		region.Memory.Init(GetBufferInfo(capacity));
+		region.Memory.Map();
+
+		region.Data = (uint8_t*)region.Memory.GetMappedMemory();
+		region.DeviceAddress = Device::UseMemoryAddress() ? region.Memory.GetDeviceAddress() : 0;
+		region.Capacity = capacity;
+	}
+
+	/**
+	 * @brief Serves an allocation that doesn't fit into the region from a buffer of its own. The region is grown by
+	 * the overflow the next time its frame begins, so this only happens until the usage settles.
+	 */
+	FrameAllocator::Allocation FrameAllocator::AllocateOverflow(Region& region, VkDeviceSize size)
+	{
+		std::unique_lock<std::mutex> lock(s_OverflowMutex);
+
+		region.Overflow.push_back(std::make_unique<Vulture::Buffer>(GetBufferInfo(size)));
+		Vulture::Buffer& buffer = *region.Overflow.back();
+		buffer.Map();
+
+		// Alignment padding of the region is accounted for by rounding the grown capacity up
+		region.OverflowBytes += (size + s_RegionAlignment - 1) & ~(s_RegionAlignment - 1);
+
+		Allocation allocation;
+		allocation.Data = buffer.GetMappedMemory();
+		allocation.Buffer = buffer.GetBuffer();
+		allocation.Offset = 0;
+		allocation.Size = size;
+		allocation.DeviceAddress = Device::UseMemoryAddress() ? buffer.GetDeviceAddress() : 0;
+
+		return allocation;
+	}
+
+	Vulture::Buffer::CreateInfo FrameAllocator::GetBufferInfo(VkDeviceSize size)
+	{
+		Vulture::Buffer::CreateInfo info{};
+		info.InstanceSize = std::max<VkDeviceSize>(size, 1);
+		info.InstanceCount = 1;
+		info.MinMemoryAlignment = s_RegionAlignment;
+		info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		info.UsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+		info.Category = MemoryCategory::Staging;
+
+		if (Device::UseMemoryAddress())
+			info.UsageFlags |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		if (Device::UseRayTracing())
+			info.UsageFlags |= VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+
+		return info;
+	}
+
+}
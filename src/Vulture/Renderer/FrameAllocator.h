@@ -0,0 +1,85 @@
+#pragma once
+#include "pch.h"
+
+#include "Utility/Utility.h"
+#include "Vulkan/Buffer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace Vulture
+{
+	// Linear allocator for data that only lives for a single frame: uniform blobs, per dispatch parameters, vertex
+	// updates, acceleration structure instances. Every frame in flight owns one persistently mapped host visible
+	// buffer, allocations are a bump of its offset and the whole region is reset at once in BeginFrame, after the
+	// fence of the frame that used it last was waited on.
+	//
+	// Allocations can be made from any thread recording the current frame. When a region runs out, the allocation
+	// falls back to a dedicated buffer and the region grows the next time its frame index comes around.
+	class FrameAllocator
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32_t FramesInFlight = 0;
+			VkDeviceSize BytesPerFrame = 8 * 1024 * 1024;
+		};
+
+		struct Allocation
+		{
+			void* Data = nullptr;
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			VkDeviceSize Offset = 0;
+			VkDeviceSize Size = 0;
+			VkDeviceAddress DeviceAddress = 0; // 0 when buffer device address is disabled
+
+			inline VkDescriptorBufferInfo GetDescriptorInfo() const { return { Buffer, Offset, Size }; }
+			explicit operator bool() const { return Data != nullptr; }
+		};
+
+		static void Init(const CreateInfo& createInfo);
+		static void Destroy();
+
+		static void BeginFrame(uint32_t frameIndex);
+		static void EndFrame();
+
+		static Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+		static Allocation AllocateUniform(VkDeviceSize size);
+		static Allocation Upload(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+		static void CmdCopyToBuffer(VkCommandBuffer cmd, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+		static VkDeviceSize GetUsedBytes();
+		static inline VkDeviceSize GetPeakBytes() { return s_PeakBytes; }
+		static inline bool IsFrameActive() { return s_Current != nullptr; }
+		static inline bool IsInitialized() { return s_Initialized; }
+
+		FrameAllocator() = delete;
+		~FrameAllocator() = delete;
+
+	private:
+		struct Region
+		{
+			Vulture::Buffer Memory;
+			uint8_t* Data = nullptr;
+			VkDeviceAddress DeviceAddress = 0;
+			VkDeviceSize Capacity = 0;
+			std::atomic<VkDeviceSize> Offset = 0;
+
+			std::vector<Scope<Vulture::Buffer>> Overflow; // Freed when the frame index comes around again
+			VkDeviceSize OverflowBytes = 0;
+		};
+
+		static void CreateRegionMemory(Region& region, VkDeviceSize capacity);
+		static Allocation AllocateOverflow(Region& region, VkDeviceSize size);
+		static Vulture::Buffer::CreateInfo GetBufferInfo(VkDeviceSize size);
+
+		inline static bool s_Initialized = false;
+		inline static std::vector<Scope<Region>> s_Regions;
+		inline static Region* s_Current = nullptr;
+		inline static std::mutex s_OverflowMutex;
+		inline static VkDeviceSize s_PeakBytes = 0;
+	};
+
+}
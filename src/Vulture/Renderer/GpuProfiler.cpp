@@ -0,0 +1,571 @@
+#include "pch.h"
+#include "GpuProfiler.h"
+
+#include "Vulkan/Device.h"
+#include "Renderer.h"
+
+#ifdef VL_IMGUI
+#include <imgui.h>
+#endif
+
+namespace Vulture
+{
+	// Sampling both clocks together is cheap, doing it regularly keeps the mapping from drifting apart
+	static constexpr uint32_t s_RecalibrationInterval = 256; // Frames
+
+	void GpuProfiler::Init(const CreateInfo& createInfo)
+	{
+		if (s_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.FramesInFlight > 0, "FramesInFlight can't be 0!");
+
+		s_Epoch = std::chrono::steady_clock::now();
+		s_HistoryLength = std::max(createInfo.HistoryLength, 1u);
+
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(Device::GetPhysicalDevice(), &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(Device::GetPhysicalDevice(), &familyCount, families.data());
+
+		QueueFamilyIndices indices = Device::FindPhysicalQueueFamilies();
+		const uint32_t validBits = std::min(families[indices.GraphicsFamily].timestampValidBits, families[indices.ComputeFamily].timestampValidBits);
+		const float period = Device::GetDeviceProperties().properties.limits.timestampPeriod;
+
+		s_Initialized = true;
+		s_Enabled = validBits > 0 && period > 0.0f;
+		if (!s_Enabled)
+		{
+			VL_CORE_WARN("Timestamp queries are not supported, GPU profiling is disabled");
+			return;
+		}
+
+		s_TimestampPeriod = period;
+		s_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		s_Frames.resize(createInfo.FramesInFlight);
+		for (QueryRing& ring : s_Frames)
+			CreateRing(ring, createInfo.MaxScopesPerFrame);
+		CreateRing(s_Immediate, createInfo.MaxImmediateScopes);
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = 1;
+		VL_CORE_RETURN_ASSERT(vkCreateQueryPool(Device::GetDevice(), &poolInfo, nullptr, &s_CalibrationPool), VK_SUCCESS, "failed to create query pool!");
+
+		s_HostTimeDomain = FindHostTimeDomain();
+		Calibrate();
+	}
+
+	void GpuProfiler::Destroy()
+	{
+		if (!s_Initialized)
+			return;
+
+		for (QueryRing& ring : s_Frames)
+			vkDestroyQueryPool(Device::GetDevice(), ring.Pool, nullptr);
+		s_Frames.clear();
+
+		if (s_Immediate.Pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(Device::GetDevice(), s_Immediate.Pool, nullptr);
+		s_Immediate = {};
+
+		if (s_CalibrationPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(Device::GetDevice(), s_CalibrationPool, nullptr);
+		s_CalibrationPool = VK_NULL_HANDLE;
+		s_HostTimeDomain = VK_TIME_DOMAIN_MAX_ENUM_EXT;
+		s_FramesSinceCalibration = 0;
+
+		s_Stats.clear();
+		s_Histories.clear();
+		s_StatsIndices.clear();
+		s_LastFrame.clear();
+		s_FrameIndex = 0;
+		s_FrameActive = false;
+		s_GpuToCpuOffsetNs = 0.0;
+		s_CalibrationErrorNs = 0.0;
+		s_WarnedFull = false;
+		s_Enabled = false;
+		s_Initialized = false;
+	}
+
+	/**
+	 * @brief Reads the results of the frame that used this frame index before and starts the "Frame" scope. Call it
+	 * right after the frame's fence was waited on and its command buffer began.
+	 */
+	void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex)
+	{
+		if (!s_Enabled)
+			return;
+
+		VL_CORE_ASSERT(!s_FrameActive, "GpuProfiler frame already began!");
+
+		s_FrameIndex = frameIndex % (uint32_t)s_Frames.size();
+		QueryRing& ring = s_Frames[s_FrameIndex];
+
+		Resolve(ring, true);
+		vkCmdResetQueryPool(cmd, ring.Pool, 0, ring.Capacity);
+
+		if (++s_FramesSinceCalibration >= s_RecalibrationInterval)
+		{
+			s_FramesSinceCalibration = 0;
+			CalibrateWithHostClock();
+		}
+
+		s_FrameActive = true;
+		BeginScope(cmd, "Frame");
+	}
+
+	void GpuProfiler::EndFrame(VkCommandBuffer cmd)
+	{
+		if (!s_FrameActive)
+			return;
+
+		QueryRing& ring = s_Frames[s_FrameIndex];
+		if (ring.Stack.size() > 1)
+		{
+			VL_CORE_WARN("{} GPU profiler scopes weren't ended this frame", ring.Stack.size() - 1);
+			while (ring.Stack.size() > 1)
+				EndScope(cmd);
+		}
+
+		EndScope(cmd);
+		s_FrameActive = false;
+	}
+
+	/**
+	 * @brief The frame's command buffer won't be submitted, forget its scopes.
+	 */
+	void GpuProfiler::CancelFrame()
+	{
+		if (!s_Enabled)
+			return;
+
+		QueryRing& ring = s_Frames[s_FrameIndex];
+		ring.QueryCount = 0;
+		ring.Scopes.clear();
+		ring.Stack.clear();
+		s_FrameActive = false;
+	}
+
+	/**
+	 * @brief Starts a timed region, also begins a debug label with the same name. Scopes can be nested.
+	 */
+	void GpuProfiler::BeginScope(VkCommandBuffer cmd, const char* name, glm::vec4 color)
+	{
+		Device::BeginLabel(cmd, name, color);
+
+		if (s_FrameActive)
+			Begin(s_Frames[s_FrameIndex], cmd, name);
+	}
+
+	void GpuProfiler::EndScope(VkCommandBuffer cmd)
+	{
+		if (s_FrameActive)
+			End(s_Frames[s_FrameIndex], cmd);
+
+		Device::EndLabel(cmd);
+	}
+
+	/**
+	 * @brief Times a region of a one-shot command buffer that is waited on right after submission. Other threads
+	 * can't record immediate scopes until this thread calls ResolveImmediate().
+	 */
+	void GpuProfiler::BeginImmediateScope(VkCommandBuffer cmd, const char* name)
+	{
+		if (!s_Enabled)
+			return;
+
+		if (s_ImmediateOwner.load() != std::this_thread::get_id())
+		{
+			s_ImmediateMutex.lock();
+			s_ImmediateOwner.store(std::this_thread::get_id());
+		}
+
+		const uint32_t query = s_Immediate.QueryCount;
+		if (query + 2 <= s_Immediate.Capacity)
+			vkCmdResetQueryPool(cmd, s_Immediate.Pool, query, 2);
+
+		Begin(s_Immediate, cmd, name);
+	}
+
+	void GpuProfiler::EndImmediateScope(VkCommandBuffer cmd)
+	{
+		if (!s_Enabled)
+			return;
+
+		VL_CORE_ASSERT(s_ImmediateOwner.load() == std::this_thread::get_id(), "Immediate scope was begun on a different thread!");
+		End(s_Immediate, cmd);
+	}
+
+	/**
+	 * @brief Reads the immediate scopes, call it after the command buffer they were recorded into finished.
+	 */
+	void GpuProfiler::ResolveImmediate()
+	{
+		if (!s_Enabled || s_ImmediateOwner.load() != std::this_thread::get_id())
+			return;
+
+		VL_CORE_ASSERT(s_Immediate.Stack.empty(), "Immediate scopes have to be ended before resolving them!");
+		Resolve(s_Immediate, false);
+
+		s_ImmediateOwner.store(std::thread::id());
+		s_ImmediateMutex.unlock();
+	}
+
+	/**
+	 * @brief Finds the offset between GPU timestamps and the CPU clock. When the device supports
+	 * VK_EXT_calibrated_timestamps both clocks are sampled together, which doesn't touch the queue. Otherwise a
+	 * timestamp is written at the top of an empty submission bracketed by CPU time, that waits on the queue, so it
+	 * stalls when frames are in flight.
+	 */
+	void GpuProfiler::Calibrate()
+	{
+		if (!s_Enabled)
+			return;
+
+		if (!CalibrateWithHostClock())
+			CalibrateWithRoundTrip();
+
+		VL_CORE_TRACE("Calibrated GPU timestamps, error +-{:.3f}ms", GetCalibrationErrorMs());
+	}
+
+	/**
+	 * @brief Returns the calibrateable time domain steady_clock reads, or VK_TIME_DOMAIN_MAX_ENUM_EXT when there
+	 * is none.
+	 */
+	VkTimeDomainEXT GpuProfiler::FindHostTimeDomain()
+	{
+		if (!Device::IsCalibratedTimestampsSupported())
+			return VK_TIME_DOMAIN_MAX_ENUM_EXT;
+
+		uint32_t domainCount = 0;
+		Device::vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(Device::GetPhysicalDevice(), &domainCount, nullptr);
+		std::vector<VkTimeDomainEXT> domains(domainCount);
+		Device::vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(Device::GetPhysicalDevice(), &domainCount, domains.data());
+
+		// steady_clock is QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere
+#ifdef WIN
+		const VkTimeDomainEXT hostDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+		const VkTimeDomainEXT hostDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+		const bool hasDevice = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+		const bool hasHost = std::find(domains.begin(), domains.end(), hostDomain) != domains.end();
+		if (!hasDevice || !hasHost)
+		{
+			VL_CORE_INFO("Device can't calibrate timestamps against the CPU clock, falling back to a queue round trip");
+			return VK_TIME_DOMAIN_MAX_ENUM_EXT;
+		}
+
+		return hostDomain;
+	}
+
+	/**
+	 * @brief Samples the GPU and CPU clocks together with VK_EXT_calibrated_timestamps, keeping the sample with the
+	 * smallest deviation of a few. Returns false when the host clock can't be calibrated against.
+	 */
+	bool GpuProfiler::CalibrateWithHostClock()
+	{
+		if (s_HostTimeDomain == VK_TIME_DOMAIN_MAX_ENUM_EXT)
+			return false;
+
+		VkCalibratedTimestampInfoEXT infos[2]{};
+		infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+		infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[1].timeDomain = s_HostTimeDomain;
+
+#ifdef WIN
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		const double hostPeriod = 1'000'000'000.0 / (double)frequency.QuadPart;
+#else
+		const double hostPeriod = 1.0;
+#endif
+		const double epochNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(s_Epoch.time_since_epoch()).count();
+
+		uint64_t bestDeviation = std::numeric_limits<uint64_t>::max();
+		for (int i = 0; i < 5; i++)
+		{
+			uint64_t timestamps[2] = {};
+			uint64_t deviation = 0;
+			if (Device::vkGetCalibratedTimestampsEXT(Device::GetDevice(), 2, infos, timestamps, &deviation) != VK_SUCCESS)
+				continue;
+
+			if (deviation < bestDeviation)
+			{
+				bestDeviation = deviation;
+				const double cpuNs = (double)timestamps[1] * hostPeriod - epochNs;
+				s_GpuToCpuOffsetNs = cpuNs - (double)(timestamps[0] & s_TimestampMask) * s_TimestampPeriod;
+			}
+		}
+
+		if (bestDeviation == std::numeric_limits<uint64_t>::max())
+			return false;
+
+		s_CalibrationErrorNs = (double)bestDeviation;
+		return true;
+	}
+
+	/**
+	 * @brief Brackets a timestamp written at the top of an empty submission with CPU time, the tightest of a few
+	 * tries is kept. The queue is waited on.
+	 */
+	void GpuProfiler::CalibrateWithRoundTrip()
+	{
+		int64_t bestRoundTrip = std::numeric_limits<int64_t>::max();
+		for (int i = 0; i < 5; i++)
+		{
+			VkCommandBuffer cmd;
+			Device::BeginSingleTimeCommands(cmd, Device::GetGraphicsCommandPool());
+			vkCmdResetQueryPool(cmd, s_CalibrationPool, 0, 1);
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_CalibrationPool, 0);
+
+			const int64_t before = GetCpuTimeNs();
+			Device::EndSingleTimeCommands(cmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
+			const int64_t after = GetCpuTimeNs();
+
+			uint64_t ticks = 0;
+			vkGetQueryPoolResults(Device::GetDevice(), s_CalibrationPool, 0, 1, sizeof(uint64_t), &ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+			if (after - before < bestRoundTrip)
+			{
+				bestRoundTrip = after - before;
+				s_GpuToCpuOffsetNs = (double)(before + after) / 2.0 - (double)(ticks & s_TimestampMask) * s_TimestampPeriod;
+			}
+		}
+
+		s_CalibrationErrorNs = bestRoundTrip / 2.0;
+	}
+
+	std::vector<GpuProfiler::ScopeStats> GpuProfiler::GetStats()
+	{
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+		return s_Stats;
+	}
+
+	/**
+	 * @brief CPU clock the timings are expressed in, milliseconds since Init().
+	 */
+	double GpuProfiler::GetCpuTimeMs()
+	{
+		return GetCpuTimeNs() / 1'000'000.0;
+	}
+
+	void GpuProfiler::DrawImGui(bool* open)
+	{
+#ifdef VL_IMGUI
+		if (!ImGui::Begin("GPU Profiler", open))
+		{
+			ImGui::End();
+			return;
+		}
+
+		if (!s_Enabled)
+		{
+			ImGui::TextUnformatted("Timestamp queries are not supported on this device");
+			ImGui::End();
+			return;
+		}
+
+		ImGui::Text("Calibration error: +-%.3f ms", GetCalibrationErrorMs());
+		ImGui::SameLine();
+		if (ImGui::Button("Recalibrate"))
+			Calibrate();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Waits for the GPU to be idle");
+
+		std::vector<float> frameTimes;
+		{
+			std::unique_lock<std::mutex> lock(s_StatsMutex);
+			auto frame = s_StatsIndices.find("Frame");
+			if (frame != s_StatsIndices.end())
+			{
+				const History& history = s_Histories[frame->second];
+				for (uint32_t i = 0; i < (uint32_t)history.Samples.size(); i++)
+					frameTimes.push_back(history.Samples[(history.Next + i) % history.Samples.size()].Ms);
+			}
+		}
+
+		if (!frameTimes.empty())
+			ImGui::PlotLines("Frame (ms)", frameTimes.data(), (int)frameTimes.size(), 0, nullptr, 0.0f, std::numeric_limits<float>::max(), ImVec2(0.0f, 60.0f));
+
+		const std::vector<ScopeStats> stats = GetStats();
+		if (ImGui::BeginTable("Scopes", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable))
+		{
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("Last");
+			ImGui::TableSetupColumn("Avg");
+			ImGui::TableSetupColumn("Min");
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableSetupColumn("Latency");
+			ImGui::TableHeadersRow();
+
+			for (const ScopeStats& scope : stats)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%*s%s", scope.Depth * 2, "", scope.Name.c_str());
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.LastMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.AverageMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.MinMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.MaxMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.LatencyMs);
+			}
+
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+#endif
+	}
+
+	void GpuProfiler::CreateRing(QueryRing& ring, uint32_t scopeCount)
+	{
+		ring.Capacity = std::max(scopeCount, 1u) * 2;
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = ring.Capacity;
+		VL_CORE_RETURN_ASSERT(vkCreateQueryPool(Device::GetDevice(), &poolInfo, nullptr, &ring.Pool), VK_SUCCESS, "failed to create query pool!");
+	}
+
+	void GpuProfiler::Begin(QueryRing& ring, VkCommandBuffer cmd, const char* name)
+	{
+		ScopeRecord scope{ GetStatsIndex(name), (uint32_t)ring.Stack.size(), std::numeric_limits<uint32_t>::max(), GetCpuTimeNs() };
+		if (ring.QueryCount + 2 <= ring.Capacity)
+		{
+			scope.Query = ring.QueryCount;
+			ring.QueryCount += 2;
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, ring.Pool, scope.Query);
+		}
+		else if (!s_WarnedFull)
+		{
+			VL_CORE_WARN("GPU profiler ran out of queries, scope {} and the ones after it aren't timed", name);
+			s_WarnedFull = true;
+		}
+
+		ring.Stack.push_back((uint32_t)ring.Scopes.size());
+		ring.Scopes.push_back(scope);
+	}
+
+	void GpuProfiler::End(QueryRing& ring, VkCommandBuffer cmd)
+	{
+		VL_CORE_ASSERT(!ring.Stack.empty(), "EndScope called without a matching BeginScope!");
+
+		const ScopeRecord& scope = ring.Scopes[ring.Stack.back()];
+		ring.Stack.pop_back();
+
+		if (scope.Query != std::numeric_limits<uint32_t>::max())
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, ring.Pool, scope.Query + 1);
+	}
+
+	// Results that aren't available yet (the command buffer was never submitted) are skipped instead of waited for
+	void GpuProfiler::Resolve(QueryRing& ring, bool keepTimings)
+	{
+		if (keepTimings)
+			s_LastFrame.clear();
+
+		if (ring.QueryCount > 0)
+		{
+			// Value and availability for every query
+			std::vector<uint64_t> results(ring.QueryCount * 2);
+			vkGetQueryPoolResults(Device::GetDevice(), ring.Pool, 0, ring.QueryCount, results.size() * sizeof(uint64_t), results.data(),
+				2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+			for (const ScopeRecord& scope : ring.Scopes)
+			{
+				if (scope.Query == std::numeric_limits<uint32_t>::max())
+					continue;
+
+				const uint64_t* begin = &results[scope.Query * 2];
+				const uint64_t* end = &results[(scope.Query + 1) * 2];
+				if (begin[1] == 0 || end[1] == 0)
+					continue;
+
+				const double durationNs = (double)((end[0] - begin[0]) & s_TimestampMask) * s_TimestampPeriod;
+				const double beginNs = ToCpuNs(begin[0] & s_TimestampMask);
+
+				AddSample(scope.Stats, scope.Depth, (float)(durationNs / 1'000'000.0), (float)((beginNs - scope.RecordNs) / 1'000'000.0));
+
+				if (keepTimings)
+					s_LastFrame.push_back({ scope.Stats, scope.Depth, scope.RecordNs / 1'000'000.0, beginNs / 1'000'000.0, (beginNs + durationNs) / 1'000'000.0 });
+			}
+		}
+
+		ring.QueryCount = 0;
+		ring.Scopes.clear();
+		ring.Stack.clear();
+	}
+
+	uint32_t GpuProfiler::GetStatsIndex(const char* name)
+	{
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+
+		auto it = s_StatsIndices.find(name);
+		if (it != s_StatsIndices.end())
+			return it->second;
+
+		const uint32_t index = (uint32_t)s_Stats.size();
+		s_StatsIndices.emplace(name, index);
+		s_Stats.emplace_back().Name = name;
+		s_Histories.emplace_back().Samples.reserve(s_HistoryLength);
+
+		return index;
+	}
+
+	void GpuProfiler::AddSample(uint32_t stats, uint32_t depth, float ms, float latencyMs)
+	{
+		std::unique_lock<std::mutex> lock(s_StatsMutex);
+
+		History& history = s_Histories[stats];
+		if (history.Samples.size() < s_HistoryLength)
+			history.Samples.push_back({ ms, latencyMs });
+		else
+			history.Samples[history.Next] = { ms, latencyMs };
+		history.Next = (history.Next + 1) % s_HistoryLength;
+
+		ScopeStats& scope = s_Stats[stats];
+		scope.Depth = depth;
+		scope.LastMs = ms;
+		scope.SampleCount++;
+
+		float sum = 0.0f;
+		float latencySum = 0.0f;
+		scope.MinMs = std::numeric_limits<float>::max();
+		scope.MaxMs = 0.0f;
+		for (const Sample& sample : history.Samples)
+		{
+			sum += sample.Ms;
+			latencySum += sample.LatencyMs;
+			scope.MinMs = std::min(scope.MinMs, sample.Ms);
+			scope.MaxMs = std::max(scope.MaxMs, sample.Ms);
+		}
+		scope.AverageMs = sum / history.Samples.size();
+		scope.LatencyMs = latencySum / history.Samples.size();
+	}
+
+	double GpuProfiler::ToCpuNs(uint64_t ticks)
+	{
+		if (s_TimestampMask == ~0ull)
+			return (double)ticks * s_TimestampPeriod + s_GpuToCpuOffsetNs;
+
+		// The GPU only reports the low bits, restore the rest from the current time. Resolved timestamps are at
+		// most a few frames old, far less than the wrap around period.
+		const uint64_t expected = (uint64_t)std::max(0.0, (GetCpuTimeNs() - s_GpuToCpuOffsetNs) / s_TimestampPeriod);
+		uint64_t full = (expected & ~s_TimestampMask) | ticks;
+		if (full > expected + s_TimestampMask / 2 && full > s_TimestampMask)
+			full -= s_TimestampMask + 1;
+
+		return (double)full * s_TimestampPeriod + s_GpuToCpuOffsetNs;
+	}
+
+	int64_t GpuProfiler::GetCpuTimeNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_Epoch).count();
+	}
+
+}
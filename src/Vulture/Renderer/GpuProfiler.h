@@ -0,0 +1,168 @@
+#pragma once
+#include "pch.h"
+#include "Utility/Utility.h"
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+namespace Vulture
+{
+	// Measures GPU time of labelled regions with timestamp queries. Every frame in flight has its own query pool,
+	// results of a frame are read when its index comes around again, after its fence was waited on, so reading them
+	// never stalls. GPU timestamps are mapped onto the CPU clock, which makes it possible to tell how long after
+	// recording a scope actually ran.
+	//
+	// Scopes are also emitted as debug labels. They have to be recorded on the thread that records the frame's
+	// primary command buffer, between Renderer::BeginFrame and Renderer::EndFrame.
+	class GpuProfiler
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32_t FramesInFlight = 0;
+			uint32_t MaxScopesPerFrame = 256;
+			uint32_t MaxImmediateScopes = 64;
+			uint32_t HistoryLength = 128; // Frames the rolling statistics are computed over
+		};
+
+		struct ScopeStats
+		{
+			std::string Name;
+			uint32_t Depth = 0; // Nesting level the last time it was recorded
+			float LastMs = 0.0f;
+			float AverageMs = 0.0f;
+			float MinMs = 0.0f;
+			float MaxMs = 0.0f;
+			float LatencyMs = 0.0f; // Average time between recording the scope on the CPU and the GPU starting it
+			uint64_t SampleCount = 0;
+		};
+
+		// One scope of the last resolved frame, times are in milliseconds on the CPU clock since Init()
+		struct ScopeTiming
+		{
+			uint32_t Stats; // Index into GetStats()
+			uint32_t Depth;
+			double RecordMs;
+			double BeginMs;
+			double EndMs;
+		};
+
+		static void Init(const CreateInfo& createInfo);
+		static void Destroy();
+
+		static void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+		static void EndFrame(VkCommandBuffer cmd);
+		static void CancelFrame();
+
+		static void BeginScope(VkCommandBuffer cmd, const char* name, glm::vec4 color = glm::vec4(1.0f));
+		static void EndScope(VkCommandBuffer cmd);
+
+		static void BeginImmediateScope(VkCommandBuffer cmd, const char* name);
+		static void EndImmediateScope(VkCommandBuffer cmd);
+		static void ResolveImmediate();
+
+		static void Calibrate();
+
+		static std::vector<ScopeStats> GetStats();
+		static inline const std::vector<ScopeTiming>& GetLastFrame() { return s_LastFrame; }
+		static inline double GetCalibrationErrorMs() { return s_CalibrationErrorNs / 1'000'000.0; }
+		static double GetCpuTimeMs();
+
+		static void DrawImGui(bool* open = nullptr);
+
+		static inline bool IsEnabled() { return s_Enabled; }
+		static inline bool IsInitialized() { return s_Initialized; }
+
+		GpuProfiler() = delete;
+		~GpuProfiler() = delete;
+
+	private:
+		struct ScopeRecord
+		{
+			uint32_t Stats;
+			uint32_t Depth;
+			uint32_t Query; // Begin query, the end is the next one. UINT32_MAX when the pool was full
+			int64_t RecordNs;
+		};
+
+		struct QueryRing
+		{
+			VkQueryPool Pool = VK_NULL_HANDLE;
+			uint32_t Capacity = 0; // In queries
+			uint32_t QueryCount = 0;
+			std::vector<ScopeRecord> Scopes;
+			std::vector<uint32_t> Stack; // Open scopes
+		};
+
+		struct Sample
+		{
+			float Ms;
+			float LatencyMs;
+		};
+
+		struct History
+		{
+			std::vector<Sample> Samples;
+			uint32_t Next = 0;
+		};
+
+		static void CreateRing(QueryRing& ring, uint32_t scopeCount);
+		static void Begin(QueryRing& ring, VkCommandBuffer cmd, const char* name);
+		static void End(QueryRing& ring, VkCommandBuffer cmd);
+		static void Resolve(QueryRing& ring, bool keepTimings);
+		static uint32_t GetStatsIndex(const char* name);
+		static void AddSample(uint32_t stats, uint32_t depth, float ms, float latencyMs);
+		static VkTimeDomainEXT FindHostTimeDomain();
+		static bool CalibrateWithHostClock();
+		static void CalibrateWithRoundTrip();
+		static double ToCpuNs(uint64_t ticks);
+		static int64_t GetCpuTimeNs();
+
+		inline static std::vector<QueryRing> s_Frames;
+		inline static uint32_t s_FrameIndex = 0;
+		inline static bool s_FrameActive = false;
+
+		// One-shot command buffers that are waited on right after submission, e.g. acceleration structure builds
+		inline static QueryRing s_Immediate;
+		inline static std::mutex s_ImmediateMutex; // Held from the first BeginImmediateScope until ResolveImmediate
+		inline static std::atomic<std::thread::id> s_ImmediateOwner;
+
+		inline static VkQueryPool s_CalibrationPool = VK_NULL_HANDLE;
+		inline static VkTimeDomainEXT s_HostTimeDomain = VK_TIME_DOMAIN_MAX_ENUM_EXT; // Domain of steady_clock, when the device can sample it together with the GPU clock
+		inline static double s_TimestampPeriod = 1.0; // Nanoseconds per tick
+		inline static uint64_t s_TimestampMask = ~0ull;
+		inline static double s_GpuToCpuOffsetNs = 0.0;
+		inline static uint32_t s_FramesSinceCalibration = 0;
+		inline static double s_CalibrationErrorNs = 0.0;
+		inline static std::chrono::steady_clock::time_point s_Epoch;
+
+		inline static std::mutex s_StatsMutex;
+		inline static std::vector<ScopeStats> s_Stats;
+		inline static std::vector<History> s_Histories;
+		inline static std::unordered_map<std::string, uint32_t> s_StatsIndices;
+		inline static std::vector<ScopeTiming> s_LastFrame;
+		inline static uint32_t s_HistoryLength = 0;
+		inline static bool s_WarnedFull = false;
+
+		inline static bool s_Enabled = false; // The graphics and compute queues support timestamps
+		inline static bool s_Initialized = false;
+	};
+
+	// Scope that ends with the C++ scope
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(VkCommandBuffer cmd, const char* name, glm::vec4 color = glm::vec4(1.0f)) : m_Cmd(cmd) { GpuProfiler::BeginScope(cmd, name, color); }
+		~GpuProfileScope() { GpuProfiler::EndScope(m_Cmd); }
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+	private:
+		VkCommandBuffer m_Cmd;
+	};
+
+}
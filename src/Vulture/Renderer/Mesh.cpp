@@ -1,8 +1,49 @@
 #include "pch.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "FrameAllocator.h"
+#include "Math/PerspectiveCamera.h"
+
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/constants.hpp"
 
 namespace Vulture
 {
+	static int16_t ToSnorm16(float value)
+	{
+		return (int16_t)glm::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	static float FromSnorm16(int16_t value)
+	{
+		return glm::max((float)value / 32767.0f, -1.0f);
+	}
+
+	static glm::vec2 OctahedralEncode(glm::vec3 normal)
+	{
+		const float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+		if (length == 0.0f)
+			return glm::vec2(0.0f);
+
+		normal /= length;
+		glm::vec2 encoded(normal.x, normal.y);
+		if (normal.z < 0.0f)
+		{
+			encoded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * glm::vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		return encoded;
+	}
+
+	static glm::vec3 OctahedralDecode(glm::vec2 encoded)
+	{
+		glm::vec3 normal(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+		const float fold = glm::max(-normal.z, 0.0f);
+		normal.x += normal.x >= 0.0f ? -fold : fold;
+		normal.y += normal.y >= 0.0f ? -fold : fold;
+
+		return glm::normalize(normal);
+	}
 
 	void Mesh::Init(const CreateInfo& createInfo)
 	{
@@ -30,6 +71,14 @@ namespace Vulture
 		m_VertexBuffer.Destroy();
 		if (m_HasIndexBuffer)
 			m_IndexBuffer.Destroy();
+		if (m_DequantTransformBuffer.IsInitialized())
+			m_DequantTransformBuffer.Destroy();
+		if (m_MeshletBuffer.IsInitialized())
+		{
+			m_MeshletBuffer.Destroy();
+			m_MeshletVertexBuffer.Destroy();
+			m_MeshletTriangleBuffer.Destroy();
+		}
 
 		Reset();
 	}
@@ -41,14 +90,74 @@ namespace Vulture
 
 	void Mesh::CreateMesh(const CreateInfo& createInfo)
 	{
-		CreateVertexBuffer(createInfo.Vertices, createInfo.VertexUsageFlags);
-		CreateIndexBuffer(createInfo.Indices, createInfo.IndexUsageFlags);
+		const bool hasLODs = createInfo.LODs != nullptr && !createInfo.LODs->empty();
+		VL_CORE_ASSERT(!hasLODs || !createInfo.Optimize, "Meshes with LODs can't be optimized on creation, optimize LOD 0 before generating them!");
+		VL_CORE_ASSERT(!hasLODs || (*createInfo.LODs)[0].IndexOffset == 0, "LOD 0 has to start at the beginning of the index buffer!");
+
+		m_Layout = createInfo.Layout;
+
+		if (createInfo.Optimize && createInfo.Indices != nullptr)
+		{
+			std::vector<Vertex> vertices = *createInfo.Vertices;
+			std::vector<uint32_t> indices = *createInfo.Indices;
+
+			MeshOptimizer::Result result = MeshOptimizer::Optimize(vertices, indices, createInfo.OptimizeOverdraw);
+			VL_CORE_TRACE("Optimized mesh: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", result.Before.GetACMR(), result.After.GetACMR(), result.Before.GetATVR(), result.After.GetATVR());
+
+			CreateVertexBuffer(&vertices, createInfo.VertexUsageFlags);
+			CreateIndexBuffer(&indices, createInfo.IndexUsageFlags);
+		}
+		else
+		{
+			CreateVertexBuffer(createInfo.Vertices, createInfo.VertexUsageFlags);
+			CreateIndexBuffer(createInfo.Indices, createInfo.IndexUsageFlags);
+		}
+
+		if (createInfo.Meshlets != nullptr && !createInfo.Meshlets->Meshlets.empty())
+			CreateMeshletBuffers(*createInfo.Meshlets);
+
+		if (hasLODs)
+			m_LODs = *createInfo.LODs;
+		else
+			m_LODs = { LOD{ 0, (uint32_t)m_IndexCount, 0.0f } };
+
+		if (m_Layout == VertexLayout::Compact)
+		{
+			const uint64_t fullSize = m_VertexCount * sizeof(Vertex) + m_IndexCount * sizeof(uint32_t);
+			const uint64_t compactSize = m_VertexCount * GetVertexStride() + m_IndexCount * GetIndexSize();
+			VL_CORE_TRACE("Compact mesh: {} KB instead of {} KB", compactSize / 1024, fullSize / 1024);
+		}
+
+		m_IndexCount = m_LODs[0].IndexCount;
 	}
 
 	void Mesh::CreateMesh(aiMesh* mesh, const aiScene* scene, glm::mat4 mat, VkBufferUsageFlags customUsageFlags)
 	{
 		std::vector<Vertex> vertices;
 		std::vector<uint32_t> indices;
+		ReadAssimpMesh(mesh, mat, vertices, indices);
+
+		CreateInfo createInfo{};
+		createInfo.Vertices = &vertices;
+		createInfo.Indices = &indices;
+		createInfo.Layout = s_DefaultLayout;
+		createInfo.Optimize = mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+		CreateMesh(createInfo);
+	}
+
+	/**
+	 * @brief Converts assimp mesh into vertex and index arrays, doesn't touch the GPU so it can run on any thread.
+	 *
+	 * @param mesh - Assimp mesh.
+	 * @param mat - Transform applied to positions and normals.
+	 * @param outVertices - Vertices of the mesh.
+	 * @param outIndices - Indices of all faces.
+	 */
+	void Mesh::ReadAssimpMesh(aiMesh* mesh, const glm::mat4& mat, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices)
+	{
+		outVertices.clear();
+		outIndices.clear();
+		outVertices.reserve(mesh->mNumVertices);
 
 		// vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -63,6 +172,7 @@ namespace Vulture
 			vertex.Position = mat * glm::vec4(vector, 1.0f);
 
 			// normals
+			vertex.Normal = glm::vec3(0.0f);
 			if (mesh->HasNormals())
 			{
 				vector.x = mesh->mNormals[i].x;
@@ -84,7 +194,7 @@ namespace Vulture
 			else
 				vertex.TexCoord = glm::vec2(0.0f, 0.0f);
 
-			vertices.push_back(vertex);
+			outVertices.push_back(vertex);
 		}
 
 		// indices
@@ -92,18 +202,42 @@ namespace Vulture
 		{
 			aiFace face = mesh->mFaces[i];
 			for (unsigned int j = 0; j < face.mNumIndices; j++)
-				indices.push_back(face.mIndices[j]);
+				outIndices.push_back(face.mIndices[j]);
 		}
-
-		CreateVertexBuffer(&vertices);
-		CreateIndexBuffer(&indices);
 	}
 
 	void Mesh::CreateVertexBuffer(const std::vector<Vertex>* const vertices, VkBufferUsageFlags customUsageFlags)
 	{
 		m_VertexCount = (uint64_t)vertices->size();
-		VkDeviceSize bufferSize = sizeof(Vertex) * m_VertexCount;
-		uint32_t vertexSize = sizeof(Vertex);
+
+		if (!vertices->empty())
+		{
+			glm::vec3 min(std::numeric_limits<float>::max());
+			glm::vec3 max(std::numeric_limits<float>::lowest());
+			for (const Vertex& vertex : *vertices)
+			{
+				min = glm::min(min, vertex.Position);
+				max = glm::max(max, vertex.Position);
+			}
+
+			m_BoundingBoxMin = min;
+			m_BoundingBoxMax = max;
+			m_BoundingSphereCenter = (min + max) * 0.5f;
+			m_BoundingSphereRadius = 0.0f;
+			for (const Vertex& vertex : *vertices)
+				m_BoundingSphereRadius = glm::max(m_BoundingSphereRadius, glm::length(vertex.Position - m_BoundingSphereCenter));
+		}
+
+		const void* vertexData = vertices->data();
+		std::vector<CompactVertex> compactVertices;
+		if (m_Layout == VertexLayout::Compact)
+		{
+			EncodeVertices(*vertices, compactVertices, m_DequantScale, m_DequantOffset);
+			vertexData = compactVertices.data();
+		}
+
+		uint32_t vertexSize = GetVertexStride();
+		VkDeviceSize bufferSize = (VkDeviceSize)vertexSize * m_VertexCount;
 
 		/*
 			We need to be able to write our vertex data to memory.
@@ -124,7 +258,7 @@ namespace Vulture
 			This is done by mapping the buffer memory into CPU accessible memory with vkMapMemory.
 		*/
 		stagingBuffer.Map();
-		stagingBuffer.WriteToBuffer((void*)vertices->data());
+		stagingBuffer.WriteToBuffer((void*)vertexData);
 
 		/*
 			The vertexBuffer is now allocated from a memory type that is device
@@ -145,6 +279,67 @@ namespace Vulture
 		m_VertexBuffer.Init(bufferInfo);
 
 		Buffer::CopyBuffer(stagingBuffer.GetBuffer(), m_VertexBuffer.GetBuffer(), bufferSize, 0, 0, Device::GetGraphicsQueue(), 0, Device::GetGraphicsCommandPool());
+
+		if (m_Layout == VertexLayout::Compact && Device::UseRayTracing())
+			CreateDequantTransformBuffer();
+	}
+
+	/**
+	 * @brief BLAS builds dequantize compact positions themselves through a geometry transform, so the acceleration
+	 * structure ends up in the same space as for full precision vertices.
+	 */
+	void Mesh::CreateDequantTransformBuffer()
+	{
+		VkTransformMatrixKHR transform{};
+		transform.matrix[0][0] = m_DequantScale.x;
+		transform.matrix[1][1] = m_DequantScale.y;
+		transform.matrix[2][2] = m_DequantScale.z;
+		transform.matrix[0][3] = m_DequantOffset.x;
+		transform.matrix[1][3] = m_DequantOffset.y;
+		transform.matrix[2][3] = m_DequantOffset.z;
+
+		Buffer::CreateInfo bufferInfo{};
+		bufferInfo.InstanceSize = sizeof(VkTransformMatrixKHR);
+		bufferInfo.UsageFlags = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+		bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		bufferInfo.Category = MemoryCategory::Mesh;
+		m_DequantTransformBuffer.Init(bufferInfo);
+
+		m_DequantTransformBuffer.Map();
+		m_DequantTransformBuffer.WriteToBuffer(&transform);
+		m_DequantTransformBuffer.Unmap();
+	}
+
+	/**
+	 * @brief Uploads meshlets, their vertex indices and triangles into storage buffers for GPU driven rendering.
+	 */
+	void Mesh::CreateMeshletBuffers(const MeshletData& meshlets)
+	{
+		m_Meshlets = meshlets.Meshlets;
+
+		auto upload = [](Buffer& buffer, const void* data, VkDeviceSize size)
+		{
+			Buffer::CreateInfo bufferInfo{};
+			bufferInfo.InstanceSize = size;
+			bufferInfo.UsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			Buffer stagingBuffer;
+			stagingBuffer.Init(bufferInfo);
+
+			stagingBuffer.Map();
+			stagingBuffer.WriteToBuffer((void*)data);
+
+			bufferInfo.UsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			bufferInfo.Category = MemoryCategory::Mesh;
+			buffer.Init(bufferInfo);
+
+			Buffer::CopyBuffer(stagingBuffer.GetBuffer(), buffer.GetBuffer(), size, 0, 0, Device::GetGraphicsQueue(), 0, Device::GetGraphicsCommandPool());
+		};
+
+		upload(m_MeshletBuffer, meshlets.Meshlets.data(), meshlets.Meshlets.size() * sizeof(Meshlet));
+		upload(m_MeshletVertexBuffer, meshlets.VertexIndices.data(), meshlets.VertexIndices.size() * sizeof(uint32_t));
+		upload(m_MeshletTriangleBuffer, meshlets.Triangles.data(), meshlets.Triangles.size());
 	}
 
 	void Mesh::CreateIndexBuffer(const std::vector<uint32_t>* const  indices, VkBufferUsageFlags customUsageFlags)
@@ -158,8 +353,21 @@ namespace Vulture
 		m_HasIndexBuffer = m_IndexCount > 0;
 		if (!m_HasIndexBuffer) { return; }
 
-		VkDeviceSize bufferSize = sizeof(uint32_t) * m_IndexCount;
-		uint32_t indexSize = sizeof(uint32_t);
+		// Compact meshes use 16 bit indices whenever every vertex can be addressed with them
+		m_IndexType = m_Layout == VertexLayout::Compact && m_VertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+		const void* indexData = indices->data();
+		std::vector<uint16_t> shortIndices;
+		if (m_IndexType == VK_INDEX_TYPE_UINT16)
+		{
+			shortIndices.resize(indices->size());
+			for (int i = 0; i < indices->size(); i++)
+				shortIndices[i] = (uint16_t)(*indices)[i];
+			indexData = shortIndices.data();
+		}
+
+		uint32_t indexSize = GetIndexSize();
+		VkDeviceSize bufferSize = (VkDeviceSize)indexSize * m_IndexCount;
 
 		/*
 			We need to be able to write our index data to memory.
@@ -180,7 +388,7 @@ namespace Vulture
 			This is done by mapping the buffer memory into CPU accessible memory with vkMapMemory.
 		*/
 		stagingBuffer.Map();
-		stagingBuffer.WriteToBuffer((void*)indices->data());
+		stagingBuffer.WriteToBuffer((void*)indexData);
 
 		/*
 			The IndexBuffer is now allocated from a memory type that is device
@@ -209,6 +417,16 @@ namespace Vulture
 		m_VertexCount = 0;
 		m_HasIndexBuffer = false;
 		m_IndexCount = 0;
+		m_LODs.clear();
+		m_Meshlets.clear();
+		m_BoundingSphereCenter = glm::vec3(0.0f);
+		m_BoundingSphereRadius = 0.0f;
+		m_BoundingBoxMin = glm::vec3(0.0f);
+		m_BoundingBoxMax = glm::vec3(0.0f);
+		m_Layout = VertexLayout::Full;
+		m_IndexType = VK_INDEX_TYPE_UINT32;
+		m_DequantScale = glm::vec3(1.0f);
+		m_DequantOffset = glm::vec3(0.0f);
 		m_Initialized = false;
 	}
 
@@ -222,6 +440,20 @@ namespace Vulture
 		m_HasIndexBuffer = std::move(other.m_HasIndexBuffer);
 		m_IndexBuffer = std::move(other.m_IndexBuffer);
 		m_IndexCount = std::move(other.m_IndexCount);
+		m_LODs = std::move(other.m_LODs);
+		m_Meshlets = std::move(other.m_Meshlets);
+		m_MeshletBuffer = std::move(other.m_MeshletBuffer);
+		m_MeshletVertexBuffer = std::move(other.m_MeshletVertexBuffer);
+		m_MeshletTriangleBuffer = std::move(other.m_MeshletTriangleBuffer);
+		m_BoundingSphereCenter = std::move(other.m_BoundingSphereCenter);
+		m_BoundingSphereRadius = std::move(other.m_BoundingSphereRadius);
+		m_BoundingBoxMin = std::move(other.m_BoundingBoxMin);
+		m_BoundingBoxMax = std::move(other.m_BoundingBoxMax);
+		m_Layout = std::move(other.m_Layout);
+		m_IndexType = std::move(other.m_IndexType);
+		m_DequantScale = std::move(other.m_DequantScale);
+		m_DequantOffset = std::move(other.m_DequantOffset);
+		m_DequantTransformBuffer = std::move(other.m_DequantTransformBuffer);
 		m_Initialized = std::move(other.m_Initialized);
 
 		other.Reset();
@@ -247,6 +479,20 @@ namespace Vulture
 		m_HasIndexBuffer = std::move(other.m_HasIndexBuffer);
 		m_IndexBuffer = std::move(other.m_IndexBuffer);
 		m_IndexCount = std::move(other.m_IndexCount);
+		m_LODs = std::move(other.m_LODs);
+		m_Meshlets = std::move(other.m_Meshlets);
+		m_MeshletBuffer = std::move(other.m_MeshletBuffer);
+		m_MeshletVertexBuffer = std::move(other.m_MeshletVertexBuffer);
+		m_MeshletTriangleBuffer = std::move(other.m_MeshletTriangleBuffer);
+		m_BoundingSphereCenter = std::move(other.m_BoundingSphereCenter);
+		m_BoundingSphereRadius = std::move(other.m_BoundingSphereRadius);
+		m_BoundingBoxMin = std::move(other.m_BoundingBoxMin);
+		m_BoundingBoxMax = std::move(other.m_BoundingBoxMax);
+		m_Layout = std::move(other.m_Layout);
+		m_IndexType = std::move(other.m_IndexType);
+		m_DequantScale = std::move(other.m_DequantScale);
+		m_DequantOffset = std::move(other.m_DequantOffset);
+		m_DequantTransformBuffer = std::move(other.m_DequantTransformBuffer);
 		m_Initialized = std::move(other.m_Initialized);
 
 		other.Reset();
@@ -265,15 +511,17 @@ namespace Vulture
 
 		if (m_HasIndexBuffer) 
 		{ 
-			vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.GetBuffer(), 0, m_IndexType);
 		}
 	}
 
-	void Mesh::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
+	void Mesh::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod)
 	{
 		if (m_HasIndexBuffer)
 		{ 
-			vkCmdDrawIndexed(commandBuffer, (uint32_t)m_IndexCount, instanceCount, 0, 0, firstInstance); 
+			// LOD 0 goes through m_IndexCount since it can be changed from outside, see Text
+			const uint32_t indexCount = lod == 0 ? (uint32_t)m_IndexCount : m_LODs[lod].IndexCount;
+			vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, m_LODs[lod].IndexOffset, 0, firstInstance); 
 		}
 		else 
 		{ 
@@ -281,6 +529,47 @@ namespace Vulture
 		}
 	}
 
+	/**
+	 * @brief Picks the coarsest LOD whose error stays under pixelError once projected on the screen.
+	 *
+	 * @param camera - Camera the mesh is rendered with.
+	 * @param transform - Model matrix of the mesh.
+	 * @param viewportHeight - Height of the render target in pixels.
+	 * @param pixelError - Allowed screen space deviation in pixels.
+	 */
+	uint32_t Mesh::SelectLOD(const PerspectiveCamera& camera, const glm::mat4& transform, float viewportHeight, float pixelError) const
+	{
+		if (m_LODs.size() <= 1)
+			return 0;
+
+		const glm::vec3 cameraPosition = glm::vec3(glm::inverse(camera.ViewMat)[3]);
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(m_BoundingSphereCenter, 1.0f));
+		const float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		// Distance to the closest point of the bounding sphere
+		const float distance = glm::length(center - cameraPosition) - m_BoundingSphereRadius * scale;
+		if (distance <= 0.0f)
+			return 0;
+
+		const float pixelsPerUnit = scale * viewportHeight / (2.0f * distance * glm::tan(glm::radians(camera.FOV) * 0.5f));
+
+		uint32_t lod = 0;
+		for (uint32_t i = 1; i < (uint32_t)m_LODs.size(); i++)
+		{
+			if (m_LODs[i].Error * pixelsPerUnit > pixelError)
+				break;
+
+			lod = i;
+		}
+
+		return lod;
+	}
+
+	uint64_t Mesh::GetTotalIndexCount() const
+	{
+		return m_LODs.size() > 1 ? (uint64_t)m_LODs.back().IndexOffset + m_LODs.back().IndexCount : m_IndexCount;
+	}
+
 	/**
 	 * @brief Specifies how many vertex buffers we wish to bind to our pipeline. In this case there is only one with all data packed inside it
 	*/
@@ -308,14 +597,308 @@ namespace Vulture
 		return attributeDescriptions;
 	}
 
+	std::vector<VkVertexInputBindingDescription> Mesh::CompactVertex::GetBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescription(1);
+		bindingDescription[0].binding = 0;
+		bindingDescription[0].stride = sizeof(CompactVertex);
+		bindingDescription[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	/**
+	 * @brief Specifies layout of data inside compact vertex buffer. Position has to be dequantized and normal
+	 * octahedral decoded in the vertex shader, TexCoord is read as a regular vec2.
+	*/
+	std::vector<VkVertexInputAttributeDescription> Mesh::CompactVertex::GetAttributeDescriptions()
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		attributeDescriptions.reserve(3);
+		attributeDescriptions.emplace_back(VkVertexInputAttributeDescription{ 0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompactVertex, Position) });
+		attributeDescriptions.emplace_back(VkVertexInputAttributeDescription{ 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, Normal) });
+		attributeDescriptions.emplace_back(VkVertexInputAttributeDescription{ 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, TexCoord) });
+
+		return attributeDescriptions;
+	}
+
+	std::vector<VkVertexInputBindingDescription> Mesh::GetBindingDescriptions(VertexLayout layout)
+	{
+		return layout == VertexLayout::Compact ? CompactVertex::GetBindingDescriptions() : Vertex::GetBindingDescriptions();
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Mesh::GetAttributeDescriptions(VertexLayout layout)
+	{
+		return layout == VertexLayout::Compact ? CompactVertex::GetAttributeDescriptions() : Vertex::GetAttributeDescriptions();
+	}
+
+	/**
+	 * @brief Converts vertices into the compact layout. Positions are quantized inside the bounding box of the mesh.
+	 *
+	 * @param vertices - Full precision vertices.
+	 * @param outVertices - Compact vertices.
+	 * @param outScale - Half extent of the bounding box, position = offset + scale * snorm.
+	 * @param outOffset - Center of the bounding box.
+	 */
+	void Mesh::EncodeVertices(const std::vector<Vertex>& vertices, std::vector<CompactVertex>& outVertices, glm::vec3& outScale, glm::vec3& outOffset)
+	{
+		glm::vec3 min(std::numeric_limits<float>::max());
+		glm::vec3 max(std::numeric_limits<float>::lowest());
+		for (const Vertex& vertex : vertices)
+		{
+			min = glm::min(min, vertex.Position);
+			max = glm::max(max, vertex.Position);
+		}
+
+		if (vertices.empty())
+		{
+			min = glm::vec3(0.0f);
+			max = glm::vec3(0.0f);
+		}
+
+		outOffset = (min + max) * 0.5f;
+		outScale = glm::max((max - min) * 0.5f, glm::vec3(1e-6f)); // Flat meshes would divide by 0 otherwise
+
+		outVertices.resize(vertices.size());
+		for (int i = 0; i < vertices.size(); i++)
+		{
+			const glm::vec3 position = (vertices[i].Position - outOffset) / outScale;
+			const glm::vec2 normal = OctahedralEncode(vertices[i].Normal);
+
+			CompactVertex& vertex = outVertices[i];
+			vertex.Position[0] = ToSnorm16(position.x);
+			vertex.Position[1] = ToSnorm16(position.y);
+			vertex.Position[2] = ToSnorm16(position.z);
+			vertex.Position[3] = 0;
+			vertex.Normal[0] = ToSnorm16(normal.x);
+			vertex.Normal[1] = ToSnorm16(normal.y);
+			vertex.TexCoord[0] = glm::packHalf1x16(vertices[i].TexCoord.x);
+			vertex.TexCoord[1] = glm::packHalf1x16(vertices[i].TexCoord.y);
+		}
+	}
+
+	void Mesh::DecodeVertices(const std::vector<CompactVertex>& vertices, const glm::vec3& scale, const glm::vec3& offset, std::vector<Vertex>& outVertices)
+	{
+		outVertices.resize(vertices.size());
+		for (int i = 0; i < vertices.size(); i++)
+		{
+			const CompactVertex& vertex = vertices[i];
+			outVertices[i].Position = offset + scale * glm::vec3(FromSnorm16(vertex.Position[0]), FromSnorm16(vertex.Position[1]), FromSnorm16(vertex.Position[2]));
+			outVertices[i].Normal = OctahedralDecode(glm::vec2(FromSnorm16(vertex.Normal[0]), FromSnorm16(vertex.Normal[1])));
+			outVertices[i].TexCoord = glm::vec2(glm::unpackHalf1x16(vertex.TexCoord[0]), glm::unpackHalf1x16(vertex.TexCoord[1]));
+		}
+	}
+
+	/**
+	 * @brief Compares memory of full and compact layouts on synthetic spheres and measures encoding, decoding and
+	 * quantization error. Results are logged. Frame time depends on the pipelines of the application, measure it with
+	 * GpuProfiler scopes after switching SetDefaultVertexLayout.
+	 *
+	 * @param vertexCounts - Approximate vertex counts of the spheres.
+	 */
+	void Mesh::RunVertexLayoutBenchmark(const std::vector<uint32_t>& vertexCounts)
+	{
+		VL_CORE_INFO("Vertex layout benchmark");
+		for (uint32_t vertexCount : vertexCounts)
+		{
+			const uint32_t columns = glm::max((uint32_t)glm::sqrt((float)vertexCount * 2.0f), 4u);
+			const uint32_t rows = glm::max(vertexCount / columns, 3u);
+
+			std::vector<Vertex> vertices((uint64_t)rows * columns);
+			for (uint32_t y = 0; y < rows; y++)
+			{
+				for (uint32_t x = 0; x < columns; x++)
+				{
+					const glm::vec2 uv((float)x / (columns - 1), (float)y / (rows - 1));
+					const float theta = uv.y * glm::pi<float>();
+					const float phi = uv.x * glm::two_pi<float>();
+					const glm::vec3 normal(glm::sin(theta) * glm::cos(phi), glm::cos(theta), glm::sin(theta) * glm::sin(phi));
+
+					Vertex& vertex = vertices[(uint64_t)y * columns + x];
+					vertex.Position = normal * 25.0f + glm::vec3(100.0f, -3.0f, 40.0f);
+					vertex.Normal = normal;
+					vertex.TexCoord = uv * 4.0f;
+				}
+			}
+
+			std::vector<uint32_t> indices;
+			indices.reserve((uint64_t)(rows - 1) * (columns - 1) * 6);
+			for (uint32_t y = 0; y < rows - 1; y++)
+			{
+				for (uint32_t x = 0; x < columns - 1; x++)
+				{
+					const uint32_t i = y * columns + x;
+					indices.insert(indices.end(), { i, i + columns, i + 1, i + 1, i + columns, i + columns + 1 });
+				}
+			}
+
+			std::vector<CompactVertex> compact;
+			glm::vec3 scale, offset;
+			Timer timer;
+			EncodeVertices(vertices, compact, scale, offset);
+			const float encodeMs = timer.ElapsedMillis();
+
+			std::vector<Vertex> decoded;
+			timer.Reset();
+			DecodeVertices(compact, scale, offset, decoded);
+			const float decodeMs = timer.ElapsedMillis();
+
+			float positionError = 0.0f, normalError = 0.0f, texCoordError = 0.0f;
+			for (uint64_t i = 0; i < vertices.size(); i++)
+			{
+				positionError = glm::max(positionError, glm::length(vertices[i].Position - decoded[i].Position));
+				normalError = glm::max(normalError, glm::acos(glm::clamp(glm::dot(vertices[i].Normal, decoded[i].Normal), -1.0f, 1.0f)));
+				texCoordError = glm::max(texCoordError, glm::length(vertices[i].TexCoord - decoded[i].TexCoord));
+			}
+
+			const uint32_t compactIndexSize = vertices.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+			const double fullKB = (vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t)) / 1024.0;
+			const double compactKB = (vertices.size() * sizeof(CompactVertex) + indices.size() * compactIndexSize) / 1024.0;
+
+			VL_CORE_INFO("    {:>8} vertices  full {:10.1f}KB  compact {:10.1f}KB ({:.2f}x)  encode {:7.2f}ms  decode {:7.2f}ms",
+				vertices.size(), fullKB, compactKB, fullKB / compactKB, encodeMs, decodeMs);
+			VL_CORE_INFO("    {:>8} max error  position {:.5f} ({:.5f} of radius)  normal {:.4f} deg  uv {:.6f}",
+				"", positionError, positionError / 25.0f, glm::degrees(normalError), texCoordError);
+		}
+	}
+
+	/**
+	 * @brief Reads buffers in one submission, or one by one when the readback service isn't running.
+	 */
+	void Mesh::ReadBuffers(const std::vector<BufferReadback::Request>& requests)
+	{
+		if (BufferReadback::IsInitialized())
+		{
+			BufferReadback::Read(requests);
+			return;
+		}
+
+		for (const BufferReadback::Request& request : requests)
+		{
+			if (request.Size != 0)
+				request.Source->ReadFromBuffer(request.Destination, request.Size, request.Offset);
+		}
+	}
+
+	/**
+	 * @brief Reads vertex and index buffers back from the GPU, compact vertices and 16 bit indices are expanded.
+	 * Indices of all LODs are returned, one after another. Meshlets are read in the same submission when
+	 * outMeshlets is given, so the whole mesh is read back with a single wait.
+	 */
+	void Mesh::ReadVertices(std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices, MeshletData* outMeshlets)
+	{
+		ReadbackData data;
+		std::vector<BufferReadback::Request> requests;
+		AddReadRequests(data, requests, outMeshlets != nullptr);
+
+		ReadBuffers(requests);
+		FinishRead(data);
+
+		outVertices = std::move(data.Vertices);
+		outIndices = std::move(data.Indices);
+		if (outMeshlets != nullptr)
+			*outMeshlets = std::move(data.Meshlets);
+	}
+
+	/**
+	 * @brief Appends requests that read the whole mesh into outData, so that several meshes can be read back in
+	 * one submission. Call FinishRead() once the requests completed.
+	 *
+	 * @param outData - Has to stay at the same address until the requests complete.
+	 * @param meshlets - Whether meshlet buffers are read as well.
+	 */
+	void Mesh::AddReadRequests(ReadbackData& outData, std::vector<BufferReadback::Request>& requests, bool meshlets)
+	{
+		if (m_Layout == VertexLayout::Compact)
+		{
+			outData.CompactVertices.resize(m_VertexCount);
+			requests.push_back({ &m_VertexBuffer, outData.CompactVertices.data(), outData.CompactVertices.size() * sizeof(CompactVertex), 0 });
+		}
+		else
+		{
+			outData.Vertices.resize(m_VertexCount);
+			requests.push_back({ &m_VertexBuffer, outData.Vertices.data(), outData.Vertices.size() * sizeof(Vertex), 0 });
+		}
+
+		const uint64_t indexCount = m_HasIndexBuffer ? GetTotalIndexCount() : 0;
+		outData.Indices.resize(indexCount);
+		if (indexCount > 0)
+		{
+			if (m_IndexType == VK_INDEX_TYPE_UINT16)
+			{
+				outData.ShortIndices.resize(indexCount);
+				requests.push_back({ &m_IndexBuffer, outData.ShortIndices.data(), outData.ShortIndices.size() * sizeof(uint16_t), 0 });
+			}
+			else
+			{
+				requests.push_back({ &m_IndexBuffer, outData.Indices.data(), outData.Indices.size() * sizeof(uint32_t), 0 });
+			}
+		}
+
+		if (meshlets)
+			AddMeshletReadRequests(outData.Meshlets, requests);
+	}
+
+	/**
+	 * @brief Expands compact vertices and 16 bit indices of a completed read.
+	 */
+	void Mesh::FinishRead(ReadbackData& data) const
+	{
+		if (m_Layout == VertexLayout::Compact)
+		{
+			DecodeVertices(data.CompactVertices, m_DequantScale, m_DequantOffset, data.Vertices);
+			data.CompactVertices = {};
+		}
+
+		for (size_t i = 0; i < data.ShortIndices.size(); i++)
+			data.Indices[i] = data.ShortIndices[i];
+		data.ShortIndices = {};
+	}
+
+	/**
+	 * @brief Reads meshlet buffers back from the GPU, leaves outMeshlets empty for meshes without meshlets.
+	 */
+	void Mesh::ReadMeshlets(MeshletData& outMeshlets)
+	{
+		std::vector<BufferReadback::Request> requests;
+		AddMeshletReadRequests(outMeshlets, requests);
+
+		ReadBuffers(requests);
+	}
+
+	void Mesh::AddMeshletReadRequests(MeshletData& outMeshlets, std::vector<BufferReadback::Request>& requests)
+	{
+		outMeshlets = {};
+		if (m_Meshlets.empty())
+			return;
+
+		outMeshlets.Meshlets = m_Meshlets;
+
+		outMeshlets.VertexIndices.resize(m_MeshletVertexBuffer.GetBufferSize() / sizeof(uint32_t));
+		requests.push_back({ &m_MeshletVertexBuffer, outMeshlets.VertexIndices.data(), outMeshlets.VertexIndices.size() * sizeof(uint32_t), 0 });
+
+		outMeshlets.Triangles.resize(m_MeshletTriangleBuffer.GetBufferSize());
+		requests.push_back({ &m_MeshletTriangleBuffer, outMeshlets.Triangles.data(), outMeshlets.Triangles.size(), 0 });
+	}
+
 	void Mesh::UpdateVertexBuffer(const std::vector<Vertex>& vertices, int offset, VkCommandBuffer cmd)
 	{
-		vkCmdUpdateBuffer(cmd, m_VertexBuffer.GetBuffer(), offset, sizeof(vertices[0]) * vertices.size(), vertices.data());
+		VL_CORE_ASSERT(m_Layout == VertexLayout::Full, "Only meshes with full vertex layout can be updated!");
+		const VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
+		if (FrameAllocator::IsFrameActive())
+			FrameAllocator::CmdCopyToBuffer(cmd, m_VertexBuffer.GetBuffer(), offset, vertices.data(), size);
+		else
+			vkCmdUpdateBuffer(cmd, m_VertexBuffer.GetBuffer(), offset, size, vertices.data());
 	}
 
 	void Mesh::UpdateIndexBuffer(const std::vector<uint32_t>& indices, int offset, VkCommandBuffer cmd /*= 0*/)
 	{
-		vkCmdUpdateBuffer(cmd, m_IndexBuffer.GetBuffer(), offset, sizeof(indices[0]) * indices.size(), indices.data());
+		VL_CORE_ASSERT(m_IndexType == VK_INDEX_TYPE_UINT32, "Only meshes with 32 bit indices can be updated!");
+		const VkDeviceSize size = sizeof(indices[0]) * indices.size();
+		if (FrameAllocator::IsFrameActive())
+			FrameAllocator::CmdCopyToBuffer(cmd, m_IndexBuffer.GetBuffer(), offset, indices.data(), size);
+		else
+			vkCmdUpdateBuffer(cmd, m_IndexBuffer.GetBuffer(), offset, size, indices.data());
 	}
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "Vulkan/Buffer.h"
+#include "Vulkan/BufferReadback.h"
 #include "../Utility/Utility.h"
 #include "glm/glm.hpp"
 
@@ -10,6 +11,14 @@
 
 namespace Vulture
 {
+	enum class VertexLayout
+	{
+		Full,		// Mesh::Vertex, 32 bytes of float position, normal and UV. Uses 32 bit indices
+		Compact,	// Mesh::CompactVertex, 16 bytes. Uses 16 bit indices when there are at most 65536 vertices
+	};
+
+	class PerspectiveCamera;
+
 	class Mesh
 	{
 	public:
@@ -23,6 +32,62 @@ namespace Vulture
 			static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
 		};
 
+		// Position is quantized to SNORM16 inside mesh bounds, shaders dequantize it with GetDequantScale() and GetDequantOffset().
+		// Normal is octahedral encoded into SNORM16x2, TexCoord is half float.
+		struct CompactVertex
+		{
+			int16_t Position[4]; // w is padding
+			int16_t Normal[2];
+			uint16_t TexCoord[2];
+
+			static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+		};
+
+		// Range of the index buffer holding one level of detail, all LODs index into the same vertex buffer
+		struct LOD
+		{
+			uint32_t IndexOffset = 0;
+			uint32_t IndexCount = 0;
+			float Error = 0.0f; // Maximal deviation from LOD 0 surface, in mesh units
+		};
+
+		// Cluster of at most 64 vertices and 124 triangles, laid out for std430 storage buffers
+		struct Meshlet
+		{
+			uint32_t VertexOffset = 0;		// Into meshlet vertex index buffer
+			uint32_t TriangleOffset = 0;	// In bytes into meshlet triangle buffer, always a multiple of 4
+			uint32_t VertexCount = 0;
+			uint32_t TriangleCount = 0;
+
+			glm::vec3 Center = glm::vec3(0.0f);	// Bounding sphere
+			float Radius = 0.0f;
+
+			glm::vec3 ConeAxis = glm::vec3(0.0f);	// Normal cone, zero axis when the cluster can't be backface culled
+			float ConeCutoff = 1.0f;
+
+			glm::vec3 ConeApex = glm::vec3(0.0f);
+			float Padding = 0.0f;
+		};
+
+		struct MeshletData
+		{
+			std::vector<Meshlet> Meshlets;
+			std::vector<uint32_t> VertexIndices;	// Meshlet local vertex -> mesh vertex
+			std::vector<uint8_t> Triangles;			// 3 local vertex indices per triangle
+		};
+
+		// Destination of a read batched with other meshes, see AddReadRequests()
+		struct ReadbackData
+		{
+			std::vector<Vertex> Vertices;
+			std::vector<uint32_t> Indices;
+			MeshletData Meshlets;
+
+			std::vector<CompactVertex> CompactVertices; // Expanded into Vertices by FinishRead()
+			std::vector<uint16_t> ShortIndices; // Expanded into Indices by FinishRead()
+		};
+
 		struct CreateInfo
 		{
 			const std::vector<Vertex>* Vertices = nullptr;
@@ -30,6 +95,14 @@ namespace Vulture
 
 			VkBufferUsageFlags VertexUsageFlags = 0;
 			VkBufferUsageFlags IndexUsageFlags = 0;
+
+			VertexLayout Layout = VertexLayout::Full;
+
+			bool Optimize = false;			// Run MeshOptimizer on the data before upload, Indices have to be a triangle list
+			bool OptimizeOverdraw = true;	// Disable when triangle order matters, e.g. blended meshes
+
+			const std::vector<LOD>* LODs = nullptr; // Ranges of Indices, LOD 0 has to start at 0. Null means Indices are a single LOD
+			const MeshletData* Meshlets = nullptr; // Clusters of LOD 0, optional
 		};
 
 		void Init(const CreateInfo& createInfo);
@@ -47,22 +120,66 @@ namespace Vulture
 		Mesh& operator=(Mesh&& other) noexcept;
 
 		void Bind(VkCommandBuffer commandBuffer);
-		void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance = 0);
+		void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance = 0, uint32_t lod = 0);
+
+		uint32_t SelectLOD(const PerspectiveCamera& camera, const glm::mat4& transform, float viewportHeight, float pixelError = 1.0f) const;
 
 		void UpdateVertexBuffer(const std::vector<Vertex>& vertices, int offset, VkCommandBuffer cmd = 0);
 		void UpdateIndexBuffer(const std::vector<uint32_t>& indices, int offset, VkCommandBuffer cmd = 0);
 
+		void ReadVertices(std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices, MeshletData* outMeshlets = nullptr);
+		void ReadMeshlets(MeshletData& outMeshlets);
+		void AddReadRequests(ReadbackData& outData, std::vector<BufferReadback::Request>& requests, bool meshlets = true);
+		void FinishRead(ReadbackData& data) const;
+		static void ReadBuffers(const std::vector<BufferReadback::Request>& requests);
+		static void ReadAssimpMesh(aiMesh* mesh, const glm::mat4& mat, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices);
+
+		static void EncodeVertices(const std::vector<Vertex>& vertices, std::vector<CompactVertex>& outVertices, glm::vec3& outScale, glm::vec3& outOffset);
+		static void DecodeVertices(const std::vector<CompactVertex>& vertices, const glm::vec3& scale, const glm::vec3& offset, std::vector<Vertex>& outVertices);
+
+		static void RunVertexLayoutBenchmark(const std::vector<uint32_t>& vertexCounts = { 65536, 1 << 20 });
+
+		static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexLayout layout);
+		static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexLayout layout);
+
+		// Layout used by meshes imported from model files and deserialized from scenes. Stays Full unless the application
+		// switches it, pipelines drawing or tracing Compact meshes have to decode them with Shaders/CompactVertex.glsl
+		static inline void SetDefaultVertexLayout(VertexLayout layout) { s_DefaultLayout = layout; }
+		static inline VertexLayout GetDefaultVertexLayout() { return s_DefaultLayout; }
+
 		inline const Buffer* GetVertexBuffer() const { return &m_VertexBuffer; }
 		inline Buffer* GetVertexBuffer() { return &m_VertexBuffer; }
 
 		inline const Buffer* GetIndexBuffer() const { return &m_IndexBuffer; }
 		inline Buffer* GetIndexBuffer() { return &m_IndexBuffer; }
 
-		inline uint64_t& GetIndexCount() { return m_IndexCount; }
+		inline uint64_t& GetIndexCount() { return m_IndexCount; } // LOD 0 only
+		uint64_t GetTotalIndexCount() const;
 		inline uint64_t& GetVertexCount() { return m_VertexCount; }
 
 		inline bool& HasIndexBuffer() { return m_HasIndexBuffer; }
 
+		inline VertexLayout GetVertexLayout() const { return m_Layout; }
+		inline uint32_t GetVertexStride() const { return m_Layout == VertexLayout::Compact ? sizeof(CompactVertex) : sizeof(Vertex); }
+		inline VkIndexType GetIndexType() const { return m_IndexType; }
+		inline uint32_t GetIndexSize() const { return m_IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+		inline glm::vec3 GetDequantScale() const { return m_DequantScale; }
+		inline glm::vec3 GetDequantOffset() const { return m_DequantOffset; }
+		inline const Buffer* GetDequantTransformBuffer() const { return &m_DequantTransformBuffer; }
+
+		inline uint32_t GetLODCount() const { return (uint32_t)m_LODs.size(); }
+		inline const LOD& GetLOD(uint32_t lod) const { return m_LODs[lod]; }
+		inline bool HasMeshlets() const { return !m_Meshlets.empty(); }
+		inline const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
+		inline const Buffer* GetMeshletBuffer() const { return &m_MeshletBuffer; }
+		inline const Buffer* GetMeshletVertexBuffer() const { return &m_MeshletVertexBuffer; }
+		inline const Buffer* GetMeshletTriangleBuffer() const { return &m_MeshletTriangleBuffer; }
+
+		inline glm::vec3 GetBoundingSphereCenter() const { return m_BoundingSphereCenter; }
+		inline float GetBoundingSphereRadius() const { return m_BoundingSphereRadius; }
+		inline glm::vec3 GetBoundingBoxMin() const { return m_BoundingBoxMin; }
+		inline glm::vec3 GetBoundingBoxMax() const { return m_BoundingBoxMax; }
+
 		inline bool IsInitialized() const { return m_Initialized; }
 	private:
 		
@@ -71,6 +188,9 @@ namespace Vulture
 
 		void CreateVertexBuffer(const std::vector<Vertex>* const vertices, VkBufferUsageFlags customUsageFlags = 0);
 		void CreateIndexBuffer(const std::vector<uint32_t>* const indices, VkBufferUsageFlags customUsageFlags = 0);
+		void CreateDequantTransformBuffer();
+		void CreateMeshletBuffers(const MeshletData& meshlets);
+		void AddMeshletReadRequests(MeshletData& outMeshlets, std::vector<BufferReadback::Request>& requests);
 		
 		Buffer m_VertexBuffer;
 		uint64_t m_VertexCount = 0;
@@ -78,6 +198,25 @@ namespace Vulture
 		bool m_HasIndexBuffer = false;
 		Buffer m_IndexBuffer;
 		uint64_t m_IndexCount = 0;
+		std::vector<LOD> m_LODs;
+
+		glm::vec3 m_BoundingSphereCenter = glm::vec3(0.0f);
+		float m_BoundingSphereRadius = 0.0f;
+		glm::vec3 m_BoundingBoxMin = glm::vec3(0.0f);
+		glm::vec3 m_BoundingBoxMax = glm::vec3(0.0f);
+
+		std::vector<Meshlet> m_Meshlets; // CPU copy for culling
+		Buffer m_MeshletBuffer;
+		Buffer m_MeshletVertexBuffer;
+		Buffer m_MeshletTriangleBuffer;
+
+		VertexLayout m_Layout = VertexLayout::Full;
+		VkIndexType m_IndexType = VK_INDEX_TYPE_UINT32;
+		glm::vec3 m_DequantScale = glm::vec3(1.0f);
+		glm::vec3 m_DequantOffset = glm::vec3(0.0f);
+		Buffer m_DequantTransformBuffer; // Ray tracing only, 3x4 transform applied to positions during BLAS builds
+
+		inline static VertexLayout s_DefaultLayout = VertexLayout::Full;
 
 		bool m_Initialized = false;
 
@@ -0,0 +1,413 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+namespace Vulture
+{
+	static uint32_t HashVertex(const Mesh::Vertex& vertex)
+	{
+		static_assert(sizeof(Mesh::Vertex) % sizeof(uint32_t) == 0);
+
+		uint32_t words[sizeof(Mesh::Vertex) / sizeof(uint32_t)];
+		memcpy(words, &vertex, sizeof(Mesh::Vertex));
+
+		uint32_t hash = 2166136261u;
+		for (uint32_t word : words)
+		{
+			hash ^= word;
+			hash *= 16777619u;
+		}
+
+		// FNV alone mixes the high bits poorly and the table is indexed with the low ones
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6bu;
+		hash ^= hash >> 13;
+
+		return hash;
+	}
+
+	MeshOptimizer::Stats& MeshOptimizer::Stats::operator+=(const Stats& other)
+	{
+		TriangleCount += other.TriangleCount;
+		VertexCount += other.VertexCount;
+		TransformCount += other.TransformCount;
+
+		return *this;
+	}
+
+	/**
+	 * @brief Runs every pass on a triangle list. Meshes that aren't triangle lists are left untouched.
+	 *
+	 * @param vertices - Vertices, welded and reordered in place.
+	 * @param indices - Triangle list indices, reordered in place.
+	 * @param optimizeOverdraw - Whether to sort triangle clusters for overdraw. Disable for meshes
+	 * where triangle order matters, e.g. blended ones.
+	 *
+	 * @return Cache statistics before and after the optimization.
+	 */
+	MeshOptimizer::Result MeshOptimizer::Optimize(std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices, bool optimizeOverdraw)
+	{
+		Result result{};
+		result.Before = Analyze(indices, vertices.size());
+
+		if (indices.empty() || indices.size() % 3 != 0)
+		{
+			result.After = result.Before;
+			return result;
+		}
+
+		WeldVertices(vertices, indices);
+
+		std::vector<uint32_t> clusters;
+		OptimizeVertexCache(indices, vertices.size(), &clusters);
+
+		if (optimizeOverdraw)
+			OptimizeOverdraw(indices, vertices, clusters);
+
+		OptimizeVertexFetch(vertices, indices);
+
+		result.After = Analyze(indices, vertices.size());
+		return result;
+	}
+
+	/**
+	 * @brief Simulates a FIFO post transform cache of given size.
+	 *
+	 * @param indices - Triangle list indices.
+	 * @param vertexCount - Number of vertices the indices point into.
+	 * @param cacheSize - Number of vertices in the cache.
+	 */
+	MeshOptimizer::Stats MeshOptimizer::Analyze(const std::vector<uint32_t>& indices, uint64_t vertexCount, uint32_t cacheSize)
+	{
+		Stats stats{};
+		stats.TriangleCount = indices.size() / 3;
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32_t time = cacheSize + 1;
+
+		for (uint32_t index : indices)
+		{
+			if (!referenced[index])
+			{
+				referenced[index] = true;
+				stats.VertexCount++;
+			}
+
+			if (time - cacheTime[index] > cacheSize)
+			{
+				cacheTime[index] = time++;
+				stats.TransformCount++;
+			}
+		}
+
+		return stats;
+	}
+
+	/**
+	 * @brief Merges vertices that are bitwise identical. Unreferenced vertices are kept,
+	 * OptimizeVertexFetch() removes them.
+	 */
+	void MeshOptimizer::WeldVertices(std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		if (vertices.empty())
+			return;
+
+		uint64_t tableSize = 16;
+		while (tableSize < vertices.size() * 2)
+			tableSize *= 2;
+
+		// Open addressing table of indices into uniqueVertices
+		std::vector<uint32_t> table(tableSize, UINT32_MAX);
+		std::vector<uint32_t> remap(vertices.size());
+		std::vector<Mesh::Vertex> uniqueVertices;
+		uniqueVertices.reserve(vertices.size());
+
+		for (uint64_t i = 0; i < vertices.size(); i++)
+		{
+			uint64_t slot = HashVertex(vertices[i]) & (tableSize - 1);
+			while (table[slot] != UINT32_MAX && memcmp(&uniqueVertices[table[slot]], &vertices[i], sizeof(Mesh::Vertex)) != 0)
+				slot = (slot + 1) & (tableSize - 1);
+
+			if (table[slot] == UINT32_MAX)
+			{
+				table[slot] = (uint32_t)uniqueVertices.size();
+				uniqueVertices.push_back(vertices[i]);
+			}
+
+			remap[i] = table[slot];
+		}
+
+		for (uint32_t& index : indices)
+			index = remap[index];
+
+		vertices = std::move(uniqueVertices);
+	}
+
+	/**
+	 * @brief Reorders triangles for the post transform cache using Tipsify (Sander et al. 2007).
+	 * Triangles are emitted in fans around a vertex, the next fan is the one around the vertex that
+	 * will still be in the cache after it's processed.
+	 *
+	 * @param indices - Triangle list indices, reordered in place.
+	 * @param vertexCount - Number of vertices the indices point into.
+	 * @param outClusters - Optional, receives the first triangle of every cluster. A cluster ends when
+	 * the algorithm hits a dead end and has to jump to a vertex that's not in the cache anymore.
+	 * @param cacheSize - Number of vertices in the cache.
+	 */
+	void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint64_t vertexCount, std::vector<uint32_t>* outClusters, uint32_t cacheSize)
+	{
+		if (outClusters)
+			outClusters->clear();
+
+		const uint64_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Vertex to triangle adjacency
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices)
+			liveTriangles[index]++;
+
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (uint64_t i = 0; i < vertexCount; i++)
+			offsets[i + 1] = offsets[i] + liveTriangles[i];
+
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (uint64_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEndStack;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		uint32_t time = cacheSize + 1;
+		uint64_t cursor = 0;
+
+		auto skipDeadEnd = [&]() -> int64_t
+		{
+			// Prefer recently used vertices, they're the most likely to still be in the cache
+			while (!deadEndStack.empty())
+			{
+				const uint32_t vertex = deadEndStack.back();
+				deadEndStack.pop_back();
+				if (liveTriangles[vertex] > 0)
+					return vertex;
+			}
+
+			while (cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+					return (int64_t)cursor;
+				cursor++;
+			}
+
+			return -1;
+		};
+
+		if (outClusters)
+			outClusters->push_back(0);
+
+		int64_t current = skipDeadEnd();
+		while (current >= 0)
+		{
+			candidates.clear();
+			for (uint32_t i = offsets[current]; i < offsets[current + 1]; i++)
+			{
+				const uint32_t triangle = adjacency[i];
+				if (emitted[triangle])
+					continue;
+
+				emitted[triangle] = true;
+				for (int c = 0; c < 3; c++)
+				{
+					const uint32_t vertex = indices[triangle * 3 + c];
+					result.push_back(vertex);
+					deadEndStack.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+
+					if (time - cacheTime[vertex] > cacheSize)
+						cacheTime[vertex] = time++;
+				}
+			}
+
+			// Pick the oldest candidate that stays in the cache after its own fan is emitted
+			int64_t next = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (liveTriangles[vertex] == 0)
+					continue;
+
+				int64_t priority = 0;
+				if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+					priority = time - cacheTime[vertex];
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+
+			if (next == -1)
+			{
+				next = skipDeadEnd();
+				if (next != -1 && outClusters)
+					outClusters->push_back((uint32_t)(result.size() / 3));
+			}
+
+			current = next;
+		}
+
+		indices = std::move(result);
+	}
+
+	/**
+	 * @brief Sorts triangle clusters so that the ones facing away from the mesh center are drawn first, they're
+	 * the most likely to occlude the rest. Clusters from OptimizeVertexCache() are first split into smaller ones
+	 * wherever that doesn't make their cache efficiency worse than threshold times the original.
+	 *
+	 * @param indices - Triangle list indices, reordered in place.
+	 * @param vertices - Vertices the indices point into.
+	 * @param clusters - First triangle of every cluster, see OptimizeVertexCache().
+	 * @param threshold - Allowed ACMR increase, 1.05 means 5% worse.
+	 * @param cacheSize - Number of vertices in the cache.
+	 */
+	void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Mesh::Vertex>& vertices, const std::vector<uint32_t>& clusters, float threshold, uint32_t cacheSize)
+	{
+		const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+		if (triangleCount == 0)
+			return;
+
+		std::vector<uint32_t> cacheTime(vertices.size(), 0);
+		uint32_t time = cacheSize + 1;
+		auto simulateTriangle = [&](uint32_t triangle)
+		{
+			uint32_t misses = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				const uint32_t vertex = indices[triangle * 3 + c];
+				if (time - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		};
+		auto flushCache = [&]() { time += cacheSize + 1; };
+
+		// Split clusters into smaller ones, each of them starts with an empty cache since they'll be reordered
+		std::vector<uint32_t> softClusters;
+		for (uint64_t i = 0; i < std::max(clusters.size(), (size_t)1); i++)
+		{
+			const uint32_t start = clusters.empty() ? 0 : clusters[i];
+			const uint32_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+			flushCache();
+			uint32_t clusterMisses = 0;
+			for (uint32_t triangle = start; triangle < end; triangle++)
+				clusterMisses += simulateTriangle(triangle);
+			const float clusterACMR = (float)clusterMisses / (float)(end - start);
+
+			flushCache();
+			softClusters.push_back(start);
+			uint32_t subStart = start;
+			uint32_t misses = 0;
+			for (uint32_t triangle = start; triangle < end; triangle++)
+			{
+				misses += simulateTriangle(triangle);
+				if (triangle + 1 < end && (float)misses <= clusterACMR * threshold * (float)(triangle + 1 - subStart))
+				{
+					softClusters.push_back(triangle + 1);
+					subStart = triangle + 1;
+					misses = 0;
+					flushCache();
+				}
+			}
+		}
+
+		// Area weighted centroids and normals
+		std::vector<glm::vec3> clusterCentroids(softClusters.size(), glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(softClusters.size(), glm::vec3(0.0f));
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		for (uint64_t i = 0; i < softClusters.size(); i++)
+		{
+			const uint32_t end = i + 1 < softClusters.size() ? softClusters[i + 1] : triangleCount;
+
+			float clusterArea = 0.0f;
+			for (uint32_t triangle = softClusters[i]; triangle < end; triangle++)
+			{
+				const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].Position;
+				const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].Position;
+				const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].Position;
+
+				const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				const float area = glm::length(normal);
+
+				clusterCentroids[i] += (p0 + p1 + p2) * (area / 3.0f);
+				clusterNormals[i] += normal;
+				clusterArea += area;
+			}
+
+			meshCentroid += clusterCentroids[i];
+			meshArea += clusterArea;
+			clusterCentroids[i] = clusterArea > 0.0f ? clusterCentroids[i] / clusterArea : clusterCentroids[i];
+		}
+		meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+		std::vector<float> sortKeys(softClusters.size());
+		for (uint64_t i = 0; i < softClusters.size(); i++)
+		{
+			const float normalLength = glm::length(clusterNormals[i]);
+			const glm::vec3 normal = normalLength > 0.0f ? clusterNormals[i] / normalLength : glm::vec3(0.0f);
+			sortKeys[i] = glm::dot(clusterCentroids[i] - meshCentroid, normal);
+		}
+
+		std::vector<uint32_t> order(softClusters.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (uint32_t cluster : order)
+		{
+			const uint32_t start = softClusters[cluster];
+			const uint32_t end = cluster + 1 < softClusters.size() ? softClusters[cluster + 1] : triangleCount;
+			result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+		}
+
+		indices = std::move(result);
+	}
+
+	/**
+	 * @brief Reorders vertices in the order they're first referenced by the index buffer so vertex fetches
+	 * are mostly sequential. Vertices that aren't referenced at all are removed.
+	 */
+	void MeshOptimizer::OptimizeVertexFetch(std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Mesh::Vertex> result;
+		result.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = (uint32_t)result.size();
+				result.push_back(vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		vertices = std::move(result);
+	}
+
+}
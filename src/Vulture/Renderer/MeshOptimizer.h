@@ -0,0 +1,48 @@
+#pragma once
+#include "pch.h"
+
+#include "Mesh.h"
+
+namespace Vulture
+{
+	// CPU side optimization of indexed triangle lists. Passes are meant to be run in the order used by Optimize():
+	// weld identical vertices, reorder triangles for the post transform cache (Tipsify), sort triangle clusters
+	// front to back for early depth rejection and finally reorder vertices in the order they're fetched.
+	class MeshOptimizer
+	{
+	public:
+		// Post transform cache statistics, measured by simulating a FIFO cache
+		struct Stats
+		{
+			uint64_t TriangleCount = 0;
+			uint64_t VertexCount = 0;		// Vertices referenced by the index buffer
+			uint64_t TransformCount = 0;	// Cache misses, i.e. vertex shader invocations
+
+			inline float GetACMR() const { return TriangleCount != 0 ? (float)TransformCount / (float)TriangleCount : 0.0f; }
+			inline float GetATVR() const { return VertexCount != 0 ? (float)TransformCount / (float)VertexCount : 0.0f; }
+
+			Stats& operator+=(const Stats& other);
+		};
+
+		struct Result
+		{
+			Stats Before;
+			Stats After;
+		};
+
+		MeshOptimizer() = delete;
+
+		static Result Optimize(std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices, bool optimizeOverdraw = true);
+
+		static Stats Analyze(const std::vector<uint32_t>& indices, uint64_t vertexCount, uint32_t cacheSize = s_CacheSize);
+
+		static void WeldVertices(std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices);
+		static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint64_t vertexCount, std::vector<uint32_t>* outClusters = nullptr, uint32_t cacheSize = s_CacheSize);
+		static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Mesh::Vertex>& vertices, const std::vector<uint32_t>& clusters, float threshold = 1.05f, uint32_t cacheSize = s_CacheSize);
+		static void OptimizeVertexFetch(std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	private:
+		inline static uint32_t s_CacheSize = 16;
+	};
+
+}
@@ -0,0 +1,317 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+namespace Vulture
+{
+	// Symmetric 4x4 matrix of the plane equation, weighted by triangle area
+	struct Quadric
+	{
+		double A2 = 0.0, B2 = 0.0, C2 = 0.0, D2 = 0.0;
+		double AB = 0.0, AC = 0.0, AD = 0.0, BC = 0.0, BD = 0.0, CD = 0.0;
+		double Weight = 0.0;
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			A2 += other.A2; B2 += other.B2; C2 += other.C2; D2 += other.D2;
+			AB += other.AB; AC += other.AC; AD += other.AD; BC += other.BC; BD += other.BD; CD += other.CD;
+			Weight += other.Weight;
+
+			return *this;
+		}
+	};
+
+	static Quadric PlaneQuadric(const glm::vec3& normal, float distance, float weight)
+	{
+		const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+		Quadric quadric;
+		quadric.A2 = a * a * weight; quadric.B2 = b * b * weight; quadric.C2 = c * c * weight; quadric.D2 = d * d * weight;
+		quadric.AB = a * b * weight; quadric.AC = a * c * weight; quadric.AD = a * d * weight;
+		quadric.BC = b * c * weight; quadric.BD = b * d * weight; quadric.CD = c * d * weight;
+		quadric.Weight = weight;
+
+		return quadric;
+	}
+
+	// Mean squared distance of the point from all planes accumulated in the quadric
+	static double EvaluateQuadric(const Quadric& quadric, const glm::vec3& point)
+	{
+		const double x = point.x, y = point.y, z = point.z;
+		const double error =
+			quadric.A2 * x * x + quadric.B2 * y * y + quadric.C2 * z * z + quadric.D2 +
+			2.0 * (quadric.AB * x * y + quadric.AC * x * z + quadric.BC * y * z + quadric.AD * x + quadric.BD * y + quadric.CD * z);
+
+		return quadric.Weight > 0.0 ? glm::max(error, 0.0) / quadric.Weight : 0.0;
+	}
+
+	/**
+	 * @brief Collapses edges in order of increasing cost until the index count drops to the target or the
+	 * cheapest collapse exceeds settings.MaxError.
+	 *
+	 * @param vertices - Vertices of the mesh, they're never modified.
+	 * @param indices - Triangle list to simplify.
+	 * @param targetIndexCount - Desired index count.
+	 * @param settings - Error limit and attribute weights.
+	 * @param outError - Optional, receives the largest deviation introduced, in mesh units.
+	 *
+	 * @return Simplified triangle list indexing into the same vertices.
+	 */
+	std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<Mesh::Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t targetIndexCount, const LODSettings& settings, float* outError)
+	{
+		std::vector<uint32_t> result = indices;
+		if (outError)
+			*outError = 0.0f;
+
+		if (result.size() <= targetIndexCount || vertices.empty())
+			return result;
+
+		// Positions are normalized to a unit box so the error limit and weights don't depend on mesh scale
+		glm::vec3 min(std::numeric_limits<float>::max());
+		glm::vec3 max(std::numeric_limits<float>::lowest());
+		for (const Mesh::Vertex& vertex : vertices)
+		{
+			min = glm::min(min, vertex.Position);
+			max = glm::max(max, vertex.Position);
+		}
+		const float extent = glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z));
+		const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+		std::vector<glm::vec3> positions(vertices.size());
+		for (uint64_t i = 0; i < vertices.size(); i++)
+			positions[i] = (vertices[i].Position - min) * scale;
+
+		std::vector<Quadric> quadrics(vertices.size());
+		for (uint64_t i = 0; i < result.size(); i += 3)
+		{
+			const glm::vec3& p0 = positions[result[i + 0]];
+			const glm::vec3& p1 = positions[result[i + 1]];
+			const glm::vec3& p2 = positions[result[i + 2]];
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+
+			normal /= length;
+			const Quadric quadric = PlaneQuadric(normal, -glm::dot(normal, p0), length * 0.5f);
+			for (int c = 0; c < 3; c++)
+				quadrics[result[i + c]] += quadric;
+		}
+
+		// Every edge that isn't shared by exactly two triangles locks its vertices
+		std::vector<bool> locked(vertices.size(), false);
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeCounts;
+			edgeCounts.reserve(result.size());
+			for (uint64_t i = 0; i < result.size(); i += 3)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					const uint32_t a = result[i + c];
+					const uint32_t b = result[i + (c + 1) % 3];
+					edgeCounts[((uint64_t)glm::min(a, b) << 32) | glm::max(a, b)]++;
+				}
+			}
+
+			for (auto& [edge, count] : edgeCounts)
+			{
+				if (count != 2)
+				{
+					locked[edge >> 32] = true;
+					locked[edge & UINT32_MAX] = true;
+				}
+			}
+		}
+
+		struct Collapse
+		{
+			uint32_t From;
+			uint32_t To;
+			double Cost;
+			double Error;
+		};
+
+		auto computeCollapse = [&](uint32_t from, uint32_t to) -> Collapse
+		{
+			Quadric quadric = quadrics[from];
+			quadric += quadrics[to];
+
+			const double error = EvaluateQuadric(quadric, positions[to]);
+			const glm::vec3 normalDelta = vertices[from].Normal - vertices[to].Normal;
+			const glm::vec2 texCoordDelta = vertices[from].TexCoord - vertices[to].TexCoord;
+			const double attributeCost = settings.NormalWeight * glm::dot(normalDelta, normalDelta) + settings.TexCoordWeight * glm::dot(texCoordDelta, texCoordDelta);
+
+			return { from, to, error + attributeCost, error };
+		};
+
+		const double maxCost = (double)settings.MaxError * settings.MaxError;
+		double maxError = 0.0;
+
+		std::vector<uint32_t> remap(vertices.size());
+		std::iota(remap.begin(), remap.end(), 0);
+
+		std::vector<uint32_t> offsets(vertices.size() + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<Collapse> collapses;
+		std::vector<bool> touched(vertices.size());
+
+		while (result.size() > targetIndexCount)
+		{
+			// Vertex to triangle adjacency of the current triangles
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for (uint32_t index : result)
+				offsets[index + 1]++;
+			for (uint64_t i = 0; i < vertices.size(); i++)
+				offsets[i + 1] += offsets[i];
+
+			adjacency.resize(result.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (uint64_t i = 0; i < result.size(); i++)
+				adjacency[fill[result[i]]++] = (uint32_t)(i / 3);
+
+			// Interior edges show up in two triangles with opposite winding, taking only a < b visits each of them once
+			collapses.clear();
+			for (uint64_t i = 0; i < result.size(); i += 3)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					const uint32_t a = result[i + c];
+					const uint32_t b = result[i + (c + 1) % 3];
+					if (a > b || (locked[a] && locked[b]))
+						continue;
+
+					if (locked[a])
+						collapses.push_back(computeCollapse(b, a));
+					else if (locked[b])
+						collapses.push_back(computeCollapse(a, b));
+					else
+					{
+						const Collapse ab = computeCollapse(a, b);
+						const Collapse ba = computeCollapse(b, a);
+						collapses.push_back(ab.Cost <= ba.Cost ? ab : ba);
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			// Triangles around a collapsed vertex change, so none of their vertices can be collapsed again in this pass
+			std::fill(touched.begin(), touched.end(), false);
+			uint64_t triangleCount = result.size() / 3;
+			bool collapsed = false;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.Cost > maxCost || triangleCount * 3 <= targetIndexCount)
+					break;
+
+				if (touched[collapse.From] || touched[collapse.To])
+					continue;
+
+				// Reject collapses that would flip any of the remaining triangles
+				bool flips = false;
+				uint32_t removedTriangles = 0;
+				for (uint32_t i = offsets[collapse.From]; i < offsets[collapse.From + 1] && !flips; i++)
+				{
+					const uint32_t* triangle = &result[adjacency[i] * 3];
+					if (triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To)
+					{
+						removedTriangles++;
+						continue;
+					}
+
+					glm::vec3 corners[3];
+					for (int c = 0; c < 3; c++)
+						corners[c] = positions[triangle[c]];
+					const glm::vec3 oldNormal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+					for (int c = 0; c < 3; c++)
+					{
+						if (triangle[c] == collapse.From)
+							corners[c] = positions[collapse.To];
+					}
+					const glm::vec3 newNormal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+					flips = glm::dot(oldNormal, newNormal) <= 0.0f;
+				}
+
+				if (flips)
+					continue;
+
+				for (uint32_t i = offsets[collapse.From]; i < offsets[collapse.From + 1]; i++)
+				{
+					const uint32_t* triangle = &result[adjacency[i] * 3];
+					for (int c = 0; c < 3; c++)
+						touched[triangle[c]] = true;
+				}
+
+				remap[collapse.From] = collapse.To;
+				quadrics[collapse.To] += quadrics[collapse.From];
+				maxError = glm::max(maxError, collapse.Error);
+
+				triangleCount -= removedTriangles;
+				collapsed = true;
+			}
+
+			if (!collapsed)
+				break;
+
+			// Targets were touched, so they weren't collapsed themselves and one remap lookup is enough
+			uint64_t writeIndex = 0;
+			for (uint64_t i = 0; i < result.size(); i += 3)
+			{
+				const uint32_t a = remap[result[i + 0]];
+				const uint32_t b = remap[result[i + 1]];
+				const uint32_t c = remap[result[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+			result.resize(writeIndex);
+		}
+
+		if (outError)
+			*outError = (float)glm::sqrt(maxError) * extent;
+
+		return result;
+	}
+
+	/**
+	 * @brief Appends simplified LODs to the index array. Each LOD is simplified from LOD 0, so errors are measured
+	 * against the original surface. Stops early when a LOD can't get meaningfully smaller within settings.MaxError.
+	 *
+	 * @param vertices - Vertices shared by all LODs.
+	 * @param indices - LOD 0 triangle list on input, all LODs one after another on output.
+	 * @param outLODs - Index ranges of every LOD, LOD 0 included.
+	 * @param settings - Number of LODs, reduction ratio and error limits.
+	 */
+	void MeshSimplifier::GenerateLODs(const std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Mesh::LOD>& outLODs, const LODSettings& settings)
+	{
+		outLODs.clear();
+		outLODs.push_back({ 0, (uint32_t)indices.size(), 0.0f });
+
+		const std::vector<uint32_t> baseIndices = indices;
+		uint64_t previousCount = indices.size();
+		for (uint32_t i = 1; i < settings.MaxLODCount; i++)
+		{
+			const uint64_t targetCount = (uint64_t)((double)previousCount * settings.ReductionRatio) / 3 * 3;
+			if (targetCount < 3)
+				break;
+
+			float error = 0.0f;
+			std::vector<uint32_t> lod = Simplify(vertices, baseIndices, targetCount, settings, &error);
+			if (lod.empty() || (double)lod.size() > (double)previousCount * 0.9)
+				break;
+
+			MeshOptimizer::OptimizeVertexCache(lod, vertices.size());
+
+			outLODs.push_back({ (uint32_t)indices.size(), (uint32_t)lod.size(), error });
+			indices.insert(indices.end(), lod.begin(), lod.end());
+			previousCount = lod.size();
+		}
+	}
+
+}
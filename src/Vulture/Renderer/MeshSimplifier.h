@@ -0,0 +1,30 @@
+#pragma once
+#include "pch.h"
+
+#include "Mesh.h"
+
+namespace Vulture
+{
+	struct LODSettings
+	{
+		uint32_t MaxLODCount = 4;		// Including LOD 0
+		float ReductionRatio = 0.5f;	// Target triangle count of each LOD relative to the previous one
+		float MaxError = 0.05f;			// Maximal deviation relative to the mesh extent, LODs above it aren't generated
+		float NormalWeight = 0.0025f;	// Attribute costs are in squared relative distance units
+		float TexCoordWeight = 0.01f;
+	};
+
+	// Quadric error metric simplification (Garland & Heckbert 1997) using half edge collapses, so every LOD
+	// indexes into the original vertex buffer. Vertices on open borders, attribute seams and non manifold
+	// edges are locked, which keeps LODs crack free and UVs intact.
+	class MeshSimplifier
+	{
+	public:
+		MeshSimplifier() = delete;
+
+		static std::vector<uint32_t> Simplify(const std::vector<Mesh::Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t targetIndexCount, const LODSettings& settings, float* outError = nullptr);
+
+		static void GenerateLODs(const std::vector<Mesh::Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Mesh::LOD>& outLODs, const LODSettings& settings);
+	};
+
+}
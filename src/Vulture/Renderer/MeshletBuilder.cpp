@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "MeshletBuilder.h"
+
+#include "Math/Frustum.h"
+#include "Utility/Logger.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace Vulture
+{
+	static_assert(sizeof(Mesh::Meshlet) == 64, "Meshlet layout has to match shaders");
+
+	/**
+	 * @brief Greedily fills meshlets with consecutive triangles, a new meshlet is started once the next triangle
+	 * doesn't fit into MaxVertices or MaxTriangles.
+	 *
+	 * @param vertices - Mesh vertices, used for bounds.
+	 * @param indices - Triangle list.
+	 * @param indexCount - Number of indices to cluster, e.g. LOD 0 only.
+	 * @param outData - Meshlets, their vertex indices and local triangles.
+	 */
+	void MeshletBuilder::Build(const std::vector<Mesh::Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t indexCount, Mesh::MeshletData& outData)
+	{
+		outData = {};
+		outData.VertexIndices.reserve(indexCount / 3);
+		outData.Triangles.reserve(indexCount);
+
+		constexpr uint8_t unused = 0xFF;
+		std::vector<uint8_t> localIndices(vertices.size(), unused);
+
+		Mesh::Meshlet meshlet{};
+		auto finishMeshlet = [&]()
+		{
+			for (uint32_t i = 0; i < meshlet.VertexCount; i++)
+				localIndices[outData.VertexIndices[meshlet.VertexOffset + i]] = unused;
+
+			// Keep every meshlet's triangles 4 byte aligned so shaders can read them as uints
+			while (outData.Triangles.size() % 4 != 0)
+				outData.Triangles.push_back(0);
+
+			ComputeBounds(vertices, outData, meshlet);
+			outData.Meshlets.push_back(meshlet);
+
+			meshlet = {};
+			meshlet.VertexOffset = (uint32_t)outData.VertexIndices.size();
+			meshlet.TriangleOffset = (uint32_t)outData.Triangles.size();
+		};
+
+		for (uint64_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const uint32_t a = indices[i + 0];
+			const uint32_t b = indices[i + 1];
+			const uint32_t c = indices[i + 2];
+
+			uint32_t newVertices = (localIndices[a] == unused) + (localIndices[b] == unused && b != a) + (localIndices[c] == unused && c != a && c != b);
+			if (meshlet.VertexCount + newVertices > MaxVertices || meshlet.TriangleCount + 1 > MaxTriangles)
+				finishMeshlet();
+
+			for (uint32_t vertex : { a, b, c })
+			{
+				if (localIndices[vertex] == unused)
+				{
+					localIndices[vertex] = (uint8_t)meshlet.VertexCount++;
+					outData.VertexIndices.push_back(vertex);
+				}
+
+				outData.Triangles.push_back(localIndices[vertex]);
+			}
+
+			meshlet.TriangleCount++;
+		}
+
+		if (meshlet.TriangleCount > 0)
+			finishMeshlet();
+	}
+
+	/**
+	 * @brief Computes bounding sphere and normal cone of a meshlet. The cone uses the apex formulation, so a
+	 * meshlet is backfacing when dot(normalize(ConeApex - cameraPosition), ConeAxis) >= ConeCutoff.
+	 */
+	void MeshletBuilder::ComputeBounds(const std::vector<Mesh::Vertex>& vertices, const Mesh::MeshletData& data, Mesh::Meshlet& meshlet)
+	{
+		auto position = [&](uint32_t triangle, uint32_t corner) -> const glm::vec3&
+		{
+			const uint8_t local = data.Triangles[meshlet.TriangleOffset + triangle * 3 + corner];
+			return vertices[data.VertexIndices[meshlet.VertexOffset + local]].Position;
+		};
+
+		glm::vec3 min(std::numeric_limits<float>::max());
+		glm::vec3 max(std::numeric_limits<float>::lowest());
+		for (uint32_t i = 0; i < meshlet.VertexCount; i++)
+		{
+			const glm::vec3& vertexPosition = vertices[data.VertexIndices[meshlet.VertexOffset + i]].Position;
+			min = glm::min(min, vertexPosition);
+			max = glm::max(max, vertexPosition);
+		}
+
+		meshlet.Center = (min + max) * 0.5f;
+		meshlet.Radius = 0.0f;
+		for (uint32_t i = 0; i < meshlet.VertexCount; i++)
+			meshlet.Radius = glm::max(meshlet.Radius, glm::length(vertices[data.VertexIndices[meshlet.VertexOffset + i]].Position - meshlet.Center));
+
+		// Normal cone, degenerate triangles keep a zero normal and are skipped
+		std::vector<glm::vec3> normals(meshlet.TriangleCount, glm::vec3(0.0f));
+		glm::vec3 normalSum(0.0f);
+		for (uint32_t i = 0; i < meshlet.TriangleCount; i++)
+		{
+			const glm::vec3 normal = glm::cross(position(i, 1) - position(i, 0), position(i, 2) - position(i, 0));
+			const float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+
+			normals[i] = normal / length;
+			normalSum += normals[i];
+		}
+
+		meshlet.ConeAxis = glm::vec3(0.0f);
+		meshlet.ConeCutoff = 1.0f;
+		meshlet.ConeApex = meshlet.Center;
+
+		const float sumLength = glm::length(normalSum);
+		if (sumLength == 0.0f)
+			return;
+
+		const glm::vec3 axis = normalSum / sumLength;
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+		{
+			if (normal != glm::vec3(0.0f))
+				minDot = glm::min(minDot, glm::dot(axis, normal));
+		}
+
+		// Cones wider than ~85 degrees half angle almost never cull anything
+		if (minDot <= 0.1f)
+			return;
+
+		// Move the apex back along the axis until every triangle plane is in front of it
+		float maxT = 0.0f;
+		for (uint32_t i = 0; i < meshlet.TriangleCount; i++)
+		{
+			if (normals[i] == glm::vec3(0.0f))
+				continue;
+
+			const float t = glm::dot(meshlet.Center - position(i, 0), normals[i]) / glm::dot(axis, normals[i]);
+			maxT = glm::max(maxT, t);
+		}
+
+		meshlet.ConeAxis = axis;
+		meshlet.ConeCutoff = glm::sqrt(1.0f - minDot * minDot);
+		meshlet.ConeApex = meshlet.Center - axis * maxT;
+	}
+
+	/**
+	 * @brief CPU reference of meshlet culling, GPU culling shaders are expected to give identical results.
+	 * Meshlets are tested against the view frustum and their normal cone. Culling is done in mesh space,
+	 * so cone tests are exact only for transforms without non uniform scale.
+	 *
+	 * @param meshlets - Meshlets of the mesh.
+	 * @param viewProj - Projection * view matrix of the camera.
+	 * @param transform - Model matrix of the mesh.
+	 * @param cameraPosition - World space camera position.
+	 * @param outVisible - Optional, receives indices of meshlets that passed.
+	 * @param outStats - Optional, receives how many meshlets were culled by each test.
+	 *
+	 * @return Number of visible meshlets.
+	 */
+	uint32_t MeshletBuilder::Cull(const std::vector<Mesh::Meshlet>& meshlets, const glm::mat4& viewProj, const glm::mat4& transform, const glm::vec3& cameraPosition, std::vector<uint32_t>* outVisible, CullStats* outStats)
+	{
+		if (outVisible)
+			outVisible->clear();
+
+		CullStats stats{};
+		stats.MeshletCount = (uint32_t)meshlets.size();
+
+		// Planes of viewProj * transform are in mesh space, normalized so that they can be tested against spheres
+		const Frustum frustum(viewProj * transform);
+		glm::vec4 planes[6];
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			planes[i] = frustum.GetPlane(i);
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+
+		const glm::vec3 localCamera = glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.0f));
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < (uint32_t)meshlets.size(); i++)
+		{
+			const Mesh::Meshlet& meshlet = meshlets[i];
+
+			bool outside = false;
+			for (const glm::vec4& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), meshlet.Center) + plane.w < -meshlet.Radius)
+				{
+					outside = true;
+					break;
+				}
+			}
+
+			if (outside)
+			{
+				stats.FrustumCulled++;
+				continue;
+			}
+
+			if (glm::dot(glm::normalize(meshlet.ConeApex - localCamera), meshlet.ConeAxis) >= meshlet.ConeCutoff)
+			{
+				stats.BackfaceCulled++;
+				continue;
+			}
+
+			visibleCount++;
+			if (outVisible)
+				outVisible->push_back(i);
+		}
+
+		if (outStats)
+			*outStats = stats;
+
+		return visibleCount;
+	}
+
+
+	/**
+	 * @brief Runs Cull() on a flat grid facing +Z with cameras and transforms whose outcome is known: seen from the
+	 * front, from behind, rotated away from the camera, off to the side and behind the camera. Failed cases are logged.
+	 *
+	 * @return false when any meshlet ends up with a different result than expected.
+	 */
+	bool MeshletBuilder::ValidateCull()
+	{
+		// 8x8 quads in [-1, 1] on z = 0, counter clockwise when seen from +Z
+		constexpr uint32_t gridSize = 8;
+		std::vector<Mesh::Vertex> vertices;
+		for (uint32_t y = 0; y <= gridSize; y++)
+		{
+			for (uint32_t x = 0; x <= gridSize; x++)
+			{
+				const glm::vec2 uv((float)x / gridSize, (float)y / gridSize);
+				vertices.push_back({ glm::vec3(uv * 2.0f - 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), uv });
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y < gridSize; y++)
+		{
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				const uint32_t i = y * (gridSize + 1) + x;
+				indices.insert(indices.end(), { i, i + 1, i + gridSize + 2, i, i + gridSize + 2, i + gridSize + 1 });
+			}
+		}
+
+		Mesh::MeshletData data;
+		Build(vertices, indices, indices.size(), data);
+
+		struct Case
+		{
+			const char* Name;
+			glm::vec3 Camera;
+			glm::mat4 Transform;
+			uint32_t Visible;
+			uint32_t FrustumCulled;
+			uint32_t BackfaceCulled;
+		};
+
+		const uint32_t count = (uint32_t)data.Meshlets.size();
+		const glm::mat4 identity(1.0f);
+		const glm::mat4 turned = glm::rotate(identity, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const Case cases[] =
+		{
+			{ "front", glm::vec3(0.0f, 0.0f, 5.0f), identity, count, 0, 0 },
+			{ "behind", glm::vec3(0.0f, 0.0f, -5.0f), identity, 0, 0, count },
+			{ "turned away", glm::vec3(0.0f, 0.0f, 5.0f), turned, 0, 0, count },
+			{ "off to the side", glm::vec3(0.0f, 0.0f, 5.0f), glm::translate(identity, glm::vec3(100.0f, 0.0f, 0.0f)), 0, count, 0 },
+			{ "behind the camera", glm::vec3(0.0f, 0.0f, 5.0f), glm::translate(identity, glm::vec3(0.0f, 0.0f, 10.0f)), 0, count, 0 },
+		};
+
+		const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+		bool valid = true;
+		for (const Case& test : cases)
+		{
+			// Every camera looks at the origin
+			const glm::mat4 view = glm::lookAtRH(test.Camera, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+			CullStats stats{};
+			const uint32_t visible = Cull(data.Meshlets, projection * view, test.Transform, test.Camera, nullptr, &stats);
+			if (visible != test.Visible || stats.FrustumCulled != test.FrustumCulled || stats.BackfaceCulled != test.BackfaceCulled)
+			{
+				VL_CORE_WARN("Meshlet culling case \"{}\" failed: {} visible, {} frustum culled, {} backface culled, expected {}, {}, {}",
+					test.Name, visible, stats.FrustumCulled, stats.BackfaceCulled, test.Visible, test.FrustumCulled, test.BackfaceCulled);
+				valid = false;
+			}
+		}
+
+		return valid;
+	}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "pch.h"
+
+#include "Mesh.h"
+
+namespace Vulture
+{
+	// Splits triangle lists into meshlets and computes their culling bounds. Triangles are taken in index
+	// buffer order, so run MeshOptimizer first to get spatially coherent clusters.
+	class MeshletBuilder
+	{
+	public:
+		static constexpr uint32_t MaxVertices = 64;
+		static constexpr uint32_t MaxTriangles = 124;
+
+		struct CullStats
+		{
+			uint32_t MeshletCount = 0;
+			uint32_t FrustumCulled = 0;
+			uint32_t BackfaceCulled = 0;
+		};
+
+		MeshletBuilder() = delete;
+
+		static void Build(const std::vector<Mesh::Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t indexCount, Mesh::MeshletData& outData);
+
+		static uint32_t Cull(const std::vector<Mesh::Meshlet>& meshlets, const glm::mat4& viewProj, const glm::mat4& transform, const glm::vec3& cameraPosition, std::vector<uint32_t>* outVisible = nullptr, CullStats* outStats = nullptr);
+		static bool ValidateCull();
+
+	private:
+		static void ComputeBounds(const std::vector<Mesh::Vertex>& vertices, const Mesh::MeshletData& data, Mesh::Meshlet& meshlet);
+	};
+
+}
@@ -0,0 +1,250 @@
+#include "pch.h"
+#include "ParallelRecorder.h"
+
+#include "Vulkan/Device.h"
+#include "Asset/AssetManager.h"
+
+namespace Vulture
+{
+
+	void ParallelRecorder::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.FramesInFlight > 0, "FramesInFlight can't be 0!");
+
+		VL_CORE_ASSERT(AssetManager::GetThreadPool().IsInitialized(), "AssetManager has to be initialized before the parallel recorder!");
+
+		uint32_t threadCount = createInfo.ThreadCount;
+		if (threadCount == 0)
+			threadCount = AssetManager::GetThreadPool().GetThreadCount();
+
+		const uint32_t chunkCount = threadCount + 1;
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Buffers are never reset one by one
+		poolInfo.queueFamilyIndex = Device::FindPhysicalQueueFamilies().GraphicsFamily;
+
+		m_Pools.resize(createInfo.FramesInFlight);
+		for (uint32_t frame = 0; frame < createInfo.FramesInFlight; frame++)
+		{
+			m_Pools[frame].resize(chunkCount);
+			for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+			{
+				VL_CORE_RETURN_ASSERT(vkCreateCommandPool(Device::GetDevice(), &poolInfo, nullptr, &m_Pools[frame][chunk].Pool),
+					VK_SUCCESS,
+					"failed to create command pool!"
+				);
+			}
+		}
+
+		m_Initialized = true;
+	}
+
+	/**
+	 * @brief Waits for helper tasks still in the worker pool and destroys every command pool. Command buffers of
+	 * frames still in flight are freed as well, so wait for the device first.
+	 */
+	void ParallelRecorder::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_DoneCV.wait(lock, [this] { return m_QueuedHelpers == 0; });
+		}
+
+		for (std::vector<ChunkPool>& framePools : m_Pools)
+		{
+			for (ChunkPool& pool : framePools)
+				vkDestroyCommandPool(Device::GetDevice(), pool.Pool, nullptr);
+		}
+
+		Reset();
+	}
+
+	ParallelRecorder::ParallelRecorder(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	ParallelRecorder::~ParallelRecorder()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Recycles every command buffer recorded for this frame index. Call it only after the fence of the frame
+	 * that used the index before was waited on.
+	 */
+	void ParallelRecorder::BeginFrame(uint32_t frameIndex)
+	{
+		VL_CORE_ASSERT(m_Initialized, "ParallelRecorder is not initialized!");
+
+		m_FrameIndex = frameIndex % (uint32_t)m_Pools.size();
+		for (ChunkPool& pool : m_Pools[m_FrameIndex])
+		{
+			if (pool.UsedBuffers == 0)
+				continue;
+
+			vkResetCommandPool(Device::GetDevice(), pool.Pool, 0);
+			pool.UsedBuffers = 0;
+		}
+	}
+
+	/**
+	 * @brief Calls fn for every task in [0, taskCount) across the worker threads and executes the recorded buffers
+	 * into the primary command buffer in task order. Returns once everything is recorded.
+	 *
+	 * @param primary - Command buffer the chunks are executed into, only touched by the calling thread.
+	 * @param fn - Called with the task index and the secondary command buffer of its chunk. Tasks of one chunk
+	 * are recorded in ascending order into the same buffer, tasks of different chunks run concurrently.
+	 * @param inheritance - Render pass the primary command buffer is inside of, if any. Secondary command buffers
+	 * don't inherit any other state, every task has to bind its pipeline and descriptors and set viewport and scissor.
+	 * @param minTasksPerChunk - Keeps cheap tasks from being spread over more threads than they are worth.
+	 */
+	void ParallelRecorder::Record(VkCommandBuffer primary, uint32_t taskCount, const RecordFn& fn, const Inheritance& inheritance, uint32_t minTasksPerChunk)
+	{
+		VL_CORE_ASSERT(m_Initialized, "ParallelRecorder is not initialized!");
+
+		if (taskCount == 0)
+			return;
+
+		minTasksPerChunk = std::max(minTasksPerChunk, 1u);
+		uint32_t chunkCount = std::min(GetChunkCount(), (taskCount + minTasksPerChunk - 1) / minTasksPerChunk);
+		const uint32_t chunkSize = (taskCount + chunkCount - 1) / chunkCount;
+		chunkCount = (taskCount + chunkSize - 1) / chunkSize;
+
+		m_InheritanceInfo = {};
+		m_InheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		m_InheritanceInfo.renderPass = inheritance.RenderPass;
+		m_InheritanceInfo.subpass = inheritance.Subpass;
+		m_InheritanceInfo.framebuffer = inheritance.Framebuffer;
+
+		m_Fn = &fn;
+		m_TaskCount = taskCount;
+		m_ChunkBuffers.assign(chunkCount, VK_NULL_HANDLE);
+
+		ThreadPool& pool = AssetManager::GetThreadPool();
+		const uint32_t helperCount = std::min(chunkCount - 1, pool.GetThreadCount());
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_ActiveChunks = chunkCount;
+			m_NextChunk = 0;
+			m_PendingChunks = chunkCount;
+			m_QueuedHelpers += helperCount;
+		}
+
+		for (uint32_t i = 0; i < helperCount; i++)
+			pool.PushTask([this]() { RunHelper(); });
+
+		RecordChunks();
+
+		// Only chunks helpers already claimed are waited for
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_DoneCV.wait(lock, [this] { return m_PendingChunks == 0; });
+		}
+
+		vkCmdExecuteCommands(primary, chunkCount, m_ChunkBuffers.data());
+
+		m_Fn = nullptr;
+	}
+
+	VkCommandBuffer ParallelRecorder::AcquireBuffer(ChunkPool& pool)
+	{
+		if (pool.UsedBuffers == (uint32_t)pool.Buffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = pool.Pool;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer buffer;
+			VL_CORE_RETURN_ASSERT(vkAllocateCommandBuffers(Device::GetDevice(), &allocInfo, &buffer),
+				VK_SUCCESS,
+				"Failed to allocate command buffers!"
+			);
+			pool.Buffers.push_back(buffer);
+		}
+
+		return pool.Buffers[pool.UsedBuffers++];
+	}
+
+	void ParallelRecorder::RecordChunk(uint32_t chunk)
+	{
+		const uint32_t chunkSize = (m_TaskCount + m_ActiveChunks - 1) / m_ActiveChunks;
+		const uint32_t begin = std::min(m_TaskCount, chunk * chunkSize);
+		const uint32_t end = std::min(m_TaskCount, begin + chunkSize);
+
+		VkCommandBuffer cmd = AcquireBuffer(m_Pools[m_FrameIndex][chunk]);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (m_InheritanceInfo.renderPass != VK_NULL_HANDLE)
+			beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &m_InheritanceInfo;
+
+		VL_CORE_RETURN_ASSERT(vkBeginCommandBuffer(cmd, &beginInfo), VK_SUCCESS, "failed to begin recording command buffer!");
+
+		for (uint32_t task = begin; task < end; task++)
+			(*m_Fn)(task, cmd);
+
+		VL_CORE_RETURN_ASSERT(vkEndCommandBuffer(cmd), VK_SUCCESS, "Failed to record command buffer!");
+
+		m_ChunkBuffers[chunk] = cmd;
+	}
+
+	/**
+	 * @brief Records chunks until none are left to claim.
+	 */
+	void ParallelRecorder::RecordChunks()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (m_NextChunk < m_ActiveChunks)
+		{
+			const uint32_t chunk = m_NextChunk++;
+			lock.unlock();
+
+			RecordChunk(chunk);
+
+			lock.lock();
+			if (--m_PendingChunks == 0)
+				m_DoneCV.notify_all();
+		}
+	}
+
+	/**
+	 * @brief Pool task of a helper, finds nothing to record when it starts after the calling thread claimed every chunk.
+	 */
+	void ParallelRecorder::RunHelper()
+	{
+		RecordChunks();
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (--m_QueuedHelpers == 0)
+			m_DoneCV.notify_all();
+	}
+
+	void ParallelRecorder::Reset()
+	{
+		m_Pools.clear();
+		m_FrameIndex = 0;
+		m_NextChunk = 0;
+		m_PendingChunks = 0;
+		m_QueuedHelpers = 0;
+		m_Fn = nullptr;
+		m_InheritanceInfo = {};
+		m_TaskCount = 0;
+		m_ActiveChunks = 0;
+		m_ChunkBuffers.clear();
+		m_Initialized = false;
+	}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "pch.h"
+#include "Utility/Utility.h"
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <condition_variable>
+
+namespace Vulture
+{
+	// Records command buffers on the engine worker pool (AssetManager::GetThreadPool()). Work is split into contiguous
+	// chunks of tasks, every chunk is recorded into one secondary command buffer and the chunks are executed into the
+	// primary command buffer in task order, so the result is the same no matter how the threads were scheduled.
+	//
+	// Chunks are claimed by the calling thread and by helper tasks pushed to the pool. The calling thread records
+	// every chunk nobody else claimed, so pool threads busy with other work never hold Record() up.
+	//
+	// Every frame in flight has its own command pool per chunk. A pool is only used by one thread at a time, so none
+	// of them need locking, and all buffers of a frame are recycled by resetting its pools once its fence signaled.
+	class ParallelRecorder
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32_t FramesInFlight = 0;
+			uint32_t ThreadCount = 0; // Pool threads besides the calling one, 0 picks every thread of the pool
+		};
+
+		// Set RenderPass to record inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+		struct Inheritance
+		{
+			VkRenderPass RenderPass = VK_NULL_HANDLE;
+			uint32_t Subpass = 0;
+			VkFramebuffer Framebuffer = VK_NULL_HANDLE;
+		};
+
+		using RecordFn = std::function<void(uint32_t task, VkCommandBuffer cmd)>;
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		ParallelRecorder() = default;
+		ParallelRecorder(const CreateInfo& createInfo);
+		~ParallelRecorder();
+
+		ParallelRecorder(const ParallelRecorder&) = delete;
+		ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+		ParallelRecorder(ParallelRecorder&&) = delete;
+		ParallelRecorder& operator=(ParallelRecorder&&) = delete;
+
+		void BeginFrame(uint32_t frameIndex);
+		void Record(VkCommandBuffer primary, uint32_t taskCount, const RecordFn& fn, const Inheritance& inheritance = {}, uint32_t minTasksPerChunk = 1);
+
+		inline uint32_t GetChunkCount() const { return m_Pools.empty() ? 0 : (uint32_t)m_Pools[0].size(); }
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		struct ChunkPool
+		{
+			VkCommandPool Pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> Buffers; // Allocated so far, reused after every reset
+			uint32_t UsedBuffers = 0;
+		};
+
+		VkCommandBuffer AcquireBuffer(ChunkPool& pool);
+		void RecordChunk(uint32_t chunk);
+		void RecordChunks();
+		void RunHelper();
+
+		std::vector<std::vector<ChunkPool>> m_Pools; // [frame][chunk]
+		uint32_t m_FrameIndex = 0;
+
+		// State of the Record call in progress, helpers only read it between claiming a chunk and finishing it
+		std::mutex m_Mutex;
+		std::condition_variable m_DoneCV;
+		uint32_t m_NextChunk = 0;
+		uint32_t m_PendingChunks = 0;
+		uint32_t m_QueuedHelpers = 0; // Helper tasks pushed to the pool that haven't returned yet, Destroy() waits for them
+
+		const RecordFn* m_Fn = nullptr;
+		VkCommandBufferInheritanceInfo m_InheritanceInfo{};
+		uint32_t m_TaskCount = 0;
+		uint32_t m_ActiveChunks = 0;
+		std::vector<VkCommandBuffer> m_ChunkBuffers;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
@@ -0,0 +1,330 @@
+#include "pch.h"
+#include "ReadbackRing.h"
+#include "Utility/File.h"
+
+namespace Vulture
+{
+	void ReadbackRing::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		for (uint32_t i = 0; i < createInfo.SlotCount; i++)
+			m_Slots.push_back(std::make_unique<Slot>());
+
+		m_EncodePool.Init(ThreadPool::CreateInfo{ std::max(1u, createInfo.EncodeThreadCount) });
+		m_PNGCompression = createInfo.PNGCompression;
+
+		m_Initialized = true;
+	}
+
+	void ReadbackRing::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		Flush();
+		m_EncodePool.Destroy();
+
+		const uint32_t pending = GetPendingCount();
+		if (pending != 0)
+			VL_CORE_WARN("Dropping {} image captures that never finished on the GPU", pending);
+
+		Reset();
+	}
+
+	ReadbackRing::ReadbackRing(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	ReadbackRing::~ReadbackRing()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Records a copy of the image into cmd, the file is written once the frame is resolved. The image is
+	 * returned to its current layout afterwards.
+	 *
+	 * @param cmd - Command buffer of the frame the image is rendered in.
+	 * @param image - Image to capture, its current contents at this point of cmd are saved.
+	 * @param filepath - Output file.
+	 * @param format - Output file format.
+	 * @param frameSerial - Serial of the frame cmd belongs to, see Resolve().
+	 */
+	void ReadbackRing::Capture(VkCommandBuffer cmd, Image* image, const std::string& filepath, FileFormat format, uint64_t frameSerial)
+	{
+		VL_CORE_ASSERT(m_Initialized, "ReadbackRing is not initialized!");
+
+		Slot* slot = AcquireSlot();
+		slot->FrameSerial = frameSerial;
+		slot->Filepath = filepath;
+		slot->Format = format;
+		slot->Compression = m_PNGCompression;
+
+		const VkImageLayout oldLayout = image->GetLayout();
+		image->TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cmd);
+
+		RecordCopy(cmd, *slot, image->GetImage(), image->GetFormat(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->GetImageSize());
+
+		if (oldLayout != VK_IMAGE_LAYOUT_UNDEFINED && oldLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+			image->TransitionImageLayout(oldLayout, cmd);
+	}
+
+	/**
+	 * @brief Same as the Image overload for images not owned by an Image object, such as offscreen presentable
+	 * images. The image has to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+	 */
+	void ReadbackRing::Capture(VkCommandBuffer cmd, VkImage image, VkFormat imageFormat, VkExtent2D extent, const std::string& filepath, FileFormat format, uint64_t frameSerial)
+	{
+		VL_CORE_ASSERT(m_Initialized, "ReadbackRing is not initialized!");
+
+		Slot* slot = AcquireSlot();
+		slot->FrameSerial = frameSerial;
+		slot->Filepath = filepath;
+		slot->Format = format;
+		slot->Compression = m_PNGCompression;
+
+		// Make writes done earlier in the frame visible to the copy
+		Image::TransitionImageLayout(
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			cmd
+		);
+
+		RecordCopy(cmd, *slot, image, imageFormat, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, extent);
+	}
+
+	/**
+	 * @brief Hands every capture of finished frames to the encoding threads.
+	 *
+	 * @param completedFrameSerial - Every frame with this serial or lower has finished executing on the GPU.
+	 */
+	void ReadbackRing::Resolve(uint64_t completedFrameSerial)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		for (Scope<Slot>& slot : m_Slots)
+		{
+			if (slot->State != SlotState::Recorded || slot->FrameSerial > completedFrameSerial)
+				continue;
+
+			slot->State = SlotState::Encoding;
+			m_EncodingCount++;
+
+			Slot* slotPtr = slot.get();
+			m_EncodePool.PushTask([this, slotPtr]() { Encode(slotPtr); });
+		}
+	}
+
+	/**
+	 * @brief Frees captures recorded into a command buffer that was never submitted.
+	 */
+	void ReadbackRing::Cancel(uint64_t frameSerial)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		for (Scope<Slot>& slot : m_Slots)
+		{
+			if (slot->State == SlotState::Recorded && slot->FrameSerial == frameSerial)
+			{
+				VL_CORE_WARN("Image capture {} dropped, its frame was never submitted", slot->Filepath);
+				slot->State = SlotState::Free;
+			}
+		}
+	}
+
+	/**
+	 * @brief Waits until every resolved capture is written. Captures still waiting for the GPU are kept.
+	 */
+	void ReadbackRing::Flush()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CV.wait(lock, [this]() { return m_EncodingCount == 0; });
+	}
+
+	/**
+	 * @brief Number of captures that weren't written yet.
+	 */
+	uint32_t ReadbackRing::GetPendingCount()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		uint32_t count = 0;
+		for (Scope<Slot>& slot : m_Slots)
+			count += slot->State != SlotState::Free ? 1 : 0;
+
+		return count;
+	}
+
+	const char* ReadbackRing::GetExtension(FileFormat format)
+	{
+		switch (format)
+		{
+		case FileFormat::PNG: return ".png";
+		case FileFormat::PPM: return ".ppm";
+		case FileFormat::PFM: return ".pfm";
+		default:              return ".raw";
+		}
+	}
+
+	ReadbackRing::Slot* ReadbackRing::AcquireSlot()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true)
+		{
+			for (Scope<Slot>& slot : m_Slots)
+			{
+				if (slot->State == SlotState::Free)
+				{
+					slot->State = SlotState::Recorded;
+					return slot.get();
+				}
+			}
+
+			// Encoders free their slots without any help, slots waiting for the GPU would never be freed here
+			if (m_EncodingCount == 0)
+				break;
+
+			m_CV.wait(lock);
+		}
+
+		VL_CORE_WARN("Readback ring is full, growing to {} slots", m_Slots.size() + 1);
+		m_Slots.push_back(std::make_unique<Slot>());
+		m_Slots.back()->State = SlotState::Recorded;
+		return m_Slots.back().get();
+	}
+
+	void ReadbackRing::PrepareBuffer(Slot& slot, VkDeviceSize size)
+	{
+		if (slot.Readback.IsInitialized() && slot.Readback.GetBufferSize() >= size)
+			return;
+
+		Buffer::CreateInfo info{};
+		info.InstanceSize = size;
+		// Cached, the encoders read every byte and uncached reads are many times slower
+		info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		info.UsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		info.NoPool = true;
+		slot.Readback.Init(info);
+		slot.Readback.Map();
+	}
+
+	void ReadbackRing::PrepareConvertedImage(Slot& slot, VkExtent2D extent, VkFormat format)
+	{
+		if (slot.Converted.IsInitialized() && slot.Converted.GetFormat() == format && slot.Converted.GetImageSize().width == extent.width && slot.Converted.GetImageSize().height == extent.height)
+			return;
+
+		Image::CreateInfo imageInfo{};
+		imageInfo.Aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageInfo.Format = format;
+		imageInfo.Width = extent.width;
+		imageInfo.Height = extent.height;
+		imageInfo.Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		imageInfo.SamplerInfo = SamplerInfo{};
+		imageInfo.Usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.DebugName = "Readback Converted Image";
+		slot.Converted.Init(imageInfo);
+	}
+
+	void ReadbackRing::RecordCopy(VkCommandBuffer cmd, Slot& slot, VkImage image, VkFormat imageFormat, VkImageLayout layout, VkExtent2D extent)
+	{
+		VkImage copySource = image;
+		VkImageLayout copyLayout = layout;
+		uint32_t texelSize = Image::FormatToSize(imageFormat);
+
+		// Texel format the encoder expects, Raw takes anything
+		VkFormat encoderFormat = imageFormat;
+		if (slot.Format == FileFormat::PNG || slot.Format == FileFormat::PPM)
+			encoderFormat = imageFormat == VK_FORMAT_R8G8B8A8_SRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		else if (slot.Format == FileFormat::PFM)
+			encoderFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+		if (encoderFormat != imageFormat)
+		{
+			PrepareConvertedImage(slot, extent, encoderFormat);
+			slot.Converted.TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd);
+
+			VkImageBlit blitRegion{};
+			blitRegion.srcOffsets[1] = { (int32_t)extent.width, (int32_t)extent.height, 1 };
+			blitRegion.dstOffsets[1] = { (int32_t)extent.width, (int32_t)extent.height, 1 };
+			blitRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			blitRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			vkCmdBlitImage(cmd, image, layout, slot.Converted.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blitRegion, VK_FILTER_NEAREST);
+
+			slot.Converted.TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cmd);
+
+			copySource = slot.Converted.GetImage();
+			copyLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			texelSize = Image::FormatToSize(encoderFormat);
+		}
+
+		VL_CORE_ASSERT(texelSize != 0, "Unsupported capture format {}", (int)imageFormat);
+
+		slot.Extent = extent;
+		slot.TexelSize = texelSize;
+		PrepareBuffer(slot, (VkDeviceSize)extent.width * extent.height * texelSize);
+
+		VkBufferImageCopy region{};
+		region.imageExtent = { extent.width, extent.height, 1 };
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		vkCmdCopyImageToBuffer(cmd, copySource, copyLayout, slot.Readback.GetBuffer(), 1, &region);
+
+		// The fence wait alone doesn't make transfer writes visible to the host
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = slot.Readback.GetBuffer();
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	void ReadbackRing::Encode(Slot* slot)
+	{
+		slot->Readback.Invalidate();
+		const unsigned char* pixels = (const unsigned char*)slot->Readback.GetMappedMemory();
+		const uint64_t size = (uint64_t)slot->Extent.width * slot->Extent.height * slot->TexelSize;
+
+		Timer timer;
+		switch (slot->Format)
+		{
+		case FileFormat::PNG:
+			ImageEncoder::WritePNG(slot->Filepath, pixels, slot->Extent.width, slot->Extent.height, slot->Compression);
+			break;
+		case FileFormat::PPM:
+			ImageEncoder::WritePPM(slot->Filepath, pixels, slot->Extent.width, slot->Extent.height);
+			break;
+		case FileFormat::PFM:
+			ImageEncoder::WritePFM(slot->Filepath, (const float*)pixels, slot->Extent.width, slot->Extent.height);
+			break;
+		case FileFormat::Raw:
+			File::WriteToFile(pixels, (uint32_t)size, slot->Filepath);
+			break;
+		default:
+			VL_CORE_ASSERT(false, "Unknown capture format");
+			break;
+		}
+		VL_CORE_TRACE("Saved {} in {:.2f}ms", slot->Filepath, timer.ElapsedMillis());
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		slot->State = SlotState::Free;
+		m_EncodingCount--;
+		m_CV.notify_all();
+	}
+
+	void ReadbackRing::Reset()
+	{
+		m_Slots.clear();
+		m_EncodingCount = 0;
+		m_Initialized = false;
+	}
+
+}
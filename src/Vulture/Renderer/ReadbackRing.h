@@ -0,0 +1,108 @@
+#pragma once
+#include "pch.h"
+#include "Utility/Utility.h"
+#include "Utility/ImageEncoder.h"
+
+#include "Vulkan/Buffer.h"
+#include "Vulkan/Image.h"
+
+#include <mutex>
+#include <condition_variable>
+
+namespace Vulture
+{
+	// Image captures that don't stall the frame. The copy into a persistently mapped host visible buffer is recorded
+	// into the frame's command buffer, the buffer is handed to encoding threads once that frame finished on the GPU
+	// (see Resolve()) and the slot is reused after the file is written. When every slot is busy the ring waits for
+	// an encoder to finish, or grows when all of them still wait for the GPU.
+	class ReadbackRing
+	{
+	public:
+		enum class FileFormat
+		{
+			PNG, // 8 bit RGBA, other source formats are blitted to RGBA8 first
+			PPM, // 8 bit RGB, uncompressed
+			PFM, // 32 bit float RGB, uncompressed, keeps HDR values
+			Raw, // Texels of the source format as they are, row by row without any header
+		};
+
+		struct CreateInfo
+		{
+			uint32_t SlotCount = 4; // Initial number of slots
+			uint32_t EncodeThreadCount = 2;
+			ImageEncoder::Compression PNGCompression = ImageEncoder::Compression::Default;
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		ReadbackRing() = default;
+		ReadbackRing(const CreateInfo& createInfo);
+		~ReadbackRing();
+
+		ReadbackRing(const ReadbackRing&) = delete;
+		ReadbackRing& operator=(const ReadbackRing&) = delete;
+		ReadbackRing(ReadbackRing&&) = delete;
+		ReadbackRing& operator=(ReadbackRing&&) = delete;
+
+		void Capture(VkCommandBuffer cmd, Image* image, const std::string& filepath, FileFormat format, uint64_t frameSerial);
+		void Capture(VkCommandBuffer cmd, VkImage image, VkFormat imageFormat, VkExtent2D extent, const std::string& filepath, FileFormat format, uint64_t frameSerial);
+
+		void Resolve(uint64_t completedFrameSerial);
+		void Cancel(uint64_t frameSerial);
+		void Flush();
+
+		uint32_t GetPendingCount();
+
+		// Applies to captures made from now on
+		inline void SetPNGCompression(ImageEncoder::Compression compression) { m_PNGCompression = compression; }
+		inline ImageEncoder::Compression GetPNGCompression() const { return m_PNGCompression; }
+
+		static const char* GetExtension(FileFormat format);
+		inline uint32_t GetSlotCount() const { return (uint32_t)m_Slots.size(); }
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		enum class SlotState
+		{
+			Free,
+			Recorded, // Copy recorded, waiting for the frame to finish on the GPU
+			Encoding,
+		};
+
+		struct Slot
+		{
+			Buffer Readback;
+			Image Converted; // Blit target for captures whose file format needs a different texel format
+
+			SlotState State = SlotState::Free;
+			uint64_t FrameSerial = 0;
+			std::string Filepath;
+			FileFormat Format = FileFormat::PNG;
+			ImageEncoder::Compression Compression = ImageEncoder::Compression::Default;
+			VkExtent2D Extent = { 0, 0 };
+			uint32_t TexelSize = 0;
+		};
+
+		Slot* AcquireSlot();
+		void PrepareBuffer(Slot& slot, VkDeviceSize size);
+		void PrepareConvertedImage(Slot& slot, VkExtent2D extent, VkFormat format);
+		void RecordCopy(VkCommandBuffer cmd, Slot& slot, VkImage image, VkFormat imageFormat, VkImageLayout layout, VkExtent2D extent);
+		void Encode(Slot* slot);
+
+		std::vector<Scope<Slot>> m_Slots;
+		ThreadPool m_EncodePool;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_CV;
+		uint32_t m_EncodingCount = 0;
+
+		ImageEncoder::Compression m_PNGCompression = ImageEncoder::Compression::Default;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
@@ -0,0 +1,692 @@
+#include "pch.h"
+#include "RenderGraph.h"
+
+#include "GpuProfiler.h"
+
+namespace Vulture
+{
+	struct AccessInfo
+	{
+		VkImageLayout Layout;
+		VkAccessFlags AccessMask;
+		VkAccessFlags WriteMask;
+		VkImageUsageFlags Usage;
+	};
+
+	static AccessInfo GetAccessInfo(RenderGraph::Access access)
+	{
+		switch (access)
+		{
+		case RenderGraph::Access::Sampled:          return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case RenderGraph::Access::StorageRead:      return { VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraph::Access::StorageWrite:     return { VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraph::Access::StorageReadWrite: return { VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraph::Access::TransferSrc:      return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, 0, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		case RenderGraph::Access::TransferDst:      return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		case RenderGraph::Access::ColorAttachment:  return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		default:
+			VL_CORE_ASSERT(false, "Unknown access");
+			return {};
+		}
+	}
+
+	static VkPipelineStageFlags GetStage(RenderGraph::PassType type, RenderGraph::Access access)
+	{
+		switch (access)
+		{
+		case RenderGraph::Access::TransferSrc:
+		case RenderGraph::Access::TransferDst:
+			return VK_PIPELINE_STAGE_TRANSFER_BIT;
+		case RenderGraph::Access::ColorAttachment:
+			return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		default:
+			break;
+		}
+
+		switch (type)
+		{
+		case RenderGraph::PassType::Compute:    return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		case RenderGraph::PassType::Graphics:   return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		case RenderGraph::PassType::RayTracing: return VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
+		default:
+			VL_CORE_ASSERT(false, "Transfer passes can't access images from shaders!");
+			return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
+	}
+
+	void RenderGraph::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		m_AliasTransients = createInfo.AliasTransients;
+
+		m_Initialized = true;
+	}
+
+	void RenderGraph::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		ReleaseTransients();
+		Reset();
+	}
+
+	RenderGraph::RenderGraph(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		Destroy();
+	}
+
+	void RenderGraph::PassBuilder::Read(ResourceHandle resource, Access access)
+	{
+		VL_CORE_ASSERT(GetAccessInfo(access).WriteMask == 0, "{} is a write access!", (int)access);
+		VL_CORE_ASSERT(resource < m_Graph->m_Resources.size(), "Invalid resource handle {}", resource);
+		m_Graph->m_Passes[m_PassIndex].Accesses.push_back({ resource, access });
+	}
+
+	void RenderGraph::PassBuilder::Write(ResourceHandle resource, Access access)
+	{
+		VL_CORE_ASSERT(GetAccessInfo(access).WriteMask != 0, "{} is a read access!", (int)access);
+		VL_CORE_ASSERT(resource < m_Graph->m_Resources.size(), "Invalid resource handle {}", resource);
+		m_Graph->m_Passes[m_PassIndex].Accesses.push_back({ resource, access });
+	}
+
+	/**
+	 * @brief Makes an image owned by someone else usable in passes. Imported images keep their contents between
+	 * executions and passes writing them are never culled.
+	 *
+	 * @param image - Image that outlives the graph.
+	 * @param finalLayout - Layout the image is transitioned to at the end of every execution, VK_IMAGE_LAYOUT_UNDEFINED
+	 * leaves it in the layout of its last use.
+	 */
+	RenderGraph::ResourceHandle RenderGraph::ImportImage(Image* image, VkImageLayout finalLayout)
+	{
+		VL_CORE_ASSERT(m_Initialized, "RenderGraph is not initialized!");
+		VL_CORE_ASSERT(image != nullptr && image->IsInitialized(), "Can't import an uninitialized image!");
+
+		Resource resource;
+		resource.Imported = image;
+		resource.FinalLayout = finalLayout;
+		m_Resources.push_back(std::move(resource));
+		m_Compiled = false;
+
+		return (ResourceHandle)m_Resources.size() - 1;
+	}
+
+	/**
+	 * @brief Declares a transient image, it's created by Compile().
+	 */
+	RenderGraph::ResourceHandle RenderGraph::CreateImage(const ImageDesc& desc)
+	{
+		VL_CORE_ASSERT(m_Initialized, "RenderGraph is not initialized!");
+		VL_CORE_ASSERT(desc.Width > 0 && desc.Height > 0, "Transient image {} has no size!", desc.DebugName);
+
+		Resource resource;
+		resource.Desc = desc;
+		resource.Usage = desc.Usage;
+		m_Resources.push_back(std::move(resource));
+		m_Compiled = false;
+
+		return (ResourceHandle)m_Resources.size() - 1;
+	}
+
+	/**
+	 * @brief Adds a pass that runs after every pass added before it.
+	 *
+	 * @param name - Used in logs.
+	 * @param type - Determines the pipeline stages shader accesses happen in.
+	 * @param setup - Called right away, declares the accesses through the PassBuilder.
+	 * @param execute - Records the pass. Images are already in the declared layouts, don't transition them.
+	 */
+	void RenderGraph::AddPass(const std::string& name, PassType type, const std::function<void(PassBuilder&)>& setup, std::function<void(VkCommandBuffer)> execute)
+	{
+		VL_CORE_ASSERT(m_Initialized, "RenderGraph is not initialized!");
+
+		Pass pass;
+		pass.Name = name;
+		pass.Type = type;
+		pass.Execute = std::move(execute);
+		m_Passes.push_back(std::move(pass));
+
+		PassBuilder builder(this, (uint32_t)m_Passes.size() - 1);
+		setup(builder);
+
+		// One layout per image per pass
+		const std::vector<PassAccess>& accesses = m_Passes.back().Accesses;
+		for (uint32_t i = 0; i < (uint32_t)accesses.size(); i++)
+		{
+			for (uint32_t j = i + 1; j < (uint32_t)accesses.size(); j++)
+			{
+				VL_CORE_ASSERT(accesses[i].Resource != accesses[j].Resource || GetAccessInfo(accesses[i].Type).Layout == GetAccessInfo(accesses[j].Type).Layout,
+					"Pass {} uses resource {} in two different layouts!", name, accesses[i].Resource);
+			}
+		}
+
+		m_Compiled = false;
+	}
+
+	/**
+	 * @brief Culls passes, creates transient images and precomputes all barriers. Waits for the device to be idle
+	 * when transient images from an earlier Compile() have to be freed.
+	 */
+	void RenderGraph::Compile()
+	{
+		VL_CORE_ASSERT(m_Initialized, "RenderGraph is not initialized!");
+
+		ReleaseTransients();
+
+		m_Stats = {};
+		m_Stats.PassCount = (uint32_t)m_Passes.size();
+
+		CullPasses();
+		ComputeLifetimes();
+		CreateTransients();
+		BuildBarriers();
+
+		m_Compiled = true;
+		m_Version++;
+
+		VL_CORE_TRACE("Compiled render graph: {} passes ({} culled), {} image barriers in {} batches, {} transient images in {:.2f}MB instead of {:.2f}MB",
+			m_Stats.PassCount, m_Stats.CulledPassCount, m_Stats.ImageBarrierCount, m_Stats.BarrierBatchCount, m_Stats.TransientCount,
+			m_Stats.AllocatedBytes / (1024.0 * 1024.0), m_Stats.TransientBytes / (1024.0 * 1024.0));
+	}
+
+	/**
+	 * @brief Records every pass that wasn't culled together with its barriers.
+	 */
+	void RenderGraph::Execute(VkCommandBuffer cmd)
+	{
+		VL_CORE_ASSERT(m_Compiled, "RenderGraph has to be compiled before executing it!");
+
+		for (Pass& pass : m_Passes)
+		{
+			if (pass.Culled)
+				continue;
+
+			RecordBatch(pass.Batch, cmd);
+
+			// Keep the images' own layout tracking right for code that still uses it
+			for (const PassAccess& access : pass.Accesses)
+				GetImage(access.Resource)->SetLayout(GetAccessInfo(access.Type).Layout);
+
+			GpuProfiler::BeginScope(cmd, pass.Name.c_str());
+			pass.Execute(cmd);
+			GpuProfiler::EndScope(cmd);
+		}
+
+		RecordBatch(m_FinalBatch, cmd);
+
+		for (ResourceHandle i = 0; i < (ResourceHandle)m_Resources.size(); i++)
+		{
+			if (m_EndLayouts[i] != VK_IMAGE_LAYOUT_UNDEFINED)
+				GetImage(i)->SetLayout(m_EndLayouts[i]);
+		}
+	}
+
+	/**
+	 * @brief Removes every pass and resource. Transient images are freed as well, so the device is waited on.
+	 */
+	void RenderGraph::Clear()
+	{
+		ReleaseTransients();
+
+		m_Resources.clear();
+		m_Passes.clear();
+		m_FinalBatch = {};
+		m_EndLayouts.clear();
+		m_Compiled = false;
+		m_Stats = {};
+	}
+
+	/**
+	 * @brief Image behind a resource. Transient images only exist after Compile().
+	 */
+	Image* RenderGraph::GetImage(ResourceHandle resource) const
+	{
+		VL_CORE_ASSERT(resource < m_Resources.size(), "Invalid resource handle {}", resource);
+
+		const Resource& res = m_Resources[resource];
+		return res.Imported != nullptr ? res.Imported : res.Transient.get();
+	}
+
+	VkExtent2D RenderGraph::GetImageSize(ResourceHandle resource) const
+	{
+		VL_CORE_ASSERT(resource < m_Resources.size(), "Invalid resource handle {}", resource);
+
+		const Resource& res = m_Resources[resource];
+		return res.Imported != nullptr ? res.Imported->GetImageSize() : VkExtent2D{ res.Desc.Width, res.Desc.Height };
+	}
+
+	void RenderGraph::LogStats() const
+	{
+		VL_CORE_INFO("Render graph: {} passes ({} culled), {} image barriers in {} batches",
+			m_Stats.PassCount, m_Stats.CulledPassCount, m_Stats.ImageBarrierCount, m_Stats.BarrierBatchCount);
+		VL_CORE_INFO("    {} transient images, {:.2f}MB allocated, {:.2f}MB without aliasing",
+			m_Stats.TransientCount, m_Stats.AllocatedBytes / (1024.0 * 1024.0), m_Stats.TransientBytes / (1024.0 * 1024.0));
+
+		for (const Pass& pass : m_Passes)
+		{
+			VL_CORE_INFO("    {:<32} {}", pass.Name, pass.Culled ? "culled" : std::to_string(pass.Batch.Barriers.size()) + " barriers");
+		}
+	}
+
+	// Walks the passes backwards, a pass survives when something that survives (or an imported image) uses what it writes
+	void RenderGraph::CullPasses()
+	{
+		std::vector<bool> needed(m_Resources.size(), false);
+		for (ResourceHandle i = 0; i < (ResourceHandle)m_Resources.size(); i++)
+			needed[i] = m_Resources[i].Imported != nullptr;
+
+		for (int32_t i = (int32_t)m_Passes.size() - 1; i >= 0; i--)
+		{
+			Pass& pass = m_Passes[i];
+
+			bool writesAnything = false;
+			bool writesNeeded = false;
+			for (const PassAccess& access : pass.Accesses)
+			{
+				if (GetAccessInfo(access.Type).WriteMask == 0)
+					continue;
+
+				writesAnything = true;
+				writesNeeded |= needed[access.Resource];
+			}
+
+			// A pass that declares no writes does something the graph doesn't know about
+			pass.Culled = writesAnything && !writesNeeded;
+			if (pass.Culled)
+			{
+				m_Stats.CulledPassCount++;
+				continue;
+			}
+
+			for (const PassAccess& access : pass.Accesses)
+			{
+				if ((GetAccessInfo(access.Type).AccessMask & ~GetAccessInfo(access.Type).WriteMask) != 0)
+					needed[access.Resource] = true;
+			}
+		}
+	}
+
+	void RenderGraph::ComputeLifetimes()
+	{
+		for (Resource& resource : m_Resources)
+		{
+			resource.FirstPass = std::numeric_limits<uint32_t>::max();
+			resource.LastPass = 0;
+			resource.AllStages = 0;
+			resource.WriteAccess = 0;
+			resource.Usage = resource.Desc.Usage;
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)m_Passes.size(); i++)
+		{
+			if (m_Passes[i].Culled)
+				continue;
+
+			for (const PassAccess& access : m_Passes[i].Accesses)
+			{
+				Resource& resource = m_Resources[access.Resource];
+				const AccessInfo info = GetAccessInfo(access.Type);
+
+				resource.FirstPass = std::min(resource.FirstPass, i);
+				resource.LastPass = std::max(resource.LastPass, i);
+				resource.AllStages |= GetStage(m_Passes[i].Type, access.Type);
+				resource.WriteAccess |= info.WriteMask;
+				resource.Usage |= info.Usage;
+			}
+		}
+	}
+
+	/**
+	 * @brief Places every used transient image into the first memory block whose images are all dead during its
+	 * lifetime, largest images first. Every block is one allocation and images in it start at offset 0.
+	 */
+	void RenderGraph::CreateTransients()
+	{
+		std::vector<ResourceHandle> transients;
+		std::vector<VkMemoryRequirements> requirements(m_Resources.size());
+		for (ResourceHandle i = 0; i < (ResourceHandle)m_Resources.size(); i++)
+		{
+			Resource& resource = m_Resources[i];
+			if (resource.Imported != nullptr || resource.FirstPass == std::numeric_limits<uint32_t>::max())
+				continue;
+
+			// Requirements of an image that is never bound, the real one is created once its block is allocated
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent = { resource.Desc.Width, resource.Desc.Height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = resource.Desc.Format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = resource.Usage;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VkImage probe;
+			VL_CORE_RETURN_ASSERT(vkCreateImage(Device::GetDevice(), &imageInfo, nullptr, &probe), VK_SUCCESS, "failed to create image!");
+			vkGetImageMemoryRequirements(Device::GetDevice(), probe, &requirements[i]);
+			vkDestroyImage(Device::GetDevice(), probe, nullptr);
+
+			transients.push_back(i);
+			m_Stats.TransientBytes += requirements[i].size;
+		}
+
+		std::stable_sort(transients.begin(), transients.end(), [&](ResourceHandle a, ResourceHandle b) { return requirements[a].size > requirements[b].size; });
+
+		for (ResourceHandle handle : transients)
+		{
+			Resource& resource = m_Resources[handle];
+			const VkMemoryRequirements& req = requirements[handle];
+
+			uint32_t blockIndex = (uint32_t)m_MemoryBlocks.size();
+			for (uint32_t b = 0; m_AliasTransients && b < (uint32_t)m_MemoryBlocks.size(); b++)
+			{
+				const MemoryBlock& block = m_MemoryBlocks[b];
+				if ((block.Requirements.memoryTypeBits & req.memoryTypeBits) == 0)
+					continue;
+
+				bool overlaps = false;
+				for (ResourceHandle other : block.Resources)
+				{
+					const Resource& otherResource = m_Resources[other];
+					overlaps |= resource.FirstPass <= otherResource.LastPass && otherResource.FirstPass <= resource.LastPass;
+				}
+
+				if (!overlaps)
+				{
+					blockIndex = b;
+					break;
+				}
+			}
+
+			if (blockIndex == (uint32_t)m_MemoryBlocks.size())
+			{
+				m_MemoryBlocks.emplace_back();
+				m_MemoryBlocks.back().Requirements = req;
+			}
+
+			MemoryBlock& block = m_MemoryBlocks[blockIndex];
+			block.Requirements.size = std::max(block.Requirements.size, req.size);
+			block.Requirements.alignment = std::max(block.Requirements.alignment, req.alignment);
+			block.Requirements.memoryTypeBits &= req.memoryTypeBits;
+			block.Resources.push_back(handle);
+			resource.MemoryBlock = blockIndex;
+		}
+
+		for (MemoryBlock& block : m_MemoryBlocks)
+		{
+			VmaAllocationCreateInfo allocInfo{};
+			allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			VL_CORE_RETURN_ASSERT(vmaAllocateMemory(Device::GetAllocator(), &block.Requirements, &allocInfo, &block.Allocation, nullptr),
+				VK_SUCCESS,
+				"failed to allocate transient image memory!"
+			);
+			MemoryService::Track(block.Allocation, MemoryCategory::RenderTarget);
+			m_Stats.AllocatedBytes += block.Requirements.size;
+
+			for (ResourceHandle handle : block.Resources)
+			{
+				Resource& resource = m_Resources[handle];
+
+				Image::CreateInfo imageInfo{};
+				imageInfo.Width = resource.Desc.Width;
+				imageInfo.Height = resource.Desc.Height;
+				imageInfo.Format = resource.Desc.Format;
+				imageInfo.Usage = resource.Usage;
+				imageInfo.Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				imageInfo.Aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+				imageInfo.DebugName = resource.Desc.DebugName.c_str();
+				imageInfo.AliasAllocation = block.Allocation;
+				imageInfo.AliasOffset = 0;
+				resource.Transient = std::make_unique<Image>(imageInfo);
+			}
+		}
+
+		m_Stats.TransientCount = (uint32_t)transients.size();
+	}
+
+	/**
+	 * @brief Simulates one execution and records, for every pass, the barriers it needs. Layout changes and writes
+	 * wait for everything that touched the image before, reads only wait for the last write and only once per
+	 * pipeline stage.
+	 */
+	void RenderGraph::BuildBarriers()
+	{
+		struct ResourceState
+		{
+			bool Used = false;
+			VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags WriteStages = 0; // Last write, or the stages that waited for the last layout transition
+			VkAccessFlags WriteAccess = 0;
+			VkPipelineStageFlags ReadStages = 0; // Reads since the last write
+			VkPipelineStageFlags VisibleStages = 0; // Stages that already waited for the last write
+		};
+		std::vector<ResourceState> states(m_Resources.size());
+
+		// The memory a transient image takes over was last used by the block's previous image, or by the block's
+		// last image during the previous execution
+		auto getPreviousOccupant = [&](ResourceHandle handle)
+		{
+			const MemoryBlock& block = m_MemoryBlocks[m_Resources[handle].MemoryBlock];
+			ResourceHandle previous = handle;
+			uint32_t previousLastPass = 0;
+			ResourceHandle latest = handle;
+			for (ResourceHandle other : block.Resources)
+			{
+				const Resource& otherResource = m_Resources[other];
+				if (otherResource.LastPass < m_Resources[handle].FirstPass && (previous == handle || otherResource.LastPass >= previousLastPass))
+				{
+					previous = other;
+					previousLastPass = otherResource.LastPass;
+				}
+				if (otherResource.LastPass > m_Resources[latest].LastPass)
+					latest = other;
+			}
+			return previous != handle ? previous : latest;
+		};
+
+		for (Pass& pass : m_Passes)
+		{
+			pass.Batch = {};
+			if (pass.Culled)
+				continue;
+
+			for (const PassAccess& access : pass.Accesses)
+			{
+				const AccessInfo info = GetAccessInfo(access.Type);
+				const VkPipelineStageFlags stage = GetStage(pass.Type, access.Type);
+				const Resource& resource = m_Resources[access.Resource];
+				ResourceState& state = states[access.Resource];
+
+				// Already handled by an earlier access of the same pass
+				bool handled = false;
+				for (Barrier& barrier : pass.Batch.Barriers)
+				{
+					if (barrier.Resource == access.Resource)
+					{
+						barrier.DstAccess |= info.AccessMask;
+						pass.Batch.DstStages |= stage;
+						handled = true;
+						break;
+					}
+				}
+
+				Barrier barrier{ access.Resource, state.Layout, info.Layout, 0, info.AccessMask, false };
+				VkPipelineStageFlags srcStages = 0;
+				bool needed = false;
+
+				if (handled)
+					needed = false;
+				else if (!state.Used)
+				{
+					needed = true;
+					if (resource.Imported != nullptr)
+					{
+						// Whatever happened to it before the graph runs
+						barrier.FromCurrentLayout = true;
+						barrier.SrcAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+						srcStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+					}
+					else
+					{
+						const Resource& previous = m_Resources[getPreviousOccupant(access.Resource)];
+						barrier.OldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+						barrier.SrcAccess = previous.WriteAccess;
+						srcStages = previous.AllStages;
+					}
+				}
+				else if (state.Layout != info.Layout || info.WriteMask != 0)
+				{
+					srcStages = state.WriteStages | state.ReadStages;
+					barrier.SrcAccess = state.WriteAccess;
+					needed = state.Layout != info.Layout || srcStages != 0;
+				}
+				else if (state.WriteStages != 0 && (stage & ~state.VisibleStages) != 0)
+				{
+					srcStages = state.WriteStages;
+					barrier.SrcAccess = state.WriteAccess;
+					needed = true;
+				}
+
+				if (needed)
+				{
+					pass.Batch.Barriers.push_back(barrier);
+					pass.Batch.SrcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					pass.Batch.DstStages |= stage;
+				}
+
+				const bool transitioned = !state.Used || state.Layout != info.Layout;
+				state.Used = true;
+				state.Layout = info.Layout;
+				if (transitioned)
+				{
+					// The transition itself is a write only the stages of this barrier waited for
+					state.WriteStages = stage;
+					state.WriteAccess = 0;
+					state.ReadStages = 0;
+					state.VisibleStages = stage;
+				}
+
+				if (info.WriteMask != 0)
+				{
+					state.WriteStages = stage;
+					state.WriteAccess = info.WriteMask;
+					state.ReadStages = 0;
+					state.VisibleStages = 0;
+				}
+				else
+				{
+					state.ReadStages |= stage;
+					if (needed || handled)
+						state.VisibleStages |= stage;
+				}
+			}
+
+			if (!pass.Batch.Barriers.empty())
+			{
+				m_Stats.BarrierBatchCount++;
+				m_Stats.ImageBarrierCount += (uint32_t)pass.Batch.Barriers.size();
+			}
+		}
+
+		m_FinalBatch = {};
+		m_EndLayouts.assign(m_Resources.size(), VK_IMAGE_LAYOUT_UNDEFINED);
+		for (ResourceHandle i = 0; i < (ResourceHandle)m_Resources.size(); i++)
+		{
+			const Resource& resource = m_Resources[i];
+			const ResourceState& state = states[i];
+			if (!state.Used)
+				continue;
+
+			m_EndLayouts[i] = state.Layout;
+			if (resource.Imported == nullptr || resource.FinalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.FinalLayout == state.Layout)
+				continue;
+
+			// Next user is unknown, make everything available to everyone
+			m_FinalBatch.Barriers.push_back({ i, state.Layout, resource.FinalLayout, state.WriteAccess, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, false });
+			m_FinalBatch.SrcStages |= (state.WriteStages | state.ReadStages) != 0 ? state.WriteStages | state.ReadStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			m_FinalBatch.DstStages |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			m_EndLayouts[i] = resource.FinalLayout;
+		}
+
+		if (!m_FinalBatch.Barriers.empty())
+		{
+			m_Stats.BarrierBatchCount++;
+			m_Stats.ImageBarrierCount += (uint32_t)m_FinalBatch.Barriers.size();
+		}
+	}
+
+	void RenderGraph::RecordBatch(const BarrierBatch& batch, VkCommandBuffer cmd)
+	{
+		if (batch.Barriers.empty())
+			return;
+
+		std::vector<VkImageMemoryBarrier> barriers(batch.Barriers.size());
+		for (uint32_t i = 0; i < (uint32_t)batch.Barriers.size(); i++)
+		{
+			const Barrier& desc = batch.Barriers[i];
+			Image* image = GetImage(desc.Resource);
+
+			VkImageMemoryBarrier& barrier = barriers[i];
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = desc.FromCurrentLayout ? image->GetLayout() : desc.OldLayout;
+			barrier.newLayout = desc.NewLayout;
+			barrier.srcAccessMask = desc.SrcAccess;
+			barrier.dstAccessMask = desc.DstAccess;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image->GetImage();
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+		}
+
+		vkCmdPipelineBarrier(cmd, batch.SrcStages, batch.DstStages, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+	}
+
+	void RenderGraph::ReleaseTransients()
+	{
+		if (m_MemoryBlocks.empty())
+			return;
+
+		// Images of earlier frames may still be executing
+		vkDeviceWaitIdle(Device::GetDevice());
+
+		for (Resource& resource : m_Resources)
+		{
+			resource.Transient.reset();
+			resource.MemoryBlock = std::numeric_limits<uint32_t>::max();
+		}
+
+		for (MemoryBlock& block : m_MemoryBlocks)
+		{
+			MemoryService::Untrack(block.Allocation);
+			vmaFreeMemory(Device::GetAllocator(), block.Allocation);
+		}
+		m_MemoryBlocks.clear();
+
+		m_Compiled = false;
+	}
+
+	void RenderGraph::Reset()
+	{
+		m_Resources.clear();
+		m_Passes.clear();
+		m_MemoryBlocks.clear();
+		m_FinalBatch = {};
+		m_EndLayouts.clear();
+		m_AliasTransients = true;
+		m_Compiled = false;
+		m_Stats = {};
+		m_Initialized = false;
+	}
+
+}
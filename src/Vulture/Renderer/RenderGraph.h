@@ -0,0 +1,195 @@
+#pragma once
+#include "pch.h"
+#include "Utility/Utility.h"
+
+#include "Vulkan/Image.h"
+
+namespace Vulture
+{
+	// Graph of image passes. Passes run in the order they were added and declare which images they read and write,
+	// the graph derives every layout transition and memory dependency from that. All barriers a pass needs are
+	// issued in a single vkCmdPipelineBarrier, reads that follow each other in the same layout get none. Passes
+	// whose results never reach an imported image are culled. Transient images only live between their first and
+	// last use and the ones whose lifetimes don't overlap share memory.
+	//
+	// The graph is built once and executed every frame. After changing it (e.g. on resize) call Clear(), add
+	// everything again and Compile().
+	class RenderGraph
+	{
+	public:
+		using ResourceHandle = uint32_t;
+		static constexpr ResourceHandle InvalidResource = std::numeric_limits<uint32_t>::max();
+
+		enum class PassType
+		{
+			Compute,
+			Graphics, // Passes begin their own render passes, attachments have to be declared anyway
+			RayTracing,
+			Transfer,
+		};
+
+		enum class Access
+		{
+			Sampled,          // Read through a sampler
+			StorageRead,      // imageLoad
+			StorageWrite,     // imageStore, previous contents are not needed
+			StorageReadWrite, // imageLoad and imageStore
+			TransferSrc,
+			TransferDst,
+			ColorAttachment,
+		};
+
+		// Transient color image, its contents are undefined at the first use in every execution
+		struct ImageDesc
+		{
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			VkFormat Format = VK_FORMAT_R16G16B16A16_SFLOAT;
+			VkImageUsageFlags Usage = 0; // Usage needed by the declared accesses is added automatically
+			std::string DebugName;
+		};
+
+		struct CreateInfo
+		{
+			bool AliasTransients = true; // Disable to give every transient image its own memory
+		};
+
+		struct Stats
+		{
+			uint32_t PassCount = 0;
+			uint32_t CulledPassCount = 0;
+			uint32_t BarrierBatchCount = 0; // vkCmdPipelineBarrier calls per execution
+			uint32_t ImageBarrierCount = 0;
+			uint32_t TransientCount = 0;
+			VkDeviceSize TransientBytes = 0; // What the transient images would take without aliasing
+			VkDeviceSize AllocatedBytes = 0; // What they actually take
+		};
+
+		class PassBuilder
+		{
+		public:
+			void Read(ResourceHandle resource, Access access = Access::Sampled);
+			void Write(ResourceHandle resource, Access access = Access::StorageWrite);
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph* graph, uint32_t passIndex) : m_Graph(graph), m_PassIndex(passIndex) {}
+
+			RenderGraph* m_Graph;
+			uint32_t m_PassIndex;
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		RenderGraph() = default;
+		RenderGraph(const CreateInfo& createInfo);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+		RenderGraph(RenderGraph&&) = delete;
+		RenderGraph& operator=(RenderGraph&&) = delete;
+
+		ResourceHandle ImportImage(Image* image, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+		ResourceHandle CreateImage(const ImageDesc& desc);
+		void AddPass(const std::string& name, PassType type, const std::function<void(PassBuilder&)>& setup, std::function<void(VkCommandBuffer)> execute);
+
+		void Compile();
+		void Execute(VkCommandBuffer cmd);
+		void Clear();
+
+		Image* GetImage(ResourceHandle resource) const;
+		VkExtent2D GetImageSize(ResourceHandle resource) const;
+
+		// Incremented by every Compile(), anything referencing transient images (descriptor sets) has to be updated
+		inline uint64_t GetVersion() const { return m_Version; }
+		inline const Stats& GetStats() const { return m_Stats; }
+		void LogStats() const;
+
+		inline bool IsCompiled() const { return m_Compiled; }
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		struct Resource
+		{
+			Image* Imported = nullptr;
+			VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			ImageDesc Desc;
+			VkImageUsageFlags Usage = 0;
+			Scope<Image> Transient;
+			uint32_t MemoryBlock = std::numeric_limits<uint32_t>::max();
+
+			// Kept passes only
+			uint32_t FirstPass = std::numeric_limits<uint32_t>::max();
+			uint32_t LastPass = 0;
+			VkPipelineStageFlags AllStages = 0;
+			VkAccessFlags WriteAccess = 0;
+		};
+
+		struct PassAccess
+		{
+			ResourceHandle Resource;
+			Access Type;
+		};
+
+		struct Barrier
+		{
+			ResourceHandle Resource;
+			VkImageLayout OldLayout;
+			VkImageLayout NewLayout;
+			VkAccessFlags SrcAccess;
+			VkAccessFlags DstAccess;
+			bool FromCurrentLayout; // First use of an imported image, the old layout is only known when executing
+		};
+
+		struct BarrierBatch
+		{
+			std::vector<Barrier> Barriers;
+			VkPipelineStageFlags SrcStages = 0;
+			VkPipelineStageFlags DstStages = 0;
+		};
+
+		struct Pass
+		{
+			std::string Name;
+			PassType Type;
+			std::vector<PassAccess> Accesses;
+			std::function<void(VkCommandBuffer)> Execute;
+
+			bool Culled = false;
+			BarrierBatch Batch;
+		};
+
+		struct MemoryBlock
+		{
+			VmaAllocation Allocation = VK_NULL_HANDLE;
+			VkMemoryRequirements Requirements{};
+			std::vector<ResourceHandle> Resources;
+		};
+
+		void CullPasses();
+		void ComputeLifetimes();
+		void CreateTransients();
+		void BuildBarriers();
+		void ReleaseTransients();
+		void RecordBatch(const BarrierBatch& batch, VkCommandBuffer cmd);
+
+		std::vector<Resource> m_Resources;
+		std::vector<Pass> m_Passes;
+		std::vector<MemoryBlock> m_MemoryBlocks;
+		BarrierBatch m_FinalBatch; // Imported images that need to end in a specific layout
+		std::vector<VkImageLayout> m_EndLayouts; // Layout of every resource after an execution
+
+		bool m_AliasTransients = true;
+		bool m_Compiled = false;
+		uint64_t m_Version = 0;
+		Stats m_Stats;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
@@ -0,0 +1,205 @@
+#include "pch.h"
+#include "RenderSnapshot.h"
+
+#include "Scene/Scene.h"
+#include "Scene/Components.h"
+#include "Math/PerspectiveCamera.h"
+#include "Asset/AssetManager.h"
+
+namespace Vulture
+{
+	/**
+	 * @brief Copies world transforms of every entity with a loaded mesh, the camera and the first tonemap and
+	 * bloom settings found in the scene. Has to run on the thread that updates the scene.
+	 *
+	 * @param scene - Scene to extract from, its world transforms are brought up to date first.
+	 * @param camera - Optional camera to copy.
+	 */
+	void RenderSnapshot::Extract(Scene& scene, const PerspectiveCamera* camera)
+	{
+		scene.UpdateTransforms();
+
+		entt::registry& registry = scene.GetRegistry();
+
+		auto view = registry.view<MeshComponent, TransformComponent>();
+		Instances.clear();
+		for (auto entity : view)
+		{
+			MeshComponent& meshComponent = view.get<MeshComponent>(entity);
+			if (!meshComponent.AssetHandle.IsAssetLoaded())
+				continue;
+
+			Instance instance{};
+			instance.Entity = entity;
+			instance.Transform = view.get<TransformComponent>(entity).WorldMatrix;
+			instance.MeshPtr = meshComponent.AssetHandle.GetMesh();
+
+			MaterialComponent* materialComponent = registry.try_get<MaterialComponent>(entity);
+			if (materialComponent != nullptr && materialComponent->AssetHandle.IsAssetLoaded())
+				instance.MaterialPtr = materialComponent->AssetHandle.GetMaterial();
+
+			Instances.push_back(instance);
+		}
+
+		HasCamera = camera != nullptr;
+		if (HasCamera)
+		{
+			Camera.View = camera->ViewMat;
+			Camera.Proj = camera->ProjMat;
+			Camera.Position = camera->Translation;
+			Camera.NearFar = camera->NearFar;
+			Camera.FOV = camera->FOV;
+		}
+
+		auto tonemapView = registry.view<TonemapperSettingsComponent>();
+		HasTonemapSettings = tonemapView.begin() != tonemapView.end();
+		if (HasTonemapSettings)
+			TonemapSettings = tonemapView.get<TonemapperSettingsComponent>(*tonemapView.begin()).Settings;
+
+		auto bloomView = registry.view<BloomSettingsComponent>();
+		HasBloomSettings = bloomView.begin() != bloomView.end();
+		if (HasBloomSettings)
+			BloomSettings = bloomView.get<BloomSettingsComponent>(*bloomView.begin()).Settings;
+	}
+
+	/**
+	 * @brief Empties the snapshot, keeps the instance storage allocated.
+	 */
+	void RenderSnapshot::Clear()
+	{
+		Instances.clear();
+		HasCamera = false;
+		HasTonemapSettings = false;
+		HasBloomSettings = false;
+		FrameNumber = 0;
+		DeltaTime = 0.0;
+		InterpolationAlpha = 1.0;
+	}
+
+	void RenderSnapshotQueue::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.SnapshotCount >= 2, "At least 2 snapshots are needed for the simulation and rendering to overlap!");
+
+		for (uint32_t i = 0; i < createInfo.SnapshotCount; i++)
+		{
+			m_Snapshots.push_back(std::make_unique<RenderSnapshot>());
+			m_Free.push_back(m_Snapshots.back().get());
+		}
+
+		m_Initialized = true;
+	}
+
+	void RenderSnapshotQueue::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		Reset();
+	}
+
+	RenderSnapshotQueue::RenderSnapshotQueue(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	RenderSnapshotQueue::~RenderSnapshotQueue()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Returns a cleared snapshot to fill, blocks while all of them are queued or being rendered.
+	 *
+	 * @return nullptr once the queue was closed.
+	 */
+	RenderSnapshot* RenderSnapshotQueue::BeginWrite()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CV.wait(lock, [this]() { return !m_Free.empty() || m_Closed; });
+		if (m_Closed)
+			return nullptr;
+
+		RenderSnapshot* snapshot = m_Free.back();
+		m_Free.pop_back();
+		lock.unlock();
+
+		snapshot->Clear();
+		snapshot->AssetPin = AssetManager::PinAssets();
+		return snapshot;
+	}
+
+	/**
+	 * @brief Hands a snapshot returned by BeginWrite() over to the reader.
+	 */
+	void RenderSnapshotQueue::EndWrite(RenderSnapshot* snapshot)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Ready.push_back(snapshot);
+		}
+		m_CV.notify_all();
+	}
+
+	/**
+	 * @brief Returns the oldest written snapshot, blocks until there is one.
+	 *
+	 * @return nullptr once the queue was closed and every written snapshot was read.
+	 */
+	RenderSnapshot* RenderSnapshotQueue::BeginRead()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CV.wait(lock, [this]() { return !m_Ready.empty() || m_Closed; });
+		if (m_Ready.empty())
+			return nullptr;
+
+		RenderSnapshot* snapshot = m_Ready.front();
+		m_Ready.pop_front();
+		return snapshot;
+	}
+
+	/**
+	 * @brief Gives a snapshot returned by BeginRead() back to the writer.
+	 */
+	void RenderSnapshotQueue::EndRead(RenderSnapshot* snapshot)
+	{
+		AssetManager::UnpinAssets(snapshot->AssetPin);
+		snapshot->AssetPin = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Free.push_back(snapshot);
+		}
+		m_CV.notify_all();
+	}
+
+	/**
+	 * @brief Wakes up both sides, the writer gets nullptr right away and the reader after draining queued snapshots.
+	 */
+	void RenderSnapshotQueue::Close()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Closed = true;
+		}
+		m_CV.notify_all();
+	}
+
+	void RenderSnapshotQueue::Reset()
+	{
+		for (auto& snapshot : m_Snapshots)
+		{
+			if (snapshot->AssetPin != 0)
+				AssetManager::UnpinAssets(snapshot->AssetPin);
+		}
+
+		m_Free.clear();
+		m_Ready.clear();
+		m_Snapshots.clear();
+		m_Closed = false;
+		m_Initialized = false;
+	}
+
+}
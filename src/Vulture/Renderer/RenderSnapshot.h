@@ -0,0 +1,113 @@
+#pragma once
+#include "pch.h"
+#include "entt/entt.h"
+#include "Utility/Utility.h"
+
+#include "glm/glm.hpp"
+
+#include "Effects/Tonemap.h"
+#include "Effects/Bloom.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace Vulture
+{
+	class Scene;
+	class Mesh;
+	class Material;
+	class PerspectiveCamera;
+
+	// Everything the renderer needs from a simulated frame, copied out of the scene so the simulation can already
+	// modify the registry for the next frame while this one is recorded. Meshes and materials are referenced by
+	// pointer, RenderSnapshotQueue pins assets while the snapshot is in flight so unloads are deferred until it's read.
+	class RenderSnapshot
+	{
+	public:
+		struct Instance
+		{
+			entt::entity Entity = entt::null;
+			glm::mat4 Transform{ 1.0f };
+			Mesh* MeshPtr = nullptr;
+			Material* MaterialPtr = nullptr; // Null when the entity has no loaded material
+		};
+
+		struct CameraData
+		{
+			glm::mat4 View{ 1.0f };
+			glm::mat4 Proj{ 1.0f };
+			glm::vec3 Position{ 0.0f };
+			glm::vec2 NearFar{ 0.0f };
+			float FOV = 45.0f;
+		};
+
+		void Extract(Scene& scene, const PerspectiveCamera* camera = nullptr);
+		void Clear();
+
+		std::vector<Instance> Instances;
+		CameraData Camera;
+		bool HasCamera = false;
+
+		Tonemap::TonemapInfo TonemapSettings{};
+		bool HasTonemapSettings = false;
+		Bloom::BloomInfo BloomSettings{};
+		bool HasBloomSettings = false;
+
+		uint64_t FrameNumber = 0;
+		double DeltaTime = 0.0;
+		double InterpolationAlpha = 1.0; // See Application::GetInterpolationAlpha()
+
+		uint64_t AssetPin = 0; // See AssetManager::PinAssets(), 0 when the snapshot isn't in flight
+	};
+
+	// Fixed number of snapshots cycled between one producer (simulation) and one consumer (render thread). With 2 the
+	// simulation can be one frame ahead of rendering, with 3 two frames. The producer blocks when every snapshot is
+	// either waiting to be rendered or being rendered, so the simulation never runs away from the renderer.
+	class RenderSnapshotQueue
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32_t SnapshotCount = 2;
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		RenderSnapshotQueue() = default;
+		RenderSnapshotQueue(const CreateInfo& createInfo);
+		~RenderSnapshotQueue();
+
+		RenderSnapshotQueue(const RenderSnapshotQueue&) = delete;
+		RenderSnapshotQueue& operator=(const RenderSnapshotQueue&) = delete;
+		RenderSnapshotQueue(RenderSnapshotQueue&&) = delete;
+		RenderSnapshotQueue& operator=(RenderSnapshotQueue&&) = delete;
+
+		RenderSnapshot* BeginWrite();
+		void EndWrite(RenderSnapshot* snapshot);
+
+		RenderSnapshot* BeginRead();
+		void EndRead(RenderSnapshot* snapshot);
+
+		void Close();
+
+		inline uint32_t GetSnapshotCount() const { return (uint32_t)m_Snapshots.size(); }
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		std::vector<Scope<RenderSnapshot>> m_Snapshots;
+		std::vector<RenderSnapshot*> m_Free;
+		std::deque<RenderSnapshot*> m_Ready; // Oldest first
+
+		std::mutex m_Mutex;
+		std::condition_variable m_CV;
+		bool m_Closed = false;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
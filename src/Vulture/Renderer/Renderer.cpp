@@ -2,8 +2,7 @@
 #include "Renderer.h"
 #include "Scene/Scene.h"
 #include "Scene/Components.h"
-
-#include "lodepng.h"
+#include "Asset/TextureStreamer.h"
 
 #ifdef VL_IMGUI
 #include <backends/imgui_impl_glfw.h>
@@ -23,6 +22,13 @@ namespace Vulture
 		s_Initialized = false;
 		vkDeviceWaitIdle(Device::GetDevice());
 		vkFreeCommandBuffers(Device::GetDevice(), Device::GetGraphicsCommandPool(), (uint32_t)s_CommandBuffers.size(), s_CommandBuffers.data());
+		s_Recorder.reset();
+		GpuProfiler::Destroy();
+		FrameAllocator::Destroy();
+
+		// Every frame is finished after the wait, write out whatever is still pending
+		s_Readback->Resolve(s_SubmittedFrames);
+		s_Readback.reset();
 
 		s_Swapchain.reset();
 
@@ -39,10 +45,13 @@ namespace Vulture
 		s_Pool.reset();
 
 #ifdef VL_IMGUI
-		ImGui_ImplVulkan_DestroyDeviceObjects();
+		if (!IsHeadless())
+			ImGui_ImplVulkan_DestroyDeviceObjects();
 #endif
 
 		DestroyImGui();
+
+		s_Window = nullptr;
 	}
 
 	static void CheckVkResult(VkResult err)
@@ -53,6 +62,29 @@ namespace Vulture
 	}
 
 	void Renderer::Init(Window& window, uint32_t maxFramesInFlight)
+	{
+		s_Window = &window;
+		InitInternal(maxFramesInFlight);
+	}
+
+	/**
+	 * @brief Initializes the renderer without a window. Frames are rendered into a ring of offscreen images
+	 * with the same BeginFrame/EndFrame semantics, use ReadFrame or SaveFrameToFile to get them back.
+	 *
+	 * @param extent - Size of the offscreen images.
+	 * @param maxFramesInFlight - Also the number of offscreen images.
+	 */
+	void Renderer::InitHeadless(VkExtent2D extent, uint32_t maxFramesInFlight)
+	{
+		VL_CORE_ASSERT(Device::IsHeadless(), "Headless renderer requires a headless device!");
+		VL_CORE_ASSERT(extent.width != 0 && extent.height != 0, "Headless extent can't be 0!");
+
+		s_Window = nullptr;
+		s_HeadlessExtent = extent;
+		InitInternal(maxFramesInFlight);
+	}
+
+	void Renderer::InitInternal(uint32_t maxFramesInFlight)
 	{
 		m_MaxFramesInFlight = maxFramesInFlight;
 
@@ -61,8 +93,12 @@ namespace Vulture
 		s_RendererLinearSamplerRepeat.Init(SamplerInfo(VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR));
 		s_RendererNearestSampler.Init(SamplerInfo(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST));
 
+		s_Readback = std::make_unique<ReadbackRing>(ReadbackRing::CreateInfo{ maxFramesInFlight * 2, 2 });
+		s_Recorder = std::make_unique<ParallelRecorder>(ParallelRecorder::CreateInfo{ maxFramesInFlight });
+		GpuProfiler::Init({ maxFramesInFlight });
+		FrameAllocator::Init({ maxFramesInFlight });
+
 		s_Initialized = true;
-		s_Window = &window;
 		CreateDescriptorSets();
 		RecreateSwapchain();
 		CreateCommandBuffers();
@@ -96,7 +132,13 @@ namespace Vulture
 	 */
 	bool Renderer::BeginFrame()
 	{
-		return BeginFrameInternal();
+		VL_PROFILE_FUNCTION();
+		Timer timer;
+		const bool started = BeginFrameInternal();
+		s_FrameTimings.AcquireMs += timer.ElapsedMillis();
+
+		s_RecordTimer.Reset();
+		return started;
 	}
 
 	/*
@@ -107,7 +149,77 @@ namespace Vulture
 	 */
 	bool Renderer::EndFrame()
 	{
-		return EndFrameInternal();
+		VL_PROFILE_FUNCTION();
+		s_FrameTimings.RecordMs += s_RecordTimer.ElapsedMillis();
+
+		const bool ended = EndFrameInternal();
+		VL_PROFILE_FRAME("Frame");
+
+		return ended;
+	}
+
+	/**
+	 * @brief Returns stage timings accumulated since the previous call and starts over.
+	 */
+	Renderer::FrameTimings Renderer::TakeFrameTimings()
+	{
+		FrameTimings timings = s_FrameTimings;
+		s_FrameTimings = {};
+		return timings;
+	}
+
+	void Renderer::SetHeadlessExtent(VkExtent2D extent)
+	{
+		VL_CORE_ASSERT(IsHeadless(), "Only headless renderer can be resized manually, resize the window instead!");
+		VL_CORE_ASSERT(extent.width != 0 && extent.height != 0, "Headless extent can't be 0!");
+
+		if (extent.width == s_HeadlessExtent.width && extent.height == s_HeadlessExtent.height)
+			return;
+
+		s_HeadlessExtent = extent;
+		s_HeadlessResized = true;
+	}
+
+	/**
+	 * @brief Returns true once after the window or the headless extent was resized.
+	 */
+	bool Renderer::TakeResizeRequest()
+	{
+		if (IsHeadless())
+		{
+			const bool resized = s_HeadlessResized;
+			s_HeadlessResized = false;
+			return resized;
+		}
+
+		std::unique_lock<std::mutex> lock(s_PlatformMutex);
+		if (!s_Window->WasWindowResized() && !s_RecreatePending)
+			return false;
+
+		s_Window->ResetWindowResizedFlag();
+		return true;
+	}
+
+	/**
+	 * @brief Polls window events and feeds ImGui its platform input. GLFW may only be used from the main thread,
+	 * so with a render thread this is the only place that touches it and the render thread reads the window state
+	 * and ImGui input under the same lock. Blocks while the window is minimized.
+	 */
+	void Renderer::PollEvents()
+	{
+		if (IsHeadless())
+			return;
+
+		std::unique_lock<std::mutex> lock(s_PlatformMutex);
+		s_Window->PollEvents();
+
+		// Nothing can be presented to a minimized window
+		while ((s_Window->GetExtent().width == 0 || s_Window->GetExtent().height == 0) && !s_Window->ShouldClose())
+			glfwWaitEvents();
+
+#ifdef VL_IMGUI
+		ImGui_ImplGlfw_NewFrame();
+#endif
 	}
 
 	void Renderer::SetImGuiFunction(std::function<void()> fn)
@@ -117,6 +229,8 @@ namespace Vulture
 
 	void Renderer::RayTrace(VkCommandBuffer cmdBuf, SBT* sbt, VkExtent2D imageSize, uint32_t depth /* = 1*/)
 	{
+		GpuProfileScope scope(cmdBuf, "Ray Trace");
+
 		Device::vkCmdTraceRaysKHR(
 			cmdBuf,
 			sbt->GetRGenRegionPtr(),
@@ -139,9 +253,8 @@ namespace Vulture
 	{
 		VL_CORE_ASSERT(!s_IsFrameStarted, "Can't call BeginFrame while already in progress!");
 
-		if (s_Window->WasWindowResized())
+		if (TakeResizeRequest())
 		{
-			s_Window->ResetWindowResizedFlag();
 			RecreateSwapchain();
 
 			return false;
@@ -155,6 +268,12 @@ namespace Vulture
 		}
 		VL_CORE_ASSERT(result == VK_SUCCESS, "failed to acquire swap chain image!");
 
+		// Acquire waited for the fence of the frame that used this frame index before, so did every earlier frame
+		s_Readback->Resolve(s_SubmittedFrames >= m_MaxFramesInFlight ? s_SubmittedFrames - m_MaxFramesInFlight : 0);
+		s_Recorder->BeginFrame(s_CurrentFrameIndex);
+		FrameAllocator::BeginFrame(s_CurrentFrameIndex);
+		TextureStreamer::BeginFrame(s_CurrentFrameIndex);
+
 		s_IsFrameStarted = true;
 		auto commandBuffer = GetCurrentCommandBuffer();
 
@@ -166,6 +285,9 @@ namespace Vulture
 			VK_SUCCESS,
 			"failed to begin recording command buffer!"
 		);
+
+		// The fence of this frame index was waited on, timestamps written by its previous use are ready
+		GpuProfiler::BeginFrame(commandBuffer, s_CurrentFrameIndex);
 		return true;
 	}
 
@@ -181,14 +303,19 @@ namespace Vulture
 		auto commandBuffer = GetCurrentCommandBuffer();
 		VL_CORE_ASSERT(s_IsFrameStarted, "Cannot call EndFrame while frame is not in progress");
 
+		RecordFrameCaptures();
+		GpuProfiler::EndFrame(commandBuffer);
+		FrameAllocator::EndFrame();
+
 		// End recording the command buffer
 		auto success = vkEndCommandBuffer(commandBuffer);
 		VL_CORE_ASSERT(success == VK_SUCCESS, "Failed to record command buffer!");
 
 		// Submit the command buffer for execution and present the image
-		if (s_Window->WasWindowResized())
+		if (TakeResizeRequest())
 		{
-			s_Window->ResetWindowResizedFlag();
+			s_Readback->Cancel(s_SubmittedFrames + 1);
+			GpuProfiler::CancelFrame();
 			RecreateSwapchain();
 
 			s_IsFrameStarted = false;
@@ -197,10 +324,13 @@ namespace Vulture
 			return false;
 		}
 		auto result = s_Swapchain->SubmitCommandBuffers(&commandBuffer, s_CurrentImageIndex);
+		s_SubmittedFrames++;
+		s_FrameTimings.SubmitMs += s_Swapchain->GetLastSubmitTime();
+		s_FrameTimings.PresentMs += s_Swapchain->GetLastPresentTime();
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 		{
 			// Recreate swap chain or handle window resize
-			s_Window->ResetWindowResizedFlag();
+			TakeResizeRequest();
 			RecreateSwapchain();
 			retVal = false;
 		}
@@ -210,6 +340,7 @@ namespace Vulture
 		}
 
 		// End the frame and update frame index
+		s_LastImageIndex = s_CurrentImageIndex;
 		s_IsFrameStarted = false;
 		s_CurrentFrameIndex = (s_CurrentFrameIndex + 1) % m_MaxFramesInFlight;
 		return retVal;
@@ -223,8 +354,9 @@ namespace Vulture
 	 * @param framebuffer - The framebuffer to use in the render pass.
 	 * @param renderPass - The render pass to begin.
 	 * @param extent - The extent (width and height) of the render area.
+	 * @param contents - VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when the pass is recorded with RecordParallel.
 	 */
-	void Renderer::BeginRenderPass(const std::vector<VkClearValue>& clearColors, VkFramebuffer framebuffer, VkRenderPass renderPass, VkExtent2D extent)
+	void Renderer::BeginRenderPass(const std::vector<VkClearValue>& clearColors, VkFramebuffer framebuffer, VkRenderPass renderPass, VkExtent2D extent, VkSubpassContents contents)
 	{
 		VL_CORE_ASSERT(s_IsFrameStarted, "Cannot call BeginSwapchainRenderPass while frame is not in progress");
 
@@ -258,7 +390,7 @@ namespace Vulture
 		renderPassInfo.pClearValues = clearColors.data();
 
 		// Begin the render pass for the current command buffer
-		vkCmdBeginRenderPass(GetCurrentCommandBuffer(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(GetCurrentCommandBuffer(), &renderPassInfo, contents);
 	}
 
 	/**
@@ -272,82 +404,164 @@ namespace Vulture
 		vkCmdEndRenderPass(GetCurrentCommandBuffer());
 	}
 
-	// TODO: description
-	void Renderer::SaveImageToFile(const std::string& filepath, Image* image)
+	/**
+	 * @brief Saves the image without stalling. Inside of a frame the copy is recorded into the frame's command
+	 * buffer (so it can't be called inside of a render pass) and the file is written on a worker thread once the
+	 * frame finished on the GPU. Outside of a frame the copy is submitted right away.
+	 *
+	 * @param filepath - Output file, empty picks the next free Rendered_Images/RenderN file.
+	 * @param image - Image to save, it's returned to its current layout afterwards.
+	 * @param format - PNG and PPM convert to 8 bit, PFM to 32 bit float, Raw keeps the image format.
+	 */
+	void Renderer::SaveImageToFile(const std::string& filepath, Image* image, ReadbackRing::FileFormat format)
 	{
+		const std::string path = filepath.empty() ? GetNextRenderFilepath(ReadbackRing::GetExtension(format)) : filepath;
+
+		if (s_IsFrameStarted)
+		{
+			s_Readback->Capture(GetCurrentCommandBuffer(), image, path, format, s_SubmittedFrames + 1);
+			return;
+		}
+
 		VkCommandBuffer cmd;
 		Device::BeginSingleTimeCommands(cmd, Device::GetGraphicsCommandPool());
+		s_Readback->Capture(cmd, image, path, format, 0);
+		Device::EndSingleTimeCommands(cmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
 
-		image->TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cmd);
-
-		VkExtent2D s = image->GetImageSize();
-		int width = s.width;
-		int height = s.height;
-
-		Image::CreateInfo imageInfo{};
-		imageInfo.Aspect = VK_IMAGE_ASPECT_COLOR_BIT;
-		imageInfo.Format = VK_FORMAT_R8G8B8A8_UNORM;
-		imageInfo.Height = height;
-		imageInfo.Width = width;
-		imageInfo.Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		imageInfo.SamplerInfo = SamplerInfo{};
-		imageInfo.Usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-		Image image8Bit(imageInfo);
-		image8Bit.TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd);
-
-		VkImageBlit blitRegion{};
-		blitRegion.dstOffsets[0] = { 0, 0, 0 };
-		blitRegion.dstOffsets[1] = { width, height, 1 };
-		blitRegion.srcOffsets[0] = { 0, 0, 0 };
-		blitRegion.srcOffsets[1] = { width, height, 1 };
-		blitRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		blitRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-
-		vkCmdBlitImage(cmd, image->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image8Bit.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blitRegion, VK_FILTER_LINEAR);
-		image8Bit.TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cmd);
+		s_Readback->Resolve(s_SubmittedFrames);
+	}
+
+	/**
+	 * @brief Waits until every image save requested so far is written to disk.
+	 */
+	void Renderer::FlushImageSaves()
+	{
+		VL_CORE_ASSERT(!s_IsFrameStarted, "Can't flush image saves while a frame is being recorded!");
+
+		vkDeviceWaitIdle(Device::GetDevice());
+		s_Readback->Resolve(s_SubmittedFrames);
+		s_Readback->Flush();
+	}
+
+	/**
+	 * @brief PNG compression level of image saves requested from now on. Store and Fast are meant for dumping
+	 * many frames, Max for final renders.
+	 */
+	void Renderer::SetImageSaveCompression(ImageEncoder::Compression compression)
+	{
+		s_Readback->SetPNGCompression(compression);
+	}
+
+	/**
+	 * @brief Copies the presentable image of the last ended frame to the CPU. Waits for the frame to finish on the GPU.
+	 *
+	 * @param pixels - Filled with tightly packed RGBA8 pixels, row by row.
+	 */
+	void Renderer::ReadFrame(std::vector<unsigned char>& pixels)
+	{
+		VL_CORE_ASSERT(IsHeadless(), "Only headless frames can be read back, swapchain images aren't transfer sources!");
+		VL_CORE_ASSERT(!s_IsFrameStarted, "Can't read a frame while one is being recorded!");
+
+		const VkExtent2D extent = s_Swapchain->GetSwapchainExtent();
+		const VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * 4;
+		const VkImage image = s_Swapchain->GetPresentableImage(s_LastImageIndex);
 
 		Buffer::CreateInfo info{};
-		info.InstanceSize = width * height * 4;
-		info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-		info.UsageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		Buffer tempBuffer(info);
+		info.InstanceSize = size;
+		info.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		info.UsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		Buffer readbackBuffer(info);
+
+		VkCommandBuffer cmd;
+		Device::BeginSingleTimeCommands(cmd, Device::GetGraphicsCommandPool());
+
+		// The frame left the image in the presentable layout, only its writes have to be made visible
+		Image::TransitionImageLayout(
+			image,
+			s_Swapchain->GetPresentableLayout(),
+			s_Swapchain->GetPresentableLayout(),
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			cmd
+		);
 
 		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.imageExtent = { image->GetImageSize().width, image->GetImageSize().height, 1 };
-		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { extent.width, extent.height, 1 };
 		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		tempBuffer.Map();
+		vkCmdCopyImageToBuffer(cmd, image, s_Swapchain->GetPresentableLayout(), readbackBuffer.GetBuffer(), 1, &region);
 
-		vkCmdCopyImageToBuffer(cmd, image8Bit.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, tempBuffer.GetBuffer(), 1, &region);
 		Device::EndSingleTimeCommands(cmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
 
-		vkDeviceWaitIdle(Device::GetDevice());
+		readbackBuffer.Map(size);
+		pixels.resize(size);
+		memcpy(pixels.data(), readbackBuffer.GetMappedMemory(), size);
+		readbackBuffer.Unmap();
+	}
 
-		void* bufferData = tempBuffer.GetMappedMemory();
+	/**
+	 * @brief Saves a headless frame without stalling. Inside of a frame the current frame is captured at EndFrame,
+	 * outside of a frame the last ended one is.
+	 *
+	 * @param filepath - Output file, empty picks the next free Rendered_Images/RenderN file.
+	 * @param format - Output file format.
+	 */
+	void Renderer::SaveFrameToFile(const std::string& filepath, ReadbackRing::FileFormat format)
+	{
+		VL_CORE_ASSERT(IsHeadless(), "Only headless frames can be saved, swapchain images aren't transfer sources!");
 
-		std::vector<unsigned char> imageBuffer(width * height * 4);
-		memcpy(imageBuffer.data(), bufferData, width * height * 4);
+		const std::string path = filepath.empty() ? GetNextRenderFilepath(ReadbackRing::GetExtension(format)) : filepath;
 
-		if (filepath.empty())
+		if (s_IsFrameStarted)
 		{
-			std::string path = "Rendered_Images/";
-			if (!std::filesystem::exists(path))
-				std::filesystem::create_directory(path);
-
-			uint32_t ID = 0;
-			
-			while (std::filesystem::exists("Rendered_Images/Render" + std::to_string(ID) + ".png"))
-			{
-				ID++;
-			}
-
-			WriteToFile(std::string("Rendered_Images/Render" + std::to_string(ID) + ".png").c_str(), imageBuffer, width, height);
+			s_FrameCaptures.push_back({ path, format });
+			return;
 		}
-		else
+
+		VkCommandBuffer cmd;
+		Device::BeginSingleTimeCommands(cmd, Device::GetGraphicsCommandPool());
+		s_Readback->Capture(cmd, s_Swapchain->GetPresentableImage(s_LastImageIndex), s_Swapchain->GetSwapchainImageFormat(), s_Swapchain->GetSwapchainExtent(), path, format, 0);
+		Device::EndSingleTimeCommands(cmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
+
+		s_Readback->Resolve(s_SubmittedFrames);
+	}
+
+	/**
+	 * @brief Records the presentable image captures requested during the frame, has to be the last thing in the frame.
+	 */
+	void Renderer::RecordFrameCaptures()
+	{
+		for (const FrameCapture& capture : s_FrameCaptures)
 		{
-			WriteToFile(filepath.c_str(), imageBuffer, width, height);
+			s_Readback->Capture(
+				GetCurrentCommandBuffer(),
+				s_Swapchain->GetPresentableImage(s_CurrentImageIndex),
+				s_Swapchain->GetSwapchainImageFormat(),
+				s_Swapchain->GetSwapchainExtent(),
+				capture.Filepath,
+				capture.Format,
+				s_SubmittedFrames + 1
+			);
 		}
+
+		s_FrameCaptures.clear();
+	}
+
+	std::string Renderer::GetNextRenderFilepath(const char* extension)
+	{
+		std::string path = "Rendered_Images/";
+		if (!std::filesystem::exists(path))
+			std::filesystem::create_directory(path);
+
+		uint32_t ID = 0;
+
+		while (std::filesystem::exists("Rendered_Images/Render" + std::to_string(ID) + extension))
+		{
+			ID++;
+		}
+
+		return "Rendered_Images/Render" + std::to_string(ID) + extension;
 	}
 
 	// TODO: delete this?
@@ -382,13 +596,22 @@ namespace Vulture
 		s_QuadMesh.Draw(GetCurrentCommandBuffer(), 1);
 
 #ifdef VL_IMGUI
-		ImGui_ImplVulkan_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		if (IsHeadless())
+		{
+			EndRenderPass();
+			return;
+		}
 
-		s_ImGuiFunction();
+		{
+			// Platform input was fed by PollEvents(), GLFW callbacks can't write it while the frame is built
+			std::unique_lock<std::mutex> lock(s_PlatformMutex);
+			ImGui_ImplVulkan_NewFrame();
+			ImGui::NewFrame();
+
+			s_ImGuiFunction();
 
-		ImGui::Render();
+			ImGui::Render();
+		}
 		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), Vulture::Renderer::GetCurrentCommandBuffer());
 #endif
 		// End the render pass
@@ -398,6 +621,10 @@ namespace Vulture
 	void Renderer::ImGuiPass()
 	{
 #ifdef VL_IMGUI
+		// There's no window to take input from or to show the UI in
+		if (IsHeadless())
+			return;
+
 		std::vector<VkClearValue> clearColors;
 		clearColors.emplace_back(VkClearValue{ 0.0f, 0.0f, 0.0f, 0.0f });
 		BeginRenderPass(
@@ -407,13 +634,16 @@ namespace Vulture
 			s_Swapchain->GetSwapchainExtent()
 		);
 
-		ImGui_ImplVulkan_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		{
+			// Platform input was fed by PollEvents(), GLFW callbacks can't write it while the frame is built
+			std::unique_lock<std::mutex> lock(s_PlatformMutex);
+			ImGui_ImplVulkan_NewFrame();
+			ImGui::NewFrame();
 
-		s_ImGuiFunction();
+			s_ImGuiFunction();
 
-		ImGui::Render();
+			ImGui::Render();
+		}
 		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), Vulture::Renderer::GetCurrentCommandBuffer());
 		EndRenderPass();
 #endif
@@ -426,7 +656,7 @@ namespace Vulture
 
 		Image::TransitionImageLayout(
 			s_Swapchain->GetPresentableImage(s_CurrentImageIndex),
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			s_Swapchain->GetPresentableLayout(),
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			VK_PIPELINE_STAGE_TRANSFER_BIT,
 			VK_PIPELINE_STAGE_TRANSFER_BIT,
@@ -459,7 +689,7 @@ namespace Vulture
 		Image::TransitionImageLayout(
 			s_Swapchain->GetPresentableImage(s_CurrentImageIndex),
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			s_Swapchain->GetPresentableLayout(),
 			VK_PIPELINE_STAGE_TRANSFER_BIT,
 			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
 			VK_ACCESS_TRANSFER_WRITE_BIT,
@@ -500,21 +730,30 @@ namespace Vulture
 	 */
 	void Renderer::RecreateSwapchain()
 	{
-		// Wait for the window to have a valid extent
-		auto extent = s_Window->GetExtent();
-		while (extent.width == 0 || extent.height == 0)
+		VkExtent2D extent = s_HeadlessExtent;
+		if (!IsHeadless())
 		{
+			std::unique_lock<std::mutex> lock(s_PlatformMutex);
 			extent = s_Window->GetExtent();
-			glfwWaitEvents();
 		}
 
+		// The window is minimized, PollEvents() waits on the main thread until it's restored and the next frame
+		// tries again. The headless extent is never 0
+		s_RecreatePending = extent.width == 0 || extent.height == 0;
+		if (s_RecreatePending)
+			return;
+
 		// Wait for the device to be idle before recreating the swapchain
 		vkDeviceWaitIdle(Device::GetDevice());
 
+		// The new swapchain starts its fence ring over, everything submitted so far is finished now
+		if (s_Readback)
+			s_Readback->Resolve(s_SubmittedFrames);
+
 		// Recreate the swapchain
 		if (s_Swapchain == nullptr)
 		{
-			s_Swapchain = std::make_unique<Swapchain>(Swapchain::CreateInfo{ extent, PresentModes::VSync, m_MaxFramesInFlight, nullptr });
+			s_Swapchain = std::make_unique<Swapchain>(Swapchain::CreateInfo{ extent, PresentModes::VSync, m_MaxFramesInFlight, nullptr, IsHeadless() });
 		}
 		else
 		{
@@ -522,7 +761,7 @@ namespace Vulture
 			std::shared_ptr<Swapchain> oldSwapchain = std::move(s_Swapchain);
 
 			// Create a new swapchain using the old one as a reference
-			s_Swapchain = std::make_unique<Swapchain>(Swapchain::CreateInfo{ extent, PresentModes::VSync, m_MaxFramesInFlight, oldSwapchain });
+			s_Swapchain = std::make_unique<Swapchain>(Swapchain::CreateInfo{ extent, PresentModes::VSync, m_MaxFramesInFlight, IsHeadless() ? nullptr : oldSwapchain, IsHeadless() });
 
 			// Check if the swap formats are consistent
 			VL_CORE_ASSERT(oldSwapchain->CompareSwapFormats(*s_Swapchain), "Swap chain image or depth formats have changed!");
@@ -639,15 +878,6 @@ namespace Vulture
 
 	}
 
-	// TODO description
-	void Renderer::WriteToFile(const char* filename, std::vector<unsigned char>& image, unsigned width, unsigned height)
-	{
-		unsigned error = lodepng::encode(filename, image, width, height);
-
-		//if there's an error, display it
-		VL_CORE_ASSERT(!error, "encoder error {} | {}", error, lodepng_error_text(error));
-	}
-
 	void Renderer::InitImGui()
 	{
 #ifdef VL_IMGUI
@@ -656,6 +886,11 @@ namespace Vulture
 		ImGuiIO& io = ImGui::GetIO();
 		io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
+		// The context still exists so ImGui calls outside of the ImGui function stay valid, but without
+		// a window there are no platform and renderer backends
+		if (IsHeadless())
+			return;
+
 		ImGui_ImplGlfw_InitForVulkan(s_Window->GetGLFWwindow(), true);
 		ImGui_ImplVulkan_InitInfo info{};
 		info.Instance = Device::GetInstance();
@@ -764,8 +999,11 @@ namespace Vulture
 
 	void Renderer::DestroyImGui()
 	{
-		ImGui_ImplVulkan_Shutdown();
-		ImGui_ImplGlfw_Shutdown();
+		if (!IsHeadless())
+		{
+			ImGui_ImplVulkan_Shutdown();
+			ImGui_ImplGlfw_Shutdown();
+		}
 		ImGui::DestroyContext();
 	}
 
@@ -780,6 +1018,20 @@ namespace Vulture
 		return s_CommandBuffers[s_CurrentImageIndex];
 	}
 
+	/**
+	 * @brief Records taskCount tasks on worker threads into secondary command buffers and executes them into the
+	 * current command buffer in task order. Inside a render pass, begin it with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+	 * and pass it through inheritance, nothing else can be recorded into that subpass then.
+	 *
+	 * @param fn - Called concurrently for different tasks with the task index and the command buffer to record into.
+	 */
+	void Renderer::RecordParallel(uint32_t taskCount, const ParallelRecorder::RecordFn& fn, const ParallelRecorder::Inheritance& inheritance, uint32_t minTasksPerChunk)
+	{
+		VL_CORE_ASSERT(s_IsFrameStarted, "Cannot record commands when frame is not in progress");
+
+		s_Recorder->Record(GetCurrentCommandBuffer(), taskCount, fn, inheritance, minTasksPerChunk);
+	}
+
 	/**
 	 * @brief Retrieves the index of the current frame in progress.
 	 *
@@ -8,9 +8,15 @@
 #include "Vulkan/PushConstant.h"
 #include "Vulkan/SBT.h"
 #include "Mesh.h"
+#include "ReadbackRing.h"
+#include "ParallelRecorder.h"
+#include "GpuProfiler.h"
+#include "FrameAllocator.h"
 
 #include <vulkan/vulkan.h>
 
+#include <mutex>
+
 #ifndef VL_IMGUI
 #define VL_IMGUI
 #endif
@@ -22,10 +28,20 @@ namespace Vulture
 	class Renderer
 	{
 	public:
+		// CPU time spent in frame stages since the last TakeFrameTimings call, in milliseconds
+		struct FrameTimings
+		{
+			float AcquireMs = 0.0f; // Waiting for the frame fence and acquiring the swapchain image
+			float RecordMs = 0.0f; // Between BeginFrame and EndFrame
+			float SubmitMs = 0.0f;
+			float PresentMs = 0.0f;
+		};
+
 		~Renderer() = delete;
 		Renderer() = delete;
 
 		static void Init(Window& window, uint32_t maxFramesInFlight);
+		static void InitHeadless(VkExtent2D extent, uint32_t maxFramesInFlight);
 		static void Destroy();
 		
 		static inline Swapchain& GetSwapchain() { return *s_Swapchain; }
@@ -41,36 +57,57 @@ namespace Vulture
 		static bool BeginFrame();
 		static bool EndFrame();
 
+		// Main thread only, the render thread never calls into GLFW
+		static void PollEvents();
+
 		static void SetImGuiFunction(std::function<void()> fn);
 		static void RayTrace(VkCommandBuffer cmdBuf, SBT* sbt, VkExtent2D imageSize, uint32_t depth = 1);
 
 		static VkCommandBuffer GetCurrentCommandBuffer();
+		static void RecordParallel(uint32_t taskCount, const ParallelRecorder::RecordFn& fn, const ParallelRecorder::Inheritance& inheritance = {}, uint32_t minTasksPerChunk = 1);
+		static inline ParallelRecorder& GetParallelRecorder() { return *s_Recorder; }
 		static int GetFrameIndex();
 		inline static int GetImageIndex() { return s_CurrentImageIndex; };
 
-		static void SaveImageToFile(const std::string& filepath, Image* image);
+		static void SaveImageToFile(const std::string& filepath, Image* image, ReadbackRing::FileFormat format = ReadbackRing::FileFormat::PNG);
+		static void FlushImageSaves();
+		static void SetImageSaveCompression(ImageEncoder::Compression compression);
+
+		// Headless only, read the presentable image of the last ended frame
+		static void ReadFrame(std::vector<unsigned char>& pixels);
+		static void SaveFrameToFile(const std::string& filepath, ReadbackRing::FileFormat format = ReadbackRing::FileFormat::PNG);
 		static void ImGuiPass();
 		static void FramebufferCopyPassImGui(DescriptorSet* descriptorWithImageSampler);
 		static void FramebufferCopyPassBlit(Ref<Image> image);
 		static void EnvMapToCubemapPass(Ref<Image> envMap, Ref<Image> cubemap);
 
-		static void BeginRenderPass(const std::vector<VkClearValue>& clearColors, VkFramebuffer framebuffer, VkRenderPass renderPass, VkExtent2D extent);
+		static void BeginRenderPass(const std::vector<VkClearValue>& clearColors, VkFramebuffer framebuffer, VkRenderPass renderPass, VkExtent2D extent, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 		static void EndRenderPass();
 
 		static inline uint32_t GetMaxFramesInFlight() { return m_MaxFramesInFlight; }
 
+		static FrameTimings TakeFrameTimings();
+
 		static inline bool IsInitialized() { return s_Initialized; }
+		static inline bool IsHeadless() { return s_Window == nullptr; }
+
+		// Offscreen counterpart of a window resize, the next BeginFrame recreates the images and returns false
+		static void SetHeadlessExtent(VkExtent2D extent);
 
 	private:
 		static bool BeginFrameInternal();
 		static bool EndFrameInternal();
 
+		static void InitInternal(uint32_t maxFramesInFlight);
+		static bool TakeResizeRequest();
+		static std::string GetNextRenderFilepath(const char* extension);
+		static void RecordFrameCaptures();
+
 		static void RecreateSwapchain();
 		static void CreateCommandBuffers();
 		static void CreatePool();
 		static void CreatePipeline();
 		static void CreateDescriptorSets();
-		static void WriteToFile(const char* filename, std::vector<unsigned char>& image, unsigned width, unsigned height);
 
 		static void InitImGui();
 		static void DestroyImGui();
@@ -78,16 +115,35 @@ namespace Vulture
 		inline static uint32_t m_MaxFramesInFlight = 0;
 
 		inline static Scope<DescriptorPool> s_Pool = nullptr;
-		inline static Window* s_Window = nullptr;
+		inline static Window* s_Window = nullptr; // Null in headless mode
+		inline static VkExtent2D s_HeadlessExtent = { 0, 0 };
+		inline static bool s_HeadlessResized = false;
+		inline static bool s_RecreatePending = false; // Recreation was skipped because the window was minimized
+		inline static std::mutex s_PlatformMutex; // Held while GLFW callbacks write window state and ImGui input
 		inline static std::vector<VkCommandBuffer> s_CommandBuffers;
 		inline static Scope<Swapchain> s_Swapchain = nullptr;
 
 		inline static bool s_IsFrameStarted = false;
 		inline static uint32_t s_CurrentImageIndex = 0;
+		inline static uint32_t s_LastImageIndex = 0; // Image of the last ended frame
+		inline static uint64_t s_SubmittedFrames = 0; // Serial of the last submitted frame, the first frame is 1
+
+		struct FrameCapture
+		{
+			std::string Filepath;
+			ReadbackRing::FileFormat Format;
+		};
+
+		inline static Scope<ReadbackRing> s_Readback = nullptr;
+		inline static Scope<ParallelRecorder> s_Recorder = nullptr;
+		inline static std::vector<FrameCapture> s_FrameCaptures; // Presentable image captures recorded at EndFrame
 		inline static uint32_t s_CurrentFrameIndex = 0;
 
 		inline static Scene* s_CurrentSceneRendered = nullptr;
 
+		inline static FrameTimings s_FrameTimings;
+		inline static Timer s_RecordTimer;
+
 		inline static Mesh s_QuadMesh;
 		inline static Sampler s_RendererLinearSampler;
 		inline static Sampler s_RendererLinearSamplerRepeat;
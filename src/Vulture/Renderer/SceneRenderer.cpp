@@ -0,0 +1,436 @@
+#include "pch.h"
+#include "SceneRenderer.h"
+#include "Renderer.h"
+
+#include "Scene/Scene.h"
+#include "Scene/Components.h"
+
+namespace Vulture
+{
+	static_assert(sizeof(SceneRenderer::InstanceData) == 96, "InstanceData layout has to match shaders");
+
+	void SceneRenderer::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		const uint32_t framesInFlight = createInfo.FramesInFlight != 0 ? createInfo.FramesInFlight : Renderer::GetMaxFramesInFlight();
+		VL_CORE_ASSERT(framesInFlight > 0, "SceneRenderer needs at least one frame in flight!");
+
+		m_Selector = createInfo.Selector;
+
+		m_Frames.resize(framesInFlight);
+		for (FrameData& frame : m_Frames)
+			CreateFrameBuffers(frame, glm::max(createInfo.MaxInstances, 1u));
+
+		m_Initialized = true;
+	}
+
+	void SceneRenderer::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		Reset();
+	}
+
+	SceneRenderer::SceneRenderer(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	SceneRenderer::~SceneRenderer()
+	{
+		Destroy();
+	}
+
+	SceneRenderer::SceneRenderer(SceneRenderer&& other) noexcept
+	{
+		if (m_Initialized)
+			Destroy();
+
+		m_Pools				= std::move(other.m_Pools);
+		m_Meshes			= std::move(other.m_Meshes);
+		m_PendingCopies		= std::move(other.m_PendingCopies);
+		m_Materials			= std::move(other.m_Materials);
+		m_MaterialIndices	= std::move(other.m_MaterialIndices);
+		m_Frames			= std::move(other.m_Frames);
+		m_Selector			= std::move(other.m_Selector);
+		m_Initialized		= std::move(other.m_Initialized);
+
+		other.Reset();
+	}
+
+	SceneRenderer& SceneRenderer::operator=(SceneRenderer&& other) noexcept
+	{
+		if (m_Initialized)
+			Destroy();
+
+		m_Pools				= std::move(other.m_Pools);
+		m_Meshes			= std::move(other.m_Meshes);
+		m_PendingCopies		= std::move(other.m_PendingCopies);
+		m_Materials			= std::move(other.m_Materials);
+		m_MaterialIndices	= std::move(other.m_MaterialIndices);
+		m_Frames			= std::move(other.m_Frames);
+		m_Selector			= std::move(other.m_Selector);
+		m_Initialized		= std::move(other.m_Initialized);
+
+		other.Reset();
+
+		return *this;
+	}
+
+	/**
+	 * @brief Gathers every entity with a mesh and a transform into the frame's instance buffer and builds one
+	 * indirect command per (pipeline, mesh, LOD). Meshes seen for the first time are copied into the shared pools,
+	 * so they're expected to be static. Call it for a frame index whose previous submission has already finished.
+	 *
+	 * @param scene - Scene to draw.
+	 * @param frameIndex - Frame in flight the buffers are written for.
+	 * @param camera - Optional, when set LODs are selected by projected screen space error.
+	 * @param viewportHeight - Viewport height in pixels, used for LOD selection.
+	 * @param cmd - Frame command buffer outside of a render pass, copies of new meshes are recorded into it. When
+	 * null they're submitted together and waited for.
+	 */
+	void SceneRenderer::Update(Scene& scene, uint32_t frameIndex, const PerspectiveCamera* camera, float viewportHeight, VkCommandBuffer cmd)
+	{
+		VL_CORE_ASSERT(m_Initialized, "SceneRenderer is not initialized!");
+		VL_CORE_ASSERT(frameIndex < m_Frames.size(), "Frame index out of range!");
+
+		struct DrawItem
+		{
+			uint32_t PipelineIndex;
+			uint32_t PoolIndex;
+			uint32_t FirstIndex;
+			uint32_t IndexCount;
+			int32_t VertexOffset;
+			uint32_t InstanceIndex;
+		};
+
+		std::vector<DrawItem> items;
+		std::vector<InstanceData> instances;
+
+		scene.UpdateTransforms();
+
+		entt::registry& registry = scene.GetRegistry();
+		auto view = registry.view<MeshComponent, TransformComponent>();
+		for (auto entity : view)
+		{
+			MeshComponent& meshComponent = view.get<MeshComponent>(entity);
+			if (!meshComponent.AssetHandle.IsAssetLoaded())
+				continue;
+
+			// Non indexed meshes are rare and keep using Mesh::Draw
+			Mesh* mesh = meshComponent.AssetHandle.GetMesh();
+			if (!mesh->HasIndexBuffer())
+				continue;
+
+			const MeshEntry& entry = AddMesh(meshComponent.AssetHandle.Hash(), mesh);
+
+			Material* material = nullptr;
+			MaterialComponent* materialComponent = registry.try_get<MaterialComponent>(entity);
+			if (materialComponent != nullptr && materialComponent->AssetHandle.IsAssetLoaded())
+				material = materialComponent->AssetHandle.GetMaterial();
+
+			InstanceData instance{};
+			instance.Transform = view.get<TransformComponent>(entity).WorldMatrix;
+			instance.MaterialIndex = GetMaterialIndex(material);
+			if (mesh->GetVertexLayout() == VertexLayout::Compact)
+			{
+				instance.DequantScale = mesh->GetDequantScale();
+				instance.DequantOffset = mesh->GetDequantOffset();
+			}
+
+			const uint32_t lod = camera != nullptr ? mesh->SelectLOD(*camera, instance.Transform, viewportHeight) : 0;
+
+			DrawItem item{};
+			item.PipelineIndex = m_Selector ? m_Selector(material) : 0;
+			item.PoolIndex = entry.PoolIndex;
+			item.FirstIndex = entry.FirstIndex + (lod != 0 ? mesh->GetLOD(lod).IndexOffset : 0);
+			item.IndexCount = lod != 0 ? mesh->GetLOD(lod).IndexCount : (uint32_t)mesh->GetIndexCount();
+			item.VertexOffset = entry.VertexOffset;
+			item.InstanceIndex = (uint32_t)instances.size();
+
+			items.push_back(item);
+			instances.push_back(instance);
+		}
+
+		if (!m_PendingCopies.empty())
+		{
+			if (cmd != VK_NULL_HANDLE)
+			{
+				RecordUploads(cmd);
+			}
+			else
+			{
+				VkCommandBuffer uploadCmd;
+				Device::BeginSingleTimeCommands(uploadCmd, Device::GetGraphicsCommandPool());
+				RecordUploads(uploadCmd);
+				Device::EndSingleTimeCommands(uploadCmd, Device::GetGraphicsQueue(), Device::GetGraphicsCommandPool());
+			}
+		}
+
+		// Instances of the same mesh and LOD end up next to each other and become a single instanced command
+		std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b)
+		{
+			if (a.PipelineIndex != b.PipelineIndex) return a.PipelineIndex < b.PipelineIndex;
+			if (a.PoolIndex != b.PoolIndex) return a.PoolIndex < b.PoolIndex;
+			if (a.FirstIndex != b.FirstIndex) return a.FirstIndex < b.FirstIndex;
+			return a.VertexOffset < b.VertexOffset;
+		});
+
+		FrameData& frame = m_Frames[frameIndex];
+		if (items.size() > frame.InstanceBuffer.GetInstanceCount())
+			CreateFrameBuffers(frame, (uint32_t)glm::max<uint64_t>(items.size(), frame.InstanceBuffer.GetInstanceCount() * 2));
+
+		InstanceData* mappedInstances = (InstanceData*)frame.InstanceBuffer.GetMappedMemory();
+		VkDrawIndexedIndirectCommand* mappedCommands = (VkDrawIndexedIndirectCommand*)frame.CommandBuffer.GetMappedMemory();
+		uint32_t* mappedCounts = (uint32_t*)frame.CountBuffer.GetMappedMemory();
+
+		frame.Batches.clear();
+		uint32_t commandCount = 0;
+		for (uint32_t i = 0; i < (uint32_t)items.size(); i++)
+		{
+			const DrawItem& item = items[i];
+			mappedInstances[i] = instances[item.InstanceIndex];
+
+			const bool newBatch = i == 0 || item.PipelineIndex != items[i - 1].PipelineIndex || item.PoolIndex != items[i - 1].PoolIndex;
+			const bool newCommand = newBatch || item.FirstIndex != items[i - 1].FirstIndex || item.VertexOffset != items[i - 1].VertexOffset;
+
+			if (newBatch)
+				frame.Batches.push_back({ item.PipelineIndex, item.PoolIndex, commandCount, 0 });
+
+			if (newCommand)
+			{
+				VkDrawIndexedIndirectCommand& command = mappedCommands[commandCount++];
+				command.indexCount = item.IndexCount;
+				command.instanceCount = 0;
+				command.firstIndex = item.FirstIndex;
+				command.vertexOffset = item.VertexOffset;
+				command.firstInstance = i;
+
+				frame.Batches.back().CommandCount++;
+			}
+
+			mappedCommands[commandCount - 1].instanceCount++;
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)frame.Batches.size(); i++)
+			mappedCounts[i] = frame.Batches[i].CommandCount;
+
+		frame.InstanceCount = (uint32_t)items.size();
+	}
+
+	/**
+	 * @brief Records draws of everything assigned to the pipeline, one indirect call per geometry pool. The pipeline
+	 * has to be bound already, its vertex input has to match the pool layout and the instance buffer has to be
+	 * bound to a descriptor set by the caller.
+	 *
+	 * @param commandBuffer - Command buffer to record into.
+	 * @param frameIndex - Frame that was passed to Update().
+	 * @param pipelineIndex - Index returned by the pipeline selector.
+	 */
+	void SceneRenderer::Draw(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t pipelineIndex)
+	{
+		VL_CORE_ASSERT(m_Initialized, "SceneRenderer is not initialized!");
+		VL_CORE_ASSERT(frameIndex < m_Frames.size(), "Frame index out of range!");
+
+		const FrameData& frame = m_Frames[frameIndex];
+		constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		for (uint32_t i = 0; i < (uint32_t)frame.Batches.size(); i++)
+		{
+			const Batch& batch = frame.Batches[i];
+			if (batch.PipelineIndex != pipelineIndex)
+				continue;
+
+			const GeometryPool& pool = m_Pools[batch.PoolIndex];
+			VkBuffer vertexBuffer = pool.VertexBuffer.GetBuffer();
+			VkDeviceSize vertexOffset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &vertexOffset);
+			vkCmdBindIndexBuffer(commandBuffer, pool.IndexBuffer.GetBuffer(), 0, pool.IndexType);
+
+			const VkDeviceSize commandOffset = (VkDeviceSize)batch.FirstCommand * stride;
+			if (Device::IsDrawIndirectCountSupported())
+			{
+				vkCmdDrawIndexedIndirectCount(commandBuffer, frame.CommandBuffer.GetBuffer(), commandOffset, frame.CountBuffer.GetBuffer(), i * sizeof(uint32_t), batch.CommandCount, stride);
+			}
+			else if (Device::IsMultiDrawIndirectSupported())
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, frame.CommandBuffer.GetBuffer(), commandOffset, batch.CommandCount, stride);
+			}
+			else
+			{
+				for (uint32_t command = 0; command < batch.CommandCount; command++)
+					vkCmdDrawIndexedIndirect(commandBuffer, frame.CommandBuffer.GetBuffer(), commandOffset + command * stride, 1, stride);
+			}
+		}
+	}
+
+	/**
+	 * @brief Drops all packed meshes and materials. Has to be called when meshes that were drawn get modified or
+	 * materials get destroyed, they're repacked on the next Update(). Unloading a mesh asset doesn't need it, the
+	 * packed copy is keyed by the asset handle and reused if the asset is loaded again.
+	 */
+	void SceneRenderer::Clear()
+	{
+		m_Pools.clear();
+		m_Meshes.clear();
+		m_PendingCopies.clear();
+		m_Materials.clear();
+		m_MaterialIndices.clear();
+	}
+
+	/**
+	 * @brief Reserves room for vertices and all LODs of the mesh in the pool matching its layout and index type.
+	 * The copy is recorded later by RecordUploads() together with the other new meshes, it stays on the GPU and
+	 * the mesh itself is left untouched.
+	 */
+	const SceneRenderer::MeshEntry& SceneRenderer::AddMesh(uint64_t meshHandle, Mesh* mesh)
+	{
+		auto it = m_Meshes.find(meshHandle);
+		if (it != m_Meshes.end())
+			return it->second;
+
+		uint32_t poolIndex = 0;
+		while (poolIndex < m_Pools.size() && (m_Pools[poolIndex].Layout != mesh->GetVertexLayout() || m_Pools[poolIndex].IndexType != mesh->GetIndexType()))
+			poolIndex++;
+
+		if (poolIndex == m_Pools.size())
+		{
+			m_Pools.emplace_back();
+			m_Pools.back().Layout = mesh->GetVertexLayout();
+			m_Pools.back().IndexType = mesh->GetIndexType();
+		}
+
+		GeometryPool& pool = m_Pools[poolIndex];
+
+		PendingCopy copy{};
+		copy.PoolIndex = poolIndex;
+		copy.VertexSource = mesh->GetVertexBuffer()->GetBuffer();
+		copy.IndexSource = mesh->GetIndexBuffer()->GetBuffer();
+		copy.VertexOffset = pool.VertexBytes;
+		copy.VertexBytes = mesh->GetVertexCount() * mesh->GetVertexStride();
+		copy.IndexOffset = pool.IndexBytes;
+		copy.IndexBytes = mesh->GetTotalIndexCount() * mesh->GetIndexSize();
+		m_PendingCopies.push_back(copy);
+
+		MeshEntry entry{};
+		entry.PoolIndex = poolIndex;
+		entry.VertexOffset = (int32_t)(pool.VertexBytes / mesh->GetVertexStride());
+		entry.FirstIndex = (uint32_t)(pool.IndexBytes / mesh->GetIndexSize());
+
+		pool.VertexBytes += copy.VertexBytes;
+		pool.IndexBytes += copy.IndexBytes;
+
+		return m_Meshes.emplace(meshHandle, entry).first->second;
+	}
+
+	/**
+	 * @brief Grows every pool once to fit its reserved ranges and records copies of all pending meshes, followed
+	 * by a barrier that makes them visible to vertex input.
+	 */
+	void SceneRenderer::RecordUploads(VkCommandBuffer cmd)
+	{
+		// Growing first keeps every write of this batch in the final buffers, so the copies don't depend on each other
+		for (GeometryPool& pool : m_Pools)
+		{
+			GrowBuffer(pool.VertexBuffer, pool.UploadedVertexBytes, pool.VertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, cmd);
+			GrowBuffer(pool.IndexBuffer, pool.UploadedIndexBytes, pool.IndexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, cmd);
+		}
+
+		for (const PendingCopy& copy : m_PendingCopies)
+		{
+			const GeometryPool& pool = m_Pools[copy.PoolIndex];
+			Buffer::CopyBuffer(copy.VertexSource, pool.VertexBuffer.GetBuffer(), copy.VertexBytes, 0, copy.VertexOffset, 0, cmd);
+			Buffer::CopyBuffer(copy.IndexSource, pool.IndexBuffer.GetBuffer(), copy.IndexBytes, 0, copy.IndexOffset, 0, cmd);
+		}
+
+		for (GeometryPool& pool : m_Pools)
+		{
+			pool.UploadedVertexBytes = pool.VertexBytes;
+			pool.UploadedIndexBytes = pool.IndexBytes;
+		}
+
+		m_PendingCopies.clear();
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	uint32_t SceneRenderer::GetMaterialIndex(Material* material)
+	{
+		auto it = m_MaterialIndices.find(material);
+		if (it != m_MaterialIndices.end())
+			return it->second;
+
+		const uint32_t index = (uint32_t)m_Materials.size();
+		m_Materials.push_back(material);
+		m_MaterialIndices[material] = index;
+
+		return index;
+	}
+
+	/**
+	 * @brief (Re)creates host visible per frame buffers. They stay mapped, old ones are freed through the delete queue.
+	 */
+	void SceneRenderer::CreateFrameBuffers(FrameData& frame, uint32_t maxInstances)
+	{
+		Buffer::CreateInfo bufferInfo{};
+		bufferInfo.InstanceCount = maxInstances;
+		bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		bufferInfo.InstanceSize = sizeof(InstanceData);
+		bufferInfo.UsageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		frame.InstanceBuffer.Init(bufferInfo);
+		frame.InstanceBuffer.Map();
+
+		// There's never more commands or batches than instances
+		bufferInfo.InstanceSize = sizeof(VkDrawIndexedIndirectCommand);
+		bufferInfo.UsageFlags = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		frame.CommandBuffer.Init(bufferInfo);
+		frame.CommandBuffer.Map();
+
+		bufferInfo.InstanceSize = sizeof(uint32_t);
+		frame.CountBuffer.Init(bufferInfo);
+		frame.CountBuffer.Map();
+	}
+
+	/**
+	 * @brief Makes sure the device local buffer can hold requiredBytes, growing it at least 2x and keeping the first usedBytes.
+	 * The old buffer goes through the delete queue, so frames in flight can keep reading it.
+	 */
+	void SceneRenderer::GrowBuffer(Buffer& buffer, uint64_t usedBytes, uint64_t requiredBytes, VkBufferUsageFlags usage, VkCommandBuffer cmd)
+	{
+		if (requiredBytes == 0 || (buffer.IsInitialized() && buffer.GetBufferSize() >= requiredBytes))
+			return;
+
+		Buffer::CreateInfo bufferInfo{};
+		bufferInfo.InstanceSize = glm::max<uint64_t>(requiredBytes, buffer.IsInitialized() ? buffer.GetBufferSize() * 2 : 0);
+		bufferInfo.InstanceCount = 1;
+		bufferInfo.UsageFlags = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		bufferInfo.MemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		Buffer newBuffer(bufferInfo);
+
+		if (usedBytes > 0)
+			Buffer::CopyBuffer(buffer.GetBuffer(), newBuffer.GetBuffer(), usedBytes, 0, 0, 0, cmd);
+
+		buffer = std::move(newBuffer);
+	}
+
+	void SceneRenderer::Reset()
+	{
+		m_Pools.clear();
+		m_Meshes.clear();
+		m_PendingCopies.clear();
+		m_Materials.clear();
+		m_MaterialIndices.clear();
+		m_Frames.clear();
+		m_Selector = nullptr;
+		m_Initialized = false;
+	}
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "pch.h"
+#include "../Utility/Utility.h"
+
+#include "Mesh.h"
+#include "Vulkan/Buffer.h"
+
+namespace Vulture
+{
+	class Scene;
+	class Material;
+	class PerspectiveCamera;
+
+	// Batched draw path for static scene meshes. Meshes are packed into shared vertex and index buffers, one pair
+	// per vertex layout and index type, so a whole pipeline is drawn with a single indirect call per pool instead of
+	// a bind and draw per mesh. Shaders read per object data from the instance buffer with gl_InstanceIndex.
+	class SceneRenderer
+	{
+	public:
+		// Per object data, laid out for std430 storage buffers
+		struct InstanceData
+		{
+			glm::mat4 Transform = glm::mat4(1.0f);
+			glm::vec3 DequantScale = glm::vec3(1.0f);	// Compact layout only, identity otherwise
+			uint32_t MaterialIndex = 0;					// Into GetMaterials()
+			glm::vec3 DequantOffset = glm::vec3(0.0f);
+			uint32_t Padding = 0;
+		};
+
+		// Returns index of the pipeline a material is drawn with, see Draw()
+		using PipelineSelector = std::function<uint32_t(Material* material)>;
+
+		struct CreateInfo
+		{
+			uint32_t MaxInstances = 16384;	// Initial capacity, grows when exceeded
+			uint32_t FramesInFlight = 0;	// 0 means Renderer::GetMaxFramesInFlight()
+			PipelineSelector Selector;		// Optional, everything goes to pipeline 0 when empty
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		SceneRenderer() = default;
+		SceneRenderer(const CreateInfo& createInfo);
+		~SceneRenderer();
+
+		SceneRenderer(const SceneRenderer&) = delete;
+		SceneRenderer& operator=(const SceneRenderer&) = delete;
+		SceneRenderer(SceneRenderer&& other) noexcept;
+		SceneRenderer& operator=(SceneRenderer&& other) noexcept;
+
+		void Update(Scene& scene, uint32_t frameIndex, const PerspectiveCamera* camera = nullptr, float viewportHeight = 0.0f, VkCommandBuffer cmd = 0);
+		void Draw(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t pipelineIndex = 0);
+
+		void Clear();
+
+		// Recreated by Update() when the scene outgrows it, descriptors pointing at it have to be rewritten then
+		inline const Buffer* GetInstanceBuffer(uint32_t frameIndex) const { return &m_Frames[frameIndex].InstanceBuffer; }
+		inline const std::vector<Material*>& GetMaterials() const { return m_Materials; }
+		inline uint32_t GetInstanceCount(uint32_t frameIndex) const { return m_Frames[frameIndex].InstanceCount; }
+		inline uint32_t GetDrawCallCount(uint32_t frameIndex) const { return (uint32_t)m_Frames[frameIndex].Batches.size(); }
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		struct GeometryPool
+		{
+			VertexLayout Layout = VertexLayout::Full;
+			VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+
+			Buffer VertexBuffer;
+			Buffer IndexBuffer;
+			uint64_t VertexBytes = 0; // Reserved part of the buffers, including meshes whose copy isn't recorded yet
+			uint64_t IndexBytes = 0;
+			uint64_t UploadedVertexBytes = 0; // Part of the buffers that has been copied
+			uint64_t UploadedIndexBytes = 0;
+		};
+
+		// Copy of a mesh into its reserved pool range, recorded by RecordUploads()
+		struct PendingCopy
+		{
+			uint32_t PoolIndex = 0;
+			VkBuffer VertexSource = VK_NULL_HANDLE;
+			VkBuffer IndexSource = VK_NULL_HANDLE;
+			uint64_t VertexOffset = 0;
+			uint64_t VertexBytes = 0;
+			uint64_t IndexOffset = 0;
+			uint64_t IndexBytes = 0;
+		};
+
+		struct MeshEntry
+		{
+			uint32_t PoolIndex = 0;
+			int32_t VertexOffset = 0;	// In vertices
+			uint32_t FirstIndex = 0;	// In indices, LOD offsets are added on top
+		};
+
+		// Commands of one pipeline that share a pool, drawn with a single indirect call
+		struct Batch
+		{
+			uint32_t PipelineIndex = 0;
+			uint32_t PoolIndex = 0;
+			uint32_t FirstCommand = 0;
+			uint32_t CommandCount = 0;
+		};
+
+		struct FrameData
+		{
+			Buffer InstanceBuffer;
+			Buffer CommandBuffer;
+			Buffer CountBuffer; // One draw count per batch, used with vkCmdDrawIndexedIndirectCount
+			std::vector<Batch> Batches;
+			uint32_t InstanceCount = 0;
+		};
+
+		const MeshEntry& AddMesh(uint64_t meshHandle, Mesh* mesh);
+		void RecordUploads(VkCommandBuffer cmd);
+		uint32_t GetMaterialIndex(Material* material);
+		void CreateFrameBuffers(FrameData& frame, uint32_t maxInstances);
+		static void GrowBuffer(Buffer& buffer, uint64_t usedBytes, uint64_t requiredBytes, VkBufferUsageFlags usage, VkCommandBuffer cmd);
+
+		std::vector<GeometryPool> m_Pools;
+		std::unordered_map<uint64_t, MeshEntry> m_Meshes; // Keyed by mesh asset handle, the packed copy outlives the Mesh
+		std::vector<PendingCopy> m_PendingCopies;
+		std::vector<Material*> m_Materials;
+		std::unordered_map<Material*, uint32_t> m_MaterialIndices;
+		std::vector<FrameData> m_Frames;
+		PipelineSelector m_Selector;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Text.h"
+#include "FrameAllocator.h"
 
 namespace Vulture
 {
@@ -31,7 +32,13 @@ namespace Vulture
 
 			GetTextVertices(vertices, indices);
 
-			m_TextMesh.Init({ &vertices, &indices });
+			// Glyph quads are coplanar, sorting them for overdraw gains nothing
+			Mesh::CreateInfo meshInfo{};
+			meshInfo.Vertices = &vertices;
+			meshInfo.Indices = &indices;
+			meshInfo.Optimize = true;
+			meshInfo.OptimizeOverdraw = false;
+			m_TextMesh.Init(meshInfo);
 		}
 
 		m_Initialized = true;
@@ -108,9 +115,20 @@ namespace Vulture
 		m_TextMesh.HasIndexBuffer() = true;
 		if (!vertices.empty())
 		{
-			// Update Device local memory using vkCmdUpdateBuffer
-			m_TextMesh.GetVertexBuffer()->WriteToBuffer(vertices.data(), vertices.size() * sizeof(Mesh::Vertex), 0, cmdBuffer);
-			m_TextMesh.GetIndexBuffer()->WriteToBuffer(indices.data(), indices.size() * sizeof(uint32_t), 0, cmdBuffer);
+			const VkDeviceSize vertexSize = vertices.size() * sizeof(Mesh::Vertex);
+			const VkDeviceSize indexSize = indices.size() * sizeof(uint32_t);
+			if (cmdBuffer != VK_NULL_HANDLE && FrameAllocator::IsFrameActive())
+			{
+				// Staged through the frame's memory instead of creating staging buffers on every change
+				VL_CORE_ASSERT(vertexSize <= m_TextMesh.GetVertexBuffer()->GetBufferSize() && indexSize <= m_TextMesh.GetIndexBuffer()->GetBufferSize(), "Text is longer than its buffers!");
+				FrameAllocator::CmdCopyToBuffer(cmdBuffer, m_TextMesh.GetVertexBuffer()->GetBuffer(), 0, vertices.data(), vertexSize);
+				FrameAllocator::CmdCopyToBuffer(cmdBuffer, m_TextMesh.GetIndexBuffer()->GetBuffer(), 0, indices.data(), indexSize);
+			}
+			else
+			{
+				m_TextMesh.GetVertexBuffer()->WriteToBuffer(vertices.data(), vertexSize, 0, cmdBuffer);
+				m_TextMesh.GetIndexBuffer()->WriteToBuffer(indices.data(), indexSize, 0, cmdBuffer);
+			}
 		}
 		m_TextMesh.GetVertexCount() = (uint32_t)vertices.size();
 		m_TextMesh.GetIndexCount() = (uint32_t)indices.size();
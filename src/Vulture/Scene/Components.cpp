@@ -4,6 +4,10 @@
 
 #include "Asset/Serializer.h"
 #include "Asset/AssetManager.h"
+#include "Asset/AssetImporter.h"
+#include "Renderer/MeshOptimizer.h"
+#include "Renderer/MeshSimplifier.h"
+#include "Renderer/MeshletBuilder.h"
 
 namespace Vulture
 {
@@ -95,13 +99,47 @@ namespace Vulture
 
 	std::vector<char> TransformComponent::Serialize()
 	{
-		return Vulture::Bytes::ToBytes(this, sizeof(TransformComponent));
+		std::vector<char> bytes;
+
+		glm::vec3 translation = Transform.GetTranslation();
+		glm::quat rotation = Transform.GetRotation().GetGlmQuat();
+		glm::vec3 scale = Transform.GetScale();
+
+		std::vector<char> translationBytes = Vulture::Bytes::ToBytes(&translation, sizeof(glm::vec3));
+		std::vector<char> rotationBytes = Vulture::Bytes::ToBytes(&rotation, sizeof(glm::quat));
+		std::vector<char> scaleBytes = Vulture::Bytes::ToBytes(&scale, sizeof(glm::vec3));
+		bytes.insert(bytes.end(), translationBytes.begin(), translationBytes.end());
+		bytes.insert(bytes.end(), rotationBytes.begin(), rotationBytes.end());
+		bytes.insert(bytes.end(), scaleBytes.begin(), scaleBytes.end());
+
+		return bytes;
 	}
 
 	void TransformComponent::Deserialize(const std::vector<char>& bytes)
 	{
-		TransformComponent comp = Vulture::Bytes::FromBytes<TransformComponent>(bytes);
-		memcpy(&Transform, &comp.Transform, sizeof(Vulture::Transform));
+		glm::vec3 translation;
+		glm::quat rotation;
+		glm::vec3 scale;
+
+		// Older scenes stored the whole component raw: model matrix, translation, scale, then the quaternion
+		constexpr uint64_t serializedSize = 2 * sizeof(glm::vec3) + sizeof(glm::quat);
+		if (bytes.size() > serializedSize)
+		{
+			memcpy(&translation, bytes.data() + sizeof(glm::mat4), sizeof(glm::vec3));
+			memcpy(&scale, bytes.data() + sizeof(glm::mat4) + sizeof(glm::vec3), sizeof(glm::vec3));
+			memcpy(&rotation, bytes.data() + sizeof(glm::mat4) + 2 * sizeof(glm::vec3), sizeof(glm::quat));
+		}
+		else
+		{
+			VL_CORE_ASSERT(bytes.size() == serializedSize, "Corrupted TransformComponent data!");
+
+			memcpy(&translation, bytes.data(), sizeof(glm::vec3));
+			memcpy(&rotation, bytes.data() + sizeof(glm::vec3), sizeof(glm::quat));
+			memcpy(&scale, bytes.data() + sizeof(glm::vec3) + sizeof(glm::quat), sizeof(glm::vec3));
+		}
+
+		Transform.Init(translation, glm::vec3(0.0f), scale);
+		Transform.SetRotation(rotation);
 	}
 
 	std::vector<char> MeshComponent::Serialize()
@@ -110,19 +148,23 @@ namespace Vulture
 
 		Vulture::Mesh* mesh = AssetHandle.GetMesh();
 
-		// Get the vulkan buffers
 		uint64_t vertexCount = mesh->GetVertexCount();
 		uint64_t indexCount = mesh->GetIndexCount();
-		Vulture::Buffer* vertexBuffer = mesh->GetVertexBuffer();
-		Vulture::Buffer* indexBuffer = mesh->GetIndexBuffer();
 
-		std::vector<char> vertices(vertexCount * sizeof(Vulture::Mesh::Vertex));
-		std::vector<char> indices(indexCount * sizeof(uint32_t));
+		// Read buffers into vectors, always stored with full vertex layout and 32 bit indices. Within a scene the
+		// data was read by BeginSerialize(), otherwise the whole mesh is read in one submission
+		Vulture::Mesh::ReadbackData ownData;
+		const Vulture::Mesh::ReadbackData* data = &ownData;
+
+		auto read = s_SerializeReads.find(mesh);
+		if (read != s_SerializeReads.end())
+			data = &read->second;
+		else
+			mesh->ReadVertices(ownData.Vertices, ownData.Indices, &ownData.Meshlets);
 
-		// Read buffers into vectors
-		vertexBuffer->ReadFromBuffer(vertices.data(), vertices.size(), 0);
-		if (mesh->HasIndexBuffer()) // skip if empty
-			indexBuffer->ReadFromBuffer(indices.data(), indices.size(), 0);
+		const std::vector<Vulture::Mesh::Vertex>& vertices = data->Vertices;
+		const std::vector<uint32_t>& indices = data->Indices;
+		const Vulture::Mesh::MeshletData& meshlets = data->Meshlets;
 
 		// Start serializing
 
@@ -142,14 +184,89 @@ namespace Vulture
 		bytes.insert(bytes.end(), indexCountBytes.begin(), indexCountBytes.end()); // don't skip size even when no index buffer
 
 		// Serialize the mesh data
-		bytes.insert(bytes.end(), vertices.begin(), vertices.end());
+		const char* vertexBytes = (const char*)vertices.data();
+		bytes.insert(bytes.end(), vertexBytes, vertexBytes + vertices.size() * sizeof(Vulture::Mesh::Vertex));
 
 		if (mesh->HasIndexBuffer()) // Skip data if empty
-			bytes.insert(bytes.end(), indices.begin(), indices.end());
+		{
+			const char* indexBytes = (const char*)indices.data();
+			bytes.insert(bytes.end(), indexBytes, indexBytes + indexCount * sizeof(uint32_t));
+
+			// LODs go after LOD 0 so files without them stay readable
+			uint64_t lodCount = mesh->GetLODCount();
+			std::vector<char> lodCountBytes = Vulture::Bytes::ToBytes(&lodCount, 8);
+			bytes.insert(bytes.end(), lodCountBytes.begin(), lodCountBytes.end());
+
+			for (uint32_t i = 1; i < lodCount; i++)
+			{
+				const Vulture::Mesh::LOD& lod = mesh->GetLOD(i);
+				uint64_t lodIndexCount = lod.IndexCount;
+				float lodError = lod.Error;
+
+				std::vector<char> lodIndexCountBytes = Vulture::Bytes::ToBytes(&lodIndexCount, 8);
+				std::vector<char> lodErrorBytes = Vulture::Bytes::ToBytes(&lodError, 4);
+				bytes.insert(bytes.end(), lodIndexCountBytes.begin(), lodIndexCountBytes.end());
+				bytes.insert(bytes.end(), lodErrorBytes.begin(), lodErrorBytes.end());
+				bytes.insert(bytes.end(), indexBytes + lod.IndexOffset * sizeof(uint32_t), indexBytes + (lod.IndexOffset + lodIndexCount) * sizeof(uint32_t));
+			}
+
+			// Meshlets go after LODs, older files end before them
+			uint64_t meshletCount = meshlets.Meshlets.size();
+			uint64_t meshletVertexCount = meshlets.VertexIndices.size();
+			uint64_t meshletTriangleBytes = meshlets.Triangles.size();
+			std::vector<char> meshletCountBytes = Vulture::Bytes::ToBytes(&meshletCount, 8);
+			std::vector<char> meshletVertexCountBytes = Vulture::Bytes::ToBytes(&meshletVertexCount, 8);
+			std::vector<char> meshletTriangleBytesBytes = Vulture::Bytes::ToBytes(&meshletTriangleBytes, 8);
+			bytes.insert(bytes.end(), meshletCountBytes.begin(), meshletCountBytes.end());
+			bytes.insert(bytes.end(), meshletVertexCountBytes.begin(), meshletVertexCountBytes.end());
+			bytes.insert(bytes.end(), meshletTriangleBytesBytes.begin(), meshletTriangleBytesBytes.end());
+
+			const char* meshletBytes = (const char*)meshlets.Meshlets.data();
+			const char* meshletVertexBytes = (const char*)meshlets.VertexIndices.data();
+			const char* meshletTriangleBytesData = (const char*)meshlets.Triangles.data();
+			bytes.insert(bytes.end(), meshletBytes, meshletBytes + meshletCount * sizeof(Vulture::Mesh::Meshlet));
+			bytes.insert(bytes.end(), meshletVertexBytes, meshletVertexBytes + meshletVertexCount * sizeof(uint32_t));
+			bytes.insert(bytes.end(), meshletTriangleBytesData, meshletTriangleBytesData + meshletTriangleBytes);
+		}
 
 		return bytes;
 	}
 
+	/**
+	 * @brief Reads back every loaded mesh used by the registry in a single submission and waits for it once,
+	 * instead of one wait per mesh in Serialize().
+	 */
+	void MeshComponent::BeginSerialize(entt::registry& registry)
+	{
+		s_SerializeReads.clear();
+
+		std::vector<BufferReadback::Request> requests;
+		for (auto&& [entity, component] : registry.view<MeshComponent>().each())
+		{
+			if (!component.AssetHandle.DoesHandleExist() || !component.AssetHandle.IsAssetLoaded())
+				continue;
+
+			// Map nodes don't move, so requests can point into them
+			Vulture::Mesh* mesh = component.AssetHandle.GetMesh();
+			auto [iter, inserted] = s_SerializeReads.try_emplace(mesh);
+			if (inserted)
+				mesh->AddReadRequests(iter->second, requests);
+		}
+
+		Vulture::Mesh::ReadBuffers(requests);
+
+		for (auto& [mesh, data] : s_SerializeReads)
+			mesh->FinishRead(data);
+	}
+
+	/**
+	 * @brief Frees the data read by BeginSerialize().
+	 */
+	void MeshComponent::EndSerialize()
+	{
+		s_SerializeReads.clear();
+	}
+
 	void MeshComponent::Deserialize(const std::vector<char>& bytes)
 	{
 		uint64_t vertexCount = 0;
@@ -183,9 +300,73 @@ namespace Vulture
 		memcpy(indices.data(), bytes.data() + currentPos, indices.size() * sizeof(uint32_t));
 		currentPos += indices.size() * sizeof(uint32_t);
 
+		std::vector<Vulture::Mesh::LOD> lods;
+		if (currentPos < bytes.size())
+		{
+			uint64_t lodCount = 0;
+			memcpy(&lodCount, bytes.data() + currentPos, 8);
+			currentPos += 8;
+
+			lods.push_back({ 0, (uint32_t)indexCount, 0.0f });
+			for (uint64_t i = 1; i < lodCount; i++)
+			{
+				uint64_t lodIndexCount = 0;
+				float lodError = 0.0f;
+				memcpy(&lodIndexCount, bytes.data() + currentPos, 8);
+				currentPos += 8;
+				memcpy(&lodError, bytes.data() + currentPos, 4);
+				currentPos += 4;
+
+				lods.push_back({ (uint32_t)indices.size(), (uint32_t)lodIndexCount, lodError });
+				indices.resize(indices.size() + lodIndexCount);
+				memcpy(indices.data() + lods.back().IndexOffset, bytes.data() + currentPos, lodIndexCount * sizeof(uint32_t));
+				currentPos += lodIndexCount * sizeof(uint32_t);
+			}
+		}
+		else if (!indices.empty())
+		{
+			// Saved before meshes had LODs, data isn't optimized either
+			Vulture::MeshOptimizer::Optimize(vertices, indices);
+			Vulture::MeshSimplifier::GenerateLODs(vertices, indices, lods, Vulture::AssetImporter::GetLODSettings());
+		}
+
+		Vulture::Mesh::MeshletData meshlets;
+		if (currentPos < bytes.size())
+		{
+			uint64_t meshletCount = 0;
+			uint64_t meshletVertexCount = 0;
+			uint64_t meshletTriangleBytes = 0;
+			memcpy(&meshletCount, bytes.data() + currentPos, 8);
+			currentPos += 8;
+			memcpy(&meshletVertexCount, bytes.data() + currentPos, 8);
+			currentPos += 8;
+			memcpy(&meshletTriangleBytes, bytes.data() + currentPos, 8);
+			currentPos += 8;
+
+			meshlets.Meshlets.resize(meshletCount);
+			meshlets.VertexIndices.resize(meshletVertexCount);
+			meshlets.Triangles.resize(meshletTriangleBytes);
+			memcpy(meshlets.Meshlets.data(), bytes.data() + currentPos, meshletCount * sizeof(Vulture::Mesh::Meshlet));
+			currentPos += meshletCount * sizeof(Vulture::Mesh::Meshlet);
+			memcpy(meshlets.VertexIndices.data(), bytes.data() + currentPos, meshletVertexCount * sizeof(uint32_t));
+			currentPos += meshletVertexCount * sizeof(uint32_t);
+			memcpy(meshlets.Triangles.data(), bytes.data() + currentPos, meshletTriangleBytes);
+			currentPos += meshletTriangleBytes;
+		}
+		else if (!lods.empty())
+		{
+			Vulture::MeshletBuilder::Build(vertices, indices, lods[0].IndexCount, meshlets);
+		}
+
 		// Create the mesh
 		Vulture::Mesh mesh;
-		mesh.Init({ &vertices, &indices });
+		Vulture::Mesh::CreateInfo meshInfo{};
+		meshInfo.Vertices = &vertices;
+		meshInfo.Indices = &indices;
+		meshInfo.Layout = Vulture::Mesh::GetDefaultVertexLayout();
+		meshInfo.LODs = &lods;
+		meshInfo.Meshlets = &meshlets;
+		mesh.Init(meshInfo);
 
 		// Create the asset
 		std::unique_ptr<Vulture::Asset> meshAsset = std::make_unique<Vulture::MeshAsset>(std::move(mesh));
@@ -288,10 +469,10 @@ namespace Vulture
 		}
 
 		MaterialTextures textures{};
-		textures.AlbedoTexture = AssetManager::LoadAsset(names[0]);
-		textures.NormalTexture = AssetManager::LoadAsset(names[1]);
-		textures.RoughnessTexture = AssetManager::LoadAsset(names[2]);
-		textures.MetallnessTexture = AssetManager::LoadAsset(names[3]);
+		textures.AlbedoTexture = AssetManager::LoadAsset(names[0], TextureUsage::Color);
+		textures.NormalTexture = AssetManager::LoadAsset(names[1], TextureUsage::Normal);
+		textures.RoughnessTexture = AssetManager::LoadAsset(names[2], TextureUsage::Mask);
+		textures.MetallnessTexture = AssetManager::LoadAsset(names[3], TextureUsage::Mask);
 
 		// Material Name
 		std::string materialName;
@@ -107,7 +107,14 @@ namespace Vulture
 		std::vector<char> Serialize();
 		void Deserialize(const std::vector<char>& bytes);
 
+		// Called by Serializer around a scene, reads every mesh of the registry in one submission
+		static void BeginSerialize(entt::registry& registry);
+		static void EndSerialize();
+
 		Vulture::AssetHandle AssetHandle;
+
+	private:
+		inline static std::unordered_map<Vulture::Mesh*, Vulture::Mesh::ReadbackData> s_SerializeReads;
 	};
 
 	class MaterialComponent
@@ -131,15 +138,19 @@ namespace Vulture
 	public:
 		TransformComponent() = default;
 		~TransformComponent() = default;
-		TransformComponent(TransformComponent&& other) noexcept { Transform = std::move(other.Transform); };
-		TransformComponent(const TransformComponent& other) { Transform = other.Transform; };
-		TransformComponent& operator=(const TransformComponent& other) { Transform = other.Transform; return *this; };
-		TransformComponent& operator=(TransformComponent&& other) noexcept { Transform = std::move(other.Transform); return *this; };
+		TransformComponent(TransformComponent&& other) noexcept : Transform(std::move(other.Transform)), WorldMatrix(other.WorldMatrix), WorldVersion(other.WorldVersion) {};
+		TransformComponent(const TransformComponent& other) : Transform(other.Transform), WorldMatrix(other.WorldMatrix), WorldVersion(other.WorldVersion) {};
+		TransformComponent& operator=(const TransformComponent& other) { Transform = other.Transform; WorldMatrix = other.WorldMatrix; WorldVersion = other.WorldVersion; return *this; };
+		TransformComponent& operator=(TransformComponent&& other) noexcept { Transform = std::move(other.Transform); WorldMatrix = other.WorldMatrix; WorldVersion = other.WorldVersion; return *this; };
 
 		std::vector<char> Serialize();
 		void Deserialize(const std::vector<char>& bytes);
 
-		Vulture::Transform Transform;
+		Vulture::Transform Transform; // Relative to the parent, see Scene::SetParent()
+
+		// Written by Scene::UpdateTransforms(), WorldVersion changes whenever WorldMatrix does
+		glm::mat4 WorldMatrix{ 1.0f };
+		uint64_t WorldVersion = 0;
 	};
 
 	class NameComponent
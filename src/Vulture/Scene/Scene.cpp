@@ -2,6 +2,10 @@
 #include "Scene.h"
 #include "Entity.h"
 #include "Components.h"
+#include "SpatialIndex.h"
+#include "TransformHierarchy.h"
+#include "SystemScheduler.h"
+#include "Math/PerspectiveCamera.h"
 #include "Asset/AssetManager.h"
 
 #include "../Renderer/AccelerationStructure.h"
@@ -14,6 +18,8 @@ namespace Vulture
 			Destroy();
 
 		m_Registry = std::make_shared<entt::registry>();
+		m_TransformHierarchy = std::make_shared<TransformHierarchy>(TransformHierarchy::CreateInfo{ m_Registry.get() });
+		m_SpatialIndex = std::make_shared<SpatialIndex>(SpatialIndex::CreateInfo{ m_Registry.get(), m_TransformHierarchy.get() });
 		m_Initialized = true;
 	}
 
@@ -36,6 +42,9 @@ namespace Vulture
 			Destroy();
 
 		m_Registry = std::move(other.m_Registry);
+		m_SpatialIndex = std::move(other.m_SpatialIndex);
+		m_TransformHierarchy = std::move(other.m_TransformHierarchy);
+		m_SystemScheduler = std::move(other.m_SystemScheduler);
 		m_Systems = std::move(other.m_Systems);
 		m_Initialized = std::move(other.m_Initialized);
 
@@ -48,6 +57,9 @@ namespace Vulture
 			Destroy();
 
 		m_Registry = std::move(other.m_Registry);
+		m_SpatialIndex = std::move(other.m_SpatialIndex);
+		m_TransformHierarchy = std::move(other.m_TransformHierarchy);
+		m_SystemScheduler = std::move(other.m_SystemScheduler);
 		m_Systems = std::move(other.m_Systems);
 		m_Initialized = std::move(other.m_Initialized);
 
@@ -128,16 +140,77 @@ namespace Vulture
 		}
 	}
 
+	/**
+	 * @brief Updates all systems, the ones with non conflicting component access run in parallel.
+	 * See SystemInterface::DeclareAccess.
+	 */
 	void Scene::UpdateSystems(double deltaTime)
 	{
-		for (int i = 0; i < m_Systems.size(); i++)
-		{
-			m_Systems[i]->OnUpdate(deltaTime);
-		}
+		GetSystemScheduler().Run(m_Systems, deltaTime);
+	}
+
+	SystemScheduler& Scene::GetSystemScheduler()
+	{
+		if (m_SystemScheduler == nullptr)
+			m_SystemScheduler = std::make_shared<SystemScheduler>(SystemScheduler::CreateInfo{});
+
+		return *m_SystemScheduler;
+	}
+
+	/**
+	 * @brief Attaches child to parent, after that the child's Transform is relative to the parent. Links aren't
+	 * serialized.
+	 *
+	 * @param child - Entity with TransformComponent.
+	 * @param parent - Entity with TransformComponent, entt::null makes the child a root again.
+	 */
+	void Scene::SetParent(entt::entity child, entt::entity parent)
+	{
+		m_TransformHierarchy->SetParent(child, parent);
+	}
+
+	entt::entity Scene::GetParent(entt::entity child) const
+	{
+		return m_TransformHierarchy->GetParent(child);
+	}
+
+	/**
+	 * @brief Updates TransformComponent::WorldMatrix of every transform that changed, together with its children.
+	 */
+	void Scene::UpdateTransforms()
+	{
+		m_TransformHierarchy->Update();
+	}
+
+	/**
+	 * @brief Finds entities with a mesh whose world bounds intersect the camera frustum. World transforms
+	 * and the spatial index are synchronized with transform changes first.
+	 *
+	 * @param camera - Camera to cull against.
+	 * @param outEntities - Cleared and filled with visible entities, in no particular order.
+	 */
+	void Scene::QueryVisible(const PerspectiveCamera& camera, std::vector<entt::entity>& outEntities)
+	{
+		outEntities.clear();
+
+		UpdateTransforms();
+		m_SpatialIndex->Update();
+		m_SpatialIndex->Query(Frustum(camera.GetProjView()), outEntities);
+	}
+
+	std::vector<entt::entity> Scene::QueryVisible(const PerspectiveCamera& camera)
+	{
+		std::vector<entt::entity> entities;
+		QueryVisible(camera, entities);
+
+		return entities;
 	}
 
 	void Scene::Reset()
 	{
+		m_SpatialIndex = nullptr; // Disconnect from the registry, so they have to go first
+		m_TransformHierarchy = nullptr;
+		m_SystemScheduler = nullptr;
 		m_Registry = nullptr;
 		m_Systems.clear();
 		m_Initialized = false;
@@ -4,6 +4,7 @@
 #include "../Math/Transform.h"
 #include "Vulkan/Window.h"
 #include "Utility/Utility.h"
+#include "Utility/Parallel.h"
 
 #include "System.h"
 
@@ -12,6 +13,10 @@ namespace Vulture
 	// forward declaration
 	class Entity;
 	class AssetManager;
+	class SpatialIndex;
+	class TransformHierarchy;
+	class SystemScheduler;
+	class PerspectiveCamera;
 
 	class Scene
 	{
@@ -44,12 +49,46 @@ namespace Vulture
 		void DestroySystems();
 		void UpdateSystems(double deltaTime);
 
+		/**
+		 * @brief Calls fn(entity, components&...) for every entity with all of the components, split into chunks
+		 * that run in parallel. Meant for SystemInterface::OnUpdate, fn may only touch the components it's given.
+		 *
+		 * @param fn - Callable with signature void(entt::entity, Components&...).
+		 * @param minBatchSize - Minimal number of entities processed by a single thread.
+		 */
+		template<typename... Components, typename Fn>
+		void ForEachParallel(Fn&& fn, uint64_t minBatchSize = 1024)
+		{
+			auto view = m_Registry->view<Components...>();
+			std::vector<entt::entity> entities(view.begin(), view.end());
+
+			Parallel::For(entities.size(), minBatchSize, [&](uint64_t begin, uint64_t end, uint32_t batch)
+			{
+				for (uint64_t i = begin; i < end; i++)
+					fn(entities[i], view.template get<Components>(entities[i])...);
+			});
+		}
+
+		SystemScheduler& GetSystemScheduler();
+
+		void SetParent(entt::entity child, entt::entity parent = entt::null);
+		entt::entity GetParent(entt::entity child) const;
+		void UpdateTransforms();
+
+		void QueryVisible(const PerspectiveCamera& camera, std::vector<entt::entity>& outEntities);
+		std::vector<entt::entity> QueryVisible(const PerspectiveCamera& camera);
+
 		inline entt::registry& GetRegistry() { return *m_Registry; }
+		inline SpatialIndex& GetSpatialIndex() { return *m_SpatialIndex; }
+		inline TransformHierarchy& GetTransformHierarchy() { return *m_TransformHierarchy; }
 
 		inline bool IsInitialized() const { return m_Initialized; }
 
 	private:
 		Ref<entt::registry> m_Registry = nullptr;
+		Ref<SpatialIndex> m_SpatialIndex = nullptr; // Heap allocated, registry signals point to it
+		Ref<TransformHierarchy> m_TransformHierarchy = nullptr; // Same as above
+		Ref<SystemScheduler> m_SystemScheduler = nullptr; // Created on first use, owns worker threads
 		std::vector<SystemInterface*> m_Systems;
 
 		bool m_Initialized = false;
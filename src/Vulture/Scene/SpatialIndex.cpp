@@ -0,0 +1,164 @@
+#include "pch.h"
+#include "SpatialIndex.h"
+#include "Components.h"
+#include "TransformHierarchy.h"
+
+#include "Renderer/Mesh.h"
+
+namespace Vulture
+{
+	void SpatialIndex::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.Registry != nullptr, "SpatialIndex needs a registry!");
+		VL_CORE_ASSERT(createInfo.Hierarchy != nullptr, "SpatialIndex needs a transform hierarchy!");
+		m_Registry = createInfo.Registry;
+		m_Hierarchy = createInfo.Hierarchy;
+
+		m_Registry->on_construct<MeshComponent>().connect<&SpatialIndex::OnMeshChanged>(*this);
+		m_Registry->on_update<MeshComponent>().connect<&SpatialIndex::OnMeshChanged>(*this);
+		m_Registry->on_destroy<MeshComponent>().connect<&SpatialIndex::OnComponentDestroyed>(*this);
+		m_Registry->on_destroy<TransformComponent>().connect<&SpatialIndex::OnComponentDestroyed>(*this);
+
+		// Entities created before the index existed
+		auto view = m_Registry->view<MeshComponent, TransformComponent>();
+		m_Dirty.assign(view.begin(), view.end());
+
+		m_Initialized = true;
+	}
+
+	void SpatialIndex::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		m_Registry->on_construct<MeshComponent>().disconnect<&SpatialIndex::OnMeshChanged>(*this);
+		m_Registry->on_update<MeshComponent>().disconnect<&SpatialIndex::OnMeshChanged>(*this);
+		m_Registry->on_destroy<MeshComponent>().disconnect<&SpatialIndex::OnComponentDestroyed>(*this);
+		m_Registry->on_destroy<TransformComponent>().disconnect<&SpatialIndex::OnComponentDestroyed>(*this);
+
+		Reset();
+	}
+
+	SpatialIndex::SpatialIndex(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	SpatialIndex::~SpatialIndex()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Brings the tree up to date with the entities that changed since the last call. Entities whose mesh
+	 * isn't loaded yet are left out until it is. World matrices have to be current, see Scene::UpdateTransforms().
+	 */
+	void SpatialIndex::Update()
+	{
+		VL_CORE_ASSERT(m_Initialized, "SpatialIndex is not initialized!");
+
+		m_Hierarchy->TakeChangedEntities(m_Dirty);
+		m_Dirty.insert(m_Dirty.end(), m_Pending.begin(), m_Pending.end());
+		m_Pending.clear();
+
+		for (entt::entity entity : m_Dirty)
+			UpdateEntity(entity);
+
+		m_Dirty.clear();
+	}
+
+	void SpatialIndex::UpdateEntity(entt::entity entity)
+	{
+		if (!m_Registry->valid(entity) || !m_Registry->all_of<MeshComponent, TransformComponent>(entity))
+		{
+			RemoveObject(entity);
+			return;
+		}
+
+		MeshComponent& meshComponent = m_Registry->get<MeshComponent>(entity);
+		if (!meshComponent.AssetHandle.DoesHandleExist() || !meshComponent.AssetHandle.IsAssetLoaded())
+		{
+			RemoveObject(entity);
+
+			// Nothing to wait for without a handle, replacing the component brings it back
+			if (meshComponent.AssetHandle.DoesHandleExist())
+				m_Pending.push_back(entity);
+			return;
+		}
+
+		const Mesh* mesh = meshComponent.AssetHandle.GetMesh();
+
+		// Transformed box of the mesh bounds (Arvo 1990)
+		const glm::mat4& matrix = m_Registry->get<TransformComponent>(entity).WorldMatrix;
+		const glm::vec3 localCenter = (mesh->GetBoundingBoxMin() + mesh->GetBoundingBoxMax()) * 0.5f;
+		const glm::vec3 localExtent = (mesh->GetBoundingBoxMax() - mesh->GetBoundingBoxMin()) * 0.5f;
+
+		const glm::vec3 center = glm::vec3(matrix * glm::vec4(localCenter, 1.0f));
+		glm::vec3 extent(0.0f);
+		for (int column = 0; column < 3; column++)
+			extent += glm::abs(glm::vec3(matrix[column])) * localExtent[column];
+
+		auto it = m_Objects.find(entity);
+		if (it == m_Objects.end())
+		{
+			Object object{};
+			object.Proxy = m_Tree.CreateProxy(center - extent, center + extent, (uint32_t)entity);
+			m_Objects.emplace(entity, object);
+		}
+		else
+		{
+			m_Tree.MoveProxy(it->second.Proxy, center - extent, center + extent);
+		}
+	}
+
+	/**
+	 * @brief Appends entities whose world bounds aren't outside of the frustum. Call Update() first.
+	 */
+	void SpatialIndex::Query(const Frustum& frustum, std::vector<entt::entity>& outEntities)
+	{
+		VL_CORE_ASSERT(m_Initialized, "SpatialIndex is not initialized!");
+
+		m_QueryResult.clear();
+		m_Tree.Query(frustum, m_QueryResult);
+
+		outEntities.reserve(outEntities.size() + m_QueryResult.size());
+		for (uint32_t entity : m_QueryResult)
+			outEntities.push_back((entt::entity)entity);
+	}
+
+	void SpatialIndex::RemoveObject(entt::entity entity)
+	{
+		auto it = m_Objects.find(entity);
+		if (it == m_Objects.end())
+			return;
+
+		m_Tree.DestroyProxy(it->second.Proxy);
+		m_Objects.erase(it);
+	}
+
+	void SpatialIndex::OnMeshChanged(entt::registry& registry, entt::entity entity)
+	{
+		m_Dirty.push_back(entity);
+	}
+
+	void SpatialIndex::OnComponentDestroyed(entt::registry& registry, entt::entity entity)
+	{
+		RemoveObject(entity);
+	}
+
+	void SpatialIndex::Reset()
+	{
+		m_Registry = nullptr;
+		m_Hierarchy = nullptr;
+		m_Tree.Clear();
+		m_Objects.clear();
+		m_Dirty.clear();
+		m_Pending.clear();
+		m_QueryResult.clear();
+		m_Initialized = false;
+	}
+
+}
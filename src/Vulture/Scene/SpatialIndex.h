@@ -0,0 +1,71 @@
+#pragma once
+#include "pch.h"
+#include "entt/entt.h"
+
+#include "Math/AABBTree.h"
+#include "Math/Frustum.h"
+
+namespace Vulture
+{
+	class Mesh;
+	class TransformHierarchy;
+
+	// World space bounding boxes of every entity with MeshComponent and TransformComponent, stored in an AABBTree.
+	// Update() only visits entities the hierarchy reports as moved, entities whose MeshComponent was emplaced or
+	// replaced and the ones still waiting for their mesh to load. Assigning a handle to an existing MeshComponent
+	// has to go through registry.replace() or patch() to be noticed. Owned by Scene, which keeps it at a stable
+	// address for the signal connections.
+	class SpatialIndex
+	{
+	public:
+		struct CreateInfo
+		{
+			entt::registry* Registry = nullptr;
+			TransformHierarchy* Hierarchy = nullptr;
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		SpatialIndex() = default;
+		SpatialIndex(const CreateInfo& createInfo);
+		~SpatialIndex();
+
+		SpatialIndex(const SpatialIndex&) = delete;
+		SpatialIndex& operator=(const SpatialIndex&) = delete;
+		SpatialIndex(SpatialIndex&&) = delete;
+		SpatialIndex& operator=(SpatialIndex&&) = delete;
+
+		void Update();
+		void Query(const Frustum& frustum, std::vector<entt::entity>& outEntities);
+
+		inline uint32_t GetObjectCount() const { return (uint32_t)m_Objects.size(); }
+		inline AABBTree& GetTree() { return m_Tree; }
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		struct Object
+		{
+			int32_t Proxy = AABBTree::NullNode;
+		};
+
+		void UpdateEntity(entt::entity entity);
+		void RemoveObject(entt::entity entity);
+		void OnMeshChanged(entt::registry& registry, entt::entity entity);
+		void OnComponentDestroyed(entt::registry& registry, entt::entity entity);
+
+		entt::registry* m_Registry = nullptr;
+		TransformHierarchy* m_Hierarchy = nullptr;
+		AABBTree m_Tree;
+		std::unordered_map<entt::entity, Object> m_Objects;
+		std::vector<entt::entity> m_Dirty; // Entities to visit in the next Update(), may contain duplicates
+		std::vector<entt::entity> m_Pending; // Entities whose mesh isn't loaded yet, checked on every Update()
+		std::vector<uint32_t> m_QueryResult;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
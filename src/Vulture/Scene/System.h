@@ -1,13 +1,77 @@
 #pragma once
 #include "pch.h"
+#include "entt/entt.h"
 
 namespace Vulture
 {
+	// Components a system touches in OnUpdate. Systems that don't declare anything are exclusive and never run
+	// concurrently with any other system, which is how every system behaved before the scheduler existed.
+	class SystemAccess
+	{
+	public:
+		template<typename... Components>
+		void Read()
+		{
+			(m_Reads.push_back(entt::type_id<Components>().hash()), ...);
+			m_Declared = true;
+		}
+
+		template<typename... Components>
+		void Write()
+		{
+			(m_Writes.push_back(entt::type_id<Components>().hash()), ...);
+			m_Declared = true;
+		}
+
+		// For systems that touch global state outside of the registry
+		inline void Exclusive() { m_Exclusive = true; m_Declared = true; }
+
+		inline bool IsExclusive() const { return m_Exclusive || !m_Declared; }
+
+		/**
+		 * @brief Two systems conflict when one of them writes a component the other one reads or writes.
+		 */
+		bool ConflictsWith(const SystemAccess& other) const
+		{
+			if (IsExclusive() || other.IsExclusive())
+				return true;
+
+			auto contains = [](const std::vector<entt::id_type>& types, entt::id_type type)
+			{
+				return std::find(types.begin(), types.end(), type) != types.end();
+			};
+
+			for (entt::id_type type : m_Writes)
+			{
+				if (contains(other.m_Writes, type) || contains(other.m_Reads, type))
+					return true;
+			}
+			for (entt::id_type type : m_Reads)
+			{
+				if (contains(other.m_Writes, type))
+					return true;
+			}
+
+			return false;
+		}
+
+	private:
+		std::vector<entt::id_type> m_Reads;
+		std::vector<entt::id_type> m_Writes;
+		bool m_Exclusive = false;
+		bool m_Declared = false;
+	};
+
 	class SystemInterface
 	{
 	public:
+		virtual ~SystemInterface() = default;
+
 		virtual void OnCreate() = 0;
 		virtual void OnUpdate(double deltaTime) = 0;
 		virtual void OnDestroy() = 0;
+
+		// Called once when the scheduler builds its graph, see SystemAccess
+		virtual void DeclareAccess(SystemAccess& access) {}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,260 @@
+#include "pch.h"
+#include "SystemScheduler.h"
+
+#include "Asset/AssetManager.h"
+
+namespace Vulture
+{
+	void SystemScheduler::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		m_ThreadCount = createInfo.ThreadCount;
+
+		m_Initialized = true;
+	}
+
+	void SystemScheduler::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		// Helper tasks still in the pool reference the scheduler
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_CV.wait(lock, [this]() { return m_QueuedHelpers == 0; });
+		}
+
+		Reset();
+	}
+
+	SystemScheduler::SystemScheduler(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	SystemScheduler::~SystemScheduler()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Calls OnUpdate of every system and returns once all of them finished. The calling thread
+	 * runs systems as well.
+	 *
+	 * @param systems - Systems in registration order.
+	 * @param deltaTime - Passed to OnUpdate.
+	 */
+	void SystemScheduler::Run(const std::vector<SystemInterface*>& systems, double deltaTime)
+	{
+		VL_CORE_ASSERT(m_Initialized, "SystemScheduler is not initialized!");
+
+		// Helpers of earlier runs that are still queued see the new generation and return without touching anything
+		// else, so the graph and the per run state below can be reset
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		const uint64_t generation = ++m_Generation;
+		VL_CORE_ASSERT(m_WorkersRunning == 0, "Helpers of the previous run are still running!");
+
+		if (systems != m_GraphSystems)
+			BuildGraph(systems);
+
+		m_Timeline.Systems.resize(m_Nodes.size());
+		m_Timeline.TotalMs = 0.0;
+		m_Timeline.BusyMs = 0.0;
+		if (m_Nodes.empty())
+			return;
+
+		m_RemainingDependencies.resize(m_Nodes.size());
+		m_Ready.clear();
+		for (uint32_t i = 0; i < (uint32_t)m_Nodes.size(); i++)
+		{
+			m_RemainingDependencies[i] = m_Nodes[i].DependencyCount;
+			if (m_Nodes[i].DependencyCount == 0)
+				m_Ready.push_back(i);
+		}
+		m_Finished = 0;
+
+		// A chain of dependent systems can't use more than one thread
+		uint32_t maxWidth = 0;
+		std::vector<uint32_t> levelWidths(m_Timeline.CriticalPathLength, 0);
+		for (const Node& node : m_Nodes)
+			maxWidth = std::max(maxWidth, ++levelWidths[node.Depth]);
+		ThreadPool& pool = AssetManager::GetThreadPool();
+		const uint32_t poolThreads = pool.GetThreadCount();
+		const uint32_t helperCount = std::min({ m_ThreadCount != 0 ? m_ThreadCount : poolThreads, poolThreads, maxWidth - 1 });
+
+		m_RunStart = std::chrono::high_resolution_clock::now();
+		m_QueuedHelpers += helperCount;
+		lock.unlock();
+
+		for (uint32_t i = 0; i < helperCount; i++)
+		{
+			pool.PushTask([this, i, generation, deltaTime]() { RunHelper(i + 1, generation, deltaTime); });
+		}
+
+		WorkerLoop(0, deltaTime);
+
+		// Helpers still read the scheduler state on their way out
+		lock.lock();
+		m_CV.wait(lock, [this]() { return m_WorkersRunning == 0; });
+		lock.unlock();
+
+		m_Timeline.TotalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_RunStart).count();
+		for (const TimelineEntry& entry : m_Timeline.Systems)
+			m_Timeline.BusyMs += entry.DurationMs;
+	}
+
+	/**
+	 * @brief Forces the graph to be rebuilt on the next Run(), call it when a system changes what it accesses.
+	 */
+	void SystemScheduler::Invalidate()
+	{
+		// Queued helpers would otherwise see an empty graph as unfinished and wait in WorkerLoop for good
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Generation++;
+		m_GraphSystems.clear();
+		m_Nodes.clear();
+	}
+
+	/**
+	 * @brief Prints the last Run(), systems ordered by start time.
+	 */
+	void SystemScheduler::LogTimeline() const
+	{
+		VL_CORE_INFO("Systems: {} in {:.3f}ms, busy {:.3f}ms, parallelism {:.2f}x, critical path {} systems",
+			m_Timeline.Systems.size(), m_Timeline.TotalMs, m_Timeline.BusyMs, m_Timeline.GetParallelism(), m_Timeline.CriticalPathLength);
+
+		std::vector<const TimelineEntry*> entries;
+		for (const TimelineEntry& entry : m_Timeline.Systems)
+			entries.push_back(&entry);
+		std::sort(entries.begin(), entries.end(), [](const TimelineEntry* a, const TimelineEntry* b) { return a->StartMs < b->StartMs; });
+
+		for (const TimelineEntry* entry : entries)
+		{
+			VL_CORE_INFO("    {:<40} thread {:>2}  {:8.3f}ms -> {:8.3f}ms  ({:.3f}ms)",
+				entry->Name, entry->ThreadIndex, entry->StartMs, entry->StartMs + entry->DurationMs, entry->DurationMs);
+		}
+	}
+
+	void SystemScheduler::BuildGraph(const std::vector<SystemInterface*>& systems)
+	{
+		m_GraphSystems = systems;
+		m_Nodes.clear();
+		m_Nodes.resize(systems.size());
+
+		std::vector<SystemAccess> accesses(systems.size());
+		for (uint32_t i = 0; i < (uint32_t)systems.size(); i++)
+		{
+			systems[i]->DeclareAccess(accesses[i]);
+
+			m_Nodes[i].System = systems[i];
+			m_Nodes[i].Name = typeid(*systems[i]).name();
+			if (m_Nodes[i].Name.find("class ") != std::string::npos)
+				m_Nodes[i].Name = m_Nodes[i].Name.substr(6, m_Nodes[i].Name.size() - 6);
+		}
+
+		// Earlier systems go first whenever two of them conflict, so the result is the same as running them in order
+		uint32_t exclusiveCount = 0;
+		uint32_t criticalPath = 0;
+		for (uint32_t j = 0; j < (uint32_t)systems.size(); j++)
+		{
+			for (uint32_t i = 0; i < j; i++)
+			{
+				if (!accesses[i].ConflictsWith(accesses[j]))
+					continue;
+
+				m_Nodes[i].Dependents.push_back(j);
+				m_Nodes[j].DependencyCount++;
+				m_Nodes[j].Depth = std::max(m_Nodes[j].Depth, m_Nodes[i].Depth + 1);
+			}
+
+			criticalPath = std::max(criticalPath, m_Nodes[j].Depth + 1);
+			exclusiveCount += accesses[j].IsExclusive() ? 1 : 0;
+		}
+
+		m_Timeline.CriticalPathLength = criticalPath;
+		m_Timeline.Systems.assign(m_Nodes.size(), {});
+
+		VL_CORE_TRACE("Built system graph: {} systems, {} exclusive, critical path {}", systems.size(), exclusiveCount, criticalPath);
+	}
+
+	/**
+	 * @brief Pool task of a helper. Joins the run it was pushed for, unless every system already finished.
+	 */
+	void SystemScheduler::RunHelper(uint32_t threadIndex, uint64_t generation, double deltaTime)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_QueuedHelpers--;
+		if (generation != m_Generation || m_Finished == (uint32_t)m_Nodes.size())
+		{
+			m_CV.notify_all();
+			return;
+		}
+
+		m_WorkersRunning++;
+		lock.unlock();
+
+		WorkerLoop(threadIndex, deltaTime);
+	}
+
+	void SystemScheduler::WorkerLoop(uint32_t threadIndex, double deltaTime)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true)
+		{
+			m_CV.wait(lock, [this]() { return !m_Ready.empty() || m_Finished == (uint32_t)m_Nodes.size(); });
+			if (m_Ready.empty())
+				break;
+
+			// Lowest index first, so with a single thread systems run in registration order
+			auto next = std::min_element(m_Ready.begin(), m_Ready.end());
+			const uint32_t index = *next;
+			m_Ready.erase(next);
+			lock.unlock();
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			m_Nodes[index].System->OnUpdate(deltaTime);
+			const auto end = std::chrono::high_resolution_clock::now();
+
+			lock.lock();
+
+			TimelineEntry& entry = m_Timeline.Systems[index];
+			entry.Name = m_Nodes[index].Name;
+			entry.StartMs = std::chrono::duration<double, std::milli>(start - m_RunStart).count();
+			entry.DurationMs = std::chrono::duration<double, std::milli>(end - start).count();
+			entry.ThreadIndex = threadIndex;
+
+			m_Finished++;
+			for (uint32_t dependent : m_Nodes[index].Dependents)
+			{
+				if (--m_RemainingDependencies[dependent] == 0)
+					m_Ready.push_back(dependent);
+			}
+
+			m_CV.notify_all();
+		}
+
+		if (threadIndex != 0)
+		{
+			m_WorkersRunning--;
+			m_CV.notify_all();
+		}
+	}
+
+	void SystemScheduler::Reset()
+	{
+		m_Nodes.clear();
+		m_GraphSystems.clear();
+		m_ThreadCount = 0;
+		m_RemainingDependencies.clear();
+		m_Ready.clear();
+		m_Finished = 0;
+		m_WorkersRunning = 0;
+		m_QueuedHelpers = 0;
+		m_Generation = 0;
+		m_Timeline = {};
+		m_Initialized = false;
+	}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "pch.h"
+
+#include "System.h"
+
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+namespace Vulture
+{
+	// Runs scene systems on the engine worker pool (AssetManager::GetThreadPool()). Every system depends on the earlier
+	// registered systems it conflicts with (see SystemAccess), so registration order is kept wherever it matters and
+	// independent systems overlap. The graph is rebuilt only when the system list changes. Timings of the last Run()
+	// are kept for GetTimeline().
+	//
+	// Helpers are pushed to the pool as optional tasks. The calling thread runs whatever they don't pick up, so pool
+	// threads busy with other work, e.g. asset loading, only cost parallelism and never hold Run() up.
+	class SystemScheduler
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32_t ThreadCount = 0; // Most pool threads one Run() uses besides the calling one, 0 means all of them
+		};
+
+		struct TimelineEntry
+		{
+			std::string Name;
+			double StartMs = 0.0; // Relative to the start of Run()
+			double DurationMs = 0.0;
+			uint32_t ThreadIndex = 0; // 0 is the thread that called Run()
+		};
+
+		struct Timeline
+		{
+			std::vector<TimelineEntry> Systems;
+			double TotalMs = 0.0;
+			double BusyMs = 0.0; // Sum of all system durations
+			uint32_t CriticalPathLength = 0; // Longest dependency chain, in systems
+
+			inline double GetParallelism() const { return TotalMs > 0.0 ? BusyMs / TotalMs : 0.0; }
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		SystemScheduler() = default;
+		SystemScheduler(const CreateInfo& createInfo);
+		~SystemScheduler();
+
+		SystemScheduler(const SystemScheduler&) = delete;
+		SystemScheduler& operator=(const SystemScheduler&) = delete;
+		SystemScheduler(SystemScheduler&&) = delete;
+		SystemScheduler& operator=(SystemScheduler&&) = delete;
+
+		void Run(const std::vector<SystemInterface*>& systems, double deltaTime);
+		void Invalidate();
+
+		inline const Timeline& GetTimeline() const { return m_Timeline; }
+		void LogTimeline() const;
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		struct Node
+		{
+			SystemInterface* System = nullptr;
+			std::string Name;
+			std::vector<uint32_t> Dependents;
+			uint32_t DependencyCount = 0;
+			uint32_t Depth = 0;
+		};
+
+		void BuildGraph(const std::vector<SystemInterface*>& systems);
+		void RunHelper(uint32_t threadIndex, uint64_t generation, double deltaTime);
+		void WorkerLoop(uint32_t threadIndex, double deltaTime);
+
+		std::vector<Node> m_Nodes;
+		std::vector<SystemInterface*> m_GraphSystems; // Systems the graph was built for
+		uint32_t m_ThreadCount = 0;
+
+		// Per Run() state, guarded by m_Mutex
+		std::mutex m_Mutex;
+		std::condition_variable m_CV;
+		std::vector<uint32_t> m_RemainingDependencies;
+		std::vector<uint32_t> m_Ready;
+		uint32_t m_Finished = 0;
+		uint32_t m_WorkersRunning = 0; // Helpers that joined the current Run()
+		uint32_t m_QueuedHelpers = 0; // Helper tasks that haven't started yet, Destroy() waits for them
+		uint64_t m_Generation = 0; // Bumped by every Run() and Invalidate(), late helpers of earlier runs return right away
+		std::chrono::high_resolution_clock::time_point m_RunStart;
+
+		Timeline m_Timeline;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
@@ -0,0 +1,350 @@
+#include "pch.h"
+#include "TransformHierarchy.h"
+#include "Components.h"
+
+#include "Math/TransformBatch.h"
+#include "Utility/Parallel.h"
+
+#include <numeric>
+
+namespace Vulture
+{
+	void TransformHierarchy::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.Registry != nullptr, "TransformHierarchy needs a registry!");
+		m_Registry = createInfo.Registry;
+
+		m_Registry->on_construct<TransformComponent>().connect<&TransformHierarchy::OnTransformChanged>(*this);
+		m_Registry->on_destroy<TransformComponent>().connect<&TransformHierarchy::OnTransformChanged>(*this);
+
+		m_Initialized = true;
+	}
+
+	void TransformHierarchy::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		m_Registry->on_construct<TransformComponent>().disconnect<&TransformHierarchy::OnTransformChanged>(*this);
+		m_Registry->on_destroy<TransformComponent>().disconnect<&TransformHierarchy::OnTransformChanged>(*this);
+
+		// Transforms can outlive the hierarchy and must not report to it anymore
+		auto view = m_Registry->view<TransformComponent>();
+		for (auto entity : view)
+			view.get<TransformComponent>(entity).Transform.SetChangeList(nullptr, 0);
+
+		Reset();
+	}
+
+	TransformHierarchy::TransformHierarchy(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	TransformHierarchy::~TransformHierarchy()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Attaches child to parent, the child's Transform becomes relative to the parent's world matrix.
+	 *
+	 * @param child - Entity with TransformComponent.
+	 * @param parent - Entity with TransformComponent, entt::null detaches the child.
+	 */
+	void TransformHierarchy::SetParent(entt::entity child, entt::entity parent)
+	{
+		VL_CORE_ASSERT(m_Registry->all_of<TransformComponent>(child), "Child has to have a TransformComponent!");
+
+		if (parent == entt::null)
+		{
+			m_Parents.erase(child);
+		}
+		else
+		{
+			VL_CORE_ASSERT(m_Registry->all_of<TransformComponent>(parent), "Parent has to have a TransformComponent!");
+
+			for (entt::entity ancestor = parent; ancestor != entt::null; ancestor = GetParent(ancestor))
+				VL_CORE_ASSERT(ancestor != child, "Entity can't be parented to its own descendant!");
+
+			m_Parents[child] = parent;
+		}
+
+		m_StructureChanged = true;
+	}
+
+	entt::entity TransformHierarchy::GetParent(entt::entity child) const
+	{
+		auto it = m_Parents.find(child);
+		return it != m_Parents.end() ? it->second : entt::null;
+	}
+
+	/**
+	 * @brief Recomputes world matrices of transforms that changed since the last call and of everything below them,
+	 * then writes them into TransformComponent::WorldMatrix. Transforms that didn't change aren't visited at all.
+	 */
+	void TransformHierarchy::Update()
+	{
+		VL_CORE_ASSERT(m_Initialized, "TransformHierarchy is not initialized!");
+
+		const bool rebuilt = m_StructureChanged;
+		if (m_StructureChanged)
+			Rebuild();
+
+		m_Changed.clear();
+		m_ChangeList.Take(m_Changed);
+		if (m_Changed.empty() && !rebuilt)
+			return;
+
+		// Cleared before the transforms are read, so modifications made while this runs are reported again
+		for (uint32_t i : m_Changed)
+		{
+			m_Components[i]->Transform.ClearChanged();
+			MarkDirty(i);
+		}
+
+		m_UpdateIndex++;
+		for (uint32_t level = 0; level < (uint32_t)m_DirtyLevels.size(); level++)
+		{
+			std::vector<uint32_t>& indices = m_DirtyLevels[level];
+			if (indices.empty())
+				continue;
+
+			const uint64_t count = indices.size();
+			m_Scratch.resize(count * 10);
+			m_LocalMatrices.resize(count);
+
+			// Parents live on previous levels, so transforms of one level are independent of each other
+			Parallel::For(count, 4096, [&](uint64_t begin, uint64_t end, uint32_t batch)
+			{
+				// Gather into structure of arrays and build all local matrices with one batch call
+				float* arrays[10];
+				for (int j = 0; j < 10; j++)
+					arrays[j] = m_Scratch.data() + count * j + begin;
+
+				for (uint64_t j = 0; j < end - begin; j++)
+				{
+					const Transform& transform = m_Components[indices[begin + j]]->Transform;
+					const glm::vec3 translation = transform.GetTranslation();
+					const glm::quat rotation = transform.GetRotation().GetGlmQuat();
+					const glm::vec3 scale = transform.GetScale();
+
+					arrays[0][j] = translation.x; arrays[1][j] = translation.y; arrays[2][j] = translation.z;
+					arrays[3][j] = rotation.x; arrays[4][j] = rotation.y; arrays[5][j] = rotation.z; arrays[6][j] = rotation.w;
+					arrays[7][j] = scale.x; arrays[8][j] = scale.y; arrays[9][j] = scale.z;
+				}
+
+				TransformBatch::Input input{ arrays[0], arrays[1], arrays[2], arrays[3], arrays[4], arrays[5], arrays[6], arrays[7], arrays[8], arrays[9] };
+				TransformBatch::ComputeMat4(input, end - begin, m_LocalMatrices.data() + begin);
+
+				for (uint64_t j = begin; j < end; j++)
+				{
+					const uint32_t i = indices[j];
+					const int32_t parent = m_ParentIndices[i];
+					m_WorldMatrices[i] = parent >= 0 ? m_WorldMatrices[parent] * m_LocalMatrices[j] : m_LocalMatrices[j];
+
+					m_Components[i]->WorldMatrix = m_WorldMatrices[i];
+					m_Components[i]->WorldVersion = m_UpdateIndex;
+				}
+			});
+
+			// Children are exactly one level deeper
+			for (uint32_t i : indices)
+			{
+				for (uint32_t child = m_ChildOffsets[i]; child < m_ChildOffsets[i + 1]; child++)
+					MarkDirty(m_Children[child]);
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(m_ChangedMutex);
+				for (uint32_t i : indices)
+				{
+					m_Dirty[i] = 0;
+					if (m_ChangeReported[i])
+						continue;
+
+					m_ChangeReported[i] = 1;
+					m_ChangedIndices.push_back(i);
+				}
+			}
+
+			indices.clear();
+		}
+	}
+
+	void TransformHierarchy::MarkDirty(uint32_t index)
+	{
+		if (m_Dirty[index])
+			return;
+
+		m_Dirty[index] = 1;
+		m_DirtyLevels[m_Depths[index]].push_back(index);
+	}
+
+	/**
+	 * @brief Appends entities whose world matrix changed since the last call, lets caches of world space data like
+	 * SpatialIndex update only what moved. Entities may have been destroyed since.
+	 */
+	void TransformHierarchy::TakeChangedEntities(std::vector<entt::entity>& outEntities)
+	{
+		std::unique_lock<std::mutex> lock(m_ChangedMutex);
+
+		outEntities.reserve(outEntities.size() + m_ChangedIndices.size());
+		for (uint32_t i : m_ChangedIndices)
+		{
+			outEntities.push_back(m_Entities[i]);
+			m_ChangeReported[i] = 0;
+		}
+		m_ChangedIndices.clear();
+	}
+
+	/**
+	 * @brief Sorts all transforms by depth, called after entities were parented or transforms added or removed.
+	 */
+	void TransformHierarchy::Rebuild()
+	{
+		auto view = m_Registry->view<TransformComponent>();
+
+		// Links of entities that lost their transform are dropped, children of removed parents become roots
+		auto hasTransform = [&](entt::entity entity) { return m_Registry->valid(entity) && m_Registry->all_of<TransformComponent>(entity); };
+		for (auto it = m_Parents.begin(); it != m_Parents.end();)
+		{
+			if (!hasTransform(it->first) || !hasTransform(it->second))
+				it = m_Parents.erase(it);
+			else
+				++it;
+		}
+
+		std::unordered_map<entt::entity, uint32_t> depths;
+		depths.reserve(view.size());
+
+		std::vector<entt::entity> chain;
+		uint32_t maxDepth = 0;
+		for (auto entity : view)
+		{
+			// Walk up until an entity with known depth, then assign depths on the way back down
+			chain.clear();
+			entt::entity current = entity;
+			while (current != entt::null && depths.find(current) == depths.end())
+			{
+				chain.push_back(current);
+				current = GetParent(current);
+			}
+
+			uint32_t depth = current == entt::null ? 0 : depths[current] + 1;
+			for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+				depths[*it] = depth++;
+
+			maxDepth = std::max(maxDepth, depths[entity]);
+		}
+
+		// Counting sort by depth
+		const uint32_t count = (uint32_t)view.size();
+		m_LevelOffsets.assign(count > 0 ? maxDepth + 2 : 0, 0);
+		for (auto& [entity, depth] : depths)
+			m_LevelOffsets[depth + 1]++;
+		for (uint32_t i = 1; i < (uint32_t)m_LevelOffsets.size(); i++)
+			m_LevelOffsets[i] += m_LevelOffsets[i - 1];
+
+		std::vector<entt::entity> entities(count);
+		std::vector<uint32_t> fill(m_LevelOffsets.begin(), m_LevelOffsets.end());
+		std::unordered_map<entt::entity, uint32_t> indices;
+		indices.reserve(count);
+		for (auto entity : view)
+		{
+			const uint32_t index = fill[depths[entity]]++;
+			entities[index] = entity;
+			indices[entity] = index;
+		}
+
+		m_Components.resize(count);
+		m_ParentIndices.resize(count);
+		m_Depths.resize(count);
+		m_Entities = entities;
+		m_ChildOffsets.assign(count + 1, 0);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			m_Components[i] = &view.get<TransformComponent>(entities[i]);
+			m_Components[i]->Transform.SetChangeList(&m_ChangeList, i);
+			m_Depths[i] = depths[entities[i]];
+
+			const entt::entity parent = GetParent(entities[i]);
+			m_ParentIndices[i] = parent != entt::null ? (int32_t)indices[parent] : -1;
+			if (parent != entt::null)
+				m_ChildOffsets[m_ParentIndices[i] + 1]++;
+		}
+
+		// Children of every transform, so that only subtrees of changed transforms are visited
+		for (uint32_t i = 1; i <= count; i++)
+			m_ChildOffsets[i] += m_ChildOffsets[i - 1];
+
+		m_Children.resize(count);
+		std::vector<uint32_t> childFill(m_ChildOffsets);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (m_ParentIndices[i] >= 0)
+				m_Children[childFill[m_ParentIndices[i]]++] = i;
+		}
+
+		// Indices reported before the rebuild point at other transforms now
+		m_Changed.clear();
+		m_ChangeList.Take(m_Changed);
+		m_Changed.clear();
+
+		m_WorldMatrices.assign(count, glm::mat4(1.0f));
+		m_Dirty.assign(count, 0);
+		m_DirtyLevels.resize(GetLevelCount());
+		for (std::vector<uint32_t>& level : m_DirtyLevels)
+			level.clear();
+
+		// Everything hangs off the roots, so this recomputes every world matrix
+		if (count > 0)
+		{
+			for (uint32_t i = m_LevelOffsets[0]; i < m_LevelOffsets[1]; i++)
+				MarkDirty(i);
+		}
+
+		// Indices moved, every world matrix is recomputed anyway so all entities are reported as changed
+		{
+			std::unique_lock<std::mutex> lock(m_ChangedMutex);
+			m_ChangedIndices.resize(count);
+			std::iota(m_ChangedIndices.begin(), m_ChangedIndices.end(), 0);
+			m_ChangeReported.assign(count, 1);
+		}
+
+		m_StructureChanged = false;
+	}
+
+	void TransformHierarchy::OnTransformChanged(entt::registry& registry, entt::entity entity)
+	{
+		m_StructureChanged = true;
+	}
+
+	void TransformHierarchy::Reset()
+	{
+		m_Registry = nullptr;
+		m_Parents.clear();
+		m_Components.clear();
+		m_Entities.clear();
+		m_ParentIndices.clear();
+		m_Depths.clear();
+		m_ChildOffsets.clear();
+		m_Children.clear();
+		m_WorldMatrices.clear();
+		m_Dirty.clear();
+		m_LevelOffsets.clear();
+		m_Changed.clear();
+		m_DirtyLevels.clear();
+		m_Scratch.clear();
+		m_LocalMatrices.clear();
+		m_ChangedIndices.clear();
+		m_ChangeReported.clear();
+		m_UpdateIndex = 0;
+		m_StructureChanged = true;
+		m_Initialized = false;
+	}
+
+}
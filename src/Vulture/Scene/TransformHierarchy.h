@@ -0,0 +1,87 @@
+#pragma once
+#include "pch.h"
+#include "entt/entt.h"
+
+#include "glm/glm.hpp"
+#include "Math/Transform.h"
+
+#include <mutex>
+
+namespace Vulture
+{
+	class TransformComponent;
+
+	// Parent child relationships between entities with TransformComponent. Transforms are kept in flat arrays sorted
+	// by depth, so every parent is computed before its children and each level is updated in parallel. Transforms
+	// report their own modifications through a TransformChangeList, Update() only visits those and their subtrees,
+	// so static transforms cost nothing per frame. Owned by Scene, which keeps it at a stable address for the
+	// registry signal connections.
+	class TransformHierarchy
+	{
+	public:
+		struct CreateInfo
+		{
+			entt::registry* Registry = nullptr;
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		TransformHierarchy() = default;
+		TransformHierarchy(const CreateInfo& createInfo);
+		~TransformHierarchy();
+
+		TransformHierarchy(const TransformHierarchy&) = delete;
+		TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+		TransformHierarchy(TransformHierarchy&&) = delete;
+		TransformHierarchy& operator=(TransformHierarchy&&) = delete;
+
+		void SetParent(entt::entity child, entt::entity parent);
+		entt::entity GetParent(entt::entity child) const;
+
+		void Update();
+		void TakeChangedEntities(std::vector<entt::entity>& outEntities);
+
+		inline uint32_t GetLevelCount() const { return m_LevelOffsets.empty() ? 0 : (uint32_t)m_LevelOffsets.size() - 1; }
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		void Rebuild();
+		void MarkDirty(uint32_t index);
+		void OnTransformChanged(entt::registry& registry, entt::entity entity);
+
+		entt::registry* m_Registry = nullptr;
+		std::unordered_map<entt::entity, entt::entity> m_Parents; // Child -> parent, roots aren't stored
+
+		// Depth sorted, level i is [m_LevelOffsets[i], m_LevelOffsets[i + 1])
+		std::vector<TransformComponent*> m_Components; // Valid until a TransformComponent is added or removed, which triggers Rebuild()
+		std::vector<entt::entity> m_Entities;
+		std::vector<int32_t> m_ParentIndices;
+		std::vector<uint32_t> m_Depths;
+		std::vector<uint32_t> m_ChildOffsets; // Children of i are m_Children[m_ChildOffsets[i]] to m_Children[m_ChildOffsets[i + 1] - 1]
+		std::vector<uint32_t> m_Children;
+		std::vector<glm::mat4> m_WorldMatrices;
+		std::vector<uint8_t> m_Dirty;
+		std::vector<uint32_t> m_LevelOffsets;
+
+		TransformChangeList m_ChangeList;
+		std::vector<uint32_t> m_Changed;
+		std::vector<std::vector<uint32_t>> m_DirtyLevels; // Reused between updates, so nothing is allocated once they warmed up
+		std::vector<float> m_Scratch;
+		std::vector<glm::mat4> m_LocalMatrices;
+
+		// World matrices changed since the last TakeChangedEntities(), each index is listed once
+		std::vector<uint32_t> m_ChangedIndices;
+		std::vector<uint8_t> m_ChangeReported;
+		std::mutex m_ChangedMutex;
+
+		uint64_t m_UpdateIndex = 0;
+		bool m_StructureChanged = true;
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
@@ -0,0 +1,58 @@
+// Decoding of Mesh::CompactVertex, include it in shaders that draw or trace meshes created with VertexLayout::Compact.
+// Has to match Mesh::EncodeVertices.
+//
+// Rasterization reads the vertex through Mesh::GetAttributeDescriptions(VertexLayout::Compact), the hardware already
+// converts SNORM16 and half floats, so only DequantizePosition and DecodeOctahedral are needed:
+//
+//     vec3 position = DequantizePosition(inPosition.xyz, instance.DequantScale, instance.DequantOffset);
+//     vec3 normal = DecodeOctahedral(inNormal);
+//
+// Ray tracing fetches vertices from the storage buffer itself. Compact vertices are 16 bytes, declare the buffer
+// as uvec4 elements (not the 32 byte full Vertex) and decode them with DecodeCompactVertex. Meshes with at most
+// 65536 vertices also use 16 bit indices, see Mesh::GetIndexType, read them with ReadIndex16.
+
+#ifndef COMPACT_VERTEX_GLSL
+#define COMPACT_VERTEX_GLSL
+
+struct DecodedVertex
+{
+    vec3 Position;
+    vec3 Normal;
+    vec2 TexCoord;
+};
+
+vec3 DequantizePosition(vec3 position, vec3 dequantScale, vec3 dequantOffset)
+{
+    return dequantOffset + dequantScale * position;
+}
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded.x, encoded.y, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+
+    return normalize(normal);
+}
+
+// raw is one 16 byte vertex: position xy, position z + padding, normal, texcoord
+DecodedVertex DecodeCompactVertex(uvec4 raw, vec3 dequantScale, vec3 dequantOffset)
+{
+    vec3 position = vec3(unpackSnorm2x16(raw.x), unpackSnorm2x16(raw.y).x);
+
+    DecodedVertex vertex;
+    vertex.Position = DequantizePosition(position, dequantScale, dequantOffset);
+    vertex.Normal = DecodeOctahedral(unpackSnorm2x16(raw.z));
+    vertex.TexCoord = unpackHalf2x16(raw.w);
+
+    return vertex;
+}
+
+// word is element index / 2 of the index buffer declared as uint array
+uint ReadIndex16(uint word, uint index)
+{
+    return (index & 1u) != 0u ? word >> 16 : word & 0xFFFFu;
+}
+
+#endif
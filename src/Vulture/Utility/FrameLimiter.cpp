@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "FrameLimiter.h"
+
+#include <thread>
+
+namespace Vulture
+{
+	/**
+	 * @brief Returns at the deadline, or right away if it has already passed.
+	 */
+	void FrameLimiter::WaitUntil(Clock::time_point deadline)
+	{
+		while (true)
+		{
+			const double remainingMs = std::chrono::duration<double, std::milli>(deadline - Clock::now()).count();
+			if (remainingMs <= GetSleepEstimateMs())
+				break;
+
+			const Clock::time_point start = Clock::now();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			const double sleptMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			// Exponential moving average, so a temporarily busy system doesn't disable sleeping for good
+			const double alpha = 0.05;
+			const double delta = sleptMs - m_SleepMean;
+			m_SleepMean += alpha * delta;
+			m_SleepVariance = (1.0 - alpha) * (m_SleepVariance + alpha * delta * delta);
+		}
+
+		while (Clock::now() < deadline)
+			std::this_thread::yield();
+	}
+
+}
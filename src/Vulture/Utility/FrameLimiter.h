@@ -0,0 +1,30 @@
+#pragma once
+#include "pch.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace Vulture
+{
+	// Waits until the next frame is due. Sleeping alone overshoots by up to a scheduler tick and spinning alone
+	// burns a core, so it sleeps in 1ms steps while more time remains than such a sleep has been taking, then
+	// spins for the rest. The estimate adapts to the OS timer resolution.
+	class FrameLimiter
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		FrameLimiter() = default;
+
+		void WaitUntil(Clock::time_point deadline);
+
+		// Mean plus two standard deviations of a 1ms sleep
+		inline double GetSleepEstimateMs() const { return m_SleepMean + 2.0 * std::sqrt(m_SleepVariance); }
+
+	private:
+		// Moving mean and variance of how long a 1ms sleep takes, in milliseconds
+		double m_SleepMean = 1.0;
+		double m_SleepVariance = 0.0;
+	};
+
+}
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "FrameStats.h"
+
+namespace Vulture
+{
+	void FrameStats::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+		VL_CORE_ASSERT(createInfo.WindowSize > 0, "Window size can't be 0!");
+		for (Window& window : m_Windows)
+			window.Samples.resize(createInfo.WindowSize);
+
+		m_Initialized = true;
+	}
+
+	void FrameStats::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+		Reset();
+	}
+
+	FrameStats::FrameStats(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	FrameStats::~FrameStats()
+	{
+		Destroy();
+	}
+
+	/**
+	 * @brief Records how long a stage took this frame, overwrites the oldest sample once the window is full.
+	 */
+	void FrameStats::AddSample(Stage stage, float milliseconds)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		Window& window = m_Windows[(int)stage];
+		window.Samples[window.Next] = milliseconds;
+		window.Next = (window.Next + 1) % (uint32_t)window.Samples.size();
+		window.Count = std::min(window.Count + 1, (uint32_t)window.Samples.size());
+	}
+
+	FrameStats::Percentiles FrameStats::GetPercentiles(Stage stage)
+	{
+		std::vector<float> samples = CopySamples(stage);
+
+		Percentiles percentiles;
+		percentiles.SampleCount = (uint32_t)samples.size();
+		if (samples.empty())
+			return percentiles;
+
+		std::sort(samples.begin(), samples.end());
+		auto at = [&](float percentile) { return samples[std::min((size_t)(percentile * samples.size()), samples.size() - 1)]; };
+		percentiles.P50 = at(0.50f);
+		percentiles.P95 = at(0.95f);
+		percentiles.P99 = at(0.99f);
+		percentiles.Max = samples.back();
+
+		return percentiles;
+	}
+
+	/**
+	 * @brief Counts samples per bucket, the last bucket also holds everything above the range.
+	 *
+	 * @param stage - Stage to build the histogram of.
+	 * @param bucketWidthMs - Width of a single bucket.
+	 * @param bucketCount - Number of buckets.
+	 */
+	std::vector<uint32_t> FrameStats::GetHistogram(Stage stage, float bucketWidthMs, uint32_t bucketCount)
+	{
+		VL_CORE_ASSERT(bucketWidthMs > 0.0f && bucketCount > 0, "Invalid histogram layout!");
+
+		std::vector<uint32_t> buckets(bucketCount, 0);
+		for (float sample : CopySamples(stage))
+			buckets[std::min((uint32_t)(sample / bucketWidthMs), bucketCount - 1)]++;
+
+		return buckets;
+	}
+
+	/**
+	 * @brief Prints percentiles of every stage that has samples.
+	 */
+	void FrameStats::Log()
+	{
+		VL_CORE_INFO("Frame stages over the last {} frames:", CopySamples(Stage::Frame).size());
+		for (int i = 0; i < (int)Stage::Count; i++)
+		{
+			const Percentiles percentiles = GetPercentiles((Stage)i);
+			if (percentiles.SampleCount == 0)
+				continue;
+
+			VL_CORE_INFO("    {:<12} p50 {:7.3f}ms  p95 {:7.3f}ms  p99 {:7.3f}ms  max {:7.3f}ms",
+				GetStageName((Stage)i), percentiles.P50, percentiles.P95, percentiles.P99, percentiles.Max);
+		}
+	}
+
+	const char* FrameStats::GetStageName(Stage stage)
+	{
+		switch (stage)
+		{
+		case Stage::Poll:        return "Poll";
+		case Stage::FixedUpdate: return "FixedUpdate";
+		case Stage::Update:      return "Update";
+		case Stage::Acquire:     return "Acquire";
+		case Stage::Record:      return "Record";
+		case Stage::Submit:      return "Submit";
+		case Stage::Present:     return "Present";
+		case Stage::Pacing:      return "Pacing";
+		case Stage::Frame:       return "Frame";
+		default:                 return "Unknown";
+		}
+	}
+
+	std::vector<float> FrameStats::CopySamples(Stage stage)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		const Window& window = m_Windows[(int)stage];
+		return std::vector<float>(window.Samples.begin(), window.Samples.begin() + window.Count);
+	}
+
+	void FrameStats::Reset()
+	{
+		for (Window& window : m_Windows)
+			window = {};
+
+		m_Initialized = false;
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "pch.h"
+
+#include <mutex>
+
+namespace Vulture
+{
+	// Rolling window of per frame stage durations. Samples are cheap to add, percentiles and histograms are
+	// computed on request from a copy of the window, so stutter shows up as a gap between p50 and p99.
+	class FrameStats
+	{
+	public:
+		enum class Stage
+		{
+			Poll,
+			FixedUpdate,
+			Update,
+			Acquire,
+			Record,
+			Submit,
+			Present,
+			Pacing,
+			Frame,
+
+			Count
+		};
+
+		struct CreateInfo
+		{
+			uint32_t WindowSize = 1024; // Frames kept per stage
+		};
+
+		struct Percentiles
+		{
+			float P50 = 0.0f;
+			float P95 = 0.0f;
+			float P99 = 0.0f;
+			float Max = 0.0f;
+			uint32_t SampleCount = 0;
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		FrameStats() = default;
+		FrameStats(const CreateInfo& createInfo);
+		~FrameStats();
+
+		FrameStats(const FrameStats&) = delete;
+		FrameStats& operator=(const FrameStats&) = delete;
+		FrameStats(FrameStats&&) = delete;
+		FrameStats& operator=(FrameStats&&) = delete;
+
+		void AddSample(Stage stage, float milliseconds);
+
+		Percentiles GetPercentiles(Stage stage);
+		std::vector<uint32_t> GetHistogram(Stage stage, float bucketWidthMs, uint32_t bucketCount);
+		void Log();
+
+		static const char* GetStageName(Stage stage);
+
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		struct Window
+		{
+			std::vector<float> Samples;
+			uint32_t Next = 0;
+			uint32_t Count = 0;
+		};
+
+		std::vector<float> CopySamples(Stage stage);
+
+		Window m_Windows[(int)Stage::Count];
+		std::mutex m_Mutex; // Stages can be recorded from the simulation and render threads
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
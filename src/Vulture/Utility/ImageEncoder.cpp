@@ -0,0 +1,1005 @@
+#include "pch.h"
+#include "ImageEncoder.h"
+
+#include "Logger.h"
+#include "Timer.h"
+#include "Parallel.h"
+
+#include "lodepng.h"
+
+#include <bit>
+
+namespace Vulture
+{
+	static constexpr uint32_t s_WindowSize = 32768;
+	static constexpr uint32_t s_HashBits = 15;
+	static constexpr uint32_t s_MinMatch = 3;
+	static constexpr uint32_t s_MaxMatch = 258;
+	static constexpr uint32_t s_MaxStoredBlock = 65535;
+	static constexpr uint32_t s_MaxBlockSymbols = 16384;
+
+	static constexpr uint16_t s_LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static constexpr uint8_t s_LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr uint16_t s_DistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static constexpr uint8_t s_DistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static constexpr uint8_t s_CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Same meaning as the zlib configuration table
+	struct MatchParams
+	{
+		uint32_t MaxChain;
+		uint32_t GoodLength; // Search only a quarter of the chain when the previous match is at least this long
+		uint32_t MaxLazy;    // Take the previous match without looking for a longer one when it's at least this long
+		uint32_t NiceLength; // Stop searching once a match this long is found
+		bool Lazy;           // Check whether the next byte starts a longer match before taking one
+	};
+
+	static MatchParams GetMatchParams(ImageEncoder::Compression compression)
+	{
+		switch (compression)
+		{
+		case ImageEncoder::Compression::Fast:    return { 4, 4, 0, 16, false };
+		case ImageEncoder::Compression::Default: return { 128, 8, 16, 128, true };
+		case ImageEncoder::Compression::Max:     return { 4096, 32, s_MaxMatch, s_MaxMatch, true };
+		default:                                 return { 0, 0, 0, 0, false };
+		}
+	}
+
+	struct EncoderTables
+	{
+		uint32_t Crc[4][256]; // Slicing by 4
+		uint8_t LengthCode[s_MaxMatch + 1]; // Match length -> length code - 257
+		uint8_t DistCodeLow[256];  // Distance - 1 -> distance code, for distances up to 256
+		uint8_t DistCodeHigh[256]; // (Distance - 1) >> 7 -> distance code, for the rest
+
+		EncoderTables()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++)
+					crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+				Crc[0][i] = crc;
+			}
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				for (int slice = 1; slice < 4; slice++)
+					Crc[slice][i] = (Crc[slice - 1][i] >> 8) ^ Crc[0][Crc[slice - 1][i] & 0xFF];
+			}
+
+			for (uint32_t code = 0; code < 29; code++)
+			{
+				for (uint32_t length = s_LengthBase[code]; length < s_LengthBase[code] + (1u << s_LengthExtra[code]) && length <= s_MaxMatch; length++)
+					LengthCode[length] = (uint8_t)code;
+			}
+			// 258 has its own code even though code 27 could express it
+			LengthCode[s_MaxMatch] = 28;
+
+			for (uint32_t code = 0; code < 30; code++)
+			{
+				const uint32_t first = s_DistBase[code] - 1;
+				const uint32_t last = first + (1u << s_DistExtra[code]);
+				for (uint32_t dist = first; dist < last; dist++)
+				{
+					if (dist < 256)
+						DistCodeLow[dist] = (uint8_t)code;
+					else
+						DistCodeHigh[dist >> 7] = (uint8_t)code;
+				}
+			}
+		}
+	};
+
+	static const EncoderTables& GetTables()
+	{
+		static EncoderTables tables;
+		return tables;
+	}
+
+	static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		const auto& table = GetTables().Crc;
+		crc = ~crc;
+		size_t i = 0;
+		for (; i + 4 <= size; i += 4)
+		{
+			crc ^= (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) | ((uint32_t)data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+			crc = table[3][crc & 0xFF] ^ table[2][(crc >> 8) & 0xFF] ^ table[1][(crc >> 16) & 0xFF] ^ table[0][crc >> 24];
+		}
+		for (; i < size; i++)
+			crc = table[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static constexpr uint32_t s_AdlerBase = 65521;
+
+	static uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0)
+		{
+			// Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits into 32 bits
+			const size_t chunk = std::min(size, (size_t)5552);
+			for (size_t i = 0; i < chunk; i++)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= s_AdlerBase;
+			b %= s_AdlerBase;
+			data += chunk;
+			size -= chunk;
+		}
+		return (b << 16) | a;
+	}
+
+	// Adler-32 of two concatenated buffers from the checksums of both of them
+	static uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, uint64_t size2)
+	{
+		const uint32_t remainder = (uint32_t)(size2 % s_AdlerBase);
+		uint32_t sum1 = adler1 & 0xFFFF;
+		uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % s_AdlerBase);
+		sum1 += (adler2 & 0xFFFF) + s_AdlerBase - 1;
+		sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + s_AdlerBase - remainder;
+		if (sum1 >= s_AdlerBase) sum1 -= s_AdlerBase;
+		if (sum1 >= s_AdlerBase) sum1 -= s_AdlerBase;
+		if (sum2 >= (s_AdlerBase << 1)) sum2 -= (s_AdlerBase << 1);
+		if (sum2 >= s_AdlerBase) sum2 -= s_AdlerBase;
+		return sum1 | (sum2 << 16);
+	}
+
+	static void AppendU32BE(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back((uint8_t)(value >> 24));
+		out.push_back((uint8_t)(value >> 16));
+		out.push_back((uint8_t)(value >> 8));
+		out.push_back((uint8_t)value);
+	}
+
+	static void AppendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, uint32_t size)
+	{
+		AppendU32BE(out, size);
+		const size_t typeOffset = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+		AppendU32BE(out, Crc32(out.data() + typeOffset, size + 4));
+	}
+
+	// Deflate bits are packed starting from the least significant bit of every byte
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out) : m_Out(out) {}
+
+		inline void Write(uint32_t bits, uint32_t count)
+		{
+			m_Buffer |= (uint64_t)bits << m_Count;
+			m_Count += count;
+			if (m_Count >= 32)
+			{
+				const uint8_t bytes[4] = { (uint8_t)m_Buffer, (uint8_t)(m_Buffer >> 8), (uint8_t)(m_Buffer >> 16), (uint8_t)(m_Buffer >> 24) };
+				m_Out.insert(m_Out.end(), bytes, bytes + 4);
+				m_Buffer >>= 32;
+				m_Count -= 32;
+			}
+		}
+
+		void AlignToByte()
+		{
+			while (m_Count > 0)
+			{
+				m_Out.push_back((uint8_t)m_Buffer);
+				m_Buffer >>= 8;
+				m_Count = m_Count > 8 ? m_Count - 8 : 0;
+			}
+			m_Buffer = 0;
+		}
+
+		// Only valid right after AlignToByte()
+		inline void WriteBytes(const uint8_t* data, size_t size) { m_Out.insert(m_Out.end(), data, data + size); }
+
+	private:
+		std::vector<uint8_t>& m_Out;
+		uint64_t m_Buffer = 0;
+		uint32_t m_Count = 0;
+	};
+
+	static void WriteStoredBlock(BitWriter& writer, const uint8_t* data, uint32_t size)
+	{
+		writer.Write(0, 3); // Not final, stored
+		writer.AlignToByte();
+		const uint8_t header[4] = { (uint8_t)size, (uint8_t)(size >> 8), (uint8_t)~size, (uint8_t)(~size >> 8) };
+		writer.WriteBytes(header, 4);
+		writer.WriteBytes(data, size);
+	}
+
+	/**
+	 * @brief Huffman code lengths limited to maxBits. When the optimal tree is too deep the frequencies are
+	 * halved until it fits, which costs next to nothing in practice. Unused symbols get length 0, a single used
+	 * symbol is paired with a dummy one so that every tree is complete.
+	 */
+	static void BuildCodeLengths(const uint32_t* frequencies, uint32_t count, uint32_t maxBits, uint8_t* outLengths)
+	{
+		std::fill(outLengths, outLengths + count, (uint8_t)0);
+
+		std::vector<uint32_t> symbols;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (frequencies[i] > 0)
+				symbols.push_back(i);
+		}
+
+		if (symbols.empty())
+			return;
+
+		if (symbols.size() == 1)
+		{
+			outLengths[symbols[0]] = 1;
+			outLengths[symbols[0] == 0 ? 1 : 0] = 1;
+			return;
+		}
+
+		std::vector<uint64_t> weights(count);
+		for (uint32_t symbol : symbols)
+			weights[symbol] = frequencies[symbol];
+
+		const uint32_t leafCount = (uint32_t)symbols.size();
+		std::vector<uint64_t> nodeWeights(leafCount * 2 - 1);
+		std::vector<uint32_t> parents(leafCount * 2 - 1);
+		std::vector<uint32_t> depths(leafCount * 2 - 1);
+		while (true)
+		{
+			std::stable_sort(symbols.begin(), symbols.end(), [&](uint32_t a, uint32_t b) { return weights[a] < weights[b]; });
+			for (uint32_t i = 0; i < leafCount; i++)
+				nodeWeights[i] = weights[symbols[i]];
+
+			// Leaves are sorted and internal nodes are created in nondecreasing weight order, so the two lightest
+			// nodes are always at the front of one of the two queues
+			uint32_t nextLeaf = 0;
+			uint32_t nextInternal = leafCount;
+			auto popLightest = [&](uint32_t end)
+			{
+				if (nextLeaf < leafCount && (nextInternal >= end || nodeWeights[nextLeaf] <= nodeWeights[nextInternal]))
+					return nextLeaf++;
+				return nextInternal++;
+			};
+
+			for (uint32_t node = leafCount; node < leafCount * 2 - 1; node++)
+			{
+				const uint32_t a = popLightest(node);
+				const uint32_t b = popLightest(node);
+				nodeWeights[node] = nodeWeights[a] + nodeWeights[b];
+				parents[a] = node;
+				parents[b] = node;
+			}
+
+			// Parents are always created after their children
+			const uint32_t root = leafCount * 2 - 2;
+			depths[root] = 0;
+			uint32_t maxDepth = 0;
+			for (int32_t node = (int32_t)root - 1; node >= 0; node--)
+			{
+				depths[node] = depths[parents[node]] + 1;
+				maxDepth = std::max(maxDepth, depths[node]);
+			}
+
+			if (maxDepth <= maxBits)
+			{
+				for (uint32_t i = 0; i < leafCount; i++)
+					outLengths[symbols[i]] = (uint8_t)depths[i];
+				return;
+			}
+
+			for (uint32_t symbol : symbols)
+				weights[symbol] = (weights[symbol] + 1) / 2;
+		}
+	}
+
+	static uint32_t ReverseBits(uint32_t code, uint32_t length)
+	{
+		uint32_t result = 0;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			result = (result << 1) | (code & 1);
+			code >>= 1;
+		}
+		return result;
+	}
+
+	// Canonical codes, bit reversed because Huffman codes are the only thing deflate packs most significant bit first
+	static void BuildCodes(const uint8_t* lengths, uint32_t count, uint16_t* outCodes)
+	{
+		uint32_t lengthCounts[16] = {};
+		for (uint32_t i = 0; i < count; i++)
+			lengthCounts[lengths[i]]++;
+		lengthCounts[0] = 0;
+
+		uint32_t nextCode[16] = {};
+		uint32_t code = 0;
+		for (uint32_t bits = 1; bits < 16; bits++)
+		{
+			code = (code + lengthCounts[bits - 1]) << 1;
+			nextCode[bits] = code;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+			outCodes[i] = lengths[i] ? (uint16_t)ReverseBits(nextCode[lengths[i]]++, lengths[i]) : 0;
+	}
+
+	struct Symbol
+	{
+		uint16_t LitLen; // Literal byte or match length
+		uint16_t Dist;   // 0 for literals
+	};
+
+	class StripDeflater
+	{
+	public:
+		StripDeflater(BitWriter& writer, const uint8_t* data, uint32_t size, const MatchParams& params)
+			: m_Writer(writer), m_Data(data), m_Size(size), m_Params(params)
+		{
+			m_Head.assign((size_t)1 << s_HashBits, -1);
+			m_Prev.assign(s_WindowSize, -1);
+			m_Symbols.reserve(s_MaxBlockSymbols);
+		}
+
+		void Compress()
+		{
+			bool hasPrevious = false;
+			uint32_t prevLength = 0;
+			uint32_t prevDist = 0;
+
+			uint32_t pos = 0;
+			while (pos < m_Size)
+			{
+				uint32_t length = 0;
+				uint32_t dist = 0;
+				if (pos + s_MinMatch <= m_Size)
+				{
+					const bool searchLonger = !hasPrevious || prevLength < m_Params.MaxLazy;
+					if (searchLonger)
+						FindMatch(pos, hasPrevious ? std::max(prevLength, s_MinMatch - 1) : s_MinMatch - 1, length, dist);
+					Insert(pos);
+				}
+
+				if (!m_Params.Lazy)
+				{
+					if (length >= s_MinMatch)
+					{
+						AddMatch(length, dist);
+						InsertRange(pos + 1, pos + length);
+						pos += length;
+					}
+					else
+					{
+						AddLiteral(m_Data[pos]);
+						pos++;
+					}
+					continue;
+				}
+
+				// The match found at the previous byte wins unless this one is longer
+				if (hasPrevious && prevLength >= s_MinMatch && length <= prevLength)
+				{
+					AddMatch(prevLength, prevDist);
+					InsertRange(pos + 1, pos - 1 + prevLength);
+					pos = pos - 1 + prevLength;
+					hasPrevious = false;
+					continue;
+				}
+
+				if (hasPrevious)
+					AddLiteral(m_Data[pos - 1]);
+
+				hasPrevious = true;
+				prevLength = length;
+				prevDist = dist;
+				pos++;
+			}
+
+			if (hasPrevious)
+				AddLiteral(m_Data[m_Size - 1]);
+
+			FlushBlock();
+
+			// Sync flush, the next strip starts at a byte boundary with a fresh block
+			m_Writer.Write(0, 3);
+			m_Writer.AlignToByte();
+			const uint8_t emptyStored[4] = { 0x00, 0x00, 0xFF, 0xFF };
+			m_Writer.WriteBytes(emptyStored, 4);
+		}
+
+	private:
+		inline uint32_t Hash(uint32_t pos) const
+		{
+			const uint32_t value = ((uint32_t)m_Data[pos] << 16) | ((uint32_t)m_Data[pos + 1] << 8) | m_Data[pos + 2];
+			return (value * 2654435761u) >> (32 - s_HashBits);
+		}
+
+		inline void Insert(uint32_t pos)
+		{
+			const uint32_t hash = Hash(pos);
+			m_Prev[pos & (s_WindowSize - 1)] = m_Head[hash];
+			m_Head[hash] = (int32_t)pos;
+		}
+
+		inline void InsertRange(uint32_t begin, uint32_t end)
+		{
+			end = std::min(end, m_Size >= s_MinMatch ? m_Size - s_MinMatch + 1 : 0);
+			for (uint32_t pos = begin; pos < end; pos++)
+				Insert(pos);
+		}
+
+		// Only reports matches longer than minLength
+		void FindMatch(uint32_t pos, uint32_t minLength, uint32_t& outLength, uint32_t& outDist) const
+		{
+			const uint32_t maxLength = std::min(s_MaxMatch, m_Size - pos);
+			if (maxLength <= minLength)
+				return;
+
+			const uint8_t* current = m_Data + pos;
+			uint32_t bestLength = minLength;
+			uint32_t chain = minLength >= m_Params.GoodLength ? m_Params.MaxChain / 4 : m_Params.MaxChain;
+			int32_t candidate = m_Head[Hash(pos)];
+			while (candidate >= 0 && pos - (uint32_t)candidate < s_WindowSize && chain-- > 0)
+			{
+				const uint8_t* match = m_Data + candidate;
+				// Only a candidate matching the two bytes around the current best length can beat it
+				if (match[bestLength] == current[bestLength] && match[bestLength - 1] == current[bestLength - 1] && match[0] == current[0] && match[1] == current[1])
+				{
+					const uint32_t length = MatchLength(match, current, maxLength);
+
+					if (length > bestLength)
+					{
+						bestLength = length;
+						outLength = length;
+						outDist = pos - (uint32_t)candidate;
+						if (length >= m_Params.NiceLength || length >= maxLength)
+							break;
+					}
+				}
+
+				candidate = m_Prev[candidate & (s_WindowSize - 1)];
+			}
+		}
+
+		// Compares 8 bytes at a time, the first differing byte is found from the lowest set bit (little endian)
+		static inline uint32_t MatchLength(const uint8_t* a, const uint8_t* b, uint32_t maxLength)
+		{
+			uint32_t length = 0;
+			while (length + 8 <= maxLength)
+			{
+				uint64_t valueA;
+				uint64_t valueB;
+				memcpy(&valueA, a + length, 8);
+				memcpy(&valueB, b + length, 8);
+				if (valueA != valueB)
+					return length + (uint32_t)std::countr_zero(valueA ^ valueB) / 8;
+				length += 8;
+			}
+			while (length < maxLength && a[length] == b[length])
+				length++;
+			return length;
+		}
+
+		inline void AddLiteral(uint8_t value)
+		{
+			m_Symbols.push_back({ value, 0 });
+			m_BlockBytes++;
+			if (m_Symbols.size() >= s_MaxBlockSymbols)
+				FlushBlock();
+		}
+
+		inline void AddMatch(uint32_t length, uint32_t dist)
+		{
+			m_Symbols.push_back({ (uint16_t)length, (uint16_t)dist });
+			m_BlockBytes += length;
+			if (m_Symbols.size() >= s_MaxBlockSymbols)
+				FlushBlock();
+		}
+
+		static inline uint32_t GetDistCode(const EncoderTables& tables, uint32_t dist)
+		{
+			return dist <= 256 ? tables.DistCodeLow[dist - 1] : tables.DistCodeHigh[(dist - 1) >> 7];
+		}
+
+		void FlushBlock()
+		{
+			if (m_Symbols.empty())
+				return;
+
+			const EncoderTables& tables = GetTables();
+
+			uint32_t litFrequencies[286] = {};
+			uint32_t distFrequencies[30] = {};
+			for (const Symbol& symbol : m_Symbols)
+			{
+				if (symbol.Dist == 0)
+				{
+					litFrequencies[symbol.LitLen]++;
+				}
+				else
+				{
+					litFrequencies[257 + tables.LengthCode[symbol.LitLen]]++;
+					distFrequencies[GetDistCode(tables, symbol.Dist)]++;
+				}
+			}
+			litFrequencies[256] = 1;
+
+			uint8_t litLengths[286];
+			uint8_t distLengths[30];
+			BuildCodeLengths(litFrequencies, 286, 15, litLengths);
+			BuildCodeLengths(distFrequencies, 30, 15, distLengths);
+			if (std::all_of(distLengths, distLengths + 30, [](uint8_t length) { return length == 0; }))
+			{
+				distLengths[0] = 1;
+				distLengths[1] = 1;
+			}
+
+			uint32_t litCount = 286;
+			while (litCount > 257 && litLengths[litCount - 1] == 0)
+				litCount--;
+			uint32_t distCount = 30;
+			while (distCount > 1 && distLengths[distCount - 1] == 0)
+				distCount--;
+
+			// Code lengths of both trees in one run length encoded sequence
+			uint8_t allLengths[286 + 30];
+			std::copy(litLengths, litLengths + litCount, allLengths);
+			std::copy(distLengths, distLengths + distCount, allLengths + litCount);
+			const uint32_t allCount = litCount + distCount;
+
+			std::vector<std::pair<uint8_t, uint8_t>> rle; // Code, extra bits value
+			rle.reserve(allCount);
+			for (uint32_t i = 0; i < allCount;)
+			{
+				const uint8_t length = allLengths[i];
+				uint32_t run = 1;
+				while (i + run < allCount && allLengths[i + run] == length)
+					run++;
+				i += run;
+
+				if (length == 0)
+				{
+					while (run >= 11)
+					{
+						const uint32_t count = std::min(run, 138u);
+						rle.push_back({ 18, (uint8_t)(count - 11) });
+						run -= count;
+					}
+					if (run >= 3)
+					{
+						rle.push_back({ 17, (uint8_t)(run - 3) });
+						run = 0;
+					}
+				}
+				else
+				{
+					rle.push_back({ length, 0 });
+					run--;
+					while (run >= 3)
+					{
+						const uint32_t count = std::min(run, 6u);
+						rle.push_back({ 16, (uint8_t)(count - 3) });
+						run -= count;
+					}
+				}
+
+				for (; run > 0; run--)
+					rle.push_back({ length, 0 });
+			}
+
+			uint32_t codeLengthFrequencies[19] = {};
+			for (const auto& [code, extra] : rle)
+				codeLengthFrequencies[code]++;
+			uint8_t codeLengthLengths[19];
+			uint16_t codeLengthCodes[19];
+			BuildCodeLengths(codeLengthFrequencies, 19, 7, codeLengthLengths);
+			BuildCodes(codeLengthLengths, 19, codeLengthCodes);
+
+			uint32_t codeLengthCount = 19;
+			while (codeLengthCount > 4 && codeLengthLengths[s_CodeLengthOrder[codeLengthCount - 1]] == 0)
+				codeLengthCount--;
+
+			// Fall back to a stored block when the data doesn't compress, the bit count is exact
+			uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount;
+			for (const auto& [code, extra] : rle)
+				dynamicBits += codeLengthLengths[code] + (code == 16 ? 2 : code == 17 ? 3 : code == 18 ? 7 : 0);
+			for (uint32_t i = 0; i < 286; i++)
+			{
+				dynamicBits += (uint64_t)litFrequencies[i] * litLengths[i];
+				if (i >= 257)
+					dynamicBits += (uint64_t)litFrequencies[i] * s_LengthExtra[i - 257];
+			}
+			for (uint32_t i = 0; i < 30; i++)
+				dynamicBits += (uint64_t)distFrequencies[i] * (distLengths[i] + s_DistExtra[i]);
+
+			const uint64_t storedBits = ((uint64_t)m_BlockBytes + 5 * ((m_BlockBytes + s_MaxStoredBlock - 1) / s_MaxStoredBlock)) * 8 + 7;
+			if (storedBits < dynamicBits)
+			{
+				const uint8_t* blockData = m_Data + m_BlockStart;
+				for (uint32_t offset = 0; offset < m_BlockBytes; offset += s_MaxStoredBlock)
+					WriteStoredBlock(m_Writer, blockData + offset, std::min(s_MaxStoredBlock, m_BlockBytes - offset));
+			}
+			else
+			{
+				uint16_t litCodes[286];
+				uint16_t distCodes[30];
+				BuildCodes(litLengths, 286, litCodes);
+				BuildCodes(distLengths, 30, distCodes);
+
+				m_Writer.Write(0, 1); // Not final
+				m_Writer.Write(2, 2); // Dynamic Huffman
+				m_Writer.Write(litCount - 257, 5);
+				m_Writer.Write(distCount - 1, 5);
+				m_Writer.Write(codeLengthCount - 4, 4);
+				for (uint32_t i = 0; i < codeLengthCount; i++)
+					m_Writer.Write(codeLengthLengths[s_CodeLengthOrder[i]], 3);
+
+				for (const auto& [code, extra] : rle)
+				{
+					m_Writer.Write(codeLengthCodes[code], codeLengthLengths[code]);
+					if (code == 16)
+						m_Writer.Write(extra, 2);
+					else if (code == 17)
+						m_Writer.Write(extra, 3);
+					else if (code == 18)
+						m_Writer.Write(extra, 7);
+				}
+
+				for (const Symbol& symbol : m_Symbols)
+				{
+					if (symbol.Dist == 0)
+					{
+						m_Writer.Write(litCodes[symbol.LitLen], litLengths[symbol.LitLen]);
+						continue;
+					}
+
+					const uint32_t lengthCode = tables.LengthCode[symbol.LitLen];
+					m_Writer.Write(litCodes[257 + lengthCode], litLengths[257 + lengthCode]);
+					m_Writer.Write(symbol.LitLen - s_LengthBase[lengthCode], s_LengthExtra[lengthCode]);
+
+					const uint32_t distCode = GetDistCode(tables, symbol.Dist);
+					m_Writer.Write(distCodes[distCode], distLengths[distCode]);
+					m_Writer.Write(symbol.Dist - s_DistBase[distCode], s_DistExtra[distCode]);
+				}
+
+				m_Writer.Write(litCodes[256], litLengths[256]);
+			}
+
+			m_BlockStart += m_BlockBytes;
+			m_BlockBytes = 0;
+			m_Symbols.clear();
+		}
+
+		BitWriter& m_Writer;
+		const uint8_t* m_Data;
+		uint32_t m_Size;
+		MatchParams m_Params;
+
+		std::vector<int32_t> m_Head;
+		std::vector<int32_t> m_Prev; // Previous position with the same hash, indexed by position within the window
+
+		std::vector<Symbol> m_Symbols;
+		uint32_t m_BlockStart = 0;
+		uint32_t m_BlockBytes = 0;
+	};
+
+	static inline uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c)
+	{
+		const int p = (int)a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return a;
+		return pb <= pc ? b : c;
+	}
+
+	static inline uint8_t FilterByte(uint32_t filter, uint8_t x, uint8_t a, uint8_t b, uint8_t c)
+	{
+		switch (filter)
+		{
+		case 1:  return x - a;
+		case 2:  return x - b;
+		case 3:  return x - (uint8_t)(((uint32_t)a + b) >> 1);
+		case 4:  return x - Paeth(a, b, c);
+		default: return x;
+		}
+	}
+
+	/**
+	 * @brief Writes the filter type byte followed by the filtered row. Picks the filter with the lowest sum of
+	 * absolute values (as signed bytes), the heuristic recommended by the PNG specification.
+	 */
+	static void FilterRow(const uint8_t* row, const uint8_t* prevRow, uint32_t rowSize, bool choose, uint8_t* out)
+	{
+		constexpr uint32_t bpp = 4;
+		if (!choose)
+		{
+			out[0] = 0;
+			memcpy(out + 1, row, rowSize);
+			return;
+		}
+
+		auto cost = [](uint8_t value) { return (uint32_t)std::abs((int)(int8_t)value); };
+
+		// Sums of every filter first, then only the winner is written
+		uint64_t sums[5] = {};
+		for (uint32_t i = 0; i < rowSize; i++)
+		{
+			const uint8_t a = i >= bpp ? row[i - bpp] : 0;
+			const uint8_t b = prevRow[i];
+			const uint8_t c = i >= bpp ? prevRow[i - bpp] : 0;
+			sums[0] += cost(row[i]);
+			sums[1] += cost(row[i] - a);
+			sums[2] += cost(row[i] - b);
+			sums[3] += cost(row[i] - (uint8_t)(((uint32_t)a + b) >> 1));
+			sums[4] += cost(row[i] - Paeth(a, b, c));
+		}
+
+		const uint32_t filter = (uint32_t)(std::min_element(sums, sums + 5) - sums);
+
+		out[0] = (uint8_t)filter;
+		for (uint32_t i = 0; i < rowSize; i++)
+		{
+			const uint8_t a = i >= bpp ? row[i - bpp] : 0;
+			const uint8_t c = i >= bpp ? prevRow[i - bpp] : 0;
+			out[1 + i] = FilterByte(filter, row[i], a, prevRow[i], c);
+		}
+	}
+
+	/**
+	 * @brief Encodes 8 bit RGBA pixels into a PNG file in memory.
+	 *
+	 * @param outData - Receives the whole file.
+	 * @param rgba - Rows of width * 4 bytes, top to bottom.
+	 */
+	bool ImageEncoder::EncodePNG(std::vector<uint8_t>& outData, const uint8_t* rgba, uint32_t width, uint32_t height, Compression compression)
+	{
+		outData.clear();
+		if (width == 0 || height == 0)
+		{
+			VL_CORE_ERROR("Can't encode an empty image ({}x{})", width, height);
+			return false;
+		}
+
+		const uint32_t rowSize = width * 4;
+		const MatchParams params = GetMatchParams(compression);
+		const bool store = compression == Compression::Store;
+
+		const uint32_t stripCount = Parallel::GetBatchCount(height, MinStripRows);
+		std::vector<std::vector<uint8_t>> stripChunks(stripCount);
+		std::vector<uint32_t> stripAdlers(stripCount);
+		std::vector<uint64_t> stripSizes(stripCount);
+
+		Parallel::For(height, MinStripRows, [&](uint64_t begin, uint64_t end, uint32_t stripIndex)
+		{
+			// Filtered scanlines of the strip, what the zlib stream holds
+			const uint64_t filteredSize = (end - begin) * (rowSize + 1);
+			std::vector<uint8_t> filtered(filteredSize);
+			const std::vector<uint8_t> zeroRow(begin == 0 ? rowSize : 0, 0);
+			for (uint64_t y = begin; y < end; y++)
+			{
+				const uint8_t* row = rgba + y * rowSize;
+				const uint8_t* prevRow = y == 0 ? zeroRow.data() : row - rowSize;
+				FilterRow(row, prevRow, rowSize, !store, filtered.data() + (y - begin) * (rowSize + 1));
+			}
+
+			stripAdlers[stripIndex] = Adler32(filtered.data(), filteredSize);
+			stripSizes[stripIndex] = filteredSize;
+
+			// Deflate straight into the chunk, length and type are patched in afterwards
+			std::vector<uint8_t>& chunk = stripChunks[stripIndex];
+			chunk.reserve(store ? filteredSize + filteredSize / s_MaxStoredBlock * 5 + 32 : filteredSize / 2 + 1024);
+			chunk.resize(8);
+			BitWriter writer(chunk);
+			if (store)
+			{
+				for (uint64_t offset = 0; offset < filteredSize; offset += s_MaxStoredBlock)
+					WriteStoredBlock(writer, filtered.data() + offset, (uint32_t)std::min((uint64_t)s_MaxStoredBlock, filteredSize - offset));
+			}
+			else
+			{
+				StripDeflater deflater(writer, filtered.data(), (uint32_t)filteredSize, params);
+				deflater.Compress();
+			}
+
+			const uint32_t dataSize = (uint32_t)(chunk.size() - 8);
+			chunk[0] = (uint8_t)(dataSize >> 24);
+			chunk[1] = (uint8_t)(dataSize >> 16);
+			chunk[2] = (uint8_t)(dataSize >> 8);
+			chunk[3] = (uint8_t)dataSize;
+			memcpy(chunk.data() + 4, "IDAT", 4);
+			AppendU32BE(chunk, Crc32(chunk.data() + 4, dataSize + 4));
+		});
+
+		uint32_t adler = stripAdlers[0];
+		for (uint32_t i = 1; i < stripCount; i++)
+			adler = Adler32Combine(adler, stripAdlers[i], stripSizes[i]);
+
+		size_t totalSize = 8 + 25 + 14 + 21 + 12;
+		for (const std::vector<uint8_t>& chunk : stripChunks)
+			totalSize += chunk.size();
+		outData.reserve(totalSize);
+
+		const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		outData.insert(outData.end(), signature, signature + 8);
+
+		uint8_t header[13];
+		for (int i = 0; i < 4; i++)
+		{
+			header[i] = (uint8_t)(width >> (24 - i * 8));
+			header[4 + i] = (uint8_t)(height >> (24 - i * 8));
+		}
+		header[8] = 8;  // Bit depth
+		header[9] = 6;  // RGBA
+		header[10] = 0; // Deflate
+		header[11] = 0; // Adaptive filtering
+		header[12] = 0; // No interlacing
+		AppendChunk(outData, "IHDR", header, 13);
+
+		// zlib header alone, the strips follow
+		const uint32_t level = compression == Compression::Store ? 0 : compression == Compression::Fast ? 1 : compression == Compression::Default ? 2 : 3;
+		uint32_t zlibHeader = (0x78 << 8) | (level << 6);
+		zlibHeader += 31 - zlibHeader % 31;
+		const uint8_t zlibHeaderBytes[2] = { (uint8_t)(zlibHeader >> 8), (uint8_t)zlibHeader };
+		AppendChunk(outData, "IDAT", zlibHeaderBytes, 2);
+
+		for (const std::vector<uint8_t>& chunk : stripChunks)
+			outData.insert(outData.end(), chunk.begin(), chunk.end());
+
+		// Empty final stored block and the checksum of everything
+		const uint8_t trailer[9] = { 0x01, 0x00, 0x00, 0xFF, 0xFF, (uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler };
+		AppendChunk(outData, "IDAT", trailer, 9);
+		AppendChunk(outData, "IEND", nullptr, 0);
+
+		return true;
+	}
+
+	/**
+	 * @brief Encodes 8 bit RGBA pixels into a PNG file, see EncodePNG().
+	 */
+	bool ImageEncoder::WritePNG(const std::string& filepath, const uint8_t* rgba, uint32_t width, uint32_t height, Compression compression)
+	{
+		std::vector<uint8_t> data;
+		if (!EncodePNG(data, rgba, width, height, compression))
+			return false;
+
+		return WriteData(filepath, data);
+	}
+
+	/**
+	 * @brief Writes a binary PPM (P6), alpha is dropped. Nothing to decode, every image tool reads it.
+	 *
+	 * @param rgba - 8 bit RGBA rows, top to bottom.
+	 */
+	bool ImageEncoder::WritePPM(const std::string& filepath, const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+
+		std::vector<uint8_t> data(header.size() + (size_t)width * height * 3);
+		memcpy(data.data(), header.data(), header.size());
+
+		uint8_t* out = data.data() + header.size();
+		const uint64_t pixelCount = (uint64_t)width * height;
+		for (uint64_t i = 0; i < pixelCount; i++)
+		{
+			out[i * 3 + 0] = rgba[i * 4 + 0];
+			out[i * 3 + 1] = rgba[i * 4 + 1];
+			out[i * 3 + 2] = rgba[i * 4 + 2];
+		}
+
+		return WriteData(filepath, data);
+	}
+
+	/**
+	 * @brief Writes a little endian PFM with 32 bit float RGB, alpha is dropped. Keeps HDR values as they are.
+	 *
+	 * @param rgba - 32 bit float RGBA rows, top to bottom. PFM stores them bottom to top.
+	 */
+	bool ImageEncoder::WritePFM(const std::string& filepath, const float* rgba, uint32_t width, uint32_t height)
+	{
+		// Negative scale means little endian
+		const std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+
+		std::vector<uint8_t> data(header.size() + (size_t)width * height * 3 * sizeof(float));
+		memcpy(data.data(), header.data(), header.size());
+
+		float* out = (float*)(data.data() + header.size());
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const float* row = rgba + (uint64_t)(height - 1 - y) * width * 4;
+			float* outRow = out + (uint64_t)y * width * 3;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				outRow[x * 3 + 0] = row[x * 4 + 0];
+				outRow[x * 3 + 1] = row[x * 4 + 1];
+				outRow[x * 3 + 2] = row[x * 4 + 2];
+			}
+		}
+
+		return WriteData(filepath, data);
+	}
+
+	/**
+	 * @brief Encodes a synthetic image with every compression level and with lodepng for comparison, then
+	 * prints throughput and compression ratios. The image mixes smooth gradients with noise, roughly what
+	 * rendered frames look like.
+	 */
+	void ImageEncoder::RunBenchmark(uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> pixels((size_t)width * height * 4);
+		uint32_t seed = 0x12345678;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				const uint32_t noise = (seed >> 24) & 7;
+				uint8_t* pixel = pixels.data() + ((size_t)y * width + x) * 4;
+				pixel[0] = (uint8_t)(x * 255 / width + noise);
+				pixel[1] = (uint8_t)(y * 255 / height + noise);
+				pixel[2] = (uint8_t)(((x / 64 + y / 64) & 1) ? 200 : 40 + noise);
+				pixel[3] = 255;
+			}
+		}
+
+		const double rawMB = pixels.size() / (1024.0 * 1024.0);
+		VL_CORE_INFO("Image encoder benchmark, {}x{} RGBA8 ({:.1f}MB), {} threads", width, height, rawMB, Parallel::GetBatchCount(height, MinStripRows));
+
+		auto report = [&](const char* name, float milliseconds, size_t size)
+		{
+			VL_CORE_INFO("    {:<16} {:9.2f}ms  {:8.1f}MB/s  ratio {:.2f}", name, milliseconds, rawMB / (milliseconds / 1000.0), (double)pixels.size() / size);
+		};
+
+		const Compression levels[] = { Compression::Store, Compression::Fast, Compression::Default, Compression::Max };
+		for (Compression level : levels)
+		{
+			std::vector<uint8_t> data;
+			Timer timer;
+			EncodePNG(data, pixels.data(), width, height, level);
+			report(CompressionToString(level), timer.ElapsedMillis(), data.size());
+		}
+
+		{
+			std::vector<unsigned char> data;
+			Timer timer;
+			lodepng::encode(data, pixels.data(), width, height);
+			report("lodepng", timer.ElapsedMillis(), data.size());
+		}
+	}
+
+	const char* ImageEncoder::CompressionToString(Compression compression)
+	{
+		switch (compression)
+		{
+		case Compression::Store:   return "Store";
+		case Compression::Fast:    return "Fast";
+		case Compression::Default: return "Default";
+		case Compression::Max:     return "Max";
+		default:                   return "Unknown";
+		}
+	}
+
+	bool ImageEncoder::WriteData(const std::string& filepath, const std::vector<uint8_t>& data)
+	{
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file.is_open())
+		{
+			VL_CORE_ERROR("Failed to open {} for writing", filepath);
+			return false;
+		}
+
+		file.write((const char*)data.data(), data.size());
+		if (!file)
+		{
+			VL_CORE_ERROR("Failed to write {}", filepath);
+			return false;
+		}
+
+		return true;
+	}
+
+}
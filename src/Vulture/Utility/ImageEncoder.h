@@ -0,0 +1,37 @@
+#pragma once
+#include "pch.h"
+
+namespace Vulture
+{
+	// Image file writers for captures. PNGs are split into horizontal strips that are filtered and deflated on
+	// separate threads. Every strip ends with a sync flush so the compressed strips can be concatenated into
+	// one zlib stream, each of them is written as its own IDAT chunk. Strips don't share an LZ77 window, which
+	// costs a fraction of a percent of compression on large images.
+	class ImageEncoder
+	{
+	public:
+		enum class Compression
+		{
+			Store,   // No compression at all, only limited by memory bandwidth
+			Fast,    // Short match search, no lazy matching
+			Default, // Roughly zlib level 6
+			Max,     // Long match search, for archiving
+		};
+
+		static bool EncodePNG(std::vector<uint8_t>& outData, const uint8_t* rgba, uint32_t width, uint32_t height, Compression compression = Compression::Default);
+		static bool WritePNG(const std::string& filepath, const uint8_t* rgba, uint32_t width, uint32_t height, Compression compression = Compression::Default);
+		static bool WritePPM(const std::string& filepath, const uint8_t* rgba, uint32_t width, uint32_t height);
+		static bool WritePFM(const std::string& filepath, const float* rgba, uint32_t width, uint32_t height);
+
+		static void RunBenchmark(uint32_t width = 3840, uint32_t height = 2160);
+
+		static const char* CompressionToString(Compression compression);
+
+		// Strips are never shorter than this, small images aren't worth splitting
+		static constexpr uint32_t MinStripRows = 32;
+
+	private:
+		static bool WriteData(const std::string& filepath, const std::vector<uint8_t>& data);
+	};
+
+}
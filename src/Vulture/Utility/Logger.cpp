@@ -5,13 +5,22 @@
 
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/basic_file_sink.h"
+#include "spdlog/sinks/null_sink.h"
+
+#include <bit>
 
 namespace Vulture
 {
 	std::shared_ptr<spdlog::logger> Logger::s_CoreLogger;
 	std::shared_ptr<spdlog::logger> Logger::s_ClientLogger;
+	thread_local Logger::RingHandle Logger::s_RingHandle;
 
 	void Logger::Init()
+	{
+		Init(CreateInfo{});
+	}
+
+	void Logger::Init(const CreateInfo& createInfo)
 	{
 		//std::remove("Vulture.log");
 		//std::vector<spdlog::sink_ptr> sinks;
@@ -27,6 +36,57 @@ namespace Vulture
 		//s_ClientLogger = std::make_shared<spdlog::logger>("APP", begin(sinks), end(sinks));
 		s_ClientLogger = spdlog::stdout_color_mt("APP");
 		s_ClientLogger->set_level(spdlog::level::trace);
+
+		s_ThreadBufferSize = std::bit_ceil(std::max(createInfo.ThreadBufferSize, 4096u));
+		if (createInfo.Async && !s_Async.load(std::memory_order_relaxed))
+		{
+			s_Stop = false;
+			s_Thread = std::thread(&Logger::BackgroundLoop);
+			s_Async.store(true, std::memory_order_release);
+		}
+	}
+
+	/**
+	 * @brief Writes everything that is still queued and stops the background thread, messages logged afterwards are
+	 * written synchronously.
+	 */
+	void Logger::Shutdown()
+	{
+		if (!s_Async.load(std::memory_order_relaxed))
+			return;
+
+		s_Async.store(false, std::memory_order_release);
+
+		{
+			std::unique_lock<std::mutex> lock(s_Mutex);
+			s_Stop = true;
+		}
+		s_WakeCV.notify_one();
+		s_Thread.join();
+
+		s_CoreLogger->flush();
+		s_ClientLogger->flush();
+	}
+
+	/**
+	 * @brief Blocks until every message queued before the call is written.
+	 */
+	void Logger::Flush()
+	{
+		if (s_Async.load(std::memory_order_acquire))
+		{
+			std::unique_lock<std::mutex> lock(s_Mutex);
+
+			// The pass in progress may have already gone past this thread's ring, so wait for the one after it
+			const uint64_t target = s_DrainPasses + 2;
+			s_FlushWaiters++;
+			s_WakeCV.notify_one();
+			s_DrainedCV.wait(lock, [&] { return s_DrainPasses >= target || s_Stop; });
+			s_FlushWaiters--;
+		}
+
+		s_CoreLogger->flush();
+		s_ClientLogger->flush();
 	}
 
 	Logger::~Logger()
@@ -34,4 +94,274 @@ namespace Vulture
 
 	}
 
-}
\ No newline at end of file
+	Logger::RingHandle::~RingHandle()
+	{
+		if (Ring != nullptr)
+			Ring->Retired.store(true, std::memory_order_release);
+	}
+
+	void Logger::DecodeText(const uint8_t* data, const char* format, fmt::memory_buffer& out)
+	{
+		const std::string_view text = Decode<std::string_view>(data);
+		out.append(text.data(), text.data() + text.size());
+	}
+
+	void Logger::FormatError(const char* format, const fmt::format_error& error, fmt::memory_buffer& out)
+	{
+		fmt::format_to(std::back_inserter(out), "Failed to format log message \"{}\": {}", format, error.what());
+	}
+
+	void Logger::LogText(spdlog::logger* logger, spdlog::level::level_enum level, std::string_view text)
+	{
+		// Keeps the order of the queued messages that led up to the error
+		if (level >= spdlog::level::err && s_Async.load(std::memory_order_acquire))
+			Flush();
+
+		logger->log(level, spdlog::string_view_t(text.data(), text.size()));
+	}
+
+	/**
+	 * @brief Reserves space for a record in the ring of the calling thread and fills its header. Waits for the
+	 * background thread when the ring is full, messages are never dropped.
+	 *
+	 * @return Header followed by payloadSize bytes of space, nullptr when the record doesn't fit into the ring at all.
+	 */
+	Logger::RecordHeader* Logger::BeginRecord(spdlog::logger* logger, spdlog::level::level_enum level, size_t payloadSize, DecodeFn decode, const char* format)
+	{
+		ThreadRing& ring = GetThreadRing();
+		const uint64_t capacity = ring.Mask + 1;
+		const uint64_t size = (sizeof(RecordHeader) + payloadSize + 7) & ~7ull;
+		if (size > capacity / 2)
+			return nullptr;
+
+		uint64_t head = ring.Head.load(std::memory_order_relaxed);
+		const uint64_t toEnd = capacity - (head & ring.Mask);
+		const uint64_t needed = toEnd < size ? toEnd + size : size;
+		while (capacity - (head - ring.Tail.load(std::memory_order_acquire)) < needed)
+		{
+			s_WakeRequested.store(true, std::memory_order_relaxed);
+			s_WakeCV.notify_one();
+			std::this_thread::yield();
+		}
+
+		if (toEnd < size)
+		{
+			// Only the first 8 bytes of a padding record are ever read
+			uint32_t padding[2] = { (uint32_t)toEnd, 1 };
+			memcpy(ring.Data.get() + (head & ring.Mask), padding, sizeof(padding));
+			head += toEnd;
+		}
+
+		RecordHeader* header = (RecordHeader*)(ring.Data.get() + (head & ring.Mask));
+		header->Size = (uint32_t)size;
+		header->IsPadding = 0;
+		header->Decode = decode;
+		header->Format = format;
+		header->Logger = logger;
+		header->Time = spdlog::log_clock::now();
+		header->Level = level;
+
+		ring.PendingHead = head + size;
+		return header;
+	}
+
+	void Logger::EndRecord()
+	{
+		ThreadRing& ring = *s_RingHandle.Ring;
+		ring.Head.store(ring.PendingHead, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Returns the ring of the calling thread, the lock is only taken the first time a thread logs.
+	 */
+	Logger::ThreadRing& Logger::GetThreadRing()
+	{
+		if (s_RingHandle.Ring != nullptr)
+			return *s_RingHandle.Ring;
+
+		std::unique_lock<std::mutex> lock(s_RingsMutex);
+
+		// Short lived threads take over the drained rings of exited ones instead of allocating new rings
+		for (std::unique_ptr<ThreadRing>& ring : s_Rings)
+		{
+			if (ring->Retired.load(std::memory_order_acquire) && ring->Tail.load(std::memory_order_acquire) == ring->Head.load(std::memory_order_relaxed))
+			{
+				ring->Retired.store(false, std::memory_order_relaxed);
+				s_RingHandle.Ring = ring.get();
+				return *ring;
+			}
+		}
+
+		std::unique_ptr<ThreadRing> ring = std::make_unique<ThreadRing>();
+		ring->Data = std::make_unique<uint8_t[]>(s_ThreadBufferSize);
+		ring->Mask = s_ThreadBufferSize - 1;
+		s_RingHandle.Ring = ring.get();
+		s_Rings.push_back(std::move(ring));
+		return *s_RingHandle.Ring;
+	}
+
+	/**
+	 * @brief Returns the oldest unread record of the ring, skipping padding. Only called by the background thread.
+	 */
+	const Logger::RecordHeader* Logger::Peek(ThreadRing& ring)
+	{
+		uint64_t tail = ring.Tail.load(std::memory_order_relaxed);
+		const uint64_t head = ring.Head.load(std::memory_order_acquire);
+		while (tail != head)
+		{
+			const uint8_t* data = ring.Data.get() + (tail & ring.Mask);
+
+			uint32_t padding[2];
+			memcpy(padding, data, sizeof(padding));
+			if (padding[1] == 0)
+				return (const RecordHeader*)data;
+
+			tail += padding[0];
+			ring.Tail.store(tail, std::memory_order_release);
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * @brief Writes every published record. Records of different threads are merged by the time they were logged.
+	 *
+	 * @return True if anything was written.
+	 */
+	bool Logger::DrainRings()
+	{
+		static std::vector<ThreadRing*> rings;
+		static fmt::memory_buffer buffer;
+
+		rings.clear();
+		{
+			std::unique_lock<std::mutex> lock(s_RingsMutex);
+			for (std::unique_ptr<ThreadRing>& ring : s_Rings)
+				rings.push_back(ring.get());
+		}
+
+		bool wrote = false;
+		while (true)
+		{
+			ThreadRing* oldestRing = nullptr;
+			const RecordHeader* oldest = nullptr;
+			for (ThreadRing* ring : rings)
+			{
+				const RecordHeader* header = Peek(*ring);
+				if (header != nullptr && (oldest == nullptr || header->Time < oldest->Time))
+				{
+					oldest = header;
+					oldestRing = ring;
+				}
+			}
+
+			if (oldest == nullptr)
+				break;
+
+			// An exception escaping here would terminate the whole process
+			buffer.clear();
+			try
+			{
+				oldest->Decode((const uint8_t*)(oldest + 1), oldest->Format, buffer);
+			}
+			catch (const fmt::format_error& error)
+			{
+				buffer.clear();
+				FormatError(oldest->Format, error, buffer);
+			}
+			oldest->Logger->log(oldest->Time, spdlog::source_loc{}, oldest->Level, spdlog::string_view_t(buffer.data(), buffer.size()));
+
+			oldestRing->Tail.store(oldestRing->Tail.load(std::memory_order_relaxed) + oldest->Size, std::memory_order_release);
+			wrote = true;
+		}
+
+		return wrote;
+	}
+
+	void Logger::BackgroundLoop()
+	{
+		std::unique_lock<std::mutex> lock(s_Mutex);
+		while (true)
+		{
+			const bool stop = s_Stop;
+			lock.unlock();
+
+			DrainRings();
+
+			lock.lock();
+			s_DrainPasses++;
+			s_DrainedCV.notify_all();
+
+			if (stop)
+				return;
+
+			// Logging threads never notify unless their ring is full, so the rings are polled
+			s_WakeCV.wait_for(lock, std::chrono::milliseconds(1), [] { return s_Stop || s_FlushWaiters > 0 || s_WakeRequested.exchange(false, std::memory_order_relaxed); });
+		}
+	}
+
+	/**
+	 * @brief Measures the cost of a log call on the calling thread. Messages go to a logger without sinks, so only
+	 * the queueing and formatting is measured, not the console.
+	 *
+	 * @param iterations - Number of messages logged in every mode.
+	 */
+	void Logger::RunBenchmark(uint32_t iterations)
+	{
+		spdlog::logger logger("BENCHMARK", std::make_shared<spdlog::sinks::null_sink_mt>());
+		logger.set_level(spdlog::level::info);
+
+		auto log = [&](spdlog::level::level_enum level, uint32_t i)
+		{
+			Log(&logger, level, "Loading asset: {} ({} of {}, {:.2f}ms)", "assets/Models/Sponza/Sponza.gltf", i, iterations, 1.5f);
+		};
+		auto measure = [&](spdlog::level::level_enum level)
+		{
+			Timer timer;
+			for (uint32_t i = 0; i < iterations; i++)
+				log(level, i);
+
+			return (double)timer.ElapsedMillis() * 1'000'000.0 / iterations;
+		};
+
+		VL_CORE_INFO("Logger benchmark, {} calls", iterations);
+
+		const bool async = s_Async.load(std::memory_order_acquire);
+		if (async)
+		{
+			// Bursts that fit into the ring, the way loads log, so the calling thread never waits for the background one
+			constexpr uint32_t burstSize = 128;
+			double burstMs = 0.0;
+			for (uint32_t i = 0; i < iterations; i += burstSize)
+			{
+				Timer timer;
+				for (uint32_t j = i; j < std::min(iterations, i + burstSize); j++)
+					log(spdlog::level::info, j);
+				burstMs += timer.ElapsedMillis();
+
+				Flush();
+			}
+
+			// Continuous logging is limited by how fast the background thread formats
+			Timer timer;
+			const double callNs = measure(spdlog::level::info);
+			Flush();
+			const double sustainedNs = (double)timer.ElapsedMillis() * 1'000'000.0 / iterations;
+
+			VL_CORE_INFO("    {:<10} {:8.1f}ns/call", "async", burstMs * 1'000'000.0 / iterations);
+			VL_CORE_INFO("    {:<10} {:8.1f}ns/call  {:8.1f}ns/message until written", "saturated", callNs, sustainedNs);
+
+			// Flips every thread to synchronous logging for the duration of the measurement
+			s_Async.store(false, std::memory_order_release);
+		}
+
+		const double syncNs = measure(spdlog::level::info);
+		const double filteredNs = measure(spdlog::level::trace);
+
+		s_Async.store(async, std::memory_order_release);
+
+		VL_CORE_INFO("    {:<10} {:8.1f}ns/call", "sync", syncNs);
+		VL_CORE_INFO("    {:<10} {:8.1f}ns/call", "filtered", filteredNs);
+	}
+
+}
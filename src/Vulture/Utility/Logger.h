@@ -4,48 +4,350 @@
 
 #include "spdlog/spdlog.h"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
 namespace Vulture
 {
+	// Messages below error are formatted on a background thread. The calling thread only copies the format string
+	// pointer and the arguments into its own ring buffer, strings are copied by value. Errors flush everything that
+	// is queued and are written synchronously, so they are never lost to the crash that usually follows them.
+	//
+	// Format strings of messages with arguments are checked against the arguments at compile time and have to be
+	// literals, the background thread only keeps a pointer to them. Only arithmetic, enum and string arguments are
+	// queued, anything else could reference memory of the caller and is formatted right away.
 	class Logger
 	{
 	public:
+		struct CreateInfo
+		{
+			bool Async = true;
+			uint32_t ThreadBufferSize = 64 * 1024; // Bytes per logging thread, rounded up to a power of two
+		};
+
+		// Only constructible from a literal or another constant with static storage, which the consteval constructor
+		// enforces, so the pointer stays valid until the background thread formats the message
+		template<typename... Args>
+		struct FormatString
+		{
+			template<size_t N>
+			consteval FormatString(const char (&literal)[N]) : Checked(literal), Literal(literal) {}
+
+			fmt::format_string<Args...> Checked;
+			const char* Literal;
+		};
+
 		static void Init();
+		static void Init(const CreateInfo& createInfo);
+		static void Shutdown();
+		static void Flush();
 		~Logger();
 
-		inline static std::shared_ptr<spdlog::logger> GetCoreLogger() { return s_CoreLogger; }
-		inline static std::shared_ptr<spdlog::logger> GetClientLogger() { return s_CoreLogger; }
+		template<typename T>
+		static void Log(spdlog::logger* logger, spdlog::level::level_enum level, const T& message);
+		template<typename... Args>
+		static void Log(spdlog::logger* logger, spdlog::level::level_enum level, FormatString<std::type_identity_t<Args>...> format, const Args&... args);
+
+		static void RunBenchmark(uint32_t iterations = 1'000'000);
+
+		inline static const std::shared_ptr<spdlog::logger>& GetCoreLogger() { return s_CoreLogger; }
+		inline static const std::shared_ptr<spdlog::logger>& GetClientLogger() { return s_CoreLogger; }
 	private:
 		Logger() {};
 
+		using DecodeFn = void(*)(const uint8_t* data, const char* format, fmt::memory_buffer& out);
+
+		// Every record starts with it, padding records fill the end of the ring when the next one doesn't fit there
+		struct RecordHeader
+		{
+			uint32_t Size; // Including the header, multiple of 8
+			uint32_t IsPadding;
+			DecodeFn Decode;
+			const char* Format;
+			spdlog::logger* Logger;
+			spdlog::log_clock::time_point Time;
+			spdlog::level::level_enum Level;
+		};
+
+		// Single producer, single consumer. Positions grow forever and are masked on access
+		struct ThreadRing
+		{
+			std::unique_ptr<uint8_t[]> Data;
+			uint64_t Mask = 0;
+			alignas(64) std::atomic<uint64_t> Head = 0; // Written by the logging thread
+			alignas(64) std::atomic<uint64_t> Tail = 0; // Written by the background thread
+			std::atomic<bool> Retired = false;
+			uint64_t PendingHead = 0; // Head after the record being written
+		};
+
+		struct RingHandle
+		{
+			~RingHandle();
+			ThreadRing* Ring = nullptr;
+		};
+
+		template<typename T>
+		static constexpr bool IsString = std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*> ||
+			std::is_same_v<std::decay_t<T>, std::string> || std::is_same_v<std::decay_t<T>, std::string_view>;
+
+		template<typename T>
+		static constexpr bool IsEncodable = IsString<T> || std::is_arithmetic_v<std::decay_t<T>> || std::is_enum_v<std::decay_t<T>>;
+
+		// Type the argument is formatted from on the background thread
+		template<typename T>
+		using Stored = std::conditional_t<IsString<T>, std::string_view, std::decay_t<T>>;
+
+		template<typename T>
+		static size_t EncodedSize(const T& arg);
+		template<typename T>
+		static uint8_t* Encode(uint8_t* data, const T& arg);
+		template<typename T>
+		static Stored<T> Decode(const uint8_t*& data);
+
+		template<typename... Args>
+		static void DecodeArgs(const uint8_t* data, const char* format, fmt::memory_buffer& out);
+		static void DecodeText(const uint8_t* data, const char* format, fmt::memory_buffer& out);
+
+		template<typename... Args>
+		static void LogFormatted(spdlog::logger* logger, spdlog::level::level_enum level, const FormatString<std::type_identity_t<Args>...>& format, const Args&... args);
+		static void LogText(spdlog::logger* logger, spdlog::level::level_enum level, std::string_view text);
+		static void FormatError(const char* format, const fmt::format_error& error, fmt::memory_buffer& out);
+		static RecordHeader* BeginRecord(spdlog::logger* logger, spdlog::level::level_enum level, size_t payloadSize, DecodeFn decode, const char* format);
+		static void EndRecord();
+		static ThreadRing& GetThreadRing();
+		static const RecordHeader* Peek(ThreadRing& ring);
+		static bool DrainRings();
+		static void BackgroundLoop();
+
 		static std::shared_ptr<spdlog::logger> s_CoreLogger;
 		static std::shared_ptr<spdlog::logger> s_ClientLogger;
+
+		inline static std::atomic<bool> s_Async = false;
+		inline static uint32_t s_ThreadBufferSize = 0;
+		inline static std::thread s_Thread;
+		inline static std::mutex s_Mutex;
+		inline static std::condition_variable s_WakeCV;
+		inline static std::condition_variable s_DrainedCV;
+		inline static bool s_Stop = false;
+		inline static uint64_t s_DrainPasses = 0;
+		inline static uint32_t s_FlushWaiters = 0;
+		inline static std::atomic<bool> s_WakeRequested = false; // Set by threads waiting on a full ring
+
+		inline static std::mutex s_RingsMutex;
+		inline static std::vector<std::unique_ptr<ThreadRing>> s_Rings;
+		static thread_local RingHandle s_RingHandle;
 	};
+
+	/**
+	 * @brief Logs a message without arguments. Strings are copied into the queue, anything else is formatted with
+	 * "{}".
+	 */
+	template<typename T>
+	void Logger::Log(spdlog::logger* logger, spdlog::level::level_enum level, const T& message)
+	{
+		if (!logger->should_log(level))
+			return;
+
+		if constexpr (IsString<T>)
+		{
+			const std::string_view text(message);
+			if (!s_Async.load(std::memory_order_acquire) || level >= spdlog::level::err)
+			{
+				LogText(logger, level, text);
+				return;
+			}
+
+			RecordHeader* header = BeginRecord(logger, level, sizeof(uint32_t) + text.size(), &DecodeText, nullptr);
+			if (header == nullptr)
+			{
+				LogText(logger, level, text);
+				return;
+			}
+
+			Encode((uint8_t*)(header + 1), text);
+			EndRecord();
+		}
+		else
+		{
+			Log(logger, level, "{}", message);
+		}
+	}
+
+	/**
+	 * @brief Queues the message for the background thread, or formats and writes it right away when logging is
+	 * synchronous, the message is an error or some argument can't be copied by value.
+	 */
+	template<typename... Args>
+	void Logger::Log(spdlog::logger* logger, spdlog::level::level_enum level, FormatString<std::type_identity_t<Args>...> format, const Args&... args)
+	{
+		if (!logger->should_log(level))
+			return;
+
+		if constexpr (!(IsEncodable<Args> && ...))
+		{
+			LogFormatted(logger, level, format, args...);
+		}
+		else
+		{
+			if (!s_Async.load(std::memory_order_acquire) || level >= spdlog::level::err)
+			{
+				LogFormatted(logger, level, format, args...);
+				return;
+			}
+
+			const size_t payloadSize = (EncodedSize(args) + ... + 0);
+			RecordHeader* header = BeginRecord(logger, level, payloadSize, &DecodeArgs<Args...>, format.Literal);
+			if (header == nullptr)
+			{
+				LogFormatted(logger, level, format, args...);
+				return;
+			}
+
+			uint8_t* data = (uint8_t*)(header + 1);
+			((data = Encode(data, args)), ...);
+			EndRecord();
+		}
+	}
+
+	/**
+	 * @brief Formats on the calling thread. Errors that slip past the compile time check are logged instead of
+	 * thrown into the caller, the same way spdlog handles them.
+	 */
+	template<typename... Args>
+	void Logger::LogFormatted(spdlog::logger* logger, spdlog::level::level_enum level, const FormatString<std::type_identity_t<Args>...>& format, const Args&... args)
+	{
+		fmt::memory_buffer buffer;
+		try
+		{
+			fmt::vformat_to(std::back_inserter(buffer), fmt::string_view(format.Checked), fmt::make_format_args(args...));
+		}
+		catch (const fmt::format_error& error)
+		{
+			buffer.clear();
+			FormatError(format.Literal, error, buffer);
+		}
+
+		LogText(logger, level, std::string_view(buffer.data(), buffer.size()));
+	}
+
+	template<typename T>
+	size_t Logger::EncodedSize(const T& arg)
+	{
+		if constexpr (IsString<T>)
+			return sizeof(uint32_t) + std::string_view(arg).size();
+		else
+			return sizeof(std::decay_t<T>);
+	}
+
+	template<typename T>
+	uint8_t* Logger::Encode(uint8_t* data, const T& arg)
+	{
+		if constexpr (IsString<T>)
+		{
+			const std::string_view text(arg);
+			const uint32_t size = (uint32_t)text.size();
+			memcpy(data, &size, sizeof(size));
+			memcpy(data + sizeof(size), text.data(), size);
+			return data + sizeof(size) + size;
+		}
+		else
+		{
+			const std::decay_t<T> value = arg;
+			memcpy(data, &value, sizeof(value));
+			return data + sizeof(value);
+		}
+	}
+
+	template<typename T>
+	Logger::Stored<T> Logger::Decode(const uint8_t*& data)
+	{
+		if constexpr (IsString<T>)
+		{
+			uint32_t size;
+			memcpy(&size, data, sizeof(size));
+			const std::string_view text((const char*)data + sizeof(size), size);
+			data += sizeof(size) + size;
+			return text;
+		}
+		else
+		{
+			std::decay_t<T> value;
+			memcpy(&value, data, sizeof(value));
+			data += sizeof(value);
+			return value;
+		}
+	}
+
+	template<typename... Args>
+	void Logger::DecodeArgs(const uint8_t* data, const char* format, fmt::memory_buffer& out)
+	{
+		// Braced initialization evaluates left to right, so the arguments are read in the order they were written
+		std::tuple<Stored<Args>...> values{ Decode<Args>(data)... };
+		std::apply([&](auto&... decoded) { fmt::vformat_to(std::back_inserter(out), fmt::string_view(format), fmt::make_format_args(decoded...)); }, values);
+	}
 }
 
-// Core log macros
+// Messages below this level are compiled out, uses spdlog level values
+#define VL_LOG_LEVEL_TRACE 0
+#define VL_LOG_LEVEL_INFO 2
+#define VL_LOG_LEVEL_WARN 3
+#define VL_LOG_LEVEL_ERROR 4
+#define VL_LOG_LEVEL_OFF 6
+
+#ifndef VL_LOG_LEVEL
 #ifdef DISTRIBUTION
+#define VL_LOG_LEVEL VL_LOG_LEVEL_OFF
+#else
+#define VL_LOG_LEVEL VL_LOG_LEVEL_TRACE
+#endif
+#endif
+
+#define VL_LOG_INTERNAL(logger, level, ...) ::Vulture::Logger::Log(logger.get(), level, __VA_ARGS__)
+
+// Core log macros
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_ERROR
+#define VL_CORE_ERROR(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetCoreLogger(), ::spdlog::level::err, __VA_ARGS__)
+#else
 #define VL_CORE_ERROR(...)
+#endif
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_WARN
+#define VL_CORE_WARN(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetCoreLogger(), ::spdlog::level::warn, __VA_ARGS__)
+#else
 #define VL_CORE_WARN(...)
+#endif
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_INFO
+#define VL_CORE_INFO(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetCoreLogger(), ::spdlog::level::info, __VA_ARGS__)
+#else
 #define VL_CORE_INFO(...)
-#define VL_CORE_TRACE(...)
+#endif
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_TRACE
+#define VL_CORE_TRACE(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetCoreLogger(), ::spdlog::level::trace, __VA_ARGS__)
 #else
-#define VL_CORE_ERROR(...)	::Vulture::Logger::GetCoreLogger()->error(__VA_ARGS__)
-#define VL_CORE_WARN(...)	::Vulture::Logger::GetCoreLogger()->warn(__VA_ARGS__)
-#define VL_CORE_INFO(...)	::Vulture::Logger::GetCoreLogger()->info(__VA_ARGS__)
-#define VL_CORE_TRACE(...)	::Vulture::Logger::GetCoreLogger()->trace(__VA_ARGS__)
+#define VL_CORE_TRACE(...)
 #endif
 #define VL_CORE_DIST_ERROR(...)	::Vulture::Logger::GetCoreLogger()->error(__VA_ARGS__)
 
 // Client log macros
-#ifdef DISTRIBUTION
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_ERROR
+#define VL_ERROR(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetClientLogger(), ::spdlog::level::err, __VA_ARGS__)
+#else
 #define VL_ERROR(...)
+#endif
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_WARN
+#define VL_WARN(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetClientLogger(), ::spdlog::level::warn, __VA_ARGS__)
+#else
 #define VL_WARN(...)
+#endif
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_INFO
+#define VL_INFO(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetClientLogger(), ::spdlog::level::info, __VA_ARGS__)
+#else
 #define VL_INFO(...)
-#define VL_TRACE(...)
+#endif
+#if VL_LOG_LEVEL <= VL_LOG_LEVEL_TRACE
+#define VL_TRACE(...)	VL_LOG_INTERNAL(::Vulture::Logger::GetClientLogger(), ::spdlog::level::trace, __VA_ARGS__)
 #else
-#define VL_ERROR(...)	::Vulture::Logger::GetClientLogger()->error(__VA_ARGS__)
-#define VL_WARN(...)	::Vulture::Logger::GetClientLogger()->warn(__VA_ARGS__)
-#define VL_INFO(...)	::Vulture::Logger::GetClientLogger()->info(__VA_ARGS__)
-#define VL_TRACE(...)	::Vulture::Logger::GetClientLogger()->trace(__VA_ARGS__)
+#define VL_TRACE(...)
 #endif
-#define VL_DIST_ERROR(...)	::Vulture::Logger::GetClientLogger()->error(__VA_ARGS__)
\ No newline at end of file
+#define VL_DIST_ERROR(...)	::Vulture::Logger::GetClientLogger()->error(__VA_ARGS__)
@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#include "Logger.h"
+
+#ifndef WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Vulture
+{
+	/**
+	 * @brief Maps the whole file into memory for reading. Leaves the object uninitialized and logs a warning
+	 * when the file can't be opened, so check IsInitialized() afterwards.
+	 *
+	 * @param createInfo - Path to the file.
+	 */
+	void MappedFile::Init(const CreateInfo& createInfo)
+	{
+		if (m_Initialized)
+			Destroy();
+
+#ifdef WIN
+		m_FileHandle = CreateFileA(createInfo.Filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_FileHandle == INVALID_HANDLE_VALUE)
+		{
+			VL_CORE_WARN("Failed to open file for mapping: {}", createInfo.Filepath);
+			Reset();
+			return;
+		}
+
+		LARGE_INTEGER size{};
+		GetFileSizeEx(m_FileHandle, &size);
+		m_Size = (uint64_t)size.QuadPart;
+
+		m_MappingHandle = m_Size != 0 ? CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		m_Data = m_MappingHandle != nullptr ? (const uint8_t*)MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (m_Data == nullptr)
+		{
+			VL_CORE_WARN("Failed to map file: {}", createInfo.Filepath);
+			if (m_MappingHandle != nullptr)
+				CloseHandle(m_MappingHandle);
+			CloseHandle(m_FileHandle);
+			Reset();
+			return;
+		}
+#else
+		m_FileDescriptor = open(createInfo.Filepath.c_str(), O_RDONLY);
+		if (m_FileDescriptor == -1)
+		{
+			VL_CORE_WARN("Failed to open file for mapping: {}", createInfo.Filepath);
+			Reset();
+			return;
+		}
+
+		struct stat fileStat{};
+		fstat(m_FileDescriptor, &fileStat);
+		m_Size = (uint64_t)fileStat.st_size;
+
+		void* data = m_Size != 0 ? mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) : MAP_FAILED;
+		if (data == MAP_FAILED)
+		{
+			VL_CORE_WARN("Failed to map file: {}", createInfo.Filepath);
+			close(m_FileDescriptor);
+			Reset();
+			return;
+		}
+		m_Data = (const uint8_t*)data;
+#endif
+
+		m_Initialized = true;
+	}
+
+	void MappedFile::Destroy()
+	{
+		if (!m_Initialized)
+			return;
+
+#ifdef WIN
+		UnmapViewOfFile(m_Data);
+		CloseHandle(m_MappingHandle);
+		CloseHandle(m_FileHandle);
+#else
+		munmap((void*)m_Data, m_Size);
+		close(m_FileDescriptor);
+#endif
+
+		Reset();
+	}
+
+	MappedFile::MappedFile(const CreateInfo& createInfo)
+	{
+		Init(createInfo);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Destroy();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		m_Data = other.m_Data;
+		m_Size = other.m_Size;
+#ifdef WIN
+		m_FileHandle = other.m_FileHandle;
+		m_MappingHandle = other.m_MappingHandle;
+#else
+		m_FileDescriptor = other.m_FileDescriptor;
+#endif
+		m_Initialized = other.m_Initialized;
+
+		other.Reset();
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (m_Initialized)
+			Destroy();
+
+		m_Data = other.m_Data;
+		m_Size = other.m_Size;
+#ifdef WIN
+		m_FileHandle = other.m_FileHandle;
+		m_MappingHandle = other.m_MappingHandle;
+#else
+		m_FileDescriptor = other.m_FileDescriptor;
+#endif
+		m_Initialized = other.m_Initialized;
+
+		other.Reset();
+
+		return *this;
+	}
+
+	void MappedFile::Reset()
+	{
+		m_Data = nullptr;
+		m_Size = 0;
+#ifdef WIN
+		m_FileHandle = INVALID_HANDLE_VALUE;
+		m_MappingHandle = nullptr;
+#else
+		m_FileDescriptor = -1;
+#endif
+		m_Initialized = false;
+	}
+
+}
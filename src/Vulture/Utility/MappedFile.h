@@ -0,0 +1,48 @@
+#pragma once
+#include "pch.h"
+
+namespace Vulture
+{
+	// Read only memory mapped file. Pages are loaded by the OS on first access, so only parts
+	// of the file that are actually read ever hit the disk.
+	class MappedFile
+	{
+	public:
+		struct CreateInfo
+		{
+			std::string Filepath = "";
+		};
+
+		void Init(const CreateInfo& createInfo);
+		void Destroy();
+
+		MappedFile() = default;
+		explicit MappedFile(const CreateInfo& createInfo);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		inline const uint8_t* GetData() const { return m_Data; }
+		inline uint64_t GetSize() const { return m_Size; }
+		inline bool IsInitialized() const { return m_Initialized; }
+
+	private:
+		const uint8_t* m_Data = nullptr;
+		uint64_t m_Size = 0;
+
+#ifdef WIN
+		HANDLE m_FileHandle = INVALID_HANDLE_VALUE;
+		HANDLE m_MappingHandle = nullptr;
+#else
+		int m_FileDescriptor = -1;
+#endif
+
+		bool m_Initialized = false;
+
+		void Reset();
+	};
+
+}
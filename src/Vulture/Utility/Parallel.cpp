@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "Parallel.h"
+
+#include "Asset/AssetManager.h"
+
+#include <mutex>
+#include <condition_variable>
+
+namespace Vulture
+{
+	namespace Parallel
+	{
+		// Shared with the helper tasks, which can start after RunBatches returned and have to find nothing left to claim
+		struct BatchState
+		{
+			std::mutex Mutex;
+			std::condition_variable DoneCV;
+			uint32_t NextBatch = 0;
+			uint32_t BatchCount = 0;
+			uint32_t PendingBatches = 0;
+			const std::function<void(uint32_t)>* Fn = nullptr; // Only valid while a batch is left to claim
+		};
+
+		/**
+		 * @brief Runs batches until none are left to claim.
+		 */
+		static void ClaimBatches(BatchState& state)
+		{
+			std::unique_lock<std::mutex> lock(state.Mutex);
+			while (state.NextBatch < state.BatchCount)
+			{
+				const uint32_t batch = state.NextBatch++;
+				lock.unlock();
+
+				(*state.Fn)(batch);
+
+				lock.lock();
+				if (--state.PendingBatches == 0)
+					state.DoneCV.notify_all();
+			}
+		}
+
+		void RunBatches(uint32_t batchCount, const std::function<void(uint32_t batch)>& fn)
+		{
+			ThreadPool& pool = AssetManager::GetThreadPool();
+			if (!pool.IsInitialized() || pool.GetThreadCount() == 0)
+			{
+				std::vector<std::thread> threads;
+				threads.reserve(batchCount - 1);
+				for (uint32_t i = 1; i < batchCount; i++)
+					threads.emplace_back([&fn, i]() { fn(i); });
+
+				fn(0);
+
+				for (auto& thread : threads)
+				{
+					thread.join();
+				}
+
+				return;
+			}
+
+			std::shared_ptr<BatchState> state = std::make_shared<BatchState>();
+			state->BatchCount = batchCount;
+			state->PendingBatches = batchCount;
+			state->Fn = &fn;
+
+			const uint32_t helperCount = std::min(batchCount - 1, pool.GetThreadCount());
+			for (uint32_t i = 0; i < helperCount; i++)
+				pool.PushTask([state]() { ClaimBatches(*state); });
+
+			ClaimBatches(*state);
+
+			// Only batches helpers already claimed are waited for
+			std::unique_lock<std::mutex> lock(state->Mutex);
+			state->DoneCV.wait(lock, [&state] { return state->PendingBatches == 0; });
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "pch.h"
+
+#include <thread>
+
+namespace Vulture
+{
+	namespace Parallel
+	{
+		/**
+		 * @brief Returns how many batches Parallel::For will split the range into. Use it to size
+		 * per batch scratch arrays (partial sums, counters etc.) before calling Parallel::For.
+		 *
+		 * @param count - Number of elements in the range.
+		 * @param minBatchSize - Minimal number of elements processed by a single thread.
+		 */
+		inline uint32_t GetBatchCount(uint64_t count, uint64_t minBatchSize)
+		{
+			if (count == 0)
+				return 0;
+
+			const uint64_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+			const uint64_t maxBatches = (count + std::max(minBatchSize, (uint64_t)1) - 1) / std::max(minBatchSize, (uint64_t)1);
+
+			return (uint32_t)std::min(hardwareThreads, maxBatches);
+		}
+
+		// Runs fn(batch) for every batch in [0, batchCount), see Parallel::For
+		void RunBatches(uint32_t batchCount, const std::function<void(uint32_t batch)>& fn);
+
+		/**
+		 * @brief Splits [0, count) into contiguous batches and runs fn(begin, end, batchIndex) on each of them
+		 * concurrently. Batches are always in ascending order, so batch i covers lower indices than batch i + 1.
+		 *
+		 * @note Batches run on the AssetManager thread pool. They're claimed one by one by the calling thread and by
+		 * helper tasks pushed to the pool, and the calling thread runs every batch nobody else claimed. It only waits
+		 * for batches that are already running, so calling it from inside pool tasks can't deadlock the pool. Falls
+		 * back to temporary threads when the pool isn't initialized.
+		 *
+		 * @param count - Number of elements in the range.
+		 * @param minBatchSize - Minimal number of elements processed by a single thread.
+		 * @param fn - Callable with signature void(uint64_t begin, uint64_t end, uint32_t batchIndex).
+		 */
+		template<typename Fn>
+		void For(uint64_t count, uint64_t minBatchSize, Fn&& fn)
+		{
+			const uint32_t batchCount = GetBatchCount(count, minBatchSize);
+			if (batchCount == 0)
+				return;
+
+			if (batchCount == 1)
+			{
+				fn((uint64_t)0, count, 0u);
+				return;
+			}
+
+			const uint64_t batchSize = (count + batchCount - 1) / batchCount;
+			RunBatches(batchCount, [&fn, count, batchSize](uint32_t batch)
+			{
+				const uint64_t begin = std::min(count, batchSize * batch);
+				const uint64_t end = std::min(count, begin + batchSize);
+				fn(begin, end, batch);
+			});
+		}
+	}
+}
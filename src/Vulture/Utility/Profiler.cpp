@@ -0,0 +1,335 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#include "Logger.h"
+
+#ifndef DISTRIBUTION
+namespace Vulture
+{
+	thread_local Profiler::ThreadHandle Profiler::s_ThreadHandle;
+
+	/**
+	 * @brief Starts recording events on every thread. Events that started before this call are left out of the trace.
+	 */
+	void Profiler::BeginSession()
+	{
+		std::unique_lock<std::mutex> lock(s_SessionMutex);
+		if (s_Active.load(std::memory_order_relaxed))
+		{
+			VL_CORE_WARN("Profiler session is already running!");
+			return;
+		}
+
+		s_SessionStartNs = GetTimeNs();
+
+		// Threads reset their buffers the first time they see the new id
+		s_SessionID.fetch_add(1, std::memory_order_release);
+		s_Active.store(true, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Stops recording and writes everything recorded during the session into a JSON file in the
+	 * Chrome trace event format.
+	 *
+	 * @param path - Path of the output file.
+	 */
+	void Profiler::EndSession(const std::string& path)
+	{
+		std::unique_lock<std::mutex> lock(s_SessionMutex);
+		if (!s_Active.load(std::memory_order_relaxed))
+		{
+			VL_CORE_WARN("Profiler session is not running!");
+			return;
+		}
+
+		s_Active.store(false, std::memory_order_release);
+		s_CaptureFramesLeft.store(0, std::memory_order_relaxed);
+
+		WriteTrace(path, s_SessionID.load(std::memory_order_relaxed), s_SessionStartNs);
+	}
+
+	/**
+	 * @brief Starts a session that ends by itself after the given number of frame markers.
+	 *
+	 * @param frameCount - Number of VL_PROFILE_FRAME calls to record.
+	 * @param path - Path the trace is written to once the last frame ends.
+	 */
+	void Profiler::CaptureFrames(uint32_t frameCount, const std::string& path)
+	{
+		if (frameCount == 0)
+			return;
+
+		BeginSession();
+
+		std::unique_lock<std::mutex> lock(s_SessionMutex);
+		s_CapturePath = path;
+		s_CaptureFramesLeft.store((int32_t)frameCount, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Records a scope that ran on the calling thread. Times come from GetTimeNs().
+	 */
+	void Profiler::RecordScope(const char* name, int64_t startNs, int64_t endNs)
+	{
+		if (!IsActive())
+			return;
+
+		Push({ name, startNs, endNs - startNs, 0.0, EventType::Scope });
+	}
+
+	/**
+	 * @brief Marks the end of a frame. Ends the session if it was started with CaptureFrames and this was its last frame.
+	 */
+	void Profiler::MarkFrame(const char* name)
+	{
+		if (!IsActive())
+			return;
+
+		Push({ name, GetTimeNs(), 0, 0.0, EventType::Frame });
+
+		if (s_CaptureFramesLeft.load(std::memory_order_relaxed) > 0 && s_CaptureFramesLeft.fetch_sub(1, std::memory_order_relaxed) == 1)
+		{
+			std::unique_lock<std::mutex> lock(s_SessionMutex);
+			std::string path = s_CapturePath;
+			lock.unlock();
+
+			EndSession(path);
+		}
+	}
+
+	void Profiler::RecordCounter(const char* name, double value)
+	{
+		if (!IsActive())
+			return;
+
+		Push({ name, GetTimeNs(), 0, value, EventType::Counter });
+	}
+
+	/**
+	 * @brief Names the calling thread in the trace, unlike event names the string is copied.
+	 */
+	void Profiler::SetThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		std::unique_lock<std::mutex> lock(s_BuffersMutex);
+		buffer.ThreadName = name;
+	}
+
+	int64_t Profiler::GetTimeNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	Profiler::ThreadBuffer::~ThreadBuffer()
+	{
+		for (std::atomic<EventChunk*>& chunk : Chunks)
+			delete chunk.load(std::memory_order_relaxed);
+	}
+
+	Profiler::ThreadHandle::~ThreadHandle()
+	{
+		if (Buffer != nullptr)
+			Buffer->Retired.store(true, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Returns the buffer of the calling thread, the lock is only taken the first time a thread calls it.
+	 */
+	Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+	{
+		if (s_ThreadHandle.Buffer != nullptr)
+			return *s_ThreadHandle.Buffer;
+
+		std::unique_lock<std::mutex> lock(s_BuffersMutex);
+
+		// Buffers of exited threads are reused once their events are no longer part of the current session,
+		// otherwise short lived threads would keep allocating new ones
+		const uint64_t sessionID = s_SessionID.load(std::memory_order_relaxed);
+		for (std::unique_ptr<ThreadBuffer>& buffer : s_Buffers)
+		{
+			if (buffer->Retired.load(std::memory_order_acquire) && buffer->SessionID.load(std::memory_order_relaxed) != sessionID)
+			{
+				buffer->Retired.store(false, std::memory_order_relaxed);
+				buffer->ThreadName.clear();
+				s_ThreadHandle.Buffer = buffer.get();
+				return *buffer;
+			}
+		}
+
+		s_Buffers.push_back(std::make_unique<ThreadBuffer>());
+		s_Buffers.back()->ThreadID = (uint32_t)s_Buffers.size();
+		s_ThreadHandle.Buffer = s_Buffers.back().get();
+		return *s_ThreadHandle.Buffer;
+	}
+
+	void Profiler::Push(const Event& event)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		const uint64_t sessionID = s_SessionID.load(std::memory_order_acquire);
+		if (buffer.SessionID.load(std::memory_order_relaxed) != sessionID)
+		{
+			// Nothing reads the buffer while its id is stale, so it can be reset without any synchronization
+			const uint32_t usedChunks = buffer.UsedChunks.load(std::memory_order_relaxed);
+			for (uint32_t i = 0; i < usedChunks; i++)
+				buffer.Chunks[i].load(std::memory_order_relaxed)->Count.store(0, std::memory_order_relaxed);
+
+			buffer.UsedChunks.store(0, std::memory_order_relaxed);
+			buffer.DroppedEvents.store(0, std::memory_order_relaxed);
+			buffer.SessionID.store(sessionID, std::memory_order_release);
+		}
+
+		const uint32_t usedChunks = buffer.UsedChunks.load(std::memory_order_relaxed);
+		EventChunk* chunk = usedChunks > 0 ? buffer.Chunks[usedChunks - 1].load(std::memory_order_relaxed) : nullptr;
+		if (chunk == nullptr || chunk->Count.load(std::memory_order_relaxed) == s_EventsPerChunk)
+		{
+			if (usedChunks == s_MaxChunks)
+			{
+				buffer.DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			// Chunks stay allocated between sessions
+			chunk = buffer.Chunks[usedChunks].load(std::memory_order_relaxed);
+			if (chunk == nullptr)
+			{
+				chunk = new EventChunk();
+				buffer.Chunks[usedChunks].store(chunk, std::memory_order_release);
+			}
+
+			chunk->Count.store(0, std::memory_order_relaxed);
+			buffer.UsedChunks.store(usedChunks + 1, std::memory_order_release);
+		}
+
+		const uint32_t count = chunk->Count.load(std::memory_order_relaxed);
+		chunk->Events[count] = event;
+		chunk->Count.store(count + 1, std::memory_order_release);
+	}
+
+	static void AppendEscaped(std::string& out, const char* str)
+	{
+		for (; *str != '\0'; str++)
+		{
+			const char c = *str;
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+				out += escaped;
+			}
+			else
+			{
+				out += c;
+			}
+		}
+	}
+
+	/**
+	 * @brief Serializes the events of every buffer that belongs to the session. Threads may still be pushing events
+	 * that raced with the end of the session, only the ones they already published are read.
+	 */
+	void Profiler::WriteTrace(const std::string& path, uint64_t sessionID, int64_t sessionStartNs)
+	{
+		std::string json;
+		json.reserve(1024 * 1024);
+		json += "{\"traceEvents\":[";
+
+		bool first = true;
+		char number[64];
+		auto beginEvent = [&](const char* name, const char* phase, uint32_t threadID)
+			{
+				json += first ? "\n" : ",\n";
+				first = false;
+
+				json += "{\"name\":\"";
+				AppendEscaped(json, name);
+				snprintf(number, sizeof(number), "\",\"ph\":\"%s\",\"pid\":1,\"tid\":%u", phase, threadID);
+				json += number;
+			};
+		auto appendMicroseconds = [&](const char* key, int64_t ns)
+			{
+				snprintf(number, sizeof(number), ",\"%s\":%.3f", key, (double)ns / 1000.0);
+				json += number;
+			};
+
+		uint64_t eventCount = 0;
+		uint64_t droppedCount = 0;
+
+		std::unique_lock<std::mutex> lock(s_BuffersMutex);
+		for (std::unique_ptr<ThreadBuffer>& buffer : s_Buffers)
+		{
+			const bool inSession = buffer->SessionID.load(std::memory_order_acquire) == sessionID;
+			if (!buffer->ThreadName.empty() && (inSession || !buffer->Retired.load(std::memory_order_relaxed)))
+			{
+				beginEvent("thread_name", "M", buffer->ThreadID);
+				json += ",\"args\":{\"name\":\"";
+				AppendEscaped(json, buffer->ThreadName.c_str());
+				json += "\"}}";
+			}
+
+			if (!inSession)
+				continue;
+
+			droppedCount += buffer->DroppedEvents.load(std::memory_order_relaxed);
+
+			const uint32_t usedChunks = buffer->UsedChunks.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < usedChunks; i++)
+			{
+				const EventChunk* chunk = buffer->Chunks[i].load(std::memory_order_acquire);
+				const uint32_t count = chunk->Count.load(std::memory_order_acquire);
+				for (uint32_t j = 0; j < count; j++)
+				{
+					const Event& event = chunk->Events[j];
+					if (event.StartNs < sessionStartNs)
+						continue;
+
+					switch (event.Type)
+					{
+					case EventType::Scope:
+						beginEvent(event.Name, "X", buffer->ThreadID);
+						appendMicroseconds("ts", event.StartNs - sessionStartNs);
+						appendMicroseconds("dur", event.DurationNs);
+						json += "}";
+						break;
+					case EventType::Frame:
+						beginEvent(event.Name, "i", buffer->ThreadID);
+						appendMicroseconds("ts", event.StartNs - sessionStartNs);
+						json += ",\"s\":\"g\"}";
+						break;
+					case EventType::Counter:
+						beginEvent(event.Name, "C", buffer->ThreadID);
+						appendMicroseconds("ts", event.StartNs - sessionStartNs);
+						snprintf(number, sizeof(number), ",\"args\":{\"value\":%.17g}}", event.Value);
+						json += number;
+						break;
+					}
+
+					eventCount++;
+				}
+			}
+		}
+		lock.unlock();
+
+		json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			VL_CORE_ERROR("Failed to open profiler output file {}", path);
+			return;
+		}
+		file.write(json.data(), json.size());
+
+		VL_CORE_INFO("Wrote {} profiler events to {}", eventCount, path);
+		if (droppedCount > 0)
+			VL_CORE_WARN("Profiler dropped {} events, the thread buffers were full", droppedCount);
+	}
+
+}
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+namespace Vulture
+{
+#ifndef DISTRIBUTION
+	// Records CPU scopes, frame markers and counters into per-thread buffers and exports them as a Chrome trace,
+	// which can be opened in chrome://tracing or ui.perfetto.dev. Recording only happens between BeginSession and
+	// EndSession, outside of a session a scope costs one relaxed atomic load.
+	//
+	// Every thread appends to its own buffer without any locks, the buffers are only read once the session ends.
+	// Names are stored as pointers, so they have to outlive the session, string literals are the intended use.
+	class Profiler
+	{
+	public:
+		static void BeginSession();
+		static void EndSession(const std::string& path);
+		static void CaptureFrames(uint32_t frameCount, const std::string& path);
+
+		static void RecordScope(const char* name, int64_t startNs, int64_t endNs);
+		static void MarkFrame(const char* name);
+		static void RecordCounter(const char* name, double value);
+		static void SetThreadName(const std::string& name);
+
+		static int64_t GetTimeNs();
+		static inline bool IsActive() { return s_Active.load(std::memory_order_relaxed); }
+
+		Profiler() = delete;
+		~Profiler() = delete;
+
+	private:
+		enum class EventType : uint8_t
+		{
+			Scope,
+			Frame,
+			Counter
+		};
+
+		struct Event
+		{
+			const char* Name;
+			int64_t StartNs;
+			int64_t DurationNs;
+			double Value;
+			EventType Type;
+		};
+
+		static constexpr uint32_t s_EventsPerChunk = 4096;
+		static constexpr uint32_t s_MaxChunks = 256;
+
+		struct EventChunk
+		{
+			Event Events[s_EventsPerChunk];
+			std::atomic<uint32_t> Count = 0; // Events visible to the reader
+		};
+
+		// Written only by the owning thread, read by EndSession after the writes were published by the release stores
+		struct ThreadBuffer
+		{
+			~ThreadBuffer();
+
+			std::atomic<EventChunk*> Chunks[s_MaxChunks] = {};
+			std::atomic<uint32_t> UsedChunks = 0;
+			std::atomic<uint64_t> SessionID = 0; // Session the events belong to
+			std::atomic<uint64_t> DroppedEvents = 0;
+			std::atomic<bool> Retired = false; // The thread exited, the buffer can be handed to a new one
+			std::string ThreadName; // Guarded by s_BuffersMutex
+			uint32_t ThreadID = 0;
+		};
+
+		// Retires the buffer when its thread exits
+		struct ThreadHandle
+		{
+			~ThreadHandle();
+			ThreadBuffer* Buffer = nullptr;
+		};
+
+		static ThreadBuffer& GetThreadBuffer();
+		static void Push(const Event& event);
+		static void WriteTrace(const std::string& path, uint64_t sessionID, int64_t sessionStartNs);
+
+		inline static std::atomic<bool> s_Active = false;
+		inline static std::atomic<uint64_t> s_SessionID = 0;
+		inline static int64_t s_SessionStartNs = 0;
+		inline static std::mutex s_SessionMutex;
+
+		inline static std::atomic<int32_t> s_CaptureFramesLeft = 0;
+		inline static std::string s_CapturePath;
+
+		inline static std::mutex s_BuffersMutex;
+		inline static std::vector<std::unique_ptr<ThreadBuffer>> s_Buffers;
+		static thread_local ThreadHandle s_ThreadHandle;
+	};
+
+	// Records the time between its construction and destruction
+	class ProfileScope
+	{
+	public:
+		ProfileScope(const char* name) : m_Name(name), m_StartNs(Profiler::IsActive() ? Profiler::GetTimeNs() : -1) {}
+		~ProfileScope()
+		{
+			if (m_StartNs >= 0)
+				Profiler::RecordScope(m_Name, m_StartNs, Profiler::GetTimeNs());
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* m_Name;
+		int64_t m_StartNs;
+	};
+#endif
+}
+
+#define VL_PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define VL_PROFILE_CONCAT(a, b) VL_PROFILE_CONCAT_INTERNAL(a, b)
+
+#ifdef DISTRIBUTION
+#define VL_PROFILE_BEGIN_SESSION()
+#define VL_PROFILE_END_SESSION(path)
+#define VL_PROFILE_CAPTURE_FRAMES(count, path)
+#define VL_PROFILE_SCOPE(name)
+#define VL_PROFILE_FUNCTION()
+#define VL_PROFILE_FRAME(name)
+#define VL_PROFILE_COUNTER(name, value)
+#define VL_PROFILE_THREAD(name)
+#else
+#define VL_PROFILE_BEGIN_SESSION()				::Vulture::Profiler::BeginSession()
+#define VL_PROFILE_END_SESSION(path)			::Vulture::Profiler::EndSession(path)
+#define VL_PROFILE_CAPTURE_FRAMES(count, path)	::Vulture::Profiler::CaptureFrames(count, path)
+#define VL_PROFILE_SCOPE(name)					::Vulture::ProfileScope VL_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define VL_PROFILE_FUNCTION()					VL_PROFILE_SCOPE(__FUNCTION__)
+#define VL_PROFILE_FRAME(name)					::Vulture::Profiler::MarkFrame(name)
+#define VL_PROFILE_COUNTER(name, value)			::Vulture::Profiler::RecordCounter(name, (double)(value))
+#define VL_PROFILE_THREAD(name)					::Vulture::Profiler::SetThreadName(name)
+#endif
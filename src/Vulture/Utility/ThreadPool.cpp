@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "ThreadPool.h"
+#include "Profiler.h"
 #include "Vulkan/Device.h"
 
 namespace Vulture
@@ -30,7 +31,8 @@ namespace Vulture
 	{
 		for (uint32_t i = 0; i < createInfo.threadCount; i++)
 		{
-			m_WorkerThreads.emplace_back([this] {
+			m_WorkerThreads.emplace_back([this, i] {
+				VL_PROFILE_THREAD("Worker " + std::to_string(i));
 				Device::CreateCommandPoolForThread();
 				while (true)
 				{
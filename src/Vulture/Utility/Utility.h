@@ -7,4 +7,8 @@
 #include "File.h"
 #include "ThreadPool.h"
 #include "FunctionQueue.h"
-#include "Bytes.h"
\ No newline at end of file
+#include "Bytes.h"
+#include "Parallel.h"
+#include "MappedFile.h"
+#include "ImageEncoder.h"
+#include "Profiler.h"
\ No newline at end of file